@@ -79,6 +79,10 @@ int WINAPI _tWinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCmd
 	if (!load_result) // LoadFromFile() relies upon us to do this check.  No script was loaded or we're in /iLib mode, so nothing more to do.
 		return 0;
 
+	// Anything allocated from SimpleHeap from here on is due to code being executed (dynamic vars,
+	// Hotkey(), Hotstring(), etc.), so account for it separately from what was allocated by loading.
+	SimpleHeap::SetArena(&SimpleHeap::sRuntime);
+
 	switch (CheckPriorInstance())
 	{
 	case EARLY_EXIT: return 0;
@@ -139,6 +143,10 @@ ResultType ParseCmdLineArgs(LPTSTR &script_filespec)
 		}
 		else if (!_tcsicmp(param, _T("/validate")))
 			g_script.mValidateThenExit = true;
+		else if (!_tcsicmp(param, _T("/ProfileLoad")))
+			g_script.mProfileLoad = true;
+		else if (!_tcsicmp(param, _T("/DumpPostfix")))
+			g_script.mDumpPostfix = true;
 		// DEPRECATED: /iLib
 		else if (!_tcsicmp(param, _T("/iLib"))) // v1.0.47: Build an include-file so that ahk2exe can include library functions called by the script.
 		{
@@ -0,0 +1,67 @@
+#pragma once
+
+//
+// CharSet, for util.h.  It is kept separate so that tests/unit can build it; includers must define
+// TBYTE and _tcschr().
+//
+
+// A set of characters, such as a list of delimiters or omitted characters, for repeated membership
+// tests.  ASCII characters are tested via a bitmap, so the cost per character doesn't depend on the
+// length of the list; any other characters are looked up in the list itself.  aList must remain
+// valid for the lifetime of the CharSet.
+class CharSet
+{
+	UINT mAscii[128 / 32];
+	LPCTSTR mList;
+	bool mHasNonAscii;
+
+public:
+	CharSet(LPCTSTR aList) : mList(aList), mHasNonAscii(false)
+	{
+		mAscii[0] = mAscii[1] = mAscii[2] = mAscii[3] = 0;
+		for (LPCTSTR cp = aList; *cp; ++cp)
+		{
+			TBYTE c = (TBYTE)*cp;
+			if (c < 128)
+				mAscii[c >> 5] |= 1U << (c & 31);
+			else
+				mHasNonAscii = true;
+		}
+	}
+
+	bool Contains(TCHAR aChar) const
+	{
+		TBYTE c = (TBYTE)aChar;
+		if (c < 128)
+			return ((mAscii[c >> 5] >> (c & 31)) & 1) != 0; // Never true for '\0'.
+		return mHasNonAscii && _tcschr(mList, aChar);
+	}
+
+	// Same as StrChrAny(aStr, aList).  A single character is located with _tcschr(), which is
+	// typically much faster than testing one character at a time.
+	template<typename T>
+	T Find(T aStr) const
+	{
+		if (*mList && !mList[1])
+			return (T)_tcschr(aStr, *mList);
+		for (; *aStr; ++aStr)
+			if (Contains(*aStr))
+				return aStr;
+		return NULL;
+	}
+};
+
+// Same as omit_leading_any() and omit_trailing_any() in util.h, but for a CharSet.
+template<typename T>
+inline T omit_leading_any(T aBuf, const CharSet &aOmit, size_t aLength)
+{
+	for (T end = aBuf + aLength; aBuf < end && aOmit.Contains(*aBuf); ++aBuf);
+	return aBuf;
+}
+
+template<typename T>
+inline size_t omit_trailing_any(T aBuf, const CharSet &aOmit, T aBuf_marker)
+{
+	for (; aBuf_marker > aBuf && aOmit.Contains(*aBuf_marker); --aBuf_marker);
+	return aBuf_marker - aBuf + !aOmit.Contains(*aBuf_marker);
+}
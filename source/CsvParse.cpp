@@ -0,0 +1,64 @@
+#include "stdafx.h" // pre-compiled headers
+#include "CsvParse.h"
+
+
+
+static inline LPTSTR FindDelimiter(LPTSTR aStr, bool aRows)
+// Returns the position of the next comma (or if aRows, newline) in aStr, or of its terminator.
+{
+	if (!aRows)
+	{
+		LPTSTR cp = _tcschr(aStr, ',');
+		return cp ? cp : aStr + _tcslen(aStr);
+	}
+	// A simple loop is faster than _tcscspn() for this, since fields are usually short.
+	for (; *aStr && *aStr != ',' && *aStr != '\n'; ++aStr);
+	return aStr;
+}
+
+
+
+LPTSTR CsvParseField(LPTSTR aField, LPTSTR &aValue, LPTSTR &aValueEnd, bool aRows)
+{
+	LPTSTR field_end, value_end;
+	if (*aField == '"')
+	{
+		// The leading double-quote is skipped since it always marks the beginning of the field.
+		// This assumes that a field containing escaped double-quote is always contained in double
+		// quotes, which is how Excel does it.  For example: """string with escaped quotes"""
+		// resolves to a literal quoted string.  Each pair of quotes is replaced with a single
+		// literal quote by copying the field's contents back over itself as the search proceeds,
+		// so value_end trails the search position by the number of pairs found so far.  This
+		// avoids moving the remainder of the buffer for each pair.
+		aValue = value_end = ++aField;
+		for (LPTSTR cp = aField;;)
+		{
+			if (   !(field_end = _tcschr(cp, '"'))   )
+				field_end = cp + _tcslen(cp); // No ending quote, so the field extends to the end of the string.
+			else if (field_end[1] == '"') // A pair of quotes was encountered.
+			{
+				// Include a single literal double quote and keep looking for the "real" ending quote.
+				++field_end;
+				if (value_end != cp)
+					tmemmove(value_end, cp, field_end - cp);
+				value_end += field_end - cp;
+				cp = field_end + 1;
+				continue;
+			}
+			// Otherwise, field_end is the ending quote or the terminator.
+			if (value_end != cp)
+				tmemmove(value_end, cp, field_end - cp);
+			value_end += field_end - cp;
+			break;
+		}
+		aValueEnd = value_end;
+		if (!*field_end)
+			return field_end;
+		return FindDelimiter(field_end + 1, aRows); // Skip anything between the ending quote and the next delimiter.
+	}
+	// The field is not enclosed in quotes, so the next delimiter (if any) ends it.
+	aValue = aField;
+	field_end = FindDelimiter(aField, aRows);
+	aValueEnd = aRows && *field_end == '\n' && field_end > aField && field_end[-1] == '\r' ? field_end - 1 : field_end;
+	return field_end;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+//
+// CsvParse - Splits comma-separated values into fields, for Loop Parse CSV and CSVParse().
+//
+// A field which begins with a double quote extends to the next quote which isn't one of a pair,
+// and each pair of quotes within it stands for one literal quote.  Anything between that ending
+// quote and the next delimiter is ignored.  Any other field extends to the next delimiter.
+// Fields are parsed in place: pairs of quotes are collapsed by copying the rest of the field back
+// over itself, so a field's value never extends past the end of its source text.
+//
+
+// Parses the field which begins at aField, which must be writable and null-terminated.  aValue
+// and aValueEnd receive the bounds of the field's value, which the caller may terminate at
+// aValueEnd.  Returns the position of the character which ended the field: a comma or the
+// terminator, or if aRows is true, a newline (`n).  With aRows, a field which isn't enclosed in
+// quotes also excludes any `r preceding the newline, and a quoted field can contain newlines.
+LPTSTR CsvParseField(LPTSTR aField, LPTSTR &aValue, LPTSTR &aValueEnd, bool aRows);
@@ -0,0 +1,506 @@
+#include "stdafx.h" // pre-compiled headers
+#include "defines.h"
+#include "globaldata.h"
+#include "script.h"
+#include "script_object.h"
+#include "CycleCollector.h"
+
+#include <typeinfo>
+
+
+Object **CycleCollector::sRoot = nullptr;
+UINT CycleCollector::sRootCount = 0, CycleCollector::sRootCapacity = 0;
+bool CycleCollector::sCollecting = false;
+bool CycleCollector::sDue = false;
+UINT CycleCollector::sThreshold = 0;
+UINT CycleCollector::sCollections = 0;
+UINT CycleCollector::sLastFreed = 0;
+__int64 CycleCollector::sTotalFreed = 0;
+__int64 CycleCollector::sLastTime = 0, CycleCollector::sMaxTime = 0, CycleCollector::sTotalTime = 0;
+
+
+bool CycleCollector::GrowRoots()
+{
+	UINT new_capacity = sRootCapacity ? sRootCapacity * 2 : 512;
+	auto new_root = (Object **)calloc(new_capacity, sizeof(Object *));
+	if (!new_root)
+		return false;
+	auto old_root = sRoot;
+	UINT old_capacity = sRootCapacity;
+	sRoot = new_root;
+	sRootCapacity = new_capacity;
+	for (UINT i = 0; i < old_capacity; ++i)
+	{
+		if (!old_root[i])
+			continue;
+		UINT j = Slot(old_root[i]);
+		while (sRoot[j])
+			j = (j + 1) & (sRootCapacity - 1);
+		sRoot[j] = old_root[i];
+	}
+	free(old_root);
+	return true;
+}
+
+
+void CycleCollector::AddRoot(Object *aObj)
+{
+	if (sCollecting)
+		return; // Releases made while breaking cycles can't create new garbage cycles.
+	if ((sRootCount + 1) * 2 > sRootCapacity && !GrowRoots())
+		return; // Leave it unbuffered; at worst, a cycle is leaked as it would be without the collector.
+	UINT i = Slot(aObj);
+	while (sRoot[i])
+		i = (i + 1) & (sRootCapacity - 1);
+	sRoot[i] = aObj;
+	aObj->mFlags |= Object::PossibleCycleRoot;
+	if (++sRootCount >= sThreshold)
+		sDue = true;
+}
+
+
+void CycleCollector::RemoveRoot(Object *aObj)
+// Called by ~Object() for an object which is still in the buffer.  Most candidates are temporary
+// references which are released shortly after being buffered, so this must not scan the buffer.
+{
+	aObj->mFlags &= ~Object::PossibleCycleRoot;
+	UINT mask = sRootCapacity - 1, i = Slot(aObj);
+	while (sRoot[i] != aObj)
+	{
+		if (!sRoot[i])
+			return; // Not found; shouldn't happen.
+		i = (i + 1) & mask;
+	}
+	// Backward-shift deletion: move up any later entry of the same probe run which would no longer
+	// be found once slot i is empty, so that no tombstones are needed.
+	for (UINT j = i; ; )
+	{
+		j = (j + 1) & mask;
+		if (!sRoot[j])
+			break;
+		UINT k = Slot(sRoot[j]); // Home slot of the entry at j.
+		if (i <= j ? (k <= i || k > j) : (k <= i && k > j))
+		{
+			sRoot[i] = sRoot[j];
+			i = j;
+		}
+	}
+	sRoot[i] = nullptr;
+	--sRootCount;
+}
+
+
+void CycleCollector::SetThreshold(UINT aThreshold)
+{
+	sThreshold = aThreshold;
+	if (!aThreshold)
+	{
+		// Disabled: forget all roots so that memory isn't retained indefinitely.
+		for (UINT i = 0; i < sRootCapacity; ++i)
+			if (sRoot[i])
+				sRoot[i]->mFlags &= ~Object::PossibleCycleRoot;
+		free(sRoot);
+		sRoot = nullptr;
+		sRootCount = sRootCapacity = 0;
+	}
+	else if (sRootCount >= aThreshold)
+		sDue = true;
+}
+
+
+//
+// Graph of possible garbage, built during a collection.
+//
+
+enum CycleCollector::NodeKind : UCHAR
+{
+	NK_None, // Not traced; treated as external to the graph.
+	NK_Object,
+	NK_Array,
+	NK_Map,
+	NK_Closure,
+	NK_BoundFunc,
+	NK_FreeVars
+};
+
+struct CycleCollector::Node
+{
+	void *ptr;
+	ULONG refs; // Reference count minus references held by other nodes.
+	NodeKind kind;
+	bool live;
+};
+
+
+class CycleGraph
+{
+	typedef CycleCollector::Node Node;
+	typedef CycleCollector::NodeKind NodeKind;
+
+	Node *mNode = nullptr;
+	UINT mCount = 0, mCapacity = 0;
+	UINT *mTable = nullptr; // Open addressing hash table of mNode indices + 1.
+	UINT mTableSize = 0;
+
+	static UINT Hash(void *aPtr) { return CycleHash(aPtr); }
+
+	bool Rehash(UINT aNewSize)
+	{
+		auto table = (UINT *)calloc(aNewSize, sizeof(UINT));
+		if (!table)
+			return false;
+		for (UINT n = 0; n < mCount; ++n)
+		{
+			UINT i = Hash(mNode[n].ptr) & (aNewSize - 1);
+			while (table[i])
+				i = (i + 1) & (aNewSize - 1);
+			table[i] = n + 1;
+		}
+		free(mTable);
+		mTable = table;
+		mTableSize = aNewSize;
+		return true;
+	}
+
+public:
+	~CycleGraph()
+	{
+		free(mNode);
+		free(mTable);
+	}
+
+	UINT Count() { return mCount; }
+	Node &operator[](UINT aIndex) { return mNode[aIndex]; }
+
+	// Returns the index of the node for aPtr, or UINT_MAX if not found.
+	UINT Find(void *aPtr)
+	{
+		if (!mTableSize)
+			return UINT_MAX;
+		for (UINT i = Hash(aPtr) & (mTableSize - 1); mTable[i]; i = (i + 1) & (mTableSize - 1))
+			if (mNode[mTable[i] - 1].ptr == aPtr)
+				return mTable[i] - 1;
+		return UINT_MAX;
+	}
+
+	// Adds a node for aPtr if there isn't one already.  Returns false on failure.
+	bool Add(void *aPtr, NodeKind aKind, ULONG aRefCount)
+	{
+		if (Find(aPtr) != UINT_MAX)
+			return true;
+		if (mCount == mCapacity)
+		{
+			UINT new_capacity = mCapacity ? mCapacity * 2 : 64;
+			auto new_node = (Node *)realloc(mNode, new_capacity * sizeof(Node));
+			if (!new_node)
+				return false;
+			mNode = new_node;
+			mCapacity = new_capacity;
+		}
+		if ((mCount + 1) * 2 > mTableSize && !Rehash(mTableSize ? mTableSize * 2 : 128))
+			return false;
+		auto &node = mNode[mCount];
+		node.ptr = aPtr;
+		node.kind = aKind;
+		node.refs = aRefCount;
+		node.live = false;
+		UINT i = Hash(aPtr) & (mTableSize - 1);
+		while (mTable[i])
+			i = (i + 1) & (mTableSize - 1);
+		mTable[i] = ++mCount;
+		return true;
+	}
+};
+
+
+CycleCollector::NodeKind CycleCollector::KindOf(FreeVars *aVars)
+{
+	// Closures which are stored in the downvars of their own function are "grouped": their references
+	// from mVar[] aren't counted and their lifetime is managed by FreeVars::FullyReleased().  Such a
+	// FreeVars is left alone rather than trying to account for the uncounted references.
+	for (int i = 0; i < aVars->mVarCount; ++i)
+		if (aVars->mVar[i].IsDirectConstant())
+			return NK_None;
+	return NK_FreeVars;
+}
+
+
+CycleCollector::NodeKind CycleCollector::KindOf(IObject *aObj)
+{
+	auto obj = dynamic_cast<Object *>(aObj);
+	if (!obj)
+		return NK_None;
+	// Only exact types are traced, since a derived class could hold references we don't know about.
+	const std::type_info &type = typeid(*obj);
+	if (type == typeid(Object))
+		return NK_Object;
+	if (type == typeid(Array))
+		return NK_Array;
+	if (type == typeid(Map))
+		return NK_Map;
+	if (type == typeid(BoundFunc))
+		return NK_BoundFunc;
+	if (type == typeid(Closure))
+		return (obj->mFlags & Closure::ClosureGroupedFlag) ? NK_None : NK_Closure;
+	return NK_None;
+}
+
+
+// Calls aVisit(ptr, kind) for each counted reference held by the given node.
+template<typename Visitor>
+void CycleCollector::ForEachRef(Node &aNode, Visitor aVisit)
+{
+	auto visit_object = [&](IObject *aObj) {
+		if (aObj)
+			aVisit((void *)aObj, KindOf(aObj));
+	};
+	auto visit_variant = [&](Object::Variant &aValue) {
+		if (aValue.symbol == SYM_OBJECT)
+			visit_object(aValue.object);
+	};
+
+	if (aNode.kind == NK_FreeVars)
+	{
+		auto vars = (FreeVars *)aNode.ptr;
+		if (vars->mOuterVars)
+			aVisit(vars->mOuterVars, KindOf(vars->mOuterVars));
+		for (int i = 0; i < vars->mVarCount; ++i)
+		{
+			// Aliases and constants are excluded since their object references are either uncounted
+			// or belong to some other variable.
+			Var &var = vars->mVar[i];
+			if (!var.IsAlias() && !var.IsDirectConstant() && var.IsObject())
+				visit_object(var.Object());
+		}
+		return;
+	}
+
+	auto obj = (Object *)aNode.ptr;
+	visit_object(obj->mBase);
+	for (Object::index_t i = 0; i < obj->mFields.Length(); ++i)
+	{
+		auto &field = obj->mFields[i];
+		if (field.symbol == SYM_DYNAMIC)
+		{
+			visit_object(field.prop->Getter());
+			visit_object(field.prop->Setter());
+			visit_object(field.prop->Method());
+		}
+		else
+			visit_variant(field);
+	}
+
+	switch (aNode.kind)
+	{
+	case NK_Array:
+	{
+		auto arr = (Array *)obj;
+		for (Object::index_t i = 0; i < arr->mLength; ++i)
+			visit_variant(arr->mItem[i]);
+		break;
+	}
+	case NK_Map:
+	{
+		auto map = (Map *)obj;
+		for (Object::index_t i = 0; i < map->mCount; ++i)
+		{
+			visit_variant(map->mItem[i]);
+			if (i >= map->mKeyOffsetObject && i < map->mKeyOffsetString)
+				visit_object(map->mItem[i].key.p);
+		}
+		break;
+	}
+	case NK_Closure:
+	{
+		auto vars = ((Closure *)obj)->mVars;
+		aVisit(vars, KindOf(vars));
+		break;
+	}
+	case NK_BoundFunc:
+	{
+		auto bf = (BoundFunc *)obj;
+		visit_object(bf->mFunc);
+		visit_object(bf->mParams);
+		break;
+	}
+	}
+}
+
+
+ULONG CycleCollector::RefCountOf(void *aPtr, NodeKind aKind)
+{
+	if (aKind == NK_FreeVars)
+		return (ULONG)((FreeVars *)aPtr)->mRefCount;
+	return ((Object *)aPtr)->RefCount();
+}
+
+
+bool CycleCollector::MustKeep(Node &aNode)
+// Returns true if the node should be kept alive regardless of whether it is reachable.
+{
+	if (aNode.kind == NK_FreeVars)
+		return false;
+	auto obj = (Object *)aNode.ptr;
+	// Objects which define __Delete are left alone so that __Delete never observes an object which
+	// has been partially cleared.  Prototypes and structs with nested objects have special lifetime
+	// management which the collector doesn't attempt to emulate.
+	return (obj->mFlags & Object::ClassPrototype) || obj->mNested
+		|| obj->HasMethod(_T("__Delete"));
+}
+
+
+void CycleCollector::ClearRefs(Node &aNode)
+// Releases the references held by aNode which can safely be released without destroying the
+// node itself.  Closure::mVars and BoundFunc::mFunc are required until deletion, but any cycle
+// through them also passes through a FreeVars or Object which can be cleared.
+{
+	if (aNode.kind == NK_FreeVars)
+	{
+		auto vars = (FreeVars *)aNode.ptr;
+		for (int i = 0; i < vars->mVarCount; ++i)
+		{
+			Var &var = vars->mVar[i];
+			if (!var.IsAlias() && !var.IsDirectConstant() && var.IsObject())
+				var.Free(VAR_ALWAYS_FREE | VAR_REQUIRE_INIT);
+		}
+		return;
+	}
+	auto obj = (Object *)aNode.ptr;
+	obj->mFlags |= Object::NoCallDelete;
+	switch (aNode.kind)
+	{
+	case NK_Array: ((Array *)obj)->RemoveAt(0, ((Array *)obj)->mLength); break;
+	case NK_Map: ((Map *)obj)->Clear(); break;
+	case NK_BoundFunc: ((BoundFunc *)obj)->mParams->RemoveAt(0, ((BoundFunc *)obj)->mParams->mLength); break;
+	}
+	obj->mFields.Remove(0, obj->mFields.Length());
+	if (aNode.kind != NK_Closure && aNode.kind != NK_BoundFunc)
+		obj->SetBase(nullptr);
+}
+
+
+UINT CycleCollector::Collect()
+{
+	if (sCollecting)
+		return 0;
+	sDue = false;
+	if (!sRootCount)
+		return 0;
+	sCollecting = true;
+
+	LARGE_INTEGER start, end, freq;
+	QueryPerformanceCounter(&start);
+
+	CycleGraph graph;
+	UINT i, freed = 0;
+	bool ok = true;
+
+	// Take the roots out of the buffer.  Any that die during collection are no longer buffered,
+	// so ~Object() won't try to remove them.
+	for (i = 0; i < sRootCapacity; ++i)
+	{
+		Object *root = sRoot[i];
+		if (!root)
+			continue;
+		sRoot[i] = nullptr;
+		root->mFlags &= ~Object::PossibleCycleRoot;
+		auto kind = KindOf(root);
+		if (kind != NK_None && ok)
+			ok = graph.Add(root, kind, root->RefCount());
+	}
+	sRootCount = 0;
+
+	// Add everything reachable from the roots.  Count() increases as nodes are added.
+	for (i = 0; i < graph.Count() && ok; ++i)
+	{
+		Node node = graph[i]; // Copy, since Add() may reallocate the array.
+		ForEachRef(node, [&](void *aPtr, NodeKind aKind) {
+			if (aKind != NK_None && ok)
+				ok = graph.Add(aPtr, aKind, RefCountOf(aPtr, aKind));
+		});
+	}
+	if (!ok) // Out of memory.
+	{
+		sCollecting = false;
+		return 0;
+	}
+
+	// Trial deletion: subtract references held within the graph.
+	for (i = 0; i < graph.Count(); ++i)
+	{
+		ForEachRef(graph[i], [&](void *aPtr, NodeKind aKind) {
+			if (aKind == NK_None)
+				return;
+			UINT n = graph.Find(aPtr);
+			if (n != UINT_MAX && graph[n].refs)
+				--graph[n].refs;
+		});
+	}
+
+	// Anything still referenced from outside the graph is live, as is everything it refers to.
+	UINT *stack = (UINT *)malloc(graph.Count() * sizeof(UINT)), sp = 0;
+	if (!stack)
+	{
+		sCollecting = false;
+		return 0;
+	}
+	for (i = 0; i < graph.Count(); ++i)
+	{
+		if (graph[i].refs || MustKeep(graph[i]))
+		{
+			graph[i].live = true;
+			stack[sp++] = i;
+		}
+	}
+	while (sp)
+	{
+		ForEachRef(graph[stack[--sp]], [&](void *aPtr, NodeKind aKind) {
+			if (aKind == NK_None)
+				return;
+			UINT n = graph.Find(aPtr);
+			if (n != UINT_MAX && !graph[n].live)
+			{
+				graph[n].live = true;
+				stack[sp++] = n;
+			}
+		});
+	}
+	free(stack);
+
+	// Whatever remains is garbage.  Hold a reference to each node so that none are deleted while
+	// references are being cleared, then release them all to let the normal mechanism free them.
+	for (i = 0; i < graph.Count(); ++i)
+	{
+		if (graph[i].live)
+			continue;
+		if (graph[i].kind == NK_FreeVars)
+			((FreeVars *)graph[i].ptr)->AddRef();
+		else
+			((Object *)graph[i].ptr)->AddRef();
+	}
+	for (i = 0; i < graph.Count(); ++i)
+		if (!graph[i].live)
+			ClearRefs(graph[i]);
+	for (i = 0; i < graph.Count(); ++i)
+	{
+		if (graph[i].live)
+			continue;
+		if (graph[i].kind == NK_FreeVars)
+			((FreeVars *)graph[i].ptr)->Release();
+		else if (((Object *)graph[i].ptr)->Release() == 0)
+			++freed;
+	}
+
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&freq);
+	sLastTime = (end.QuadPart - start.QuadPart) * 1000000 / freq.QuadPart;
+	sTotalTime += sLastTime;
+	if (sMaxTime < sLastTime)
+		sMaxTime = sLastTime;
+	++sCollections;
+	sLastFreed = freed;
+	sTotalFreed += freed;
+
+	sCollecting = false;
+	return freed;
+}
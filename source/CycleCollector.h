@@ -0,0 +1,83 @@
+#pragma once
+
+class Object;
+struct IObject;
+struct FreeVars;
+
+inline UINT CycleHash(void *aPtr)
+{
+	auto h = (UINT_PTR)aPtr >> 3;
+	return (UINT)(h ^ (h >> 15)) * 2654435761U;
+}
+
+//
+// CycleCollector - Synchronous trial-deletion collector for reference cycles.
+//
+// Reference counting alone cannot free objects which refer to each other (directly or via
+// closures and bound functions).  When enabled, any Object whose reference count is decremented
+// to a non-zero value is buffered as a possible root of a garbage cycle (Bacon & Rajan).  The buffer
+// is a hash set so that ~Object() can remove a root in constant time.  Collect()
+// then examines the subgraph reachable from those roots, subtracts each reference held within the
+// subgraph from its target's count, and reclaims whatever is not reachable from a node which still
+// has references from outside.  Only objects whose references are fully known (Object, Array, Map,
+// Closure, BoundFunc and the FreeVars of closures) are considered; any other object is treated as
+// an external reference, so the collector errs on the side of keeping things alive.
+//
+
+class CycleCollector
+{
+	static Object **sRoot; // Open addressing hash set of buffered roots; sRootCapacity is a power of 2.
+	static UINT sRootCount, sRootCapacity;
+	static bool sCollecting;
+	static bool sDue;
+
+	enum NodeKind : UCHAR;
+	struct Node;
+	friend class CycleGraph;
+
+	static NodeKind KindOf(IObject *aObj);
+	static NodeKind KindOf(FreeVars *aVars);
+	static ULONG RefCountOf(void *aPtr, NodeKind aKind);
+	template<typename Visitor> static void ForEachRef(Node &aNode, Visitor aVisit);
+	static bool MustKeep(Node &aNode);
+	static void ClearRefs(Node &aNode);
+	static UINT Slot(Object *aObj) { return CycleHash(aObj) & (sRootCapacity - 1); }
+	static bool GrowRoots();
+
+public:
+	// Number of buffered roots which causes a collection to occur the next time the script becomes
+	// idle, or sooner if the auto-execute thread is running at global scope (see IsDue()).  Zero
+	// disables the collector, including buffering of roots.
+	static UINT sThreshold;
+	static bool IsEnabled() { return sThreshold != 0; }
+	static UINT RootCount() { return sRootCount; }
+
+	// Statistics.
+	static UINT sCollections; // Number of times Collect() has been called.
+	static UINT sLastFreed; // Number of objects freed by the most recent collection.
+	static __int64 sTotalFreed; // Number of objects freed by all collections.
+	static __int64 sLastTime, sMaxTime, sTotalTime; // Pause times, in microseconds.
+
+	static void AddRoot(Object *aObj);
+	static void RemoveRoot(Object *aObj);
+	static void SetThreshold(UINT aThreshold);
+
+	// Collects all garbage cycles reachable from the buffered roots.  Returns the number of objects freed.
+	// Caller must ensure that no script code is running with uncounted references to objects.
+	static UINT Collect();
+
+	// Causes a collection to occur the next time the script becomes idle, regardless of the threshold.
+	static void Request() { sDue = true; }
+
+	// Returns true if the buffer has reached the threshold or a collection was requested.  This is
+	// checked before each line, so that a script whose auto-execute thread never finishes (such as
+	// a global loop with Sleep) still collects: see Line::ExecUntil.
+	static bool IsDue() { return sDue; }
+
+	// Called when the script is idle to perform collection if it is due.
+	static void CollectIfDue()
+	{
+		if (sDue)
+			Collect();
+	}
+};
@@ -171,6 +171,209 @@ void SetBreakpointForLineGroup(Line *line, Breakpoint *bp)
 }
 
 
+int Debugger::ParseBreakpointCondition(char *aExpression, BreakpointCondition *&aCondition)
+{
+	auto cond = new BreakpointCondition;
+	if (  !(cond->expression = _strdup(aExpression))
+		|| !(cond->name = _tcsdup(CStringTCharFromUTF8(aExpression)))  )
+	{
+		delete cond;
+		return DEBUGGER_E_INTERNAL_ERROR;
+	}
+	// Find the operator, if any, skipping over quoted keys and pseudo-properties such as <base>.
+	LPTSTR cp;
+	for (cp = cond->name; *cp; ++cp)
+	{
+		if (*cp == '"')
+		{
+			for (++cp; *cp && (*cp != '"' || cp[1] == '"'); ++cp)
+				if (*cp == '"')
+					++cp; // Skip the second quote mark of "".
+			if (!*cp)
+				break;
+		}
+		else if (_tcschr(_T("=!<>"), *cp))
+		{
+			LPTSTR end = find_identifier_end(cp + 1);
+			if (*cp != '<' || end == cp + 1 || *end != '>')
+				break;
+			cp = end; // Pseudo-property such as <base>.
+		}
+	}
+	LPTSTR op_end = cp;
+	switch (*cp)
+	{
+	case '\0': break;
+	case '=': cond->op = cp[1] == '=' ? BO_EqualCase : BO_Equal; break;
+	case '<': cond->op = cp[1] == '=' ? BO_LessOrEqual : BO_Less; break;
+	case '>': cond->op = cp[1] == '=' ? BO_GreaterOrEqual : BO_Greater; break;
+	case '!':
+		if (cp[1] == '=')
+			cond->op = cp[2] == '=' ? BO_NotEqualCase : BO_NotEqual;
+		break;
+	}
+	switch (cond->op)
+	{
+	case BO_None: break;
+	case BO_NotEqualCase: op_end += 3; break;
+	case BO_Equal: case BO_Less: case BO_Greater: op_end += 1; break;
+	default: op_end += 2; break;
+	}
+	if (*cp)
+	{
+		// Parse the literal value and terminate the name.
+		LPTSTR value_end;
+		if (   cond->op == BO_None
+			|| !(value_end = ParsePropertyKeyLiteral(omit_leading_whitespace(op_end), cond->value))
+			|| cond->value.symbol == SYM_OBJECT
+			|| *omit_leading_whitespace(value_end)   )
+		{
+			delete cond;
+			return DEBUGGER_E_INVALID_OPTIONS;
+		}
+		*cp = '\0';
+	}
+	rtrim(cond->name);
+	if (!*cond->name)
+	{
+		delete cond;
+		return DEBUGGER_E_INVALID_OPTIONS;
+	}
+	aCondition = cond;
+	return DEBUGGER_E_OK;
+}
+
+// Returns true if the breakpoint should take effect, after updating its hit count.
+bool Debugger::BreakpointIsHit(Breakpoint &aBp)
+{
+	if (aBp.condition && !BreakpointConditionIsMet(*aBp.condition))
+		return false;
+	++aBp.hit_count;
+	if (!aBp.hit_value)
+		return true;
+	switch (aBp.hit_condition)
+	{
+	case BHC_Equal: return aBp.hit_count == aBp.hit_value;
+	case BHC_Multiple: return aBp.hit_count % aBp.hit_value == 0;
+	default: return aBp.hit_count >= aBp.hit_value;
+	}
+}
+
+bool Debugger::BreakpointConditionIsMet(BreakpointCondition &aCondition)
+{
+	TCHAR value_buf[_f_retval_buf_size];
+	PropertySource prop(value_buf);
+	if (EvaluateProperty(aCondition.name, _tcslen(aCondition.name), prop))
+		return false; // Invalid or failed conditions never take effect.
+	ExprTokenType &value = prop.value, &operand = aCondition.value;
+	if (aCondition.op == BO_None)
+		return TokenToBOOL(value);
+
+	int result; // <0, 0 or >0, as with strcmp.
+	SymbolType value_type = TokenIsPureNumeric(value), operand_type = TokenIsPureNumeric(operand);
+	if (value_type && operand_type)
+	{
+		if (value_type == PURE_INTEGER && operand_type == PURE_INTEGER)
+		{
+			__int64 a = TokenToInt64(value), b = TokenToInt64(operand);
+			result = (a > b) - (a < b);
+		}
+		else
+		{
+			double a = TokenToDouble(value), b = TokenToDouble(operand);
+			result = (a > b) - (a < b);
+		}
+	}
+	else
+	{
+		// Only equality is supported for strings, and an object never equals a literal value.
+		if (aCondition.op >= BO_Less)
+			return false;
+		if (TokenToObject(value))
+			result = 1;
+		else
+		{
+			TCHAR value_number_buf[MAX_NUMBER_SIZE], operand_number_buf[MAX_NUMBER_SIZE];
+			size_t value_length, operand_length;
+			LPTSTR value_string = TokenToString(value, value_number_buf, &value_length);
+			LPTSTR operand_string = TokenToString(operand, operand_number_buf, &operand_length);
+			if (aCondition.op == BO_EqualCase || aCondition.op == BO_NotEqualCase)
+				result = !(value_length == operand_length && !tmemcmp(value_string, operand_string, value_length));
+			else
+				result = _tcsicmp(value_string, operand_string);
+		}
+	}
+	switch (aCondition.op)
+	{
+	case BO_Equal: case BO_EqualCase: return result == 0;
+	case BO_NotEqual: case BO_NotEqualCase: return result != 0;
+	case BO_Less: return result < 0;
+	case BO_LessOrEqual: return result <= 0;
+	case BO_Greater: return result > 0;
+	default: return result >= 0;
+	}
+}
+
+// Writes a logpoint's message the same way as OutputDebug, replacing each {name} with the value of
+// that property: to the stderr stream if the client enabled it with "stderr -c", otherwise (or also,
+// for "stderr -c 1") via OutputDebugString.
+void Debugger::WriteLogMessage(LPCTSTR aMessage)
+{
+	CString text;
+	LPCTSTR cp, open, close;
+	for (cp = aMessage; (open = _tcschr(cp, '{')) && (close = _tcschr(open + 1, '}')); cp = close + 1)
+	{
+		text.Append(cp, int(open - cp));
+		TCHAR value_buf[_f_retval_buf_size];
+		PropertySource prop(value_buf);
+		if (EvaluateProperty(open + 1, close - open - 1, prop))
+			text.Append(_T("<error>"));
+		else if (auto obj = TokenToObject(prop.value))
+			text.Append(obj->Type());
+		else
+		{
+			TCHAR number_buf[MAX_NUMBER_SIZE];
+			size_t length;
+			LPTSTR value = TokenToString(prop.value, number_buf, &length);
+			text.Append(value, (int)length);
+		}
+	}
+	text.Append(cp);
+	text.Append(_T("\n"));
+	if (!OutputStdErr(text))
+		OutputDebugString(text);
+}
+
+// Retrieves the value of a property for a conditional breakpoint or logpoint, as property_get would
+// at stack depth 0.  Any script code this invokes (such as a property getter) can't trigger breakpoints
+// or report errors, the same as when it is invoked by property_get during a break.
+int Debugger::EvaluateProperty(LPCTSTR aName, size_t aNameLength, PropertySource &aResult)
+{
+	// ParsePropertyName() may modify the name in-place, so give it a copy.
+	LPTSTR name = (LPTSTR)_alloca((aNameLength + 1) * sizeof(TCHAR));
+	tmemcpy(name, aName, aNameLength);
+	name[aNameLength] = '\0';
+
+	Line *line = mCurrLine;
+	auto excptmode = g->ExcptMode;
+	g->ExcptMode = EXCPTMODE_DEBUGGER;
+	mProcessingCommands = true;
+	int err = ParsePropertyName(name, 0, FINDVAR_FOR_READ, nullptr, aResult);
+	if (!err)
+	{
+		switch (aResult.kind)
+		{
+		case PropVar: err = GetPropertyValue(*aResult.var, aResult.value); break;
+		case PropVarBkp: err = GetPropertyValue(*aResult.bkp, aResult.value); break;
+		}
+	}
+	mProcessingCommands = false;
+	g->ExcptMode = excptmode;
+	mCurrLine = line;
+	return err;
+}
+
+
 // PreExecLine: aLine is about to execute; handle current line marker, breakpoints and step into/over/out.
 int Debugger::PreExecLine(Line *aLine)
 {
@@ -184,8 +387,11 @@ int Debugger::PreExecLine(Line *aLine)
 	
 	// Check for a breakpoint on the current line:
 	Breakpoint *bp = aLine->mBreakpoint;
-	if (bp && bp->state == BS_Enabled)
+	if (bp && bp->state == BS_Enabled && BreakpointIsHit(*bp))
 	{
+		bool is_logpoint = bp->log_message != nullptr;
+		if (is_logpoint)
+			WriteLogMessage(bp->log_message);
 		if (bp->temporary)
 		{
 			Line *line = aLine, *prev;
@@ -194,7 +400,8 @@ int Debugger::PreExecLine(Line *aLine)
 			SetBreakpointForLineGroup(line, nullptr);
 			DeleteBreakpoint(bp);
 		}
-		return Break();
+		if (!is_logpoint)
+			return Break();
 	}
 
 	if ((mInternalState == DIS_StepInto
@@ -711,6 +918,9 @@ DEBUGGER_COMMAND(Debugger::breakpoint_set)
 	char *type = NULL, state = BS_Enabled, *filename = NULL;
 	LineNumberType lineno = 0;
 	bool temporary = false;
+	char *expression = NULL, *log_message = NULL;
+	int hit_value = 0;
+	char hit_condition = BHC_GreaterOrEqual;
 
 	for (int i = 0; i < aArgCount; ++i)
 	{
@@ -748,11 +958,33 @@ DEBUGGER_COMMAND(Debugger::breakpoint_set)
 				break;
 			return DEBUGGER_E_INVALID_OPTIONS;
 
-		case 'm': // function
 		case 'h': // hit_value
+			hit_value = atoi(value);
+			if (hit_value < 0)
+				return DEBUGGER_E_INVALID_OPTIONS;
+			break;
+
 		case 'o': // hit_condition = >= | == | %
+			if (!strcmp(value, ">="))
+				hit_condition = BHC_GreaterOrEqual;
+			else if (!strcmp(value, "=="))
+				hit_condition = BHC_Equal;
+			else if (!strcmp(value, "%"))
+				hit_condition = BHC_Multiple;
+			else
+				return DEBUGGER_E_INVALID_OPTIONS;
+			break;
+
 		case '-': // expression for conditional breakpoints
-			// These aren't used/supported.
+			expression = value;
+			break;
+
+		case 'l': // Non-standard: log message, which makes this a logpoint.
+			log_message = value;
+			break;
+
+		case 'm': // function
+			// This isn't used/supported.
 		default:
 			return DEBUGGER_E_INVALID_OPTIONS;
 		}
@@ -760,7 +992,7 @@ DEBUGGER_COMMAND(Debugger::breakpoint_set)
 
 	// Breakpoint type is required according to the spec, but allowing it to be omitted
 	// and defaulting to "line" is more convenient for debugging the debugger via console.
-	if (type && strcmp(type, "line")) // i.e. type was specified and is not "line".
+	if (type && strcmp(type, "line") && (strcmp(type, "conditional") || !expression)) // i.e. type was specified and is not "line" or a valid "conditional".
 	{
 		if (!strcmp(type, "exception") && lineno == 0 && !filename)
 		{
@@ -795,6 +1027,23 @@ DEBUGGER_COMMAND(Debugger::breakpoint_set)
 
 	if (auto line = FindFirstLineForBreakpoint(file_index, lineno))
 	{
+		// Parse the condition and message before making any changes, in case they're invalid.
+		BreakpointCondition *condition = nullptr;
+		if (expression)
+		{
+			// "The expression is base64 encoded data": https://xdebug.org/docs/dbgp
+			Base64Decode(expression, expression);
+			int err = ParseBreakpointCondition(expression, condition);
+			if (err)
+				return err;
+		}
+		LPTSTR log_message_t = nullptr;
+		if (log_message && !(log_message_t = _tcsdup(CStringTCharFromUTF8(log_message))))
+		{
+			delete condition;
+			return DEBUGGER_E_INTERNAL_ERROR;
+		}
+
 		Breakpoint *bp = line->mBreakpoint;
 		if (!bp)
 		{
@@ -802,8 +1051,16 @@ DEBUGGER_COMMAND(Debugger::breakpoint_set)
 			bp->line = line;
 			SetBreakpointForLineGroup(line, bp);
 		}
+		bp->type = condition ? BT_Conditional : BT_Line;
 		bp->state = state;
 		bp->temporary = temporary;
+		bp->hit_count = 0;
+		bp->hit_value = hit_value;
+		bp->hit_condition = hit_condition;
+		delete bp->condition;
+		bp->condition = condition;
+		free(bp->log_message);
+		bp->log_message = log_message_t;
 
 		return mResponseBuf.WriteF(
 			"<response command=\"breakpoint_set\" transaction_id=\"%e\" state=\"%s\" id=\"%i\"/>"
@@ -818,9 +1075,17 @@ int Debugger::WriteBreakpointXml(Breakpoint *aBreakpoint)
 	if (aBreakpoint->type == BT_Exception)
 		return mResponseBuf.WriteF("<breakpoint id=\"%i\" type=\"exception\" state=\"%s\" exception=\"Any\"/>"
 			, aBreakpoint->id, aBreakpoint->state == BS_Enabled ? "enabled" : "disabled");
-	return mResponseBuf.WriteF("<breakpoint id=\"%i\" type=\"line\" state=\"%s\" filename=\"%r\" lineno=\"%u\"/>"
-		, aBreakpoint->id, aBreakpoint->state ? "enabled" : "disabled"
-		, Line::sSourceFile[aBreakpoint->line->mFileIndex], aBreakpoint->line->mLineNumber);
+	mResponseBuf.WriteF("<breakpoint id=\"%i\" type=\"%s\" state=\"%s\" filename=\"%r\" lineno=\"%u\" hit_count=\"%i\""
+		, aBreakpoint->id, aBreakpoint->condition ? "conditional" : "line", aBreakpoint->state ? "enabled" : "disabled"
+		, Line::sSourceFile[aBreakpoint->line->mFileIndex], aBreakpoint->line->mLineNumber, aBreakpoint->hit_count);
+	if (aBreakpoint->hit_value)
+		mResponseBuf.WriteF(" hit_value=\"%i\" hit_condition=\"%s\"", aBreakpoint->hit_value
+			, aBreakpoint->hit_condition == BHC_Equal ? "==" : aBreakpoint->hit_condition == BHC_Multiple ? "%" : "&gt;=");
+	if (!aBreakpoint->condition)
+		return mResponseBuf.Write("/>");
+	mResponseBuf.Write("><expression>");
+	mResponseBuf.WriteEncodeBase64(aBreakpoint->condition->expression, strlen(aBreakpoint->condition->expression));
+	return mResponseBuf.Write("</expression></breakpoint>");
 }
 
 DEBUGGER_COMMAND(Debugger::breakpoint_get)
@@ -852,7 +1117,8 @@ DEBUGGER_COMMAND(Debugger::breakpoint_update)
 	
 	int breakpoint_id = -1;
 	LineNumberType lineno = 0;
-	char state = -1;
+	char state = -1, hit_condition = -1;
+	int hit_value = -1;
 
 	for (int i = 0; i < aArgCount; ++i)
 	{
@@ -880,8 +1146,20 @@ DEBUGGER_COMMAND(Debugger::breakpoint_update)
 			break;
 
 		case 'h': // hit_value
+			hit_value = atoi(value);
+			if (hit_value < 0)
+				return DEBUGGER_E_INVALID_OPTIONS;
+			break;
+
 		case 'o': // hit_condition
-			// These aren't used/supported, but ignored for now.
+			if (!strcmp(value, ">="))
+				hit_condition = BHC_GreaterOrEqual;
+			else if (!strcmp(value, "=="))
+				hit_condition = BHC_Equal;
+			else if (!strcmp(value, "%"))
+				hit_condition = BHC_Multiple;
+			else
+				return DEBUGGER_E_INVALID_OPTIONS;
 			break;
 
 		default:
@@ -911,6 +1189,10 @@ DEBUGGER_COMMAND(Debugger::breakpoint_update)
 
 			if (state != -1)
 				bp->state = state;
+			if (hit_value != -1)
+				bp->hit_value = hit_value;
+			if (hit_condition != -1)
+				bp->hit_condition = hit_condition;
 
 			return DEBUGGER_E_OK;
 		}
@@ -1281,6 +1563,8 @@ int Debugger::WriteEnumItems(PropertyInfo &aProp)
 
 void Debugger::PropertyWriter::WriteEnumItems(IObject *aEnumerable, int aStart, int aEnd)
 {
+	if (mDepth && WriteIndexedItems(aEnumerable, aStart, aEnd))
+		return;
 	IObject *enumerator;
 	auto result = GetEnumerator(enumerator, ExprTokenType(aEnumerable), 2, false);
 	if (result != OK)
@@ -1338,6 +1622,49 @@ void Debugger::PropertyWriter::WriteEnumItems(IObject *aEnumerable, int aStart,
 	enumerator->Release();
 }
 
+bool Debugger::PropertyWriter::WriteIndexedItems(IObject *aEnumerable, int aStart, int aEnd)
+// Writes the items of an Array or Map which uses the built-in enumerator by retrieving them directly,
+// so that requesting a page of a large object doesn't require enumerating all of the items before it.
+// Returns false if aEnumerable isn't such an object, in which case the caller should enumerate it.
+{
+	if (aStart < 0)
+		aStart = 0;
+	ExprTokenType key, value;
+	if (auto arr = dynamic_cast<Array *>(aEnumerable))
+	{
+		if (arr->GetMethod(_T("__Enum")) != Array::sPrototype->GetMethod(_T("__Enum")))
+			return false;
+		for (Array::index_t i = aStart; i < (Array::index_t)aEnd && arr->ItemToToken(i, value); ++i)
+		{
+			key.SetValue((__int64)i + 1);
+			WriteItemProperty(key, value);
+		}
+		return true;
+	}
+	if (auto map = dynamic_cast<Map *>(aEnumerable))
+	{
+		if (map->GetMethod(_T("__Enum")) != Map::sPrototype->GetMethod(_T("__Enum")))
+			return false;
+		for (Map::index_t i = aStart; i < (Map::index_t)aEnd && map->ItemToToken(i, key, value); ++i)
+			WriteItemProperty(key, value);
+		return true;
+	}
+	return false;
+}
+
+void Debugger::PropertyWriter::WriteItemProperty(ExprTokenType &aKey, ExprTokenType &aValue)
+// Writes an item retrieved by WriteIndexedItems.  aValue is borrowed from the Array or Map, and
+// writing a child object can run script code (such as its __Enum method) which removes the item,
+// so a reference is held until it is written.  The key is used only before any script code runs,
+// and a string value is written without running any.
+{
+	if (aValue.symbol == SYM_OBJECT)
+		aValue.object->AddRef();
+	WriteProperty(aKey, aValue);
+	if (aValue.symbol == SYM_OBJECT)
+		aValue.object->Release();
+}
+
 int Debugger::WritePropertyXml(PropertyInfo &aProp)
 {
 	char facetbuf[32]; // Alias Builtin Static
@@ -1481,6 +1808,8 @@ int Debugger::WritePropertyData(LPCTSTR aData, size_t aDataSize, int aMaxEncoded
 				utf8_size = (int)(total_utf8_size - char_size);
 			}
 		}
+		if (char_size == 4)
+			++i; // Skip the low surrogate, which was counted with the high one.
 	}
 	if (utf8_size == -1) // Data was not limited by aMaxEncodedSize.
 		utf8_size = (int)total_utf8_size;
@@ -2603,15 +2932,22 @@ size_t Debugger::Base64Encode(char *aBuf, const char *aInput, size_t aInputSize/
 	if (aInputSize == -1) // Direct comparison since aInputSize is unsigned.
 		aInputSize = strlen(aInput);
 
+	// Encode each 12 bits as a pair of characters, halving the number of lookups for large values.
+	static char sPairs[4096][2];
+	if (!sPairs[0][0])
+		for (int n = 0; n < 4096; ++n)
+		{
+			sPairs[n][0] = BINARY_TO_BASE64_CHAR(n >> 6);
+			sPairs[n][1] = BINARY_TO_BASE64_CHAR(n);
+		}
+
 	for (i = aInputSize; i > 2; i -= 3)
 	{
 		buffer = (UCHAR)aInput[0] << 16 | (UCHAR)aInput[1] << 8 | (UCHAR)aInput[2]; // L39: Fixed for chars outside the range 0..127. [thanks jackieku]
 		aInput += 3;
 
-		aBuf[len + 0] = BINARY_TO_BASE64_CHAR(buffer >> 18);
-		aBuf[len + 1] = BINARY_TO_BASE64_CHAR(buffer >> 12);
-		aBuf[len + 2] = BINARY_TO_BASE64_CHAR(buffer >> 6);
-		aBuf[len + 3] = BINARY_TO_BASE64_CHAR(buffer);
+		memcpy(aBuf + len, sPairs[buffer >> 12], 2);
+		memcpy(aBuf + len + 2, sPairs[buffer & 4095], 2);
 		len += 4;
 	}
 	if (i > 0)
@@ -2753,17 +3089,19 @@ int Debugger::Buffer::WriteF(const char *aFormat, ...)
 						{
 							switch (c)
 							{
-							case '"': entity = "quot"; break;
-							case '\'': entity = "apos"; break;
-							case '&': entity = "amp"; break;
-							case '<': entity = "lt"; break;
-							case '>': entity = "gt"; break;
+							case '"': entity = "&quot;"; break;
+							case '\'': entity = "&apos;"; break;
+							case '&': entity = "&amp;"; break;
+							case '<': entity = "&lt;"; break;
+							case '>': entity = "&gt;"; break;
 							default:
 								mData[mDataUsed++] = c;
 								continue;
 							}
-							// One of: "'&<> - entity is set to the appropriate entity name.
-							mDataUsed += sprintf(mData + mDataUsed, "&%s;", entity);
+							// One of: "'&<> - entity is set to the appropriate entity.
+							len = strlen(entity);
+							memcpy(mData + mDataUsed, entity, len);
+							mDataUsed += len;
 						}
 					}
 					++format_ptr; // Skip %, outer loop will skip format char.
@@ -81,6 +81,26 @@ extern LPCTSTR g_AutoExecuteThreadDesc;
 
 enum BreakpointTypeType {BT_Line, BT_Call, BT_Return, BT_Exception, BT_Conditional, BT_Watch};
 enum BreakpointStateType {BS_Disabled=0, BS_Enabled};
+enum BreakpointHitConditionType {BHC_GreaterOrEqual, BHC_Equal, BHC_Multiple};
+enum BreakpointOperatorType {BO_None, BO_Equal, BO_EqualCase, BO_NotEqual, BO_NotEqualCase
+	, BO_Less, BO_LessOrEqual, BO_Greater, BO_GreaterOrEqual}; // Relational operators must be last.
+
+// The condition of a conditional breakpoint, which is evaluated in-process each time the line is
+// reached: a property name in the format accepted by property_get, optionally followed by one of
+// the operators = == != !== < <= > >= and a literal string or number.
+struct BreakpointCondition
+{
+	char *expression = nullptr; // As given by the client (UTF-8).
+	LPTSTR name = nullptr; // The property name.  Also holds the literal value if it is a string.
+	ExprTokenType value; // The literal value, if op != BO_None.
+	char op = BO_None;
+
+	~BreakpointCondition()
+	{
+		free(expression);
+		free(name);
+	}
+};
 
 class Breakpoint
 {
@@ -89,15 +109,27 @@ public:
 	char type;
 	char state = BS_Disabled;
 	bool temporary = false;
+	char hit_condition = BHC_GreaterOrEqual;
+	int hit_count = 0; // Number of times the line was reached while the condition (if any) was met.
+	int hit_value = 0; // If non-zero, the breakpoint only takes effect when hit_count satisfies hit_condition.
+
+	BreakpointCondition *condition = nullptr;
+	LPTSTR log_message = nullptr; // If non-null, this is a logpoint: the message is written to stderr instead of breaking.
 
 	Line *line = nullptr;
 	Breakpoint *next = nullptr;
 	
-	// Not yet supported: function, hit_count, hit_value, hit_condition
+	// Not yet supported: function
 
 	Breakpoint(BreakpointTypeType aType = BT_Line, int aID = AllocateID())
 		: id(aID), type((char)aType) {}
 
+	~Breakpoint()
+	{
+		delete condition;
+		free(log_message);
+	}
+
 	static int AllocateID() { return ++sMaxId; }
 
 private:
@@ -386,6 +418,8 @@ private:
 		void WriteBaseProperty(IObject *aBase);
 		void WriteDynamicProperty(LPTSTR aName);
 		void WriteEnumItems(IObject *aEnumerable, int aStart, int aEnd);
+		bool WriteIndexedItems(IObject *aEnumerable, int aStart, int aEnd);
+		void WriteItemProperty(ExprTokenType &aKey, ExprTokenType &aValue);
 
 		void _WriteProperty(ExprTokenType &aValue, IObject *aInvokee = nullptr);
 
@@ -412,6 +446,11 @@ private:
 	Line *FindFirstLineForBreakpoint(int file_index, UINT line_no);
 	Breakpoint *CreateBreakpoint();
 	void DeleteBreakpoint(Breakpoint *aBp);
+	int ParseBreakpointCondition(char *aExpression, BreakpointCondition *&aCondition);
+	bool BreakpointIsHit(Breakpoint &aBp);
+	bool BreakpointConditionIsMet(BreakpointCondition &aCondition);
+	void WriteLogMessage(LPCTSTR aMessage);
+	int EvaluateProperty(LPCTSTR aName, size_t aNameLength, PropertySource &aResult);
 
 	void AppendPropertyName(CStringA &aNameBuf, size_t aParentNameLength, const char *aName);
 	void AppendStringKey(CStringA &aNameBuf, size_t aParentNameLength, const char *aKey);
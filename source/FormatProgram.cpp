@@ -0,0 +1,273 @@
+#include "stdafx.h" // pre-compiled headers
+#include "script.h"
+#include "FormatProgram.h"
+
+
+static FormatProgram *sFormatProgramCache[FORMAT_PROGRAM_CACHE_SIZE];
+
+
+
+FormatProgram *FormatProgram::Compile(LPCTSTR aFormat, size_t aLength, int aParamCount)
+// Returns a new program, or NULL if out of memory.  Caller must free() it.
+// The parsing rules must produce the same results as the original single-pass implementation,
+// including which malformed placeholders are output literally.
+{
+	int item_max = 1; // Final item.
+	for (size_t i = 0; i < aLength; ++i)
+		if (aFormat[i] == '{')
+			++item_max;
+	auto mem = (char *)malloc(sizeof(FormatProgram) + item_max * sizeof(FormatItem) + (aLength * 2 + 2) * sizeof(TCHAR));
+	if (!mem)
+		return NULL;
+	auto program = (FormatProgram *)mem;
+	program->mParamCount = aParamCount;
+	program->mSourceLength = aLength;
+	program->mItem = (FormatItem *)(mem + sizeof(FormatProgram));
+	program->mSource = (LPTSTR)(program->mItem + item_max);
+	program->mText = program->mSource + aLength + 1;
+	tmemcpy(program->mSource, aFormat, aLength + 1);
+
+	LPTSTR text = program->mText;
+	UINT text_length = 0, literal_start = 0;
+	FormatItem *item = program->mItem;
+	LPCTSTR lit, cp, cp_end, cp_spec;
+	int param, last_param = 0, spec_len;
+
+	for (lit = cp = aFormat;; )
+	{
+		// Find next placeholder.
+		for (cp_end = cp; *cp_end && *cp_end != '{'; ++cp_end);
+		if (cp_end > lit)
+		{
+			// Literal text to the left of the placeholder.
+			tmemcpy(text + text_length, lit, cp_end - lit);
+			text_length += UINT(cp_end - lit);
+			lit = cp_end; // Mark this as the next literal character (to be overridden below if it's a valid placeholder).
+		}
+		cp = cp_end;
+		if (!*cp)
+			break;
+		// else: Implies *cp == '{'.
+		++cp;
+		if ((*cp == '{' || *cp == '}') && cp[1] == '}') // {{} or {}}
+		{
+			text[text_length++] = *cp;
+			cp += 2;
+			lit = cp; // Mark this as the next literal character.
+			continue;
+		}
+
+		// Index.
+		for (cp_end = cp; *cp_end >= '0' && *cp_end <= '9'; ++cp_end);
+		if (cp_end > cp)
+			param = ATOI(cp), cp = cp_end;
+		else
+			param = last_param + 1;
+		if (param >= aParamCount || param < 1) // Invalid parameter index.
+			continue;
+
+		item->custom_format = 0; // Set default.
+		TCHAR *spec = item->spec;
+		*spec = '%';
+
+		// Optional format specifier.
+		if (*cp == ':')
+		{
+			cp_spec = ++cp;
+			// Skip valid format specifier options.
+			for (cp = cp_spec; *cp && _tcschr(_T("-+0 #"), *cp); ++cp); // flags
+			for ( ; *cp >= '0' && *cp <= '9'; ++cp); // width
+			if (*cp == '.') do ++cp; while (*cp >= '0' && *cp <= '9'); // .precision
+			spec_len = int(cp - cp_spec);
+			// For now, size specifiers (h | l | ll | w | I | I32 | I64) are not supported.
+
+			if (spec_len + 4 >= FORMAT_SPEC_SIZE) // Format specifier too long (probably invalid).
+				continue;
+			// Copy options, if any (+1 to leave the leading %).
+			tmemcpy(spec + 1, cp_spec, spec_len);
+			++spec_len; // Include the leading %.
+
+			if (*cp && _tcschr(_T("diouxX"), *cp))
+			{
+				spec[spec_len++] = 'I';
+				spec[spec_len++] = '6';
+				spec[spec_len++] = '4';
+				// Integer value; apply I64 prefix to avoid truncation.
+				item->symbol = SYM_INTEGER;
+				spec[spec_len++] = *cp++;
+			}
+			else if (*cp && _tcschr(_T("eEfgGaA"), *cp))
+			{
+				item->symbol = SYM_FLOAT;
+				spec[spec_len++] = *cp++;
+			}
+			else if (*cp && _tcschr(_T("cCp"), *cp))
+			{
+				// Input is an integer or pointer, but I64 prefix should not be applied.
+				item->symbol = SYM_INTEGER;
+				spec[spec_len++] = *cp++;
+			}
+			else
+			{
+				item->symbol = SYM_STRING;
+				spec[spec_len++] = 's'; // Default to string if not specified.
+				if (*cp && _tcschr(_T("ULlTt"), *cp))
+					item->custom_format = toupper(*cp++);
+				if (*cp == 's')
+					++cp;
+			}
+		}
+		else
+		{
+			item->symbol = SYM_STRING;
+			// spec[0] contains '%'.
+			spec[1] = 's';
+			spec_len = 2;
+		}
+		spec[spec_len] = '\0';
+		item->param = param;
+		
+		if (*cp != '}') // Syntax error.
+		{
+			// The value is still validated, but the placeholder is output as literal text.
+			item->check_only = true;
+			item->spec_length = spec_len;
+			item->literal = literal_start;
+			item->literal_length = 0;
+			++item;
+			continue;
+		}
+		++cp;
+		lit = cp; // Mark this as the next literal character.
+
+		// Now that validation is complete, set last_param for use by the next {} or {:fmt}.
+		last_param = param;
+
+		item->check_only = false;
+		// A plain string is copied directly rather than via sprintf.
+		item->spec_length = item->symbol == SYM_STRING && !item->custom_format && spec_len == 2 ? 0 : spec_len;
+		item->literal = literal_start;
+		item->literal_length = text_length - literal_start;
+		literal_start = text_length;
+		++item;
+	}
+	item->param = 0;
+	item->literal = literal_start;
+	item->literal_length = text_length - literal_start;
+	return program;
+}
+
+
+
+FormatProgram *FormatProgram::Get(LPCTSTR aFormat, size_t aLength, int aParamCount, bool &aCached)
+// Returns the program for aFormat, from the cache if possible, or NULL if out of memory.
+// If aCached is false, the caller must free() it; otherwise it remains valid until the next call.
+{
+	aCached = false;
+	if (aLength > FORMAT_PROGRAM_CACHE_MAX_LENGTH)
+		return Compile(aFormat, aLength, aParamCount);
+	UINT hash = Hash(aFormat, aLength, aParamCount);
+	FormatProgram **slot = &sFormatProgramCache[hash & (FORMAT_PROGRAM_CACHE_SIZE - 1)];
+	if (*slot && (*slot)->Matches(aFormat, aLength, aParamCount, hash))
+	{
+		aCached = true;
+		return *slot;
+	}
+	FormatProgram *program = Compile(aFormat, aLength, aParamCount);
+	if (program)
+	{
+		program->mHash = hash;
+		free(*slot); // Nothing else can be using it, since no script code runs while formatting.
+		*slot = program;
+		aCached = true;
+	}
+	return program;
+}
+
+
+
+static int FormatValue(LPTSTR aTarget, LPCTSTR aSpec, ExprTokenType &aValue)
+// Formats aValue into aTarget, or if aTarget is NULL, returns the length required.
+// Each type is passed as itself, so that printf reads the argument correctly on any ABI.
+{
+	switch (aValue.symbol)
+	{
+	case SYM_INTEGER: return aTarget ? _stprintf(aTarget, aSpec, aValue.value_int64) : _sctprintf(aSpec, aValue.value_int64);
+	case SYM_FLOAT: return aTarget ? _stprintf(aTarget, aSpec, aValue.value_double) : _sctprintf(aSpec, aValue.value_double);
+	default: return aTarget ? _stprintf(aTarget, aSpec, aValue.marker) : _sctprintf(aSpec, aValue.marker);
+	}
+}
+
+
+
+FormatItem *FormatProgram::Run(ExprTokenType *aParam[], LPTSTR aTarget, size_t &aLength)
+// If aTarget is NULL, sets aLength to the length of the result.  Otherwise, writes the result and
+// a terminator to aTarget, which must be large enough, and sets aLength to the number written.
+// Returns NULL on success, or the item whose parameter has the wrong type (String or Number,
+// depending on item->symbol).  Values are checked in the order the original implementation did.
+{
+	LPTSTR target = aTarget;
+	size_t size = 0, length;
+	TCHAR number_buf[MAX_NUMBER_SIZE];
+	ExprTokenType value;
+
+	for (FormatItem *item = mItem; ; ++item)
+	{
+		if (target)
+			tmemcpy(target, mText + item->literal, item->literal_length), target += item->literal_length;
+		else
+			size += item->literal_length;
+		if (!item->param) // Final item.
+			break;
+		ExprTokenType &param = *aParam[item->param];
+		value.symbol = item->symbol;
+		if (value.symbol == SYM_STRING)
+		{
+			if (TokenToObject(param))
+				return item;
+			value.marker = TokenToString(param, number_buf);
+		}
+		else
+		{
+			if (!TokenIsNumeric(param))
+				return item;
+			if (value.symbol == SYM_INTEGER)
+				value.value_int64 = TokenToInt64(param);
+			else
+				value.value_double = TokenToDouble(param);
+		}
+		if (item->check_only)
+			continue;
+
+		if (!item->spec_length)
+		{
+			// Plain string: stop at the first binary zero, the same as "%s".
+			length = _tcslen(value.marker);
+			if (target)
+				tmemcpy(target, value.marker, length), target += length;
+			else
+				size += length;
+		}
+		else if (target)
+		{
+			int len = FormatValue(target, item->spec, value);
+			switch (item->custom_format)
+			{
+			case 0: break; // Might help performance to list this first.
+			case 'U': CharUpper(target); break;
+			case 'L': CharLower(target); break;
+			case 'T': StrToTitleCase(target); break;
+			}
+			target += len;
+		}
+		else
+			size += FormatValue(NULL, item->spec, value);
+	}
+	if (target)
+	{
+		*target = '\0';
+		size = target - aTarget;
+	}
+	aLength = size;
+	return NULL;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+//
+// FormatProgram - A Format() string compiled into a sequence of items.
+//
+// Each item consists of literal text followed by a placeholder, so that repeated calls with the
+// same format string don't need to parse it again.  Which placeholders are valid depends on the
+// number of parameters, so that is part of the key.  The cache used by Get() is direct-mapped;
+// long strings are unlikely to be reused, so aren't cached.
+//
+
+#define FORMAT_PROGRAM_CACHE_SIZE 32 // Must be a power of 2.
+#define FORMAT_PROGRAM_CACHE_MAX_LENGTH 1024
+#define FORMAT_SPEC_SIZE (12+MAX_INTEGER_LENGTH*2)
+
+struct FormatItem
+{
+	UINT literal, literal_length; // Literal text preceding the placeholder, in FormatProgram::mText.
+	int param;                    // Parameter index, or 0 for the final item, which has only literal text.
+	SymbolType symbol;            // SYM_STRING, SYM_INTEGER or SYM_FLOAT.
+	bool check_only;              // Invalid placeholder which is output as literal text, but whose value is still type-checked.
+	TCHAR custom_format;          // 'U', 'L', 'T' or 0.
+	int spec_length;              // 0 if the value is a string to be copied as-is, otherwise the length of spec.
+	TCHAR spec[FORMAT_SPEC_SIZE]; // printf format specifier.
+};
+
+struct FormatProgram
+{
+	UINT mHash;
+	int mParamCount;
+	size_t mSourceLength;
+	LPTSTR mSource; // Copy of the format string, for Matches().
+	LPTSTR mText;   // Literal text of all items, with {{} and {}} already translated.
+	FormatItem *mItem;
+
+	static FormatProgram *Compile(LPCTSTR aFormat, size_t aLength, int aParamCount);
+	static FormatProgram *Get(LPCTSTR aFormat, size_t aLength, int aParamCount, bool &aCached);
+
+	FormatItem *Run(ExprTokenType *aParam[], LPTSTR aTarget, size_t &aLength);
+
+	static UINT Hash(LPCTSTR aFormat, size_t aLength, int aParamCount)
+	{
+		UINT hash = 2166136261U ^ (UINT)aParamCount; // FNV-1a.
+		for (size_t i = 0; i < aLength; ++i)
+			hash = (hash ^ (UINT)aFormat[i]) * 16777619U;
+		return hash;
+	}
+
+	bool Matches(LPCTSTR aFormat, size_t aLength, int aParamCount, UINT aHash)
+	{
+		return mHash == aHash && mSourceLength == aLength && mParamCount == aParamCount
+			&& !tmemcmp(mSource, aFormat, aLength);
+	}
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+
+//
+// HookEventQueue - Single-producer/single-consumer ring of hotkey and hotstring events.
+//
+// The hook thread (the only producer) pushes a record for each AHK_HOOK_HOTKEY or AHK_HOTSTRING
+// message just before posting it, and the main thread (the only consumer) takes the record back
+// when it retrieves the message.  The ring adds the hook's timestamp and other details which don't
+// fit in wParam/lParam.  Records whose messages were discarded or consumed by some other message
+// pump are discarded when a newer record is taken.  If the ring is full, the record is dropped
+// but the message is still posted.
+//
+// Events are not dispatched from the ring.  Each one is still posted as its own message, which
+// carries everything needed to launch the thread, because the message queue provides behaviour
+// that a ring with a single wake-up message would have to duplicate:
+//  - While the current thread is uninterruptible, MsgSleep() leaves these messages in the queue
+//    by filtering on the message range (MSG_FILTER_MAX).  They are then retrieved in the order
+//    they were posted relative to WM_HOTKEY (registered hotkeys), AHK_GUI_ACTION and menu items,
+//    which are posted by other threads and the OS.  Draining a separate ring would reorder hook
+//    hotkeys relative to those events.
+//  - When a MsgBox, menu or other message pump is running, it dispatches these messages to
+//    MainWindowProc(), which re-posts each one and calls MsgSleep() if the thread is interruptible.
+//    Each event thus survives foreign pumps without the ring having to be re-armed.
+//  - Posting from the hook is a single PostMessage() per event, which the hook already did before
+//    the ring existed, so the ring adds no wake-ups; it only adds the record.
+//
+// Nothing here depends on Windows beyond the integer types, so the ring can be exercised outside
+// of the program.
+//
+
+struct HookEvent
+{
+	__int64 time; // Performance counter value at the time the hook posted the event.
+	UINT message; // AHK_HOOK_HOTKEY or AHK_HOTSTRING.
+	UINT id; // The message's wParam: hotkey ID with flags, or hotstring index.
+	USHORT sc; // Scan code, or number of wheel notches.
+	UCHAR input_level;
+};
+
+
+class LatencyHistogram
+{
+public:
+	// Bucket 0 counts latencies below 1 microsecond, and bucket N counts latencies from 2**(N-1)
+	// up to 2**N microseconds.  The last bucket also counts anything larger.
+	enum { BucketCount = 24 };
+
+	UINT mBucket[BucketCount];
+	__int64 mCount, mTotal, mMax; // Microseconds.
+
+	LatencyHistogram() { Reset(); }
+
+	void Reset()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	void Add(__int64 aMicroseconds)
+	{
+		if (aMicroseconds < 0) // Shouldn't happen.
+			aMicroseconds = 0;
+		int b = 0;
+		for (__int64 n = aMicroseconds; n && b < BucketCount - 1; n >>= 1)
+			++b;
+		++mBucket[b];
+		++mCount;
+		mTotal += aMicroseconds;
+		if (mMax < aMicroseconds)
+			mMax = aMicroseconds;
+	}
+
+	static __int64 BucketLimit(int aBucket) // Returns the exclusive upper limit of aBucket, in microseconds.
+	{
+		return aBucket < BucketCount - 1 ? (__int64)1 << aBucket : _I64_MAX;
+	}
+};
+
+
+class HookEventQueue
+{
+public:
+	enum : UINT { Capacity = 256 }; // Must be a power of 2.
+
+	// Statistics.  Those updated by the producer are atomic so that they can be read by the consumer,
+	// which should use HighWater() and Overflows() rather than reading them directly.
+	std::atomic<UINT> mHighWater {0}; // Greatest number of records which were in the ring at once.
+	std::atomic<UINT> mOverflows {0}; // Number of records dropped because the ring was full.
+	UINT mSkipped = 0; // Number of records skipped because their messages weren't received by MsgSleep().
+	LatencyHistogram mLatency; // Time from the hook posting the event to the start of its thread.
+
+	// Called only by the producer.
+	bool Push(const HookEvent &aEvent)
+	{
+		if (mResetPending.load(std::memory_order_acquire))
+		{
+			// The consumer requested a reset.  Only the producer writes these, so that an update
+			// can't be lost between the consumer's reset and the producer's read-modify-write.
+			mHighWater.store(0, std::memory_order_relaxed);
+			mOverflows.store(0, std::memory_order_relaxed);
+			mResetPending.store(false, std::memory_order_release);
+		}
+		UINT head = mHead.load(std::memory_order_relaxed);
+		UINT tail = mTail.load(std::memory_order_acquire);
+		if (head - tail >= Capacity)
+		{
+			mOverflows.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		mItem[head & (Capacity - 1)] = aEvent;
+		mHead.store(head + 1, std::memory_order_release);
+		UINT depth = head + 1 - tail;
+		if (depth > mHighWater.load(std::memory_order_relaxed))
+			mHighWater.store(depth, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Called only by the consumer.
+	bool Pop(HookEvent &aEvent)
+	{
+		UINT tail = mTail.load(std::memory_order_relaxed);
+		if (tail == mHead.load(std::memory_order_acquire))
+			return false;
+		aEvent = mItem[tail & (Capacity - 1)];
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Called only by the consumer.  Takes the oldest record matching aMessage and aID, discarding any
+	// older records.  If there is no matching record (such as because the message was re-posted after
+	// its record was discarded), the ring is left unchanged and false is returned.
+	bool Take(UINT aMessage, UINT aID, HookEvent &aEvent)
+	{
+		UINT tail = mTail.load(std::memory_order_relaxed);
+		UINT head = mHead.load(std::memory_order_acquire);
+		for (UINT i = tail; i != head; ++i)
+		{
+			const HookEvent &item = mItem[i & (Capacity - 1)];
+			if (item.message == aMessage && item.id == aID)
+			{
+				aEvent = item;
+				mSkipped += i - tail;
+				mTail.store(i + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	UINT Depth()
+	{
+		return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_relaxed);
+	}
+
+	// Called only by the consumer.  The producer's statistics are reset by the producer itself when it
+	// next pushes a record; until then, HighWater() and Overflows() return 0.  An overflow or new
+	// high-water mark which the producer records while the request is being made may be discarded
+	// by the reset, so they are exact only to within one event.
+	void ResetStats()
+	{
+		mResetPending.store(true, std::memory_order_release);
+		mSkipped = 0;
+		mLatency.Reset();
+	}
+
+	UINT HighWater()
+	{
+		return mResetPending.load(std::memory_order_acquire) ? 0 : mHighWater.load(std::memory_order_relaxed);
+	}
+
+	UINT Overflows()
+	{
+		return mResetPending.load(std::memory_order_acquire) ? 0 : mOverflows.load(std::memory_order_relaxed);
+	}
+
+private:
+	HookEvent mItem[Capacity];
+	std::atomic<UINT> mHead {0}; // Index of the next record to be written; modified only by the producer.
+	std::atomic<UINT> mTail {0}; // Index of the next record to be read; modified only by the consumer.
+	std::atomic<bool> mResetPending {false}; // Set by the consumer and cleared by the producer.
+};
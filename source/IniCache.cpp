@@ -0,0 +1,351 @@
+#include "stdafx.h" // pre-compiled headers
+#include "util.h"
+#include "IniCache.h"
+
+#ifdef UNICODE // The ANSI build calls the API directly; see IniRead().
+
+#define INI_CACHE_SLOTS 4
+#define INI_CACHE_MAX_FILE_SIZE (64 * 1024 * 1024)
+
+static IniFile sIniCache[INI_CACHE_SLOTS];
+static int sIniCacheNext = 0; // The slot to reuse for the next file not already in the cache.
+
+
+
+// Compares two names the same way as the profile API: ordinal, ignoring case.
+static int IniCompare(LPCTSTR aName1, int aLength1, LPCTSTR aName2, int aLength2)
+{
+	return CompareStringOrdinal(aName1, aLength1, aName2, aLength2, TRUE) - CSTR_EQUAL;
+}
+
+static int __cdecl IniCompareSections(const void *a, const void *b)
+{
+	auto &s1 = *(const IniSection *)a, &s2 = *(const IniSection *)b;
+	int result = IniCompare(s1.name, s1.name_length, s2.name, s2.name_length);
+	return result ? result : s1.name < s2.name ? -1 : 1; // Keep duplicates in their original order.
+}
+
+static int __cdecl IniCompareKeys(const void *a, const void *b)
+{
+	auto &k1 = *(const IniKey *)a, &k2 = *(const IniKey *)b;
+	int result = IniCompare(k1.name, k1.name_length, k2.name, k2.name_length);
+	return result ? result : k1.name < k2.name ? -1 : 1;
+}
+
+
+
+static bool IsMappedToRegistry(LPCTSTR aPath)
+// Returns true if the profile API would redirect this file to the registry, in which case the
+// contents of the file are irrelevant.  Mappings are keyed by file name only.
+{
+	LPCTSTR name = _tcsrchr(aPath, '\\');
+	name = name ? name + 1 : aPath;
+	TCHAR subkey[T_MAX_PATH + 64];
+	sntprintf(subkey, _countof(subkey), _T("SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\IniFileMapping\\%s"), name);
+	HKEY key;
+	if (RegOpenKeyEx(HKEY_LOCAL_MACHINE, subkey, 0, KEY_QUERY_VALUE, &key) != ERROR_SUCCESS)
+		return false;
+	RegCloseKey(key);
+	return true;
+}
+
+
+
+bool IniFile::Matches(LPCTSTR aPath)
+{
+	return mPath && !_tcsicmp(mPath, aPath);
+}
+
+
+
+bool IniFile::IsCurrent(ULONGLONG aSize, const FILETIME &aWriteTime)
+{
+	return mSize == aSize && !CompareFileTime(&mWriteTime, &aWriteTime);
+}
+
+
+
+void IniFile::Reload(LPCTSTR aPath, ULONGLONG aSize, const FILETIME &aWriteTime)
+// If the file can't be cached, the slot still records its path, size and time so that subsequent
+// lookups fall back to the API without reading the file again until it changes.
+{
+	Free();
+	if (  !(mPath = _tcsdup(aPath))  )
+		return;
+	mSize = aSize;
+	mWriteTime = aWriteTime;
+	if (IsMappedToRegistry(aPath))
+		return;
+	HANDLE file = CreateFile(aPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE
+		, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	// Use the size and time of the file actually being read, in case it changed after the caller checked.
+	BY_HANDLE_FILE_INFORMATION info;
+	if (GetFileInformationByHandle(file, &info))
+	{
+		mSize = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+		mWriteTime = info.ftLastWriteTime;
+		if (!Load(file, mSize))
+		{
+			LPTSTR path = mPath;
+			mPath = nullptr; // Retain the path, size and time.
+			Free();
+			mPath = path;
+		}
+	}
+	CloseHandle(file);
+}
+
+
+
+bool IniFile::Load(HANDLE aFile, ULONGLONG aSize)
+// Reads and decodes the file the same way as the profile API: UTF-16LE if it starts with a BOM,
+// otherwise the ANSI code page.  Files in any other form are not cached.
+{
+	if (aSize > INI_CACHE_MAX_FILE_SIZE)
+		return false;
+	DWORD size = (DWORD)aSize, bytes_read;
+	auto data = (LPBYTE)malloc(size + 1);
+	if (!data)
+		return false;
+	if (!ReadFile(aFile, data, size, &bytes_read, NULL) || bytes_read != size)
+	{
+		free(data);
+		return false;
+	}
+	LPTSTR text = nullptr;
+	size_t length = 0;
+	if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE)
+	{
+		if (!(size & 1))
+		{
+			length = (size - 2) / sizeof(TCHAR);
+			text = tmalloc(length + 1);
+			if (text)
+				tmemcpy(text, (LPTSTR)(data + 2), length);
+		}
+	}
+	else if (!(size >= 2 && data[0] == 0xFE && data[1] == 0xFF) // UTF-16BE.
+		&& !(size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) // UTF-8.
+		&& !memchr(data, 0, size)) // Probably UTF-16 without a BOM.
+	{
+		length = size ? MultiByteToWideChar(CP_ACP, 0, (LPCSTR)data, size, NULL, 0) : 0;
+		text = tmalloc(length + 1);
+		if (text)
+			MultiByteToWideChar(CP_ACP, 0, (LPCSTR)data, size, text, (int)length);
+	}
+	free(data);
+	if (!text)
+		return false;
+	text[length] = '\0';
+	return Parse(text, length);
+}
+
+
+
+bool IniFile::Parse(LPTSTR aText, size_t aLength)
+// Takes ownership of aText, which must be terminated at aLength.  Returns false if the text contains
+// anything the API might interpret differently, such as a line which is neither a comment, a section
+// nor a key=value pair, or a key outside of any section.
+{
+	mText = aText;
+	int section_max = 0, key_max = 0;
+	LPTSTR end = aText + aLength;
+	for (LPTSTR line = aText, line_end; line < end; line = line_end + 1)
+	{
+		for (line_end = line; line_end < end && *line_end != '\n' && *line_end != '\r'; ++line_end);
+		LPTSTR cp = line_end;
+		while (line < cp && IS_SPACE_OR_TAB(*line))
+			++line;
+		while (cp > line && IS_SPACE_OR_TAB(cp[-1]))
+			--cp;
+		if (line == cp || *line == ';') // Blank line or comment.
+			continue;
+		if (!*line) // Binary zero, which the API might treat as the end of the file.
+			return false;
+		if (*line == '[')
+		{
+			if (cp[-1] != ']' || cp - line < 2)
+				return false;
+			LPTSTR name = line + 1, name_end = cp - 1;
+			if (name < name_end && (IS_SPACE_OR_TAB(*name) || IS_SPACE_OR_TAB(name_end[-1])))
+				return false;
+			for (cp = name; cp < name_end; ++cp)
+				if (*cp == '[' || *cp == ']' || !*cp)
+					return false;
+			if (mSectionCount == section_max)
+			{
+				section_max = section_max ? section_max * 2 : 16;
+				auto new_section = (IniSection *)realloc(mSection, section_max * sizeof(IniSection));
+				if (!new_section)
+					return false;
+				mSection = new_section;
+			}
+			IniSection &section = mSection[mSectionCount++];
+			section.name = name;
+			section.name_length = (int)(name_end - name);
+			section.key = (IniKey *)(INT_PTR)mKeyCount; // Converted to a pointer below, once mKey is final.
+			section.key_count = 0;
+			continue;
+		}
+		if (!mSectionCount)
+			return false;
+		LPTSTR equals = line, key_end, value, value_end = cp;
+		for (; equals < cp; ++equals)
+		{
+			if (*equals == '=')
+				break;
+			if (!*equals)
+				return false;
+		}
+		if (equals == cp) // No '=', which the API might treat as a key with no value or ignore.
+			return false;
+		for (key_end = equals; key_end > line && IS_SPACE_OR_TAB(key_end[-1]); --key_end);
+		for (value = equals + 1; value < value_end && IS_SPACE_OR_TAB(*value); ++value);
+		for (cp = value; cp < value_end; ++cp)
+			if (!*cp)
+				return false;
+		// The API discards a pair of quotation marks enclosing the value.
+		if (value_end - value >= 2 && (*value == '"' || *value == '\'') && value_end[-1] == *value)
+			++value, --value_end;
+		if (mKeyCount == key_max)
+		{
+			key_max = key_max ? key_max * 2 : 64;
+			auto new_key = (IniKey *)realloc(mKey, key_max * sizeof(IniKey));
+			if (!new_key)
+				return false;
+			mKey = new_key;
+		}
+		IniKey &key = mKey[mKeyCount++];
+		key.name = line;
+		key.name_length = (int)(key_end - line);
+		key.value = value;
+		key.value_length = (int)(value_end - value);
+		++mSection[mSectionCount - 1].key_count;
+	}
+	for (int i = 0; i < mSectionCount; ++i)
+	{
+		IniSection &section = mSection[i];
+		section.key = mKey + (INT_PTR)section.key;
+		qsort(section.key, section.key_count, sizeof(IniKey), IniCompareKeys);
+	}
+	qsort(mSection, mSectionCount, sizeof(IniSection), IniCompareSections);
+	return true;
+}
+
+
+
+IniKey *IniFile::Find(LPCTSTR aSection, LPCTSTR aKey)
+// Returns NULL if the key wasn't found or if the section or key is duplicated, since it isn't
+// certain which one the API would use.
+{
+	if (!mText)
+		return nullptr;
+	int section_length = (int)_tcslen(aSection), key_length = (int)_tcslen(aKey);
+	int left = 0, right = mSectionCount, mid;
+	while (left < right)
+	{
+		mid = left + ((right - left) >> 1);
+		if (IniCompare(mSection[mid].name, mSection[mid].name_length, aSection, section_length) < 0)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	if (left == mSectionCount
+		|| IniCompare(mSection[left].name, mSection[left].name_length, aSection, section_length)
+		|| (left + 1 < mSectionCount
+			&& !IniCompare(mSection[left + 1].name, mSection[left + 1].name_length, aSection, section_length)))
+		return nullptr;
+	IniSection &section = mSection[left];
+	for (left = 0, right = section.key_count; left < right; )
+	{
+		mid = left + ((right - left) >> 1);
+		if (IniCompare(section.key[mid].name, section.key[mid].name_length, aKey, key_length) < 0)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	if (left == section.key_count
+		|| IniCompare(section.key[left].name, section.key[left].name_length, aKey, key_length)
+		|| (left + 1 < section.key_count
+			&& !IniCompare(section.key[left + 1].name, section.key[left + 1].name_length, aKey, key_length)))
+		return nullptr;
+	return section.key + left;
+}
+
+
+
+void IniFile::Free()
+{
+	free(mPath);
+	free(mText);
+	free(mSection);
+	free(mKey);
+	mPath = nullptr;
+	mText = nullptr;
+	mSection = nullptr;
+	mKey = nullptr;
+	mSectionCount = mKeyCount = 0;
+}
+
+
+
+static bool IniIsCacheableName(LPCTSTR aName)
+// Names with leading or trailing whitespace and comments are left to the API.
+{
+	size_t length = _tcslen(aName);
+	return length && !IS_SPACE_OR_TAB(*aName) && !IS_SPACE_OR_TAB(aName[length - 1]) && *aName != ';';
+}
+
+
+
+bool IniCacheLookup(LPCTSTR aFilespec, LPCTSTR aSection, LPCTSTR aKey, LPCTSTR &aValue, size_t &aValueLength)
+// aFilespec must be a full path.  Returns true and sets aValue (not null-terminated) and aValueLength
+// if the key was found, or false if the caller should call the API.
+{
+	if (!IniIsCacheableName(aSection) || !IniIsCacheableName(aKey))
+		return false;
+	WIN32_FILE_ATTRIBUTE_DATA attrib;
+	if (!GetFileAttributesEx(aFilespec, GetFileExInfoStandard, &attrib)
+		|| (attrib.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+	ULONGLONG size = ((ULONGLONG)attrib.nFileSizeHigh << 32) | attrib.nFileSizeLow;
+	IniFile *file = nullptr;
+	for (int i = 0; i < INI_CACHE_SLOTS; ++i)
+		if (sIniCache[i].Matches(aFilespec))
+		{
+			file = &sIniCache[i];
+			break;
+		}
+	if (!file)
+	{
+		file = &sIniCache[sIniCacheNext];
+		sIniCacheNext = (sIniCacheNext + 1) % INI_CACHE_SLOTS;
+		file->Reload(aFilespec, size, attrib.ftLastWriteTime);
+	}
+	else if (!file->IsCurrent(size, attrib.ftLastWriteTime))
+		file->Reload(aFilespec, size, attrib.ftLastWriteTime);
+	IniKey *key = file->Find(aSection, aKey);
+	if (!key)
+		return false;
+	aValue = key->value;
+	aValueLength = key->value_length;
+	return true;
+}
+
+
+
+void IniCacheInvalidate(LPCTSTR aFilespec)
+// Called after writing to an INI file, since a write might not change the file's size, and might
+// not change its last-write time if the file system's timestamp resolution is coarse.  aFilespec
+// must be the full path, as passed to IniCacheLookup(); other cached files are unaffected.  A write
+// via a different path to the same file (such as an 8.3 name) isn't detected, the same as a write
+// by another process.  If aFilespec is NULL, all files are discarded.
+{
+	for (int i = 0; i < INI_CACHE_SLOTS; ++i)
+		if (!aFilespec || sIniCache[i].Matches(aFilespec))
+			sIniCache[i].Free();
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+//
+// IniCache - Parsed copies of recently read INI files, used by IniRead to look up individual keys.
+//
+// GetPrivateProfileString() opens and parses the whole file on every call, which adds up when a
+// script reads many keys from a large file.  IniCacheLookup() instead parses the file once into
+// an index of sections and keys sorted for binary search, and reuses it for as long as the file's
+// size and last-write time are unchanged.  The parser is deliberately conservative: only lookups
+// whose result is certain to match the API are answered from the cache.  Anything else, such as
+// a key which isn't present, a file containing lines the parser doesn't fully understand, or a
+// file which Windows maps to the registry, makes IniCacheLookup() return false so that the caller
+// falls back to the API.  Writes always go through the API, followed by IniCacheInvalidate() for
+// the file written.
+//
+
+struct IniKey
+{
+	LPCTSTR name, value; // Not null-terminated.
+	int name_length, value_length;
+};
+
+struct IniSection
+{
+	LPCTSTR name; // Not null-terminated.
+	int name_length;
+	IniKey *key; // The section's keys, sorted by name and then by position in the file.
+	int key_count;
+};
+
+class IniFile
+{
+	LPTSTR mPath = nullptr; // Full path, or NULL if this slot is unused.
+	ULONGLONG mSize = 0;
+	FILETIME mWriteTime = {};
+	LPTSTR mText = nullptr; // Decoded contents, or NULL if the file can't be cached.
+	IniSection *mSection = nullptr; // Sorted by name and then by position in the file.
+	int mSectionCount = 0;
+	IniKey *mKey = nullptr;
+	int mKeyCount = 0;
+
+	bool Load(HANDLE aFile, ULONGLONG aSize);
+
+public:
+	bool Matches(LPCTSTR aPath);
+	bool IsCurrent(ULONGLONG aSize, const FILETIME &aWriteTime);
+	void Reload(LPCTSTR aPath, ULONGLONG aSize, const FILETIME &aWriteTime);
+	bool Parse(LPTSTR aText, size_t aLength);
+	IniKey *Find(LPCTSTR aSection, LPCTSTR aKey);
+	void Free();
+};
+
+bool IniCacheLookup(LPCTSTR aFilespec, LPCTSTR aSection, LPCTSTR aKey, LPCTSTR &aValue, size_t &aValueLength);
+void IniCacheInvalidate(LPCTSTR aFilespec = nullptr);
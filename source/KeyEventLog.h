@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+
+//
+// KeyEventLog - Large binary ring of keyboard and mouse events seen by the hook.
+//
+// Unlike g_KeyHistory, which is sized for display by KeyHistory and records window titles,
+// each record is a packed 16-byte structure, so the ring can hold millions of events.  The hook
+// thread (the only writer) adds one record as each event leaves LowLevelCommon(), and the main
+// thread copies a range of records out for export.  Records are numbered from 0 in the order they
+// were added; a record which may have been overwritten while it was being copied is discarded by
+// comparing the sequence numbers before and after the copy.
+//
+// The buffer is replaced only by the main thread.  The writer marks itself as active before
+// loading the buffer pointer, so SetCapacity() can safely free the old buffer once it has cleared
+// the pointer and seen that no write is in progress.
+//
+
+#define KEY_EVENT_LOG_MAX_CAPACITY 0x1000000 // 16M records, 256 MB.
+
+struct KeyEventRecord
+{
+	enum : UCHAR
+	{
+		UP = 0x01,
+		MOUSE = 0x02,
+		ARTIFICIAL = 0x04,
+		IGNORED = 0x08,
+		SUPPRESSED = 0x10
+	};
+	// Bit-fields keep the record at 16 bytes with no padding, since records are exported as-is.
+	// 56 bits of performance counter last for over 200 years at the usual frequency of 10 MHz.
+	__int64 time : 56;          // Performance counter value when the hook received the event.
+	__int64 event_type : 8;     // As in KeyHistoryItem: space=none, i=ignored, s=suppressed, h=hotkey, etc.
+	UINT hotkey_id : 24;        // ID with HOTKEY_KEY_UP of the hotkey fired by this event, or HOTKEY_ID_INVALID.
+	UINT input_level : 8;
+	sc_type sc;                 // As in KeyHistoryItem; for the mouse, the number of wheel notches.
+	vk_type vk;
+	UCHAR flags;
+};
+static_assert(sizeof(KeyEventRecord) == 16, "KeyEventRecord must be kept packed; see above.");
+
+
+class KeyEventLog
+{
+	struct Buffer
+	{
+		UINT capacity; // Power of 2.
+		KeyEventRecord item[1];
+	};
+
+	std::atomic<Buffer *> mBuffer {nullptr};
+	std::atomic<bool> mWriting {false};
+	std::atomic<unsigned __int64> mNext {0}; // Sequence number of the next record to be added.
+	unsigned __int64 mFirstValid = 0; // Sequence number of the first record in the current buffer.  Accessed only by the main thread.
+
+public:
+	bool IsEnabled() { return mBuffer.load(std::memory_order_relaxed) != nullptr; }
+
+	UINT Capacity()
+	{
+		auto buf = mBuffer.load(std::memory_order_relaxed);
+		return buf ? buf->capacity : 0;
+	}
+
+	unsigned __int64 Next() { return mNext.load(std::memory_order_acquire); }
+
+	// Called only by the hook thread.
+	void Add(const KeyEventRecord &aRecord)
+	{
+		mWriting.store(true); // Sequentially consistent with the load below and the store in SetCapacity().
+		if (auto buf = mBuffer.load())
+		{
+			auto n = mNext.load(std::memory_order_relaxed);
+			buf->item[n & (buf->capacity - 1)] = aRecord;
+			mNext.store(n + 1, std::memory_order_release);
+		}
+		mWriting.store(false, std::memory_order_release);
+	}
+
+	// Called only by the main thread.  aCapacity is rounded up to a power of 2.  Any existing records
+	// are discarded, but sequence numbering continues so that exported ranges remain distinguishable.
+	// Returns false if out of memory, in which case the log is disabled.
+	bool SetCapacity(UINT aCapacity)
+	{
+		Buffer *old_buf = mBuffer.exchange(nullptr);
+		while (mWriting.load())
+			Sleep(0);
+		free(old_buf);
+		if (!aCapacity)
+			return true;
+		UINT capacity = 1;
+		while (capacity < aCapacity)
+			capacity <<= 1;
+		auto buf = (Buffer *)malloc(offsetof(Buffer, item) + capacity * sizeof(KeyEventRecord));
+		if (!buf)
+			return false;
+		buf->capacity = capacity;
+		// Records numbered before this were in the old buffer.
+		mFirstValid = mNext.load();
+		mBuffer.store(buf);
+		return true;
+	}
+
+	// Sequence number of the oldest record which may still be in the buffer.
+	unsigned __int64 Oldest()
+	{
+		auto next = Next();
+		auto cap = Capacity();
+		auto oldest = next > cap ? next - cap : 0;
+		return oldest > mFirstValid ? oldest : mFirstValid;
+	}
+
+	// Called only by the main thread.  Copies records aStart up to (but not including) aEnd into
+	// aOut, which must have room for aEnd - aStart records.  Returns the sequence number of the first
+	// record which was copied intact; those before it (if any) were overwritten during the copy.
+	unsigned __int64 Copy(unsigned __int64 aStart, unsigned __int64 aEnd, KeyEventRecord *aOut)
+	{
+		auto buf = mBuffer.load(std::memory_order_relaxed);
+		if (!buf)
+			return aEnd;
+		UINT mask = buf->capacity - 1;
+		for (auto n = aStart; n < aEnd; ++n)
+			*aOut++ = buf->item[n & mask];
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// The slot of record (next - capacity) may have been in the middle of being overwritten by
+		// record (next), and any older records have already been overwritten.
+		auto first_intact = Next() + 1 - buf->capacity;
+		if ((__int64)(first_intact - aStart) <= 0)
+			return aStart;
+		return first_intact < aEnd ? first_intact : aEnd;
+	}
+};
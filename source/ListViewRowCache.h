@@ -0,0 +1,139 @@
+#pragma once
+
+//
+// ListViewRowCache - Rows retrieved from a virtual ListView's data source function.
+//
+// A virtual (LVS_OWNERDATA) ListView asks for each field's text via LVN_GETDISPINFO every time it
+// paints the field.  When the rows come from a script function, each row is retrieved once and the
+// text of all of its fields is kept here, so that the function is called once per row rather than
+// once per field and repaint.  The cache is direct-mapped: row N is held by slot N % Size, so the
+// visible rows (which are consecutive and fewer than Size) never evict each other.
+//
+// GuiControlType owns the cache and calls the data source, passing a callback to Prefetch() and
+// CopyField(), which implement its handling of LVN_ODCACHEHINT and LVN_GETDISPINFO.  Nothing here
+// depends on Windows beyond TCHAR, so those can be exercised outside of the program.
+//
+
+class ListViewRowCache
+{
+public:
+	enum { Size = 128 };
+
+	ListViewRowCache() : mText() {}
+	~ListViewRowCache() { Clear(); }
+
+	bool Contains(int aRow)
+	{
+		int slot = aRow % Size;
+		return mText[slot] && mRow[slot] == aRow;
+	}
+
+	// Returns the text of the given zero-based field of a cached row, "" if the row has fewer fields,
+	// or nullptr if the row isn't cached.
+	LPCTSTR Field(int aRow, int aColumn)
+	{
+		if (!Contains(aRow))
+			return nullptr;
+		int slot = aRow % Size;
+		if (aColumn < 0 || aColumn >= mColCount[slot])
+			return _T("");
+		LPCTSTR field = mText[slot];
+		for (int c = 0; c < aColumn; ++c)
+			field += _tcslen(field) + 1;
+		return field;
+	}
+
+	// Stores a copy of a row's fields, evicting whichever row previously occupied its slot.
+	// aFieldText(column, buf) must return the text of the given field, and may use buf, which
+	// has room for MAX_NUMBER_SIZE characters, to format a number.  Returns false on failure
+	// to allocate memory, in which case the slot is left unchanged.
+	template<typename FieldTextFunc>
+	bool Store(int aRow, int aColCount, FieldTextFunc aFieldText)
+	{
+		TCHAR buf[MAX_NUMBER_SIZE];
+		size_t space_needed = 0;
+		for (int c = 0; c < aColCount; ++c)
+			space_needed += _tcslen(aFieldText(c, buf)) + 1;
+		LPTSTR text = (LPTSTR)malloc((space_needed ? space_needed : 1) * sizeof(TCHAR));
+		if (!text)
+			return false;
+		LPTSTR cp = text;
+		for (int c = 0; c < aColCount; ++c)
+		{
+			LPCTSTR field = aFieldText(c, buf);
+			size_t length = _tcslen(field) + 1;
+			tmemcpy(cp, field, length);
+			cp += length;
+		}
+		int slot = aRow % Size;
+		free(mText[slot]);
+		mText[slot] = text;
+		mRow[slot] = aRow;
+		mColCount[slot] = aColCount;
+		return true;
+	}
+
+	// Discards all rows, such as when the data source is replaced or refreshed.
+	void Clear()
+	{
+		for (int i = 0; i < Size; ++i)
+		{
+			free(mText[i]);
+			mText[i] = nullptr;
+		}
+	}
+
+	// Clips the range of rows given by LVN_ODCACHEHINT to the rows which exist and which can be
+	// cached at once.  Returns false if there is nothing to prefetch.  Rows past the limit are
+	// retrieved on demand.
+	static bool HintRange(int aFrom, int aTo, int aRowCount, int &aFirst, int &aLast)
+	{
+		aFirst = aFrom < 0 ? 0 : aFrom;
+		aLast = aTo < aRowCount ? aTo : aRowCount - 1;
+		if (aLast - aFirst >= Size)
+			aLast = aFirst + Size - 1;
+		return aFirst <= aLast;
+	}
+
+	// Handles LVN_ODCACHEHINT: calls aCacheRow(row) for each row which the control is about to display,
+	// clipped by HintRange(), stopping early if it returns false.  aCacheRow must store the row (if it
+	// isn't already cached) and return false if the row couldn't be retrieved or the data source has
+	// gone away.  It may even delete the cache (by destroying the control) as long as it then returns
+	// false, since nothing here is accessed after that.
+	template<typename CacheRowFunc>
+	void Prefetch(int aFrom, int aTo, int aRowCount, CacheRowFunc aCacheRow)
+	{
+		int from, to;
+		if (!HintRange(aFrom, aTo, aRowCount, from, to))
+			return;
+		for (int row = from; row <= to; ++row)
+			if (!aCacheRow(row))
+				break;
+	}
+
+	// Handles LVN_GETDISPINFO: copies the text of a field into aBuf, which has room for aBufSize
+	// characters, calling aCacheRow(aRow) as for Prefetch() to retrieve the row if needed.  aBuf is
+	// left empty if the row doesn't exist or couldn't be retrieved.
+	template<typename CacheRowFunc>
+	void CopyField(int aRow, int aColumn, int aRowCount, LPTSTR aBuf, int aBufSize, CacheRowFunc aCacheRow)
+	{
+		if (aBufSize <= 0 || aRow < 0 || aRow >= aRowCount)
+			return;
+		*aBuf = '\0';
+		if (!aCacheRow(aRow))
+			return;
+		if (LPCTSTR field = Field(aRow, aColumn))
+		{
+			size_t length = _tcslen(field);
+			if (length > (size_t)aBufSize - 1)
+				length = aBufSize - 1;
+			tmemcpy(aBuf, field, length);
+			aBuf[length] = '\0';
+		}
+	}
+
+private:
+	int mRow[Size]; // Index of the row held by each slot.
+	LPTSTR mText[Size]; // Text of each field, zero-terminated and stored consecutively.  NULL if the slot is empty.
+	int mColCount[Size]; // Number of fields in mText.
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+//
+// LoadProfiler - Measures the time spent in each phase of loading the script, for /ProfileLoad.
+//
+// Each phase is timed by a LoadPhaseTimer at the top of the function which implements it.  Time
+// spent in a nested phase (such as ParseOperands() called by ParseAndAddLine()) is attributed only
+// to the nested phase, so the totals don't overlap and add up to the total load time.  Anything
+// outside of the listed phases, such as #Include processing or class resolution, is counted under
+// LOAD_PHASE_OTHER.  When profiling is disabled, each timer only checks a flag.
+//
+
+enum LoadPhase
+{
+	LOAD_PHASE_OTHER,
+	LOAD_PHASE_GET_LINE,
+	LOAD_PHASE_PARSE_AND_ADD_LINE,
+	LOAD_PHASE_PARSE_OPERANDS,
+	LOAD_PHASE_EXPRESSION_TO_POSTFIX,
+	LOAD_PHASE_FINALIZE_EXPRESSION,
+	LOAD_PHASE_PREPARSE_VAR_REFS,
+	LOAD_PHASE_COUNT
+};
+
+
+class LoadProfiler
+{
+	__int64 mTime[LOAD_PHASE_COUNT]; // Performance counter ticks.
+	UINT mCount[LOAD_PHASE_COUNT];
+	__int64 mPhaseStart; // When the current phase was entered or resumed.
+	LoadPhase mPhase;
+
+	void Switch(LoadPhase aPhase)
+	{
+		__int64 now;
+		QueryPerformanceCounter((LARGE_INTEGER *)&now);
+		mTime[mPhase] += now - mPhaseStart;
+		mPhaseStart = now;
+		mPhase = aPhase;
+	}
+
+public:
+	bool mEnabled = false;
+	UINT mFoldedOperators; // Constant operators folded by ExpressionToPostfix().
+	UINT mRemovedBranches; // Unused branches of constant conditions removed by ExpressionToPostfix().
+
+	void Start()
+	{
+		ZeroMemory(mTime, sizeof(mTime));
+		ZeroMemory(mCount, sizeof(mCount));
+		mCount[LOAD_PHASE_OTHER] = 1;
+		mFoldedOperators = 0;
+		mRemovedBranches = 0;
+		mPhase = LOAD_PHASE_OTHER;
+		QueryPerformanceCounter((LARGE_INTEGER *)&mPhaseStart);
+		mEnabled = true;
+	}
+
+	// Must be called only while no LoadPhaseTimer is in scope.
+	void Stop()
+	{
+		Switch(LOAD_PHASE_OTHER);
+		mEnabled = false;
+	}
+
+	LoadPhase Enter(LoadPhase aPhase)
+	{
+		LoadPhase prev = mPhase;
+		Switch(aPhase);
+		++mCount[aPhase];
+		return prev;
+	}
+
+	void Leave(LoadPhase aPrev) { Switch(aPrev); }
+
+	__int64 Time(LoadPhase aPhase) { return mTime[aPhase]; }
+	UINT Count(LoadPhase aPhase) { return mCount[aPhase]; }
+
+	static LPCTSTR PhaseName(LoadPhase aPhase)
+	{
+		static LPCTSTR sName[] = { _T("Other"), _T("GetLine"), _T("ParseAndAddLine"), _T("ParseOperands")
+			, _T("ExpressionToPostfix"), _T("FinalizeExpression"), _T("PreparseVarRefs") };
+		return sName[aPhase];
+	}
+};
+
+extern LoadProfiler g_LoadProfiler;
+
+
+class LoadPhaseTimer
+{
+	LoadPhase mPrev;
+	bool mEnabled;
+public:
+	LoadPhaseTimer(LoadPhase aPhase) : mEnabled(g_LoadProfiler.mEnabled)
+	{
+		if (mEnabled)
+			mPrev = g_LoadProfiler.Enter(aPhase);
+	}
+	~LoadPhaseTimer()
+	{
+		if (mEnabled)
+			g_LoadProfiler.Leave(mPrev);
+	}
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+//
+// Locale-independent comparison of names, for util.h.  It is kept separate so that tests/unit can
+// build it; includers must define TBYTE, LPCTSTR and ctolower().
+//
+
+// Case-insensitive comparison of identifiers and other names.  Equivalent to _tcsicmp() in the "C"
+// locale (the program never calls setlocale), which folds only A-Z and compares everything else by
+// code unit, so the sort order of lists built with _tcsicmp() is preserved.  It is inline because
+// the CRT function checks the current locale on every call, which dominates the cost of comparing
+// short names in the binary searches for variables, functions and properties.  Characters are
+// folded only when they differ, since names usually match except for the final few characters.
+inline int ctcsicmp(LPCTSTR aStr1, LPCTSTR aStr2)
+{
+	for (;; ++aStr1, ++aStr2)
+	{
+		TBYTE c1 = (TBYTE)*aStr1, c2 = (TBYTE)*aStr2;
+		if (c1 != c2)
+		{
+			c1 = (TBYTE)ctolower(c1);
+			c2 = (TBYTE)ctolower(c2);
+			if (c1 != c2)
+				return (int)c1 - (int)c2;
+		}
+		else if (!c1)
+			return 0;
+	}
+}
@@ -0,0 +1,507 @@
+#include "stdafx.h" // pre-compiled headers
+#include "util.h"
+
+// Conversion between numbers and strings: IsNumeric(), ParseNumeric(), istrtoi64()/nstrtoi64()
+// (which underlie ATOI64() and related functions), ITOA64() and FTOA().  These depend on nothing
+// but the definitions in util.h, so tests/unit builds this file to check them against the C runtime.
+
+
+
+SymbolType IsNumeric(LPCTSTR aBuf, BOOL aAllowNegative, BOOL aAllowAllWhitespace
+	, BOOL aAllowFloat, BOOL aAllowImpure)  // BOOL vs. bool might squeeze a little more performance out of this frequently-called function.
+// String can contain whitespace.
+// If aBuf doesn't contain something purely numeric, PURE_NOT_NUMERIC is returned.  The same happens if
+// aBuf contains a float but aAllowFloat is false.  (The aAllowFloat parameter isn't strictly necessary
+// because the caller could just check whether the return value is/isn't PURE_FLOAT to get the same effect.
+// However, supporting aAllowFloat seems to greatly improve maintainability because it saves many callers
+// from having to compare the return value to PURE_INTEGER [they can just interpret the return value as BOOL].
+// It also improves readability due to the "Is" part of the function name.  So it seems worth keeping.)
+// Otherwise, PURE_INTEGER or PURE_FLOAT is returned.
+// If aAllowAllWhitespace==true and the string is blank or all whitespace, PURE_INTEGER is returned.
+// Obsolete comment: Making this non-inline reduces the size of the compressed EXE by only 2K.  Since this
+// function is called so often, it seems preferable to keep it inline for performance.
+{
+	aBuf = omit_leading_whitespace(aBuf); // i.e. caller doesn't have to have ltrimmed, only rtrimmed.
+	if (!*aBuf) // The string is empty or consists entirely of whitespace.
+		return aAllowAllWhitespace ? PURE_INTEGER : PURE_NOT_NUMERIC;
+
+	if (*aBuf == '-')
+	{
+		if (aAllowNegative)
+			++aBuf;
+		else
+			return PURE_NOT_NUMERIC;
+	}
+	else if (*aBuf == '+')
+		++aBuf;
+
+	// Relies on short circuit boolean order to prevent reading beyond the end of the string:
+	BOOL is_hex = IS_HEX(aBuf); // BOOL vs. bool might squeeze a little more performance out this frequently-called function.
+	if (is_hex)
+		aBuf += 2;  // Skip over the 0x prefix.
+
+	// Set defaults:
+	BOOL has_decimal_point = false;
+	BOOL has_exponent = false;
+	BOOL has_at_least_one_digit = false; // i.e. a string consisting of only "+", "-" or "." is not considered numeric.
+	int c; // int vs. char might squeeze a little more performance out of it (it does reduce code size by 5 bytes). Probably must stay signed vs. unsigned for some of the uses below.
+
+	for (;; ++aBuf)
+	{
+		c = *aBuf;
+		if (IS_SPACE_OR_TAB(c))
+		{
+			if (*omit_leading_whitespace(aBuf)) // But that space or tab is followed by something other than whitespace.
+				if (!aAllowImpure) // e.g. "123 456" is not a valid pure number.
+					return PURE_NOT_NUMERIC;
+				// else fall through to the bottom logic.
+			// else since just whitespace at the end, the number qualifies as pure, so fall through to the bottom
+			// logic (it would already have returned in the loop if it was impure)
+			break;
+		}
+		if (!c) // End of string was encountered.
+			break; // The number qualifies as pure, so fall through to the logic at the bottom. (It would already have returned elsewhere in the loop if the number is impure).
+		if (c == '.')
+		{
+			if (!aAllowFloat || has_decimal_point || is_hex) // If aAllowFloat==false, a decimal point at the very end of the number is considered non-numeric even if aAllowImpure==true.  Some callers might rely on this.
+				// i.e. if aBuf contains 2 decimal points, it can't be a valid number.
+				// Note that decimal points are allowed in hexadecimal strings, e.g. 0xFF.EE.
+				// But since that format doesn't seem to be supported by VC++'s atof() and probably
+				// related functions, and since it's extremely rare, it seems best not to support it.
+				return PURE_NOT_NUMERIC;
+			else
+				has_decimal_point = true;
+		}
+		else
+		{
+			if (is_hex ? !_istxdigit(c) : (c < '0' || c > '9')) // And since we're here, it's not '.' either.
+			{
+				if (aAllowImpure) // Since aStr starts with a number (as verified above), it is considered a number.
+				{
+					if (has_at_least_one_digit)
+						return has_decimal_point ? PURE_FLOAT : PURE_INTEGER;
+					else // i.e. the strings "." and "-" are not considered to be numeric by themselves.
+						return PURE_NOT_NUMERIC;
+				}
+				else
+				{
+					if (ctoupper(c) != 'E' // v1.0.46.11: Support scientific notation in floating point numbers.
+						|| !has_at_least_one_digit // But it must have at least one digit to the left of the 'E'. Some callers rely on this check.
+						|| has_exponent
+						|| !aAllowFloat)
+						return PURE_NOT_NUMERIC;
+					if (aBuf[1] == '-' || aBuf[1] == '+') // The optional sign is present on the exponent.
+						++aBuf; // Omit it from further consideration so that the outer loop doesn't see it as an extra/illegal sign.
+					if (aBuf[1] < '0' || aBuf[1] > '9')
+						// Even if it is an 'e', ensure what follows it is a valid exponent.  Some callers rely
+						// on this check, such as ones that expect "0.6e" to be non-numeric.
+						return PURE_NOT_NUMERIC;
+					has_exponent = true;
+					has_decimal_point = true; // For simplicity, since a decimal point after the exponent isn't valid.
+				}
+			}
+			else // This character is a valid digit or hex-digit.
+				has_at_least_one_digit = true;
+		}
+	} // for()
+
+	if (has_at_least_one_digit)
+		return has_decimal_point ? PURE_FLOAT : PURE_INTEGER;
+	else
+		return PURE_NOT_NUMERIC; // i.e. the strings "+" "-" and "." are not numeric by themselves.
+}
+
+
+
+SymbolType ParseNumeric(LPCTSTR aBuf, __int64 &aInt64, double &aDouble)
+// Equivalent to IsNumeric(aBuf, true, false, true) followed by ATOI64() or _tstof(), but integers
+// (the most common case) are validated and converted in a single pass.  Sets aInt64 if the result
+// is PURE_INTEGER or aDouble if it is PURE_FLOAT.
+{
+	LPCTSTR end;
+	__int64 value = istrtoi64(aBuf, &end);
+	if (end != aBuf && !*omit_leading_whitespace(end)) // At least one digit, followed by nothing but whitespace.
+	{
+		aInt64 = value;
+		return PURE_INTEGER;
+	}
+	// Otherwise, it's a float, an integer followed by something else, or not numeric.
+	SymbolType result = IsNumeric(aBuf, true, false, true);
+	if (result == PURE_INTEGER)
+		aInt64 = ATOI64(aBuf);
+	else if (result == PURE_FLOAT)
+		aDouble = _tstof(aBuf); // _tstof() vs. ATOF() because PURE_FLOAT is never hexadecimal.
+	return result;
+}
+
+
+
+template<typename T> T digitsTo(LPCTSTR p, LPCTSTR &end)
+{
+	T i = 0;
+	for (;; ++p)
+	{
+		int c = *p;
+		if (c <= '9' && c >= '0')
+			c -= '0';
+		else
+			break;
+		i = i * 10 + c;
+	}
+	end = p;
+	return i;
+}
+
+
+template<typename T> T xdigitsTo(LPCTSTR p, LPCTSTR &end)
+{
+	T i = 0;
+	for (;; ++p)
+	{
+		int c = *p;
+		if (c <= '9' && c >= '0')
+			c -= '0';
+		else if (c <= 'F' && c >= 'A')
+			c -= 'A' - 10;
+		else if (c <= 'f' && c >= 'a')
+			c -= 'a' - 10;
+		else
+			break;
+		i = i * 16 + c;
+	}
+	end = p;
+	return i;
+}
+
+
+// istrtoi64(): like _tcstoi64, but allows wrapping overflow consistent with
+// arithmetic expressions.  Some behaviour may be unlike _tcstoi64/strtoll:
+//  - Decimal and hexadecimal are always supported; caller cannot specify base.
+//  - A leading '0' does not activate base 8, since we specifically don't want that.
+//  - Only space and tab are considered whitespace, consistent with IsNumeric().
+//  - errno is never set.
+__int64 istrtoi64(LPCTSTR buf, LPCTSTR *endptr)
+{
+	// unsigned vs. signed is unlikely to matter in practice, but only unsigned has
+	// well-defined behaviour regarding overflow (that is, it wraps but technically
+	// never "overflows" according to the standard).
+	UINT64 i;
+
+	// Skip spaces and tabs.
+	LPCTSTR p = omit_leading_whitespace(buf);
+	
+	// Determine/skip sign.
+	bool negative = *p == '-';
+	if (negative || *p == '+')
+		++p;
+
+	LPCTSTR end;
+	if (IS_HEX(p))
+	{
+		p += 2;
+		i = xdigitsTo<UINT64>(p, end);
+	}
+	else
+	{
+		i = digitsTo<UINT64>(p, end);
+	}
+	if (endptr)
+		*endptr = p == end ? buf : end; // Don't consider " -" or "-0x" numeric on its own.
+	// Casting out of range unsigned to signed has "implementation defined" behaviour;
+	// Microsoft's implementation does not change the bit pattern.
+	return negative ? -(__int64)i : (__int64)i;
+}
+
+
+// nstrtoi64(): like istrtoi64, but permits scientific notation (including a decimal
+// fraction, which may be significant in combination with the exponent).
+// This function is mostly identical to istrtoi64, so comments there also apply here.
+// Attempts to merge the two functions resulted in 300-1000 bytes larger code size due
+// to inlining, how heavily these are used, and the fact that omitted parameters are
+// actually still passed by the compiler.
+__int64 nstrtoi64(LPCTSTR buf)
+{
+	UINT64 i;
+
+	LPCTSTR p = omit_leading_whitespace(buf);
+
+	bool negative = *p == '-';
+	if (negative || *p == '+')
+		++p;
+
+	if (IS_HEX(p))
+	{
+		p += 2;
+		i = xdigitsTo<UINT64>(p, p);
+	}
+	else // Decimal.
+	{
+		i = digitsTo<UINT64>(p, p);
+
+		// Check for a decimal fraction/exponent:
+		LPCTSTR end_int = p;
+		if (*p == '.')
+		{
+			do ++p;
+			while (*p <= '9' && *p >= '0');
+		}
+		LPCTSTR end_fraction = p;
+		if (*p == 'e' || *p == 'E')
+		{
+			++p;
+			bool exp_negative = *p == '-';
+			if (exp_negative || *p == '+')
+				++p;
+			UINT64 exp = digitsTo<UINT64>(p, p); // UINT64 vs. char does not affect code size; using UINT64 ensures that unreasonably large exponents produce a consistent result.
+			if (p > end_fraction + 1) // Exponent present.
+			{
+				if (!exp_negative && *end_int == '.')
+				{
+					// Parse additional digits while simultaneously applying part of the exponentiation.
+					for (p = end_int + 1; p < end_fraction && exp; ++p, --exp) // Scan from '.' to 'e'
+						i = i * 10 + (*p - '0');
+				}
+				if (exp >= (exp_negative ? 20 : 64)) // Avoid unnecessary looping for abnormally large exponents.
+				{
+					// For n * 10**64, the low 64 bits of the result are always 0.  
+					// For n / 10**20, the result is always 0 since 10**20 > _UI16_MAX > n.
+					i = 0;
+				}
+				else
+				{
+					// This section multiplies or divides i by a power of 10 without resorting to
+					// floating-point operations.  Overflow of the result is allowed and will wrap,
+					// but to get the correct result we must not wrap the multiplier.
+					while (exp >= 20) // Implies !exp_negative.  10**20 won't fit in multiplier.
+					{
+						i *= 10000000000000000000ull;
+						exp -= 19;
+					}
+					if (exp != 0) // An exponent of 0 is valid but does not alter the result.
+					{
+						// Perform exponentiation by squaring.
+						UINT64 multiplier = 1;
+						UINT64 bs = 10;
+						while (exp > 1)
+						{
+							if (exp & 1) multiplier *= bs;
+							exp >>= 1;
+							bs *= bs;
+						}
+						multiplier *= bs;
+						if (exp_negative)
+							i /= multiplier;
+						else
+							i *= multiplier;
+					}
+				}
+			}
+		}
+	}
+	return negative ? -(__int64)i : (__int64)i;
+}
+
+
+
+static const char sDigitPairs[] =
+	"00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839" "40414243444546474849"
+	"50515253545556575859" "60616263646566676869" "70717273747576777879" "80818283848586878889" "90919293949596979899";
+
+static LPTSTR UINT64ToDigits(UINT64 aValue, LPTSTR aEnd)
+// Writes the decimal digits of aValue so that they end just before aEnd, and returns a pointer to the first digit.
+// Digits are produced two at a time, and 32-bit arithmetic is used once the value fits, since 64-bit
+// division is a library call on x86.
+{
+	LPTSTR p = aEnd;
+	while (aValue > UINT_MAX)
+	{
+		UINT r = (UINT)(aValue % 100);
+		aValue /= 100;
+		p -= 2;
+		p[0] = sDigitPairs[r * 2];
+		p[1] = sDigitPairs[r * 2 + 1];
+	}
+	UINT v = (UINT)aValue;
+	while (v >= 100)
+	{
+		UINT r = v % 100;
+		v /= 100;
+		p -= 2;
+		p[0] = sDigitPairs[r * 2];
+		p[1] = sDigitPairs[r * 2 + 1];
+	}
+	if (v >= 10)
+	{
+		p -= 2;
+		p[0] = sDigitPairs[v * 2];
+		p[1] = sDigitPairs[v * 2 + 1];
+	}
+	else
+		*--p = (TCHAR)('0' + v);
+	return p;
+}
+
+
+
+LPTSTR ITOA64(__int64 aValue, LPTSTR aBuf)
+// Same result as _i64tot(aValue, aBuf, 10).  Caller must ensure aBuf has room for at least 21 characters.
+{
+	TCHAR digits[20];
+	LPTSTR end = digits + _countof(digits);
+	LPTSTR first = UINT64ToDigits(aValue < 0 ? 0 - (UINT64)aValue : (UINT64)aValue, end);
+	LPTSTR cp = aBuf;
+	if (aValue < 0)
+		*cp++ = '-';
+	tmemcpy(cp, first, end - first);
+	cp[end - first] = '\0';
+	return aBuf;
+}
+
+
+
+static int FTOAFixed(double aValue, LPTSTR aBuf)
+// Produces the same output as FTOA() for finite values in fixed notation; i.e. 0, and values with an
+// absolute value in the range 0.001 to 1e17.  Returns the length, or 0 to let the caller use sprintf.
+// "%.17g" rounds the exact binary value to 17 significant digits, so the digits are computed exactly
+// using integer arithmetic: for a value of m * 2**e, the digits are round(m * 10**s / 2**-e), where s
+// is chosen so that there are exactly 17 of them.  Ties are left to sprintf, in case its rounding
+// differs from round-half-even.
+{
+	UINT64 bits;
+	memcpy(&bits, &aValue, sizeof(bits)); // vs. *(UINT64 *)&aValue, which would break strict aliasing.
+	bool negative = (bits >> 63) != 0;
+	int biased_exp = (int)(bits >> 52) & 0x7FF;
+	UINT64 m = bits & 0xFFFFFFFFFFFFFull;
+	LPTSTR cp = aBuf;
+	if (negative)
+		*cp++ = '-';
+	if (!biased_exp)
+	{
+		if (m) // Denormal.
+			return 0;
+		tmemcpy(cp, _T("0.0"), 4);
+		return (int)(cp - aBuf) + 3;
+	}
+	if (biased_exp == 0x7FF) // Inf or NaN.
+		return 0;
+	m |= 1ull << 52;
+	int e = biased_exp - 1075; // aValue = m * 2**e.
+	TCHAR digits[20];
+	LPTSTR digits_end = digits + _countof(digits);
+	LPTSTR first;
+	int int_digits; // Number of digits before the decimal point, or <= 0 if the value is less than 1.
+	if (e >= 0)
+	{
+		if (e > 4) // Too large for fixed notation (2**57 > 1e17).
+			return 0;
+		UINT64 n = m << e;
+		if (n >= 100000000000000000ull) // Scientific notation.
+			return 0;
+		first = UINT64ToDigits(n, digits_end);
+		int_digits = (int)(digits_end - first);
+	}
+	else
+	{
+		int k = -e;
+		if (k > 63)
+			return 0;
+		double abs_value = negative ? -aValue : aValue;
+		if (abs_value < 0.001)
+			return 0;
+		static const UINT64 sPow10[] = { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull
+			, 100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull
+			, 100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull
+			, 1000000000000000000ull, 10000000000000000000ull };
+		// Estimate the decimal exponent; any error is corrected below.
+		int x = 16;
+		while (x > 0 && abs_value < (double)sPow10[x])
+			--x;
+		if (!x && abs_value < 1.0)
+			x = abs_value < 0.01 ? -3 : abs_value < 0.1 ? -2 : -1;
+		UINT64 q;
+		for (int attempt = 0; ; ++attempt)
+		{
+			int s = 16 - x;
+			if (s < 0 || s > 19 || attempt > 2)
+				return 0;
+			// Compute m * 10**s as a 128-bit product.
+			UINT64 p10 = sPow10[s];
+			UINT64 a_lo = (UINT)m, a_hi = m >> 32, b_lo = (UINT)p10, b_hi = p10 >> 32;
+			UINT64 ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+			UINT64 mid = (ll >> 32) + (UINT)lh + (UINT)hl;
+			UINT64 lo = (mid << 32) | (UINT)ll;
+			UINT64 hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+			if (hi >> k) // Quotient wouldn't fit in 64 bits.
+				return 0;
+			q = (hi << (64 - k)) | (lo >> k); // k is in the range 1..63, so both shifts are valid.
+			UINT64 r = lo & ((1ull << k) - 1), half = 1ull << (k - 1);
+			if (r == half)
+				return 0; // Tie.
+			if (r > half)
+				++q;
+			if (q >= 100000000000000000ull)
+				++x;
+			else if (q < 10000000000000000ull)
+				--x;
+			else
+				break;
+		}
+		if (x > 16 || x < -4) // Scientific notation.
+			return 0;
+		first = UINT64ToDigits(q, digits_end);
+		int_digits = x + 1;
+	}
+	// Strip trailing zeros from any fractional digits.
+	LPTSTR last = digits_end;
+	while (last - first > int_digits && last - first > 0 && last[-1] == '0')
+		--last;
+	if (int_digits > 0)
+	{
+		tmemcpy(cp, first, int_digits);
+		cp += int_digits;
+		first += int_digits;
+	}
+	else
+		*cp++ = '0';
+	*cp++ = '.';
+	if (first >= last) // No fractional digits; add ".0" as FTOA() would.
+		*cp++ = '0';
+	else
+	{
+		for (int i = int_digits; i < 0; ++i)
+			*cp++ = '0';
+		tmemcpy(cp, first, last - first);
+		cp += last - first;
+	}
+	*cp = '\0';
+	return (int)(cp - aBuf);
+}
+
+
+
+int FTOA(double aValue, LPTSTR aBuf, int aBufSize)
+// Converts aValue to a string while trying to ensure that conversion back to double will
+// produce the same value.  Trailing 0s after the decimal point are stripped for brevity, when not printed in scientific notation.
+// Numbers printed in scientific notation may not contain a decimal point.
+// Caller must ensure there is sufficient buffer size to avoid truncating the output.
+{
+	if (aBufSize >= 32)
+		if (int length = FTOAFixed(aValue, aBuf))
+			return length;
+	int result = sntprintf(aBuf, aBufSize, _T("%.17g"), aValue);
+	
+	// the 'g' specifier might cause the result to lack a decimal point. 
+	// If the number is not written in scientific notation, and lacks a decimal point,
+	// add ".0" to make the string look like a float.
+	size_t search_result = _tcscspn(aBuf, _T(".e")); 
+	if (search_result == result			// if true, no decimal point, '.', or 'e' was found, add ".0",
+		&& result + 3 <= aBufSize		// but only if the buffer has room for two more characters and the null terminator,
+		&& cisdigit(aBuf[result - 1]))	// and the number isn't some variation of inf or NaN.
+	{
+		aBuf[result] = '.';				// overwrites the current null terminator.
+		aBuf[result+1] = '0';
+		aBuf[result+2] = '\0';
+		result += 2;					// the result is the number of characters written, excluding the terminator.
+	}
+	return result;
+}
@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "ObjectPool.h"
+
+
+ObjectPool::FreeBlock *ObjectPool::sFree[ObjectPool::ClassCount];
+char *ObjectPool::sChunkPos, *ObjectPool::sChunkEnd;
+
+__int64 ObjectPool::sPoolAllocs = 0;
+__int64 ObjectPool::sHeapAllocs = 0;
+__int64 ObjectPool::sFrees = 0;
+__int64 ObjectPool::sInUse = 0;
+UINT ObjectPool::sChunkCount = 0;
+
+
+void *ObjectPool::AllocFromChunk(size_t aClass)
+{
+	size_t size = (aClass + 1) * Granularity;
+	if (sChunkEnd - sChunkPos < (ptrdiff_t)size)
+	{
+		// Distribute whatever remains of the current chunk among the free lists so that it isn't wasted.
+		// Since all sizes are multiples of Granularity, each piece will exactly fit a size class.
+		while (size_t remaining = sChunkEnd - sChunkPos)
+		{
+			size_t c = SizeClass(remaining < MaxSize ? remaining : MaxSize);
+			auto block = (FreeBlock *)sChunkPos;
+			block->next = sFree[c];
+			sFree[c] = block;
+			sChunkPos += (c + 1) * Granularity;
+		}
+		auto chunk = (char *)malloc(ChunkSize);
+		if (!chunk)
+		{
+			--sPoolAllocs;
+			--sInUse;
+			return nullptr;
+		}
+		++sChunkCount;
+		sChunkPos = chunk;
+		sChunkEnd = chunk + ChunkSize;
+	}
+	void *block = sChunkPos;
+	sChunkPos += size;
+	return block;
+}
+
+
+void *ObjectPool::Realloc(void *aPtr, size_t aOldSize, size_t aNewSize)
+{
+	if (!aPtr)
+		return Alloc(aNewSize);
+	if (!aNewSize)
+	{
+		Free(aPtr, aOldSize);
+		return nullptr;
+	}
+	bool old_pooled = aOldSize - 1 < MaxSize, new_pooled = aNewSize - 1 < MaxSize;
+	if (!old_pooled && !new_pooled)
+		return realloc(aPtr, aNewSize);
+	if (old_pooled && new_pooled && SizeClass(aOldSize) == SizeClass(aNewSize))
+		return aPtr; // The block already has enough room.
+	void *new_ptr = Alloc(aNewSize);
+	if (!new_ptr)
+		return nullptr;
+	memcpy(new_ptr, aPtr, aOldSize < aNewSize ? aOldSize : aNewSize);
+	Free(aPtr, aOldSize);
+	return new_ptr;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+//
+// ObjectPool - Size-class free lists for small, frequently churned allocations.
+//
+// Script objects (Object, Array, Map, Closure, etc.) and their initial item buffers are mostly
+// small and short-lived.  Rather than going to the CRT heap for each one, blocks of up to MaxSize
+// bytes are rounded up to a multiple of Granularity and carved out of larger chunks.  Freed blocks
+// are kept on a per-size free list for reuse; chunks are never returned to the system, similar to
+// SimpleHeap.  Larger requests fall through to malloc/realloc/free.  Callers must pass the original
+// size of the block to Free() and Realloc().  Not thread-safe; all callers run on the main thread.
+//
+
+class ObjectPool
+{
+public:
+	enum : size_t
+	{
+		Granularity = 16,
+		ClassCount = 16,
+		MaxSize = Granularity * ClassCount,
+		ChunkSize = 64 * 1024
+	};
+
+private:
+	struct FreeBlock { FreeBlock *next; };
+	static FreeBlock *sFree[ClassCount];
+	static char *sChunkPos, *sChunkEnd;
+
+	static size_t SizeClass(size_t aSize) { return (aSize - 1) / Granularity; } // Caller must ensure aSize > 0.
+	static void *AllocFromChunk(size_t aClass);
+
+public:
+	// Statistics.
+	static __int64 sPoolAllocs; // Number of allocations satisfied by the pool.
+	static __int64 sHeapAllocs; // Number of allocations passed through to malloc due to their size.
+	static __int64 sFrees; // Number of blocks returned to the free lists.
+	static __int64 sInUse; // Number of pool blocks currently allocated.
+	static UINT sChunkCount; // Number of chunks allocated from the system.
+
+	static void *Alloc(size_t aSize)
+	{
+		if (aSize - 1 >= MaxSize) // Also true for 0.
+		{
+			++sHeapAllocs;
+			return malloc(aSize);
+		}
+		size_t c = SizeClass(aSize);
+		++sPoolAllocs;
+		++sInUse;
+		if (auto block = sFree[c])
+		{
+			sFree[c] = block->next;
+			return block;
+		}
+		return AllocFromChunk(c);
+	}
+
+	static void Free(void *aPtr, size_t aSize)
+	{
+		if (!aPtr)
+			return;
+		if (aSize - 1 >= MaxSize)
+		{
+			free(aPtr);
+			return;
+		}
+		size_t c = SizeClass(aSize);
+		auto block = (FreeBlock *)aPtr;
+		block->next = sFree[c];
+		sFree[c] = block;
+		++sFrees;
+		--sInUse;
+	}
+
+	// Resizes a block previously returned by Alloc() or Realloc() (or nullptr, if aOldSize is 0).
+	// Returns nullptr on failure, in which case aPtr remains valid, or if aNewSize is 0.
+	static void *Realloc(void *aPtr, size_t aOldSize, size_t aNewSize);
+};
@@ -0,0 +1,399 @@
+#include "stdafx.h" // pre-compiled headers
+#include "keyboard_mouse.h"
+#include "util.h"
+#include "SendProgram.h"
+
+
+SendProgram *SendProgram::Compile(LPCTSTR aKeys, SendRawModes aSendRaw)
+{
+	UINT op_count, text_length;
+	Parse(aKeys, aSendRaw, nullptr, nullptr, op_count, text_length); // Measure.
+	auto mem = (char *)malloc(sizeof(SendProgram) + op_count * sizeof(SendOp) + text_length * sizeof(TCHAR));
+	if (!mem)
+		return nullptr;
+	auto program = new (mem) SendProgram;
+	program->mRefCount = 1;
+	program->mSendRaw = aSendRaw;
+	program->mLayout = NULL;
+	program->mSourceLength = _tcslen(aKeys);
+	program->mHash = 0;
+	program->mOp = (SendOp *)(mem + sizeof(SendProgram));
+	program->mText = (TCHAR *)(program->mOp + op_count);
+	Parse(aKeys, aSendRaw, program->mOp, program->mText, program->mOpCount, text_length);
+	return program;
+}
+
+
+
+void SendProgram::Parse(LPCTSTR aKeys, SendRawModes aSendRaw, SendOp *aOp, LPTSTR aText
+	, UINT &aOpCount, UINT &aTextLength)
+// If aOp is NULL, only the number of operations and the amount of text are counted.
+// Otherwise, aOp and aText must be large enough, as determined by a previous call.
+// Each iteration of the loop produces exactly one operation except when the item is
+// skipped entirely, so SendKeys() can track sPrevEventModifierDown per operation.
+{
+	UINT op_count = 0, text_length = 0;
+	SendOp op;
+
+	size_t source_length = _tcslen(aKeys);
+	if (aText)
+		tmemcpy(aText, aKeys, source_length + 1);
+	text_length += (UINT)source_length + 1;
+
+	size_t key_text_length, key_name_length;
+	LPCTSTR end_pos, next_word;
+	LPTSTR key_text;
+	TCHAR temp_key_text[1024]; // Make it reasonably large to support any conceivable {Click ...} usage.
+
+	for (; *aKeys; ++aKeys)
+	{
+		ZeroMemory(&op, sizeof(op));
+		op.key_scan = -1;
+		if (!aSendRaw && _tcschr(_T("^+!#{}"), *aKeys))
+		{
+			op.type = SOP_MODIFIER;
+			switch (*aKeys)
+			{
+			case '^': op.mod_mask = MOD_LCONTROL|MOD_RCONTROL; op.mod = MOD_LCONTROL; break;
+			case '+': op.mod_mask = MOD_LSHIFT|MOD_RSHIFT; op.mod = MOD_LSHIFT; break;
+			case '!': op.mod_mask = MOD_LALT|MOD_RALT; op.mod = MOD_LALT; break;
+			case '#': op.mod_mask = MOD_LWIN|MOD_RWIN; op.mod = MOD_LWIN; break;
+			case '}': op.type = SOP_SKIP; break; // Important that these be ignored.  Be very careful about changing this, see below.
+			case '{':
+			{
+				op.type = SOP_RESET; // Set default.
+				if (   !(end_pos = _tcschr(aKeys + 1, '}'))   ) // Ignore it and due to rarity, don't reset mods_for_next_key.
+				{
+					op.type = SOP_SKIP;
+					break; // This check is relied upon by some things below that assume a '}' is present prior to the terminator.
+				}
+				aKeys = omit_leading_whitespace(aKeys + 1); // v1.0.43: Skip leading whitespace inside the braces to be more flexible.
+				if (   !(key_text_length = end_pos - aKeys)   )
+				{
+					if (end_pos[1] == '}')
+					{
+						// The literal string "{}}" has been encountered, which is interpreted as a single "}".
+						++end_pos;
+						key_text_length = 1;
+					}
+					else if (IS_SPACE_OR_TAB(end_pos[1])) // v1.0.48: Support "{} down}", "{} downtemp}" and "{} up}".
+					{
+						next_word = omit_leading_whitespace(end_pos + 1);
+						if (   !_tcsnicmp(next_word, _T("Down"), 4) // "Down" or "DownTemp" (or likely enough).
+							|| !_tcsnicmp(next_word, _T("Up"), 2)   )
+						{
+							if (   !(end_pos = _tcschr(next_word, '}'))   ) // See comments at similar section above.
+							{
+								op.type = SOP_SKIP;
+								break;
+							}
+							key_text_length = end_pos - aKeys; // This result must be non-zero due to the checks above.
+						}
+						else
+							goto brace_case_end;  // The loop's ++aKeys will now skip over the '}', ignoring it.
+					}
+					else // Empty braces {} were encountered (or all whitespace, but literal whitespace isn't sent).
+						goto brace_case_end;  // The loop's ++aKeys will now skip over the '}', ignoring it.
+				}
+
+				// Make a modifiable null-terminated copy to simplify comparisons etc.
+				if (key_text_length >= _countof(temp_key_text))
+					goto brace_case_end; // Skip this unreasonably long (probably invalid) item.
+				op.text = text_length;
+				op.text_length = (UINT)key_text_length;
+				text_length += (UINT)key_text_length + 1;
+				key_text = aText ? aText + op.text : temp_key_text; // When measuring, the item still needs to be parsed since {Raw} and {Text} affect what follows.
+				tmemcpy(key_text, aKeys, key_text_length);
+				key_text[key_text_length] = '\0';
+				op.ch = *key_text;
+
+				if (!_tcsnicmp(key_text, _T("Click"), 5))
+				{
+					op.type = SOP_CLICK;
+					goto brace_case_end; // Options are parsed by SendKeys() since they aren't affected by the layout.
+				}
+				else if (!_tcsicmp(key_text, _T("Raw"))) // This is used by auto-replace hotstrings too.
+				{
+					// As documented, there's no way to switch back to non-raw mode afterward since there's no
+					// correct way to support special (non-literal) strings such as {Raw Off} while in raw mode.
+					aSendRaw = SCM_RAW;
+					goto brace_case_end; // This {} item completely handled, so move on to next.
+				}
+				else if (!_tcsicmp(key_text, _T("Text"))) // Added in v1.1.27
+				{
+					aSendRaw = SCM_RAW_TEXT;
+					goto brace_case_end; // This {} item completely handled, so move on to next.
+				}
+
+				// Since above didn't "goto", this item isn't {Click}.
+				op.event_type = KEYDOWNANDUP;      // Set defaults.
+				op.repeat_count = 1;               //
+				key_name_length = key_text_length; //
+
+				if (auto space_pos = StrChrAny(key_text, _T(" \t"))) // Assign. Also, it relies on the fact that {} key names contain no spaces.
+				{
+					*space_pos = '\0';  // Terminate here so that TextToVK() can properly resolve a single char.
+					key_name_length = space_pos - key_text; // Override the default value set above.
+					next_word = omit_leading_whitespace(space_pos + 1);
+					op.next_word = (UINT)(next_word - key_text) + op.text;
+					// An empty word (as in "{a }") yields a repeat count of zero, as it always has.
+					if (!_tcsnicmp(next_word, _T("Down"), 4))
+					{
+						op.event_type = KEYDOWN;
+						// v1.0.44.05: Added key_down_is_persistent (which is not initialized except here because
+						// it's only applicable when event_type==KEYDOWN).  It avoids the following problem:
+						// When a key is remapped to become a modifier (such as F1::Control), launching one of
+						// the script's own hotkeys via F1 would lead to bad side-effects if that hotkey uses
+						// the Send command. This is because the Send command assumes that any modifiers pressed
+						// down by the script itself (such as Control) are intended to stay down during all
+						// keystrokes generated by that script. To work around this, something like KeyWait F1
+						// would otherwise be needed. within any hotkey triggered by the F1 key.
+						if (!_tcsnicmp(next_word + 4, _T("Temp"), 4)) // "DownTemp" means non-persistent.
+							op.key_down_type = KEYDOWN_TEMP;
+						else if (ctoupper(next_word[4]) == 'R') // "DownR" means treated as a physical modifier (R = remap); i.e. not kept down during Send, but restored after Send (unlike Temp).
+							op.key_down_type = KEYDOWN_REMAP;
+						else
+							op.key_down_type = KEYDOWN_PERSISTENT;
+					}
+					else if (!_tcsicmp(next_word, _T("Up")))
+						op.event_type = KEYUP;
+					else
+						op.repeat_count = ATOI(next_word);
+						// Above: If negative or zero, that is handled further below.
+						// There is no complaint for values <1 to support scripts that want to conditionally send
+						// zero keystrokes, e.g. Send {a %Count%}
+				}
+				op.name_length = (UINT)key_name_length;
+
+				if (op.repeat_count >= 1) // Otherwise, send nothing but reset the modifiers.
+					op.type = SOP_KEY;
+
+				// If what's between {} is unrecognized, such as {Bogus}, it's safest not to send
+				// the contents literally since that's almost certainly not what the user intended.
+				// In addition, reset the modifiers, since they were intended to apply only to
+				// the key inside {}.  Also, the below is done even if repeat-count is zero.
+
+brace_case_end: // This label is used to simplify the code without sacrificing performance.
+				aKeys = end_pos;  // In prep for aKeys++ done by the loop.
+				break;
+			} // case '{'
+			} // switch()
+		} // if (!aSendRaw && strchr("^+!#{}", *aKeys))
+
+		else // Encountered a character other than ^+!#{} ... or we're in raw mode.
+		{
+			op.type = SOP_CHAR;
+			op.ch = *aKeys;
+			op.send_raw = (UCHAR)aSendRaw;
+			if (aSendRaw == SCM_RAW_TEXT)
+			{
+				// \b needs to produce VK_BACK for auto-replace hotstrings to work (this is more useful anyway).
+				// \r and \n need to produce VK_RETURN for decent compatibility.  SendKeySpecial('\n') works for
+				// some controls (such as Scintilla) but has no effect in other common applications.
+				// \t has more utility if translated to VK_TAB.  SendKeySpecial('\t') has no effect in many
+				// common cases, and seems to only work in cases where {tab} would work just as well.
+				switch (*aKeys)
+				{
+				case '\r': // Translate \r but ignore any trailing \n, since \r\n -> {Enter 2} is counter-intuitive.
+					if (aKeys[1] == '\n')
+						++aKeys;
+					// Fall through:
+				case '\n': op.vk = VK_RETURN; break;
+				case '\b': op.vk = VK_BACK; break;
+				case '\t': op.vk = VK_TAB; break;
+				default: op.vk = 0; break; // Send all other characters via SendKeySpecial()/WM_CHAR.
+				}
+			}
+			//else the character is resolved to a VK for the target layout by SendKeys().
+		}
+		if (aOp)
+			aOp[op_count] = op;
+		++op_count;
+	} // for()
+
+	aOpCount = op_count;
+	aTextLength = text_length;
+}
+
+
+
+void InputEventArray::PutKeybd(modLR_type aKeyAsModifiersLR, vk_type aVK, sc_type aSC, DWORD aEventFlags, DWORD aExtraInfo, bool aAltGr)
+// Playback hook only supports sending neutral modifiers.  Caller must ensure that any left/right modifiers
+// such as VK_RCONTROL are translated into neutral (e.g. VK_CONTROL).
+{
+	bool key_up = aEventFlags & KEYEVENTF_KEYUP;
+	// To make the SendPlay method identical in output to the other keystroke methods, have it generate
+	// a leading down/up LControl event immediately prior to each RAlt event (with no key-delay).
+	// This avoids having to add special handling to places like SetModifierLRState() to do AltGr things
+	// differently when sending via playback vs. other methods.  The event order recorded by the journal
+	// record hook is a little different than what the low-level keyboard hook sees, but I don't think
+	// the order should matter in this case:
+	//   sc  vk key	 msg
+	//   138 12 Alt	 syskeydown (right vs. left scan code)
+	//   01d 11 Ctrl keydown (left scan code) <-- In keyboard hook, normally this precedes Alt, not follows it. Seems inconsequential (testing confirms).
+	//   01d 11 Ctrl keyup	(left scan code)
+	//   138 12 Alt	 syskeyup (right vs. left scan code)
+	// Check for VK_MENU not VK_RMENU because caller should have translated it to neutral:
+	if (aVK == VK_MENU && aSC == SC_RALT && aAltGr && mPlayback)
+		// Must pass VK_CONTROL rather than VK_LCONTROL because playback hook requires neutral modifiers.
+		PutKeybd(MOD_LCONTROL, VK_CONTROL, SC_LCONTROL, aEventFlags, aExtraInfo, aAltGr); // Recursive call to self.
+
+	// Above must be done prior to the capacity check below because above might add a new array item.
+	if (mCount == mMax) // Array's capacity needs expanding.
+		if (!Expand())
+			return;
+
+	// Keep track of the predicted modifier state for use in other places:
+	if (key_up)
+		mModifiersLR &= ~aKeyAsModifiersLR;
+	else
+		mModifiersLR |= aKeyAsModifiersLR;
+
+	if (!mPlayback)
+	{
+		INPUT &this_event = mInput[mCount]; // For performance and convenience.
+		this_event.type = INPUT_KEYBOARD;
+		this_event.ki.wVk = aVK;
+		this_event.ki.wScan = (aEventFlags & KEYEVENTF_UNICODE) ? aSC : LOBYTE(aSC);
+		this_event.ki.dwFlags = aEventFlags;
+		this_event.ki.dwExtraInfo = aExtraInfo; // Although our hook won't be installed (or won't detect, in the case of playback), that of other scripts might be, so set this for them.
+		this_event.ki.time = 0; // Let the system provide its own timestamp, which might be more accurate for individual events if this will be a very long SendInput.
+		mHooksToRemove |= HOOK_KEYBD; // Presence of keyboard hook defeats uninterruptibility of keystrokes.
+	}
+	else // Playback hook.
+	{
+		PlaybackEvent &this_event = Playback()[mCount]; // For performance and convenience.
+		if (!(aVK || aSC)) // Caller is signaling that aExtraInfo contains a delay/sleep event.
+		{
+			// Although delays at the tail end of the playback array can't be implemented by the playback
+			// itself, caller wants them put in too.
+			this_event.message = 0; // Message number zero flags it as a delay rather than an actual event.
+			this_event.time_to_wait = aExtraInfo;
+		}
+		else // A normal (non-delay) event for playback.
+		{
+			// By monitoring incoming events in a message/event loop, the following key combinations were
+			// confirmed to be WM_SYSKEYDOWN vs. WM_KEYDOWN (up events weren't tested, so are assumed to
+			// be the same as down-events):
+			// Alt+Win
+			// Alt+Shift
+			// Alt+Capslock/Numlock/Scrolllock
+			// Alt+AppsKey
+			// Alt+F2/Delete/Home/End/Arrow/BS
+			// Alt+Space/Enter
+			// Alt+Numpad (tested all digits & most other keys, with/without Numlock ON)
+			// F10 (by itself) / Win+F10 / Alt+F10 / Shift+F10 (but not Ctrl+F10)
+			// By contrast, the following are not SYS: Alt+Ctrl, Alt+Esc, Alt+Tab (the latter two
+			// are never received by msg/event loop probably because the system intercepts them).
+			// So the rule appears to be: It's a normal (non-sys) key if Alt isn't down and the key
+			// isn't F10, or if Ctrl is down. Though a press of the Alt key itself is a syskey unless Ctrl is down.
+			// Update: The release of ALT is WM_KEYUP vs. WM_SYSKEYUP when it modified at least one key while it was down.
+			if (mModifiersLR & (MOD_LCONTROL | MOD_RCONTROL) // Control is down...
+				|| !(mModifiersLR & (MOD_LALT | MOD_RALT))   // ... or: Alt isn't down and this key isn't Alt or F10...
+					&& aVK != VK_F10 && !(aKeyAsModifiersLR & (MOD_LALT | MOD_RALT))
+				|| (mModifiersLR & (MOD_LALT | MOD_RALT)) && key_up) // ... or this is the release of Alt (for simplicity, assume that Alt modified something while it was down).
+				this_event.message = key_up ? WM_KEYUP : WM_KEYDOWN;
+			else
+				this_event.message = key_up ? WM_SYSKEYUP : WM_SYSKEYDOWN;
+			this_event.vk = aVK;
+			this_event.sc = aSC; // Don't omit the extended-key-bit because it is used later on.
+		}
+	}
+	++mCount;
+}
+
+
+
+void InputEventArray::PutMouse(DWORD aEventFlags, DWORD aData, DWORD aX, DWORD aY, DWORD aExtraInfo)
+// If the array-type is journal playback, caller should include MOUSEEVENTF_ABSOLUTE in aEventFlags if the
+// the mouse coordinates aX and aY are relative to the screen rather than the active window.
+{
+	if (mCount == mMax) // Array's capacity needs expanding.
+		if (!Expand())
+			return;
+
+	if (!mPlayback)
+	{
+		INPUT &this_event = mInput[mCount]; // For performance and convenience.
+		this_event.type = INPUT_MOUSE;
+		this_event.mi.dx = (aX == COORD_UNSPECIFIED) ? 0 : aX; // v1.0.43.01: Must be zero if no change in position is
+		this_event.mi.dy = (aY == COORD_UNSPECIFIED) ? 0 : aY; // desired (fixes compatibility with certain apps/games).
+		this_event.mi.dwFlags = aEventFlags;
+		this_event.mi.mouseData = aData;
+		this_event.mi.dwExtraInfo = aExtraInfo; // Although our hook won't be installed (or won't detect, in the case of playback), that of other scripts might be, so set this for them.
+		this_event.mi.time = 0; // Let the system provide its own timestamp, which might be more accurate for individual events if this will be a very long SendInput.
+		mHooksToRemove |= HOOK_MOUSE; // Presence of mouse hook defeats uninterruptibility of mouse clicks/moves.
+	}
+	else // Playback hook.
+	{
+		// Note: Delay events (sleeps), which are supported in playback mode but not SendInput, are always inserted
+		// via PutKeybd() rather than this function.
+		PlaybackEvent &this_event = Playback()[mCount]; // For performance and convenience.
+		// Determine the type of event specified by caller, but also omit MOUSEEVENTF_MOVE so that the
+		// follow variations can be differentiated:
+		// 1) MOUSEEVENTF_MOVE by itself.
+		// 2) MOUSEEVENTF_MOVE with a click event or wheel turn (in this case MOUSEEVENTF_MOVE is permitted but
+		//    not required, since all mouse events in playback mode must have explicit coordinates at the
+		//    time they're played back).
+		// 3) A click event or wheel turn by itself (same remark as above).
+		// Bits are isolated in what should be a future-proof way (also omits MSG_OFFSET_MOUSE_MOVE bit).
+		switch (aEventFlags & (0x1FFF & ~MOUSEEVENTF_MOVE)) // v1.0.48: 0x1FFF vs. 0xFFF to support MOUSEEVENTF_HWHEEL.
+		{
+		case 0:                      this_event.message = WM_MOUSEMOVE; break; // It's a movement without a click.
+		// In cases other than the above, it's a click or wheel turn with optional WM_MOUSEMOVE too.
+		case MOUSEEVENTF_LEFTDOWN:   this_event.message = WM_LBUTTONDOWN; break;
+		case MOUSEEVENTF_LEFTUP:     this_event.message = WM_LBUTTONUP; break;
+		case MOUSEEVENTF_RIGHTDOWN:  this_event.message = WM_RBUTTONDOWN; break;
+		case MOUSEEVENTF_RIGHTUP:    this_event.message = WM_RBUTTONUP; break;
+		case MOUSEEVENTF_MIDDLEDOWN: this_event.message = WM_MBUTTONDOWN; break;
+		case MOUSEEVENTF_MIDDLEUP:   this_event.message = WM_MBUTTONUP; break;
+		case MOUSEEVENTF_XDOWN:      this_event.message = WM_XBUTTONDOWN; break;
+		case MOUSEEVENTF_XUP:        this_event.message = WM_XBUTTONUP; break;
+		case MOUSEEVENTF_WHEEL:      this_event.message = WM_MOUSEWHEEL; break;
+		case MOUSEEVENTF_HWHEEL:     this_event.message = WM_MOUSEHWHEEL; break; // v1.0.48
+		// WHEEL: No info comes into journal-record about which direction the wheel was turned (nor by how many
+		// notches).  In addition, it appears impossible to specify such info when playing back the event.
+		// Therefore, playback usually produces downward wheel movement (but upward in some apps like
+		// Visual Studio).
+		}
+		// COORD_UNSPECIFIED_SHORT is used so that the very first event can be a click with unspecified
+		// coordinates: it seems best to have the cursor's position fetched during playback rather than
+		// here because if done here, there might be time for the cursor to move physically before
+		// playback begins (especially if our thread is preempted while building the array).
+		this_event.x = (aX == COORD_UNSPECIFIED) ? COORD_UNSPECIFIED_SHORT : (WORD)aX;
+		this_event.y = (aY == COORD_UNSPECIFIED) ? COORD_UNSPECIFIED_SHORT : (WORD)aY;
+		if (aEventFlags & MSG_OFFSET_MOUSE_MOVE) // Caller wants this event marked as a movement relative to cursor's current position.
+			this_event.message |= MSG_OFFSET_MOUSE_MOVE;
+	}
+	++mCount;
+}
+
+
+
+bool InputEventArray::Expand()
+// Returns false if out of memory, in which case mAbort is set so that nothing is sent.
+{
+	if (mAbort) // A prior call failed (might be impossible).  Avoid malloc() in this case.
+		return false;
+	#define EVENT_EXPANSION_MULTIPLIER 2  // Should be very rare for array to need to expand more than a few times.
+	size_t event_size = mPlayback ? sizeof(PlaybackEvent) : sizeof(INPUT);
+	void *new_mem;
+	// SendInput() appears to be limited to 5000 chars (10000 events in array), at least on XP.  This is
+	// either an undocumented SendInput limit or perhaps it's due to the system setting that determines
+	// how many messages can get backlogged in each thread's msg queue before some start to get dropped.
+	// Note that SendInput()'s return value always seems to indicate that all the characters were sent
+	// even when the ones beyond the limit were clearly never received by the target window.
+	// In any case, it seems best not to restrict to 5000 here in case the limit can vary for any reason.
+	// The 5000 limit is documented in the help file.
+	if (   !(new_mem = malloc(EVENT_EXPANSION_MULTIPLIER * mMax * event_size))   )
+	{
+		mAbort = true; // Usually better to send nothing rather than partial.
+		// Leave mInput and mMax in their current valid state, to be freed by Free().
+		return false;
+	}
+	memcpy(new_mem, mInput, mCount * event_size);
+	Free(); // Free the previous block if it was malloc'd vs. provided by the caller.
+	mInput = (LPINPUT)new_mem;
+	mMax *= EVENT_EXPANSION_MULTIPLIER;
+	return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+//
+// SendProgram - A Send key string compiled into a sequence of operations.
+//
+// Compile() parses the string once: it splits it into modifier symbols, characters and {} items,
+// and works out each item's event type, repeat count and mode changes such as {Raw} and {Text}.
+// The parser makes no system calls, so its output depends only on the string and the initial
+// raw mode.  SendKeys() then resolves the layout-dependent parts (key names and characters to
+// VK/SC codes) for the target keyboard layout and caches the result, so that sending the same
+// string again skips both the parsing and the layout lookups.  Anything that depends on the state
+// of the keyboard or on the target window (persistent modifiers, whether a character has to be
+// sent via SendKeySpecial() and so on) is still decided by SendKeys() each time it runs.
+//
+// InputEventArray - The array of events built by SendInput and SendPlay.
+//
+// SendKeys() and the mouse functions generate each keyboard or mouse event as a call to
+// PutKeybdEventIntoArray() or PutMouseEventIntoArray(), which append it here in the form that
+// SendInput() or the playback hook expects.  This makes no system calls either, so the events a
+// program produces can be checked and timed outside of the program.
+//
+
+enum SendOpType : UCHAR
+{
+	SOP_SKIP,     // A character which is ignored, such as an unmatched '{' or '}'.
+	SOP_MODIFIER, // ^ + ! or #, which applies to the next key.
+	SOP_RESET,    // A {} item which sends nothing but cancels any pending modifiers, such as {Raw} or {a 0}.
+	SOP_CLICK,    // {Click ...}; the options are parsed at the time of sending.
+	SOP_KEY,      // Any other {} item.
+	SOP_CHAR      // A character outside of braces, or any character in raw mode.
+};
+
+enum SendKeyDownTypes : UCHAR { KEYDOWN_TEMP = 0, KEYDOWN_PERSISTENT, KEYDOWN_REMAP };
+
+struct SendOp
+{
+	SendOpType type;
+	UCHAR event_type;    // KeyEventTypes, for SOP_KEY.
+	UCHAR key_down_type; // SendKeyDownTypes, for SOP_KEY with event_type == KEYDOWN.
+	UCHAR send_raw;      // SendRawModes in effect, for SOP_CHAR.
+	modLR_type mod_mask; // For SOP_MODIFIER: the modifier is not added if any of these are persistent.
+	modLR_type mod;      // For SOP_MODIFIER: the modifier to add.
+	vk_type vk;          // Resolved VK, or the fixed VK of a {Text} mode character.
+	sc_type sc;          // Resolved SC.
+	SHORT key_scan;      // VkKeyScanEx() result for ch, for SOP_CHAR and single-character key names.
+	TCHAR ch;            // The character, or the first character of the key name.
+	int repeat_count;
+	UINT text;           // Offset of the item's text (the contents of the braces) in mText.
+	UINT text_length;    // Length of the contents of the braces.
+	UINT name_length;    // Length of the key name, which is null-terminated within the text.
+	UINT next_word;      // Offset of the word following the key name, if any.
+};
+
+class SendProgram
+{
+	ULONG mRefCount;
+
+	SendProgram() {}
+	static void Parse(LPCTSTR aKeys, SendRawModes aSendRaw, SendOp *aOp, LPTSTR aText
+		, UINT &aOpCount, UINT &aTextLength);
+
+public:
+	SendRawModes mSendRaw; // The raw mode at the start of the string.
+	HKL mLayout;           // The layout the program has been resolved for, or NULL.
+	UINT mHash;
+	UINT mOpCount;
+	size_t mSourceLength;
+	SendOp *mOp;
+	TCHAR *mText;          // The source string, followed by the text of each {} item.
+
+	// Returns a new program with a reference count of 1, or NULL if out of memory.
+	static SendProgram *Compile(LPCTSTR aKeys, SendRawModes aSendRaw);
+
+	static UINT Hash(LPCTSTR aKeys, size_t aLength, SendRawModes aSendRaw, HKL aLayout)
+	{
+		UINT hash = 2166136261U ^ (UINT)aSendRaw ^ (UINT)(UINT_PTR)aLayout; // FNV-1a.
+		for (size_t i = 0; i < aLength; ++i)
+			hash = (hash ^ (UINT)aKeys[i]) * 16777619U;
+		return hash;
+	}
+
+	bool Matches(LPCTSTR aKeys, size_t aLength, SendRawModes aSendRaw, HKL aLayout, UINT aHash)
+	{
+		return mHash == aHash && mSourceLength == aLength && mSendRaw == aSendRaw && mLayout == aLayout
+			&& !tmemcmp(mText, aKeys, aLength);
+	}
+
+	LPTSTR Text(const SendOp &aOp) { return mText + aOp.text; }
+
+	void AddRef() { ++mRefCount; }
+	void Release()
+	{
+		if (!--mRefCount)
+			free(this);
+	}
+};
+
+
+
+class InputEventArray
+{
+public:
+	LPINPUT mInput;           // The events, for SendInput.  For SendPlay, the same memory holds PlaybackEvents.
+	UINT mCount, mMax;        // Number of events in the array, and its current capacity.
+	modLR_type mModifiersLR;  // The modifier state predicted as of the last event in the array.
+	HookType mHooksToRemove;  // Which hooks would see the events (SendInput only).
+	bool mAbort;              // Set if the array couldn't be expanded, in which case nothing should be sent.
+
+	// aMem is the initial array, with room for aMaxEvents PlaybackEvents if aPlayback is true or INPUTs
+	// otherwise.  The caller must keep it valid until Free() is called.
+	void Init(void *aMem, UINT aMaxEvents, modLR_type aModifiersLR, bool aPlayback)
+	{
+		mInput = (LPINPUT)aMem;
+		mCount = 0;
+		mMax = mInitialMax = aMaxEvents;
+		mModifiersLR = aModifiersLR;
+		mHooksToRemove = 0;
+		mAbort = false;
+		mPlayback = aPlayback;
+	}
+
+	// Appends a keyboard event.  If aVK and aSC are both zero, aExtraInfo is a delay (SendPlay only).
+	// aAltGr indicates that the target layout has AltGr, in which case SendPlay precedes each RAlt
+	// event with LControl, as the system does for the other methods.
+	void PutKeybd(modLR_type aKeyAsModifiersLR, vk_type aVK, sc_type aSC, DWORD aEventFlags, DWORD aExtraInfo, bool aAltGr);
+	// Appends a mouse event.  aExtraInfo is used only by SendInput.
+	void PutMouse(DWORD aEventFlags, DWORD aData, DWORD aX, DWORD aY, DWORD aExtraInfo);
+	bool Expand();
+
+	void Free() // Frees the array if Expand() allocated it.
+	{
+		if (mMax > mInitialMax)
+			free(mInput);
+	}
+
+	PlaybackEvent *Playback() { return (PlaybackEvent *)mInput; }
+
+private:
+	UINT mInitialMax;
+	bool mPlayback;
+};
@@ -19,10 +19,19 @@ GNU General Public License for more details.
 #include "globaldata.h" // for g_script, so that errors can be centrally reported here.
 
 // Static member data:
-SimpleHeap *SimpleHeap::sFirst = NULL;
-SimpleHeap *SimpleHeap::sLast  = NULL;
+SimpleHeap::Arena SimpleHeap::sDefault;
+SimpleHeap::Arena SimpleHeap::sRuntime;
+SimpleHeap::Arena *SimpleHeap::sCurrent = &SimpleHeap::sDefault;
 char *SimpleHeap::sMostRecentlyAllocated = NULL;
-UINT SimpleHeap::sBlockCount = 0;
+SimpleHeap::Arena *SimpleHeap::sMostRecentArena = NULL;
+
+// Header for allocations too large for a block, so that they can be freed along with the arena.
+// Its size is a multiple of sizeof(void *), so alignment is the same as what malloc() returns.
+struct LargeAllocHeader
+{
+	void *next;
+	size_t size;
+};
 
 LPTSTR SimpleHeap::strDup(LPCTSTR aBuf, size_t aLength)
 // v1.0.44.14: Added aLength to improve performance in cases where callers already know the length.
@@ -71,17 +80,33 @@ void* SimpleHeap::Malloc(size_t aSize)
 {
 	if (aSize < 1)
 		return NULL;
-	if (!sFirst) // We need at least one block to do anything, so create it.
-		if (   !(sFirst = CreateBlock())   )
+	Arena &arena = *sCurrent;
+	if (!arena.mFirst) // We need at least one block to do anything, so create it.
+		if (   !(arena.mFirst = CreateBlock(arena))   )
 			return NULL;
-	if (aSize > sLast->mSpaceAvailable)
+	if (aSize > arena.mLast->mSpaceAvailable)
 	{
 		if (aSize > MAX_ALLOC_IN_NEW_BLOCK) // Also covers aSize > BLOCK_SIZE.
-			return malloc(aSize); // Avoid wasting the remainder of the block.
-		if (!(sLast->mNextBlock = CreateBlock()))
+		{
+			// Avoid wasting the remainder of the block.
+			auto large = (LargeAllocHeader *)malloc(sizeof(LargeAllocHeader) + aSize);
+			if (!large)
+				return NULL;
+			large->next = arena.mLarge;
+			large->size = aSize;
+			arena.mLarge = large;
+			arena.mLargeCount++;
+			arena.mLargeBytes += aSize;
+			return large + 1;
+		}
+		SimpleHeap *prev_block = arena.mLast;
+		if (!(prev_block->mNextBlock = CreateBlock(arena))) // This also updates arena.mLast.
 			return NULL;
+		arena.mWasted += prev_block->mSpaceAvailable;
 	}
-	sMostRecentlyAllocated = sLast->mFreeMarker; // THIS IS NOW THE NEWLY ALLOCATED BLOCK FOR THE CALLER, which is 32-bit aligned because the previous call to this function (i.e. the logic below) set it up that way.
+	SimpleHeap *block = arena.mLast;
+	sMostRecentArena = &arena;
+	sMostRecentlyAllocated = block->mFreeMarker; // THIS IS NOW THE NEWLY ALLOCATED BLOCK FOR THE CALLER, which is 32-bit aligned because the previous call to this function (i.e. the logic below) set it up that way.
 	// v1.0.40.04: Set up the NEXT chunk to be aligned on a 32-bit boundary (the first chunk in each block
 	// should always be aligned since the block's address came from malloc()).  On average, this change
 	// "wastes" only 1.5 bytes per chunk. In a 200 KB script of typical contents, this change requires less
@@ -94,10 +119,10 @@ void* SimpleHeap::Malloc(size_t aSize)
 	size_t remainder = aSize % sizeof(void *);
 	size_t size_consumed = remainder ? aSize + (sizeof(void *) - remainder) : aSize;
 	// v1.0.45: The following can't happen when BLOCK_SIZE is a multiple of 4, so it's commented out:
-	//if (size_consumed > sLast->mSpaceAvailable) // For maintainability, don't allow mFreeMarker to go out of bounds or
-	//	size_consumed = sLast->mSpaceAvailable; // mSpaceAvailable to go negative (which it can't due to be unsigned).
-	sLast->mFreeMarker += size_consumed;
-	sLast->mSpaceAvailable -= size_consumed;
+	//if (size_consumed > block->mSpaceAvailable) // For maintainability, don't allow mFreeMarker to go out of bounds or
+	//	size_consumed = block->mSpaceAvailable; // mSpaceAvailable to go negative (which it can't due to be unsigned).
+	block->mFreeMarker += size_consumed;
+	block->mSpaceAvailable -= size_consumed;
 	return (void *)sMostRecentlyAllocated;
 }
 
@@ -118,30 +143,69 @@ void SimpleHeap::Delete(void *aPtr)
 {
 	if (aPtr != sMostRecentlyAllocated || !sMostRecentlyAllocated)
 		return;
-	size_t sMostRecentlyAllocated_size = sLast->mFreeMarker - sMostRecentlyAllocated;
-	sLast->mFreeMarker -= sMostRecentlyAllocated_size;
-	sLast->mSpaceAvailable += sMostRecentlyAllocated_size;
+	SimpleHeap *block = sMostRecentArena->mLast;
+	size_t size = block->mFreeMarker - sMostRecentlyAllocated;
+	block->mFreeMarker -= size;
+	block->mSpaceAvailable += size;
 	sMostRecentlyAllocated = NULL; // i.e. no support for anything other than a one-time delete of an item just added.
 }
 
 
 
-// Commented out because not currently used:
-//void SimpleHeap::DeleteAll()
-//// See Hotkey::AllDestructAndExit for comments about why this isn't actually called.
-//{
-//	SimpleHeap *next, *curr;
-//	for (curr = sFirst; curr != NULL;)
-//	{
-//		next = curr->mNextBlock;  // Save this member's value prior to deleting the object.
-//		delete curr;
-//		curr = next;
-//	}
-//}
+void SimpleHeap::Arena::Release()
+// Frees every block and large allocation of this arena.  This is not used for sDefault, since memory
+// allocated during loading is referenced for the lifetime of the program, and freeing memory just
+// prior to exiting isn't worthwhile.
+{
+	ASSERT(this != &sDefault && this != sCurrent);
+	if (sMostRecentArena == this)
+	{
+		sMostRecentlyAllocated = NULL;
+		sMostRecentArena = NULL;
+	}
+	SimpleHeap *next, *curr;
+	for (curr = mFirst; curr != NULL;)
+	{
+		next = curr->mNextBlock;  // Save this member's value prior to deleting the object.
+		delete curr;
+		curr = next;
+	}
+	for (void *large = mLarge; large != NULL;)
+	{
+		void *next_large = ((LargeAllocHeader *)large)->next;
+		free(large);
+		large = next_large;
+	}
+	*this = Arena();
+}
+
+
+
+void SimpleHeap::Arena::MoveTo(Arena &aOther)
+{
+	ASSERT(!aOther.mFirst && !aOther.mLarge);
+	aOther = *this;
+	*this = Arena();
+	if (sMostRecentArena == this)
+		sMostRecentArena = &aOther;
+}
+
+
+
+void SimpleHeap::Arena::GetStats(UINT &aBlockCount, size_t &aUsed, size_t &aWasted, UINT &aLargeCount, size_t &aLargeBytes)
+{
+	aBlockCount = mBlockCount;
+	// Every block is full except for the space wasted when each new block was created, and whatever
+	// remains in the last block.
+	aUsed = (size_t)mBlockCount * BLOCK_SIZE - mWasted - (mLast ? mLast->mSpaceAvailable : 0);
+	aWasted = mWasted;
+	aLargeCount = mLargeCount;
+	aLargeBytes = mLargeBytes;
+}
 
 
 
-SimpleHeap *SimpleHeap::CreateBlock()
+SimpleHeap *SimpleHeap::CreateBlock(Arena &aArena)
 // Added for v1.0.40.04 to try to solve the fact that some functions such as GetRawInputDeviceList()
 // will sometimes fail if passed memory from SimpleHeap. Although this change didn't actually solve
 // the issue (it turned out to be a 32-bit alignment issue), using malloc() appears to save memory
@@ -157,8 +221,8 @@ SimpleHeap *SimpleHeap::CreateBlock()
 	}
 	// Since above didn't return, block was successfully created:
 	block->mSpaceAvailable = BLOCK_SIZE;
-	sLast = block;  // Constructing a new block always results in it becoming the current block.
-	++sBlockCount;
+	aArena.mLast = block;  // Constructing a new block always results in it becoming the current block.
+	++aArena.mBlockCount;
 	return block;
 }
 
@@ -171,15 +235,12 @@ SimpleHeap::SimpleHeap()  // Construct a new block.  Caller is responsible for i
 
 
 SimpleHeap::~SimpleHeap()
-// This destructor is currently never called because all instances of the object are created
-// with "new", yet none are ever destroyed with "delete".  As an alternative to this behavior
-// the delete method should recursively delete mNextBlock, if it's non-NULL, prior to
-// returning.  It seems unnecessary to do this, however, since the whole idea behind this
-// class is that it's a simple implementation of one-time, persistent memory allocation.
-// It's not intended to permit deallocation and subsequent reclamation of freed fragments
-// within the collection of blocks.  When the program exits, all memory dynamically
-// allocated by the constructor and any other methods that call "new" will be reclaimed
-// by the OS.  UPDATE: This is now called by static method DeleteAll().
+// This destructor is called only by Arena::Release().  Blocks of the default arena are never
+// deleted, since the whole idea behind this class is that it's a simple implementation of
+// one-time, persistent memory allocation.  It's not intended to permit deallocation and
+// subsequent reclamation of freed fragments within the collection of blocks.  When the program
+// exits, all memory dynamically allocated by the constructor and any other methods that call
+// "new" will be reclaimed by the OS.
 {
 	if (mBlock) // v1.0.40.04
 		free(mBlock);
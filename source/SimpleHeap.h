@@ -39,16 +39,51 @@ GNU General Public License for more details.
 
 class SimpleHeap
 {
+public:
+	// Arena: an independent chain of blocks which can be released as a unit.  All allocations go to
+	// the current arena, which is sDefault unless redirected by SetArena() or a Scope.
+	class Arena
+	{
+		friend class SimpleHeap;
+		SimpleHeap *mFirst = nullptr, *mLast = nullptr; // The first and last blocks in the linked list.
+		void *mLarge = nullptr; // Linked list of allocations too large for a block.
+		UINT mBlockCount = 0;
+		UINT mLargeCount = 0;
+		size_t mLargeBytes = 0;
+		size_t mWasted = 0; // Space left unused at the end of each block when a new one was created.
+	public:
+		// Frees all memory allocated from this arena.  The caller must ensure nothing still refers to it.
+		void Release();
+		// Transfers this arena's memory to aOther, which must be empty, leaving this arena empty.
+		void MoveTo(Arena &aOther);
+		void GetStats(UINT &aBlockCount, size_t &aUsed, size_t &aWasted, UINT &aLargeCount, size_t &aLargeBytes);
+	};
+
+	// Scope: redirects allocations to the given arena for the lifetime of the Scope object.
+	class Scope
+	{
+		Arena *mPrev;
+	public:
+		Scope(Arena &aArena) : mPrev(SetArena(&aArena)) {}
+		~Scope() { SetArena(mPrev); }
+	};
+
+	static Arena sDefault; // Used during startup and loading of the script.
+	static Arena sRuntime; // Used after the script has loaded (see SetArena() in WinMain).
+
+	// Sets the arena which future allocations come from, and returns the previous one.
+	static Arena *SetArena(Arena *aArena) { auto prev = sCurrent; sCurrent = aArena; return prev; }
+
 private:
 	char *mBlock; // This object's memory block.  Although private, its contents are public.
 	char *mFreeMarker;  // Address inside the above block of the first unused byte.
 	size_t mSpaceAvailable;
-	static UINT sBlockCount;
-	static SimpleHeap *sFirst, *sLast;  // The first and last objects in the linked list.
-	static char *sMostRecentlyAllocated; // For use with Delete().
 	SimpleHeap *mNextBlock;  // The object after this one in the linked list; NULL if none.
+	static Arena *sCurrent;
+	static char *sMostRecentlyAllocated; // For use with Delete().
+	static Arena *sMostRecentArena; // The arena which sMostRecentlyAllocated came from.
 
-	static SimpleHeap *CreateBlock();
+	static SimpleHeap *CreateBlock(Arena &aArena);
 	SimpleHeap();  // Private constructor, since we want only the static methods to be able to create new objects.
 	~SimpleHeap();
 
@@ -67,8 +102,8 @@ public:
 	// Return a block of memory to the caller, or terminate app on failure.
 	static void* Alloc(size_t aSize);
 
+	// Reclaims aPtr if it was the most recent allocation, regardless of which arena is current.
 	static void Delete(void *aPtr);
-	//static void DeleteAll();
 
 	static void CriticalFail();
 
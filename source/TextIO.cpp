@@ -872,6 +872,37 @@ class FileObject : public Object
 		return RawX(aBuf, aBytes, aRetVal, false);
 	}
 	
+	FResult Map(IObject *&aRetVal)
+	{
+		// Map the whole file into memory, so that a script can access it (and slices of it) as a
+		// Buffer without reading it.  The mapping is writable if the file was opened with write
+		// access; otherwise it is copy-on-write, so writes to the Buffer don't affect the file.
+		HANDLE file = mFile.Handle(); // Also flushes the write buffer.
+		__int64 length = mFile.Length();
+		if (!length) // CreateFileMapping() fails for empty files.
+		{
+			aRetVal = BufferObject::Create();
+			return OK;
+		}
+		if ((unsigned __int64)length > SIZE_MAX)
+			return FR_E_OUTOFMEM;
+		DWORD access = FILE_MAP_WRITE;
+		HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READWRITE, 0, 0, NULL);
+		if (!mapping)
+		{
+			access = FILE_MAP_COPY;
+			if (  !(mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL))  )
+				return FR_E_WIN32(GetLastError());
+		}
+		void *data = MapViewOfFile(mapping, access, 0, 0, 0);
+		DWORD error = GetLastError();
+		CloseHandle(mapping); // The view keeps the mapping open.
+		if (!data)
+			return FR_E_WIN32(error);
+		aRetVal = BufferObject::CreateMapped(data, (size_t)length);
+		return OK;
+	}
+
 	FResult Seek(__int64 aDistance, optl<int> aOrigin, BOOL &aRetVal)
 	{
 		aRetVal = mFile.Seek(aDistance, aOrigin.value_or((aDistance < 0) ? SEEK_END : SEEK_SET));
@@ -974,6 +1005,7 @@ ObjectMemberMd FileObject::sMembers[] =
 	md_property		(FileObject, Encoding, Variant),
 	md_property_get	(FileObject, Handle, UIntPtr),
 	md_property		(FileObject, Length, Int64),
+	md_member		(FileObject, Map, CALL, (Ret, Object, RetVal)),
 	md_property		(FileObject, Pos, Int64),
 	md_member		(FileObject, RawRead, CALL, (In, Variant, Buffer), (In_Opt, UInt32, Bytes), (Ret, UInt32, RetVal)),
 	md_member		(FileObject, RawWrite, CALL, (In, Variant, Data), (In_Opt, UInt32, Bytes), (Ret, UInt32, RetVal)),
@@ -0,0 +1,174 @@
+#include "stdafx.h" // pre-compiled headers
+#include "WinTitleCriteria.h"
+
+
+
+static inline bool IsSpaceOrTab(TCHAR c) { return c == ' ' || c == '\t'; }
+
+static LPCTSTR FindKeyword(LPCTSTR aStart)
+// Returns the address of the next "ahk_" (case-insensitive) at or after aStart, or NULL if none.
+{
+	for (LPCTSTR cp = aStart; *cp; ++cp)
+		if ((*cp == 'a' || *cp == 'A') && !_tcsnicmp(cp, _T("ahk_"), 4))
+			return cp;
+	return NULL;
+}
+
+
+
+WinTitleCriteria *WinTitleCriteria::Compile(LPCTSTR aWinTitle)
+// The rules here must produce the same criteria as WindowSearch::SetCriteria() did when it parsed
+// WinTitle itself.  See the unit tests for the details.
+{
+	auto compiled = new (std::nothrow) WinTitleCriteria;
+	if (!compiled)
+		return NULL;
+	// The buffer holds a copy of aWinTitle (the cache key), then the values of all criteria except id,
+	// and then the values of id, so that they're consecutive.  Each region is at most the length of
+	// aWinTitle plus one terminator, since the values are disjoint substrings separated by at least
+	// their keywords.
+	size_t size = _tcslen(aWinTitle) + 1;
+	if (  !(compiled->mWinTitle = (LPTSTR)malloc(3 * size * sizeof(TCHAR)))  )
+	{
+		delete compiled;
+		return NULL;
+	}
+	tmemcpy(compiled->mWinTitle, aWinTitle, size);
+	LPTSTR buf = compiled->mWinTitle + size, id_buf = buf + size;
+
+	WinTitleCriteria &c = *compiled;
+	c.criteria = 0;
+	c.title = c.class_name = c.path = c.group = c.pid = c.id = _T("");
+	c.title_length = 0;
+	c.id_count = 0;
+	c.path_has_backslash = false;
+
+	DWORD this_criterion = CRITERION_TITLE, next_criterion;
+	LPCTSTR start, end, next_value = nullptr;
+	for (start = aWinTitle; this_criterion; start = next_value, this_criterion = next_criterion)
+	{
+		for (next_criterion = 0, end = start; (end = FindKeyword(end)) != NULL; end += 4)
+		{
+			// To reduce ambiguity, the following requires that any "ahk_" criteria beyond the first
+			// be preceded by at least one space or tab:
+			if (end > aWinTitle && !IsSpaceOrTab(end[-1]))
+				continue;
+			auto cp = end + 4;
+			if (!_tcsnicmp(cp, _T("id"), 2))
+				cp += 2, next_criterion = CRITERION_ID;
+			else if (!_tcsnicmp(cp, _T("pid"), 3))
+				cp += 3, next_criterion = CRITERION_PID;
+			else if (!_tcsnicmp(cp, _T("group"), 5))
+				cp += 5, next_criterion = CRITERION_GROUP;
+			else if (!_tcsnicmp(cp, _T("exe"), 3))
+				cp += 3, next_criterion = CRITERION_PATH;
+			else if (!_tcsnicmp(cp, _T("class"), 5))
+				cp += 5, next_criterion = CRITERION_CLASS;
+			else
+				continue;
+			next_value = cp;
+			break;
+		}
+
+		if (this_criterion == CRITERION_ID || this_criterion == CRITERION_PID)
+		{
+			// Numbers are kept as text, up to the next keyword, for the caller to convert the same
+			// way as it would the original string.
+			size_t length = end ? end - start : _tcslen(start);
+			LPTSTR &dest = this_criterion == CRITERION_ID ? id_buf : buf;
+			tmemcpy(dest, start, length);
+			dest[length] = '\0';
+			if (this_criterion == CRITERION_PID)
+				c.pid = dest; // Any previous ahk_pid is overridden.
+			else if (!c.id_count++)
+				c.id = dest;
+			dest += length + 1;
+			c.criteria |= this_criterion;
+			continue;
+		}
+
+		// Leading whitespace is omitted for backward compatibility.  Even if it's possible for a class
+		// name to start with a space, a RegEx dot or other symbol can be used to match it via
+		// SetTitleMatchMode RegEx.
+		while (IsSpaceOrTab(*start))
+			++start;
+		LPCTSTR value;
+		size_t value_length;
+		if (end == start) // Empty or consists entirely of whitespace.
+		{
+			// For backward compatibility, disqualify any title consisting entirely of whitespace,
+			// but otherwise include any trailing whitespace aside from the final delimiting space.
+			if (this_criterion == CRITERION_TITLE) // Only title, since it has no explicit keyword.
+				continue;
+			value = _T(""); // An empty value is an automatic pass for RegEx mode and fail for other modes.
+			value_length = 0;
+		}
+		else
+		{
+			// Omit exactly one space or tab: the one required to delimit the "ahk_" keyword (end[-1]
+			// is known to be a space or tab because end != start).  Any other spaces or tabs to the
+			// left of that one are considered literal (for flexibility).
+			value_length = end ? end - start - 1 : _tcslen(start);
+			tmemcpy(buf, start, value_length);
+			buf[value_length] = '\0';
+			value = buf;
+			buf += value_length + 1;
+		}
+
+		switch (this_criterion)
+		{
+		case CRITERION_TITLE:
+			c.title = value;
+			c.title_length = value_length;
+			break;
+		case CRITERION_GROUP:
+			c.group = value;
+			break;
+		case CRITERION_PATH:
+			c.path = value;
+			c.path_has_backslash = _tcschr(value, '\\') != NULL;
+			break;
+		case CRITERION_CLASS:
+			c.class_name = value;
+			break;
+		}
+		c.criteria |= this_criterion;
+	}
+	return compiled;
+}
+
+
+
+WinTitleCriteria *WinTitleCache::Get(LPCTSTR aWinTitle)
+{
+	size_t hash = 2166136261U; // FNV-1a.
+	for (LPCTSTR cp = aWinTitle; *cp; ++cp)
+		hash = (hash ^ (size_t)*cp) * 16777619U;
+	Entry &entry = mEntry[hash & (Size - 1)];
+	if (entry.criteria && entry.hash == hash && !_tcscmp(entry.criteria->WinTitle(), aWinTitle))
+	{
+		entry.criteria->AddRef();
+		return entry.criteria;
+	}
+	auto criteria = WinTitleCriteria::Compile(aWinTitle);
+	if (!criteria)
+		return NULL;
+	if (entry.criteria)
+		entry.criteria->Release(); // Might still be in use by a search, in which case it is deleted later.
+	entry.hash = hash;
+	entry.criteria = criteria;
+	criteria->AddRef(); // For the caller.
+	return criteria;
+}
+
+
+
+void WinTitleCache::Clear()
+{
+	for (int i = 0; i < Size; ++i)
+	{
+		if (mEntry[i].criteria)
+			mEntry[i].criteria->Release();
+		mEntry[i].criteria = NULL;
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+//
+// WinTitleCriteria - The compiled form of a WinTitle string, and a cache of recently compiled ones.
+//
+// WindowSearch::SetCriteria() is called once per window per WindowSpec when a window group is
+// evaluated (such as by "ahk_group" in WinExist, or GroupActivate), and once per check by #HotIf
+// WinActive/WinExist and each WinWait poll.  The WinTitle strings involved rarely change, so the
+// result of splitting them into title and "ahk_" criteria is cached, keyed by the exact string.
+// What can't be determined from the string alone (whether an ahk_id window still exists, which
+// group an ahk_group name refers to, and TitleMatchMode) is resolved by SetCriteria() each time.
+//
+// Compiled criteria are reference-counted so that a WindowSearch can keep using them after the
+// cache evicts them, such as when evaluating an ahk_group compiles other WinTitles part-way
+// through a search.  The reference count isn't atomic: each thread must have its own cache, and
+// a WindowSearch must use only criteria compiled by its own thread.
+//
+// Nothing here depends on Windows, so the parsing and matching can be exercised outside of the
+// program.
+//
+
+#include "defines.h" // For TitleMatchModes.
+
+// Bitwise fields to support multiple criteria in v1.0.36.02
+#define CRITERION_TITLE 0x01
+#define CRITERION_ID    0x02
+#define CRITERION_PID   0x04
+#define CRITERION_CLASS 0x08
+#define CRITERION_GROUP 0x10
+#define CRITERION_PATH	0x20
+
+class WinTitleCriteria
+{
+public:
+	DWORD criteria; // Which criteria are present (CRITERION_TITLE, etc.)
+	LPCTSTR title; // The portion of WinTitle preceding the first "ahk_" keyword.
+	size_t title_length;
+	LPCTSTR class_name; // For "ahk_class".
+	LPCTSTR path; // For "ahk_exe".
+	LPCTSTR group; // For "ahk_group": the name of the group, which need not exist yet.
+	LPCTSTR pid; // For "ahk_pid": the text following the keyword, for the caller to convert.
+	LPCTSTR id; // For "ahk_id": the first of id_count values, stored consecutively.  Each value is
+	int id_count; // the text following the keyword; the window must match all of them.
+	bool path_has_backslash; // Whether "ahk_exe" specifies a path rather than just a name.
+
+	// Returns new criteria with a reference count of 1, or NULL if out of memory.
+	static WinTitleCriteria *Compile(LPCTSTR aWinTitle);
+
+	// Returns whether a window with the given title, class and process name or path satisfies the
+	// title, ahk_class and ahk_exe criteria under aMatchMode (a TitleMatchModes value).  Attributes
+	// for criteria which aren't present are ignored.  aRegExMatch(aSubject, aPattern) is called in
+	// RegEx mode, which depends on the program's cache of compiled patterns.  WindowSearch::IsMatch()
+	// checks the remaining criteria.
+	template<typename RegExMatchFn>
+	bool IsMatch(int aMatchMode, LPCTSTR aTitle, LPCTSTR aClass, LPCTSTR aPath, RegExMatchFn aRegExMatch) const
+	{
+		if ((criteria & CRITERION_TITLE) && *title) // A blank title matches anything, even in RegEx mode.
+		{
+			if (aMatchMode == FIND_REGEX ? !aRegExMatch(aTitle, title) : !IsTitleMatch(aTitle, title, title_length, aMatchMode))
+				return false;
+		}
+		// For backward compatibility, all modes other than RegEx use exact-match for class and path.
+		if (criteria & CRITERION_CLASS)
+		{
+			if (aMatchMode == FIND_REGEX ? !aRegExMatch(aClass, class_name) : _tcscmp(aClass, class_name) != 0)
+				return false;
+		}
+		if (criteria & CRITERION_PATH)
+		{
+			if (aMatchMode == FIND_REGEX ? !aRegExMatch(aPath, path) : _tcsicmp(aPath, path) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	// Compares a window title with a title (or ExcludeTitle) for any aMatchMode except RegEx.
+	static bool IsTitleMatch(LPCTSTR aCandidate, LPCTSTR aTitle, size_t aTitleLength, int aMatchMode)
+	{
+		switch (aMatchMode)
+		{
+		case FIND_ANYWHERE: return _tcsstr(aCandidate, aTitle) != NULL;
+		case FIND_IN_LEADING_PART: return !_tcsncmp(aCandidate, aTitle, aTitleLength);
+		default: return !_tcscmp(aCandidate, aTitle); // Exact match.
+		}
+	}
+
+	void AddRef() { ++mRefCount; }
+	void Release() { if (!--mRefCount) delete this; }
+	LPCTSTR WinTitle() { return mWinTitle; }
+
+private:
+	int mRefCount;
+	LPTSTR mWinTitle; // The string these criteria were compiled from, followed by the values above.
+
+	WinTitleCriteria() : mRefCount(1), mWinTitle(nullptr) {}
+	~WinTitleCriteria() { free(mWinTitle); }
+};
+
+
+
+class WinTitleCache
+{
+public:
+	enum { Size = 64 }; // Must be a power of 2.
+
+	WinTitleCache() : mEntry() {}
+	~WinTitleCache() { Clear(); }
+
+	// Returns the compiled criteria for aWinTitle, with a reference which the caller must release.
+	// Returns NULL if out of memory.
+	WinTitleCriteria *Get(LPCTSTR aWinTitle);
+	void Clear();
+
+private:
+	struct Entry
+	{
+		size_t hash;
+		WinTitleCriteria *criteria;
+	};
+	Entry mEntry[Size]; // Direct-mapped by hash.
+};
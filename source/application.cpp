@@ -23,6 +23,19 @@ GNU General Public License for more details.
 #include "script_gui.h"
 
 
+static void RecordHookEventLatency(HookEvent &aEvent)
+// Adds the time elapsed since the hook posted aEvent to g_HookEvents' latency histogram.
+{
+	static LARGE_INTEGER sFrequency;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	if (!sFrequency.QuadPart)
+		QueryPerformanceFrequency(&sFrequency);
+	g_HookEvents.mLatency.Add((now.QuadPart - aEvent.time) * 1000000 / sFrequency.QuadPart);
+}
+
+
+
 bool MsgSleep(int aSleepDuration, MessageMode aMode)
 // Returns true if it launched at least one thread, and false otherwise.
 // aSleepDuration can be be zero to do a true Sleep(0), or less than 0 to avoid sleeping or
@@ -219,6 +232,8 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 	POINT gui_point;
 	HDROP hdrop_to_free;
 	input_type *input_hook;
+	HookEvent hook_event;
+	bool hook_event_found;
 	LRESULT msg_reply;
 	BOOL peek_result;
 	MSG msg;
@@ -627,6 +642,7 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 		case AHK_INPUT_KEYUP:
 		{
 			hdrop_to_free = NULL;  // Set default for this message's processing (simplifies code).
+			hook_event_found = false; // Set default.
 			switch(msg.message)
 			{
 			case AHK_GUI_ACTION: // Listed first for performance.
@@ -743,9 +759,9 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 				break;
 
 			case AHK_HOTSTRING:
-				if (msg.wParam >= Hotstring::sHotstringCount) // Invalid hotstring ID (perhaps spoofed by external app)
+				if (   !(hs = Hotstring::FromMessageParam(msg.wParam))   ) // Invalid (perhaps spoofed by external app) or deleted.
 					continue; // Do nothing.
-				hs = Hotstring::shs[msg.wParam];  // For performance and convenience.
+				hook_event_found = g_HookEvents.Take(AHK_HOTSTRING, (UINT)msg.wParam, hook_event);
 				if (hs->mHotCriterion)
 				{
 					// For details, see comments in the hotkey section of this switch().
@@ -809,6 +825,8 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 				if (hk_id >= Hotkey::sHotkeyCount) // Invalid hotkey ID.
 					continue;
 				hk = Hotkey::shk[hk_id];
+				if (msg.message == AHK_HOOK_HOTKEY)
+					hook_event_found = g_HookEvents.Take(AHK_HOOK_HOTKEY, (UINT)msg.wParam, hook_event);
 				// Check if criterion allows firing.
 				// For maintainability, this is done here rather than a little further down
 				// past the g_MaxThreadsTotal and thread-priority checks.  Those checks hardly
@@ -856,8 +874,8 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 				//
 				variant = NULL; // Set default.
 				// For #HotIf hotkey variants, we don't want to evaluate the expression a second time. If the hook
-				// thread determined that a specific variant should fire, it is passed via the high word of wParam:
-				if (variant_id = HIWORD(msg.wParam))
+				// thread determined that a specific variant should fire, it is passed via the high bits of wParam:
+				if (variant_id = (USHORT)((UINT)msg.wParam >> HOTKEY_VARIANT_SHIFT))
 				{
 					// The following relies on the fact that variants can't be removed or re-ordered;
 					// variant_id should always be the variant's one-based index in the linked list:
@@ -1244,6 +1262,8 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 				g.hWndLastUsed = criterion_found_hwnd; // v1.0.42. Even if the window is invalid for some reason, IsWindow() and such are called whenever the script accesses it (GetValidLastUsedWindow()).
 				g.SendLevel = hs->mInputLevel;
 				g.HotCriterion = hs->mHotCriterion; // v2: Let the Hotkey command use the criterion of this hotstring by default.
+				if (hook_event_found)
+					RecordHookEventLatency(hook_event);
 				hs->PerformInNewThreadMadeByCaller();
 				break;
 
@@ -1300,6 +1320,8 @@ bool MsgSleep(int aSleepDuration, MessageMode aMode)
 				g.hWndLastUsed = criterion_found_hwnd; // v1.0.42. Even if the window is invalid for some reason, IsWindow() and such are called whenever the script accesses it (GetValidLastUsedWindow()).
 				g.SendLevel = variant->mInputLevel;
 				g.HotCriterion = variant->mHotCriterion; // v2: Let the Hotkey command use the criterion of this hotkey variant by default.
+				if (hook_event_found)
+					RecordHookEventLatency(hook_event);
 				hk->PerformInNewThreadMadeByCaller(*variant);
 				
 			}
@@ -1928,6 +1950,13 @@ void ResumeUnderlyingThread()
 
 	if (!g_nThreads)
 	{
+		// With no script threads running, nothing can be holding uncounted references to objects,
+		// so this is a safe point to collect any reference cycles which have accumulated:
+		CycleCollector::CollectIfDue();
+		// Free any hotstrings deleted by Hotstring("DeleteAll"), which might have had threads running:
+		Hotstring::FreeDeleted();
+		// Also end any batch of hotkey changes (see HotkeyBatch) which the script left open:
+		Hotkey::EndManifestBatch(true);
 		// If this was the last running thread and the script has nothing keeping it open (hotkeys, Gui,
 		// message monitors, etc.) then it should terminate now:
 		if (!g_OnExitIsRunning)
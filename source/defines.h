@@ -866,6 +866,13 @@ typedef UCHAR HotCriterionType;
 enum HotCriterionEnum {HOT_NO_CRITERION, HOT_IF_ACTIVE, HOT_IF_NOT_ACTIVE, HOT_IF_EXIST, HOT_IF_NOT_EXIST // HOT_NO_CRITERION must be zero.
 	, HOT_IF_CALLBACK};
 #define HOT_IF_REQUIRES_EVAL(type) ((type) == HOT_IF_CALLBACK)
+struct HotCriterionCacheEntry
+{
+	// Only a result which prevents firing is cached, so the entry records only when it applies.
+	HWND ForegroundWindow; // The foreground window at the time the result was cached.
+	DWORD Tick; // When the result was cached.  Zero if the entry is unused.
+};
+
 struct HotkeyCriterion
 {
 	HotCriterionType Type;
@@ -873,6 +880,7 @@ struct HotkeyCriterion
 	LPTSTR OriginalExpr; // For finding expr in #HotIf expr
 	IObject *Callback;
 	HotkeyCriterion *NextCriterion, *NextExpr;
+	HotCriterionCacheEntry Cache; // For #HotIf WinActive/WinNotActive.  Used only by the hook thread.
 
 	ResultType Eval(LPTSTR aHotkeyName); // For HOT_IF_CALLBACK.
 };
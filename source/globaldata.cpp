@@ -72,6 +72,9 @@ int g_ClipboardTimeout = 1000; // v1.0.31
 HHOOK g_KeybdHook = NULL;
 HHOOK g_MouseHook = NULL;
 HHOOK g_PlaybackHook = NULL;
+HookEventQueue g_HookEvents;
+KeyEventLog g_KeyEventLog;
+LoadProfiler g_LoadProfiler;
 bool g_ForceLaunch = false;
 bool g_WinActivateForce = false;
 WarnMode g_WarnMode = WARNMODE_MSGBOX;
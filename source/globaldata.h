@@ -72,6 +72,8 @@ extern int g_ClipboardTimeout;
 extern HHOOK g_KeybdHook;
 extern HHOOK g_MouseHook;
 extern HHOOK g_PlaybackHook;
+extern HookEventQueue g_HookEvents;
+extern KeyEventLog g_KeyEventLog;
 extern bool g_ForceLaunch;
 extern bool g_WinActivateForce;
 extern WarnMode g_WarnMode;
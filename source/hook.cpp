@@ -404,6 +404,12 @@ LRESULT LowLevelCommon(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lPara
 			_tcscpy(pKeyHistoryCurr->target_window, _T("N/A")); // Due to AHK_GETWINDOWTEXT, this could collide with main thread's writing to same string; but in addition to being extremely rare, it would likely be inconsequential.
 		g_HistoryHwndPrev = fore_win;  // Updated unconditionally in case fore_win is NULL.
 	}
+	// The time is taken here so that it reflects when the event arrived, but the event is added to
+	// g_KeyEventLog by LogKeyEvent() only after it has been fully processed.
+	if (g_KeyEventLog.IsEnabled())
+		QueryPerformanceCounter((LARGE_INTEGER *)&pKeyHistoryCurr->log_time);
+	else
+		pKeyHistoryCurr->log_time = 0;
 	// Keep the following flush with the above to indicate that they're related.
 	// The following is done even if key history is disabled because firing a wheel hotkey via PostMessage gets
 	// the notch count from pKeyHistoryCurr->sc.
@@ -1758,8 +1764,10 @@ LRESULT LowLevelCommon(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lPara
 			if (firing_is_certain->mHotCriterion && HOT_IF_REQUIRES_EVAL(firing_is_certain->mHotCriterion->Type))
 			{
 				// To avoid evaluating the expression twice, indicate to the main thread that the appropriate variant
-				// has already been determined, by packing the variant's index into the high word of the param:
-				hotkey_id_to_post |= firing_is_certain->mIndex << 16;
+				// has already been determined, by packing the variant's index into the high bits of the param.
+				// Variants beyond HOTKEY_VARIANT_MAX are left undetermined, so the main thread evaluates them again.
+				if (firing_is_certain->mIndex <= HOTKEY_VARIANT_MAX)
+					hotkey_id_to_post |= (WPARAM)firing_is_certain->mIndex << HOTKEY_VARIANT_SHIFT;
 			}
 			// Otherwise CriterionFiringIsCertain() might have returned a global variant (not necessarily the one
 			// that will actually fire), so if we ever decide to do the above for other criterion types rather than
@@ -1896,6 +1904,60 @@ LRESULT LowLevelCommon(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lPara
 
 
 
+static void LogKeyEvent(const HHOOK aHook, LPARAM lParam, const vk_type aVK, bool aKeyUp, ULONG_PTR aExtraInfo
+	, KeyHistoryItem *pKeyHistoryCurr, WPARAM aHotkeyIDToPost, bool aSuppressed)
+// Adds the event to g_KeyEventLog, if enabled.  Called by SuppressThisKeyFunc() and AllowIt() since
+// every event processed by LowLevelCommon() passes through one or the other.
+{
+	if (!g_KeyEventLog.IsEnabled())
+		return;
+	KeyEventRecord record;
+	if (pKeyHistoryCurr->log_time)
+		record.time = pKeyHistoryCurr->log_time;
+	else // The log was enabled while this event was being processed.
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		record.time = now.QuadPart;
+	}
+	record.hotkey_id = (HotkeyIDType)aHotkeyIDToPost & (HOTKEY_ID_MASK | HOTKEY_KEY_UP); // Exclude any variant index.
+	record.sc = pKeyHistoryCurr->sc;
+	record.vk = aVK;
+	record.flags = (aKeyUp ? KeyEventRecord::UP : 0)
+		| (IsIgnored(aExtraInfo) ? KeyEventRecord::IGNORED : 0)
+		| (aSuppressed ? KeyEventRecord::SUPPRESSED : 0);
+	if (aHook == g_MouseHook)
+	{
+		record.flags |= KeyEventRecord::MOUSE;
+		if (((PMSLLHOOKSTRUCT)lParam)->flags & LLMHF_INJECTED)
+			record.flags |= KeyEventRecord::ARTIFICIAL;
+	}
+	else if (((PKBDLLHOOKSTRUCT)lParam)->flags & LLKHF_INJECTED)
+		record.flags |= KeyEventRecord::ARTIFICIAL;
+	record.input_level = (UCHAR)InputLevelFromInfo(aExtraInfo);
+	record.event_type = (char)pKeyHistoryCurr->event_type;
+	g_KeyEventLog.Add(record);
+}
+
+
+
+void PostHookEvent(UINT aMessage, WPARAM wParam, LPARAM lParam, sc_type aSC, int aInputLevel)
+// Posts a hotkey or hotstring message to the main thread, first recording the event in g_HookEvents.
+{
+	HookEvent event;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	event.time = now.QuadPart;
+	event.message = aMessage;
+	event.id = (UINT)wParam;
+	event.sc = aSC;
+	event.input_level = (UCHAR)aInputLevel;
+	g_HookEvents.Push(event);
+	PostMessage(g_hWnd, aMessage, wParam, lParam);
+}
+
+
+
 LRESULT SuppressThisKeyFunc(const HHOOK aHook, LPARAM lParam, const vk_type aVK, const sc_type aSC, bool aKeyUp
 	, ULONG_PTR aExtraInfo, KeyHistoryItem *pKeyHistoryCurr, WPARAM aHotkeyIDToPost, WPARAM aHSwParamToPost, LPARAM aHSlParamToPost)
 // Always use the parameter vk rather than event.vkCode because the caller or caller's caller
@@ -1951,19 +2013,20 @@ LRESULT SuppressThisKeyFunc(const HHOOK aHook, LPARAM lParam, const vk_type aVK,
 	// than the main thread is not enough to prevent the main thread from getting a timeslice
 	// before the hook thread gets back another (at least on some systems, perhaps due to their
 	// system settings of the same ilk as "favor background processes").
+	LogKeyEvent(aHook, lParam, aVK, aKeyUp, aExtraInfo, pKeyHistoryCurr, aHotkeyIDToPost, true);
 	if (aHotkeyIDToPost != HOTKEY_ID_INVALID)
 	{
 		int input_level = InputLevelFromInfo(aExtraInfo);
-		PostMessage(g_hWnd, AHK_HOOK_HOTKEY, aHotkeyIDToPost, MAKELONG(pKeyHistoryCurr->sc, input_level)); // v1.0.43.03: sc is posted currently only to support the number of wheel turns (to store in A_EventInfo).
+		PostHookEvent(AHK_HOOK_HOTKEY, aHotkeyIDToPost, MAKELONG(pKeyHistoryCurr->sc, input_level), pKeyHistoryCurr->sc, input_level); // v1.0.43.03: sc is posted currently only to support the number of wheel turns (to store in A_EventInfo).
 		if (aKeyUp && hotkey_up[aHotkeyIDToPost & HOTKEY_ID_MASK] != HOTKEY_ID_INVALID)
 		{
 			// This is a key-down hotkey being triggered by releasing a prefix key.
 			// There's also a corresponding key-up hotkey, so fire it too:
-			PostMessage(g_hWnd, AHK_HOOK_HOTKEY, hotkey_up[aHotkeyIDToPost & HOTKEY_ID_MASK], MAKELONG(pKeyHistoryCurr->sc, input_level));
+			PostHookEvent(AHK_HOOK_HOTKEY, hotkey_up[aHotkeyIDToPost & HOTKEY_ID_MASK], MAKELONG(pKeyHistoryCurr->sc, input_level), pKeyHistoryCurr->sc, input_level);
 		}
 	}
 	if (aHSwParamToPost != HOTSTRING_INDEX_INVALID)
-		PostMessage(g_hWnd, AHK_HOTSTRING, aHSwParamToPost, aHSlParamToPost);
+		PostHookEvent(AHK_HOTSTRING, aHSwParamToPost, aHSlParamToPost, pKeyHistoryCurr->sc, InputLevelFromInfo(aExtraInfo));
 	return 1;
 }
 
@@ -2204,19 +2267,20 @@ LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, cons
 	// able to launch a script subroutine before the hook thread can finish updating its key state.
 	// Search on AHK_HOOK_HOTKEY in this file for more comments.
 	LRESULT result_to_return = CallNextHookEx(aHook, aCode, wParam, lParam);
+	LogKeyEvent(aHook, lParam, aVK, aKeyUp, aExtraInfo, pKeyHistoryCurr, aHotkeyIDToPost, false);
 	if (aHotkeyIDToPost != HOTKEY_ID_INVALID)
 	{
 		int input_level = InputLevelFromInfo(aExtraInfo);
-		PostMessage(g_hWnd, AHK_HOOK_HOTKEY, aHotkeyIDToPost, MAKELONG(pKeyHistoryCurr->sc, input_level)); // v1.0.43.03: sc is posted currently only to support the number of wheel turns (to store in A_EventInfo).
+		PostHookEvent(AHK_HOOK_HOTKEY, aHotkeyIDToPost, MAKELONG(pKeyHistoryCurr->sc, input_level), pKeyHistoryCurr->sc, input_level); // v1.0.43.03: sc is posted currently only to support the number of wheel turns (to store in A_EventInfo).
 		if (aKeyUp && hotkey_up[aHotkeyIDToPost & HOTKEY_ID_MASK] != HOTKEY_ID_INVALID)
 		{
 			// This is a key-down hotkey being triggered by releasing a prefix key.
 			// There's also a corresponding key-up hotkey, so fire it too:
-    		PostMessage(g_hWnd, AHK_HOOK_HOTKEY, hotkey_up[aHotkeyIDToPost & HOTKEY_ID_MASK], MAKELONG(pKeyHistoryCurr->sc, input_level));
+    		PostHookEvent(AHK_HOOK_HOTKEY, hotkey_up[aHotkeyIDToPost & HOTKEY_ID_MASK], MAKELONG(pKeyHistoryCurr->sc, input_level), pKeyHistoryCurr->sc, input_level);
 		}
 	}
 	if (hs_wparam_to_post != HOTSTRING_INDEX_INVALID)
-		PostMessage(g_hWnd, AHK_HOTSTRING, hs_wparam_to_post, hs_lparam_to_post);
+		PostHookEvent(AHK_HOTSTRING, hs_wparam_to_post, hs_lparam_to_post, pKeyHistoryCurr->sc, InputLevelFromInfo(aExtraInfo));
 	return result_to_return;
 }
 
@@ -2796,7 +2860,7 @@ bool CollectHotstring(KBDLLHOOKSTRUCT &aEvent, TCHAR ch[], int char_count, HWND
 			//    user typed it rather than appearing at the end of the replacement.
 			// 2) Two ending characters would appear in pre-1.0.43 versions: one where the user typed
 			//    it and one at the end, which is clearly incorrect.
-			aHotstringWparamToPost = u; // Override the default set by caller.
+			aHotstringWparamToPost = Hotstring::MessageParam(u); // Override the default set by caller.
 			aHotstringLparamToPost = MAKELONG(
 				hs.mEndCharRequired  // v1.0.48.04: Fixed to omit "&& hs.mDoBackspace" so that A_EndChar is set properly even for option "B0" (no backspacing).
 					? g_HSBuf[g_HSBufLength - 1]  // Used by A_EndChar and Hotstring::DoReplace().
@@ -3715,6 +3779,9 @@ void ChangeHookState(Hotkey *aHK[], int aHK_count, HookType aWhichHook, HookType
 		int modifiersLR;  // Don't make this modLR_type to avoid integer overflow, since it's a loop-counter.
 		bool prev_hk_is_key_up, this_hk_is_key_up;
 		HotkeyIDType prev_hk_id, this_hk_id;
+		// For each suffix key, the link which follows its custom combos (if any).  Remembering this
+		// avoids scanning past the same combos again for each hotkey that uses the key.
+		HotkeyIDType *suffix_insert_at[VK_ARRAY_COUNT + SC_ARRAY_COUNT] = {};
 
 		for (i = 0; i < hk_sorted_count; ++i)
 		{
@@ -3728,9 +3795,13 @@ void ChangeHookState(Hotkey *aHK[], int aHK_count, HookType aWhichHook, HookType
 				// This enables fallback between overlapping hotkeys, such as LCtrl & a, <^+a, ^+a.
 				pThisKey = this_hk.vk ? kvk + this_hk.vk : ksc + this_hk.sc;
 				// Insert after any custom combos.
-				HotkeyIDType *first = &pThisKey->first_hotkey;
-				while (*first != HOTKEY_ID_INVALID && (aHK[*first]->mModifierVK || aHK[*first]->mModifierSC))
-					first = &aHK[*first]->mNextHotkey;
+				HotkeyIDType *&first = suffix_insert_at[this_hk.vk ? this_hk.vk : VK_ARRAY_COUNT + this_hk.sc];
+				if (!first)
+				{
+					first = &pThisKey->first_hotkey;
+					while (*first != HOTKEY_ID_INVALID && (aHK[*first]->mModifierVK || aHK[*first]->mModifierSC))
+						first = &aHK[*first]->mNextHotkey;
+				}
 				aHK[this_hk_id]->mNextHotkey = *first;
 				*first = this_hk_id;
 			}
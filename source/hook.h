@@ -18,6 +18,8 @@ GNU General Public License for more details.
 #define hook_h
 
 #include "hotkey.h" // Use here and also by hook.cpp for ChangeHookState(), which reads from static Hotkey class vars.
+#include "HookEventQueue.h"
+#include "KeyEventLog.h"
 
 // WM_USER is the lowest number that can be a user-defined message.  Anything above that is also valid.
 // NOTE: Any msg about WM_USER will be kept buffered (unreplied-to) whenever the script is uninterruptible.
@@ -121,10 +123,10 @@ struct sc_hotkey
 struct key_type
 {
 	ToggleValueType *pForceToggle;  // Pointer to a global variable for toggleable keys only.  NULL for others.
-	// Keep sub-32-bit members contiguous to save memory without having to sacrifice performance of
-	// 32-bit alignment:
 	HotkeyIDType hotkey_to_fire_upon_release; // A up-event hotkey queued by a prior down-event.
 	HotkeyIDType first_hotkey; // The first hotkey using this key as a suffix.
+	// Keep sub-32-bit members contiguous to save memory without having to sacrifice performance of
+	// 32-bit alignment:
 	modLR_type as_modifiersLR; // If this key is a modifier, this will have the corresponding bit(s) for that key.
 	#define PREFIX_ACTUAL 1 // Values for used_as_prefix below, for places that need to distinguish between type of prefix.
 	#define PREFIX_FORCED 2 // v1.0.44: Added so that a neutral hotkey like Control can be forced to fire on key-up even though it isn't actually a prefix key.
@@ -272,6 +274,7 @@ struct KeyHistoryItem
 	TCHAR event_type; // space=none, i=ignored, s=suppressed, h=hotkey, etc.
 	bool key_up;
 	float elapsed_time;  // Time since prior key or mouse button, in seconds.
+	__int64 log_time;    // Performance counter value for g_KeyEventLog, or 0 if it was disabled.
 	// It seems better to store the foreground window's title rather than its HWND since keystrokes
 	// might result in a window closing (being destroyed), in which case the displayed key history
 	// would not be able to display the title at the time the history is displayed, which would
@@ -307,6 +310,8 @@ LRESULT SuppressThisKeyFunc(const HHOOK aHook, LPARAM lParam, const vk_type aVK,
 	, bool aKeyUp, ULONG_PTR aExtraInfo, KeyHistoryItem *pKeyHistoryCurr, WPARAM aHotkeyIDToPost
 	, WPARAM aHSwParamToPost = HOTSTRING_INDEX_INVALID, LPARAM aHSlParamToPost = 0);
 
+void PostHookEvent(UINT aMessage, WPARAM wParam, LPARAM lParam, sc_type aSC, int aInputLevel);
+
 #define AllowKeyToGoToSystem AllowIt(aHook, aCode, wParam, lParam, aVK, aSC, aKeyUp, aExtraInfo, collect_input_state, pKeyHistoryCurr, hotkey_id_to_post)
 LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, const vk_type aVK, const sc_type aSC
 	, bool aKeyUp, ULONG_PTR aExtraInfo, CollectInputState &aState, KeyHistoryItem *pKeyHistoryCurr, WPARAM aHotkeyIDToPost);
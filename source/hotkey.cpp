@@ -32,6 +32,58 @@ HotkeyIDType Hotkey::sNextID = 0;
 const HotkeyIDType &Hotkey::sHotkeyCount = Hotkey::sNextID;
 bool Hotkey::sJoystickHasHotkeys[MAX_JOYSTICKS] = {false};
 DWORD Hotkey::sJoyHotkeyCount = 0;
+bool Hotkey::sVKIsPrefix[VK_ARRAY_COUNT] = {false};
+HotkeyIDType Hotkey::sManifestedCount = 0;
+int Hotkey::sKeybdHookUsers = 0;
+int Hotkey::sMouseHookUsers = 0;
+int Hotkey::sManifestBatchDepth = 0;
+bool Hotkey::sManifestPending = false;
+Hotkey::NatureIndexItem *Hotkey::sNatureIndex = NULL;
+UINT Hotkey::sNatureIndexSize = 0;
+HotkeyIDType Hotkey::sNatureIndexCount = 0;
+
+
+
+// The result of a #HotIf WinActive/WinNotActive criterion depends almost entirely on which window is
+// active, so the hook caches it until the foreground window changes or the TTL expires (to allow for
+// changes to the active window's title or text).  Without this, a key with many context-sensitive
+// variants would require a window search per variant on each keypress, within the hook's time limit.
+// Only results which prevent firing are cached.  A criterion which is met causes the hook to suppress
+// the keystroke, and if that result were stale (such as after switching tabs in a browser, which
+// changes the title but not the foreground window), the main thread's re-check would then discard
+// the hotkey and the keystroke would be lost.  So the variant which fires is always evaluated, and
+// the cache saves the evaluation of the variants before it.  A stale cached result can at worst let
+// the keystroke through unsuppressed within the TTL, as if the title had changed a moment later.
+// Only the hook thread uses the cache.  The main thread's checks are not time-critical, and include
+// the re-check just before a hotkey or hotstring fires, so must not be cached.
+static DWORD sHotCriterionCacheTTL = 100; // Milliseconds.  Zero disables the cache.
+static UINT sHotCriterionEvals, sHotCriterionCacheHits;
+
+static HWND HotCriterionIsActive(HotkeyCriterion *aCriterion)
+// Returns the criterion's result for HOT_IF_ACTIVE or HOT_IF_NOT_ACTIVE, as described below.
+// This function must be kept thread-safe because it may be called by the hook thread.
+{
+	bool use_cache = sHotCriterionCacheTTL && GetCurrentThreadId() == g_HookThreadID;
+	HWND fore_win = GetForegroundWindow();
+	DWORD tick_now = GetTickCount();
+	auto &entry = aCriterion->Cache;
+	if (use_cache && entry.Tick && entry.ForegroundWindow == fore_win
+		&& tick_now - entry.Tick < sHotCriterionCacheTTL)
+	{
+		++sHotCriterionCacheHits;
+		return NULL; // Only results which prevent firing are cached.
+	}
+	HWND found_hwnd = WinActive(g_default, aCriterion->WinTitle, aCriterion->WinText, _T(""), _T(""), false); // Thread-safe.
+	if (aCriterion->Type == HOT_IF_NOT_ACTIVE)
+		found_hwnd = (HWND)!found_hwnd;
+	if (use_cache)
+	{
+		++sHotCriterionEvals;
+		entry.ForegroundWindow = fore_win;
+		entry.Tick = found_hwnd ? 0 : tick_now ? tick_now : 1; // See comments above.
+	}
+	return found_hwnd;
+}
 
 
 
@@ -49,8 +101,7 @@ HWND HotCriterionAllowsFiring(HotkeyCriterion *aCriterion, LPTSTR aHotkeyName)
 	{
 	case HOT_IF_ACTIVE:
 	case HOT_IF_NOT_ACTIVE:
-		found_hwnd = WinActive(g_default, aCriterion->WinTitle, aCriterion->WinText, _T(""), _T(""), false); // Thread-safe.
-		break;
+		return HotCriterionIsActive(aCriterion);
 	case HOT_IF_EXIST:
 	case HOT_IF_NOT_EXIST:
 		found_hwnd = WinExist(g_default, aCriterion->WinTitle, aCriterion->WinText, _T(""), _T(""), false, false); // Thread-safe.
@@ -66,6 +117,27 @@ HWND HotCriterionAllowsFiring(HotkeyCriterion *aCriterion, LPTSTR aHotkeyName)
 
 
 
+bif_impl FResult HotIfCache(optl<int> aTTL, IObject *&aRetVal)
+// Sets the TTL of the #HotIf WinActive/WinNotActive result cache (if specified) and returns its statistics.
+{
+	if (aTTL.has_value())
+	{
+		if (*aTTL < 0)
+			return FR_E_ARG(0);
+		sHotCriterionCacheTTL = *aTTL; // Existing entries are validated against the new TTL.
+	}
+	auto stats = Object::Create();
+	if (!stats)
+		return FR_E_OUTOFMEM;
+	stats->SetOwnProp(_T("TTL"), (__int64)sHotCriterionCacheTTL);
+	stats->SetOwnProp(_T("Evaluations"), (__int64)sHotCriterionEvals);
+	stats->SetOwnProp(_T("Hits"), (__int64)sHotCriterionCacheHits);
+	aRetVal = stats;
+	return OK;
+}
+
+
+
 BIF_DECL(HotIf_Win)
 {
 	HWND found_hwnd;
@@ -168,6 +240,7 @@ HotkeyCriterion *AddHotkeyCriterion(HotCriterionType aType, LPCTSTR aWinTitle, L
 HotkeyCriterion *AddHotkeyCriterion(HotkeyCriterion *cp)
 {
 	cp->NextCriterion = NULL;
+	ZeroMemory(&cp->Cache, sizeof(cp->Cache));
 	if (!g_FirstHotCriterion)
 		g_FirstHotCriterion = g_LastHotCriterion = cp;
 	else
@@ -277,15 +350,34 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 	// HK_KEYBD_HOOK, such as when it is eclipsed by a wildcard hotkey).  One workaround would
 	// be to set mKeybdHookMandatory = true, but that would prevent the hotkey from reverting to
 	// HK_NORMAL when it no longer needs the hook.  Instead, there are now three passes.
-	bool vk_is_prefix[VK_ARRAY_COUNT] = {false};
-	bool *hk_is_inactive = (bool *)_alloca(sHotkeyCount * sizeof(bool)); // No init needed.  Currently limited to around 16k (HOTKEY_ID_MAX).
+	// The results of the first two passes are retained in sVKIsPrefix and mEclipsed so that
+	// ManifestHotkey() can later reevaluate a single hotkey without repeating them.
+	// hk_next_same_vk links together the hotkeys which have the same mVK, so that the second pass
+	// examines only those hotkeys which could be eclipsed, rather than every hotkey for each one.
+	// It is allocated before anything else is changed, so that if it fails, the hotkeys and hooks
+	// are left exactly as they were and any pending pass is still pending.
+	HotkeyIDType hk_first_with_vk[VK_ARRAY_COUNT];
+	HotkeyIDType *hk_next_same_vk = (HotkeyIDType *)malloc(sHotkeyCount * (sizeof(HotkeyIDType) + sizeof(bool)) + 1);
+	if (!hk_next_same_vk)
+	{
+		MemoryError();
+		return;
+	}
+	sManifestPending = false; // Any pass deferred by ManifestDynamic() is satisfied by this one.
+	ZeroMemory(sVKIsPrefix, sizeof(sVKIsPrefix));
+	bool *hk_is_inactive = (bool *)(hk_next_same_vk + sHotkeyCount); // No init needed.
 	HotkeyVariant *vp;
 	int i, j;
+	for (i = 0; i < VK_ARRAY_COUNT; ++i)
+		hk_first_with_vk[i] = HOTKEY_ID_INVALID;
 
 	// FIRST PASS THROUGH THE HOTKEYS:
 	for (i = 0; i < sHotkeyCount; ++i)
 	{
 		Hotkey &hot = *shk[i]; // For performance and convenience.
+		hk_next_same_vk[i] = hk_first_with_vk[hot.mVK]; // Done for inactive hotkeys too; see the second pass.
+		hk_first_with_vk[hot.mVK] = i;
+		hot.mEclipsed = false; // Set below for this or other hotkeys, including inactive ones.
 		if (   hk_is_inactive[i] = ((g_IsSuspended && !hot.IsExemptFromSuspend())
 			|| hot.IsCompletelyDisabled())   ) // Listed last for short-circuit performance.
 		{
@@ -331,7 +423,7 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 		}
 
 		if (hot.mModifierVK)
-			vk_is_prefix[hot.mModifierVK] = true;
+			sVKIsPrefix[hot.mModifierVK] = true;
 	} // End of first pass loop.
 	
 	// SECOND PASS THROUGH THE HOTKEYS:
@@ -350,7 +442,7 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 			// "#5" (reg) and "#5 up" (hook), the hook would suppress the down event because it
 			// is unaware that down-hotkey exists (it's suppressed to prevent the key from being
 			// stuck in a logically down state).
-			for (j = 0; j < sHotkeyCount; ++j)
+			for (j = hk_first_with_vk[hot.mVK]; j != HOTKEY_ID_INVALID; j = hk_next_same_vk[j])
 			{
 				// No need to check the following because they are already hook hotkeys:
 				// mModifierVK/SC
@@ -360,10 +452,13 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 				// true if it's mType is HK_NORMAL:
 				// Also, g_IsSuspended and IsCompletelyDisabled() aren't checked
 				// because it's harmless to operate on disabled hotkeys in this way.
-				if (shk[j]->mVK == hot.mVK && HK_TYPE_CAN_BECOME_KEYBD_HOOK(shk[j]->mType) // Ordered for short-circuit performance.
-					&& shk[j]->mModifiersConsolidatedLR == hot.mModifiersConsolidatedLR)
+				if (shk[j]->mModifiersConsolidatedLR == hot.mModifiersConsolidatedLR) // mVK is the same, due to the chain.
 				{
-					shk[j]->mType = HK_KEYBD_HOOK;
+					// mEclipsed is set regardless of mType so that it remains valid if this hotkey is
+					// later enabled and reevaluated by ManifestHotkey().
+					shk[j]->mEclipsed = true;
+					if (HK_TYPE_CAN_BECOME_KEYBD_HOOK(shk[j]->mType))
+						shk[j]->mType = HK_KEYBD_HOOK;
 					// And if it's currently registered, it will be unregistered later below.
 				}
 			}
@@ -384,7 +479,7 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 		//    so might as well handle eclipsed hotkeys with it too.
 		if (hot.mAllowExtraModifiers && hot.mVK && !hot.mModifiersLR && !(hot.mModifierSC || hot.mModifierVK))
 		{
-			for (j = 0; j < sHotkeyCount; ++j)
+			for (j = hk_first_with_vk[hot.mVK]; j != HOTKEY_ID_INVALID; j = hk_next_same_vk[j])
 			{
 				// If it's not of type HK_NORMAL, there's no need to change its type regardless
 				// of the values of its other members.  Also, if the wildcard hotkey (hot) has
@@ -395,13 +490,14 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 				// mModifiersConsolidated is checked for simplicity and also because it seems to add
 				// flexibility.  For example, *<^>^a would require both left AND right ctrl to be down,
 				// not EITHER. In other words, mModifiersLR can never in effect contain a neutral modifier.
-				if (shk[j]->mVK == hot.mVK && HK_TYPE_CAN_BECOME_KEYBD_HOOK(shk[j]->mType) // Ordered for short-circuit performance.
-					&& (hot.mModifiers & shk[j]->mModifiers) == hot.mModifiers)
+				if ((hot.mModifiers & shk[j]->mModifiers) == hot.mModifiers) // mVK is the same, due to the chain.
 				{
 					// Note: No need to check mModifiersLR because it would already be a hook hotkey in that case;
 					// that is, the check of shk[j]->mType precludes it.  It also precludes the possibility
 					// of shk[j] being a key-up hotkey, wildcard hotkey, etc.
-					shk[j]->mType = HK_KEYBD_HOOK;
+					shk[j]->mEclipsed = true; // See similar section above.
+					if (HK_TYPE_CAN_BECOME_KEYBD_HOOK(shk[j]->mType))
+						shk[j]->mType = HK_KEYBD_HOOK;
 					// And if it's currently registered, it will be unregistered later below.
 				}
 			}
@@ -412,109 +508,28 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 	// v1.0.42: Reset sWhichHookNeeded because it's now possible that the hook was on before but no longer
 	// needed due to changing of a hotkey from hook to registered (for various reasons described above):
 	sWhichHookNeeded = 0;
+	sKeybdHookUsers = sMouseHookUsers = 0;
 	for (i = 0; i < sHotkeyCount; ++i)
 	{
-		if (hk_is_inactive[i])
-			continue; // v1.0.40: Treat disabled hotkeys as though they're not even present.
 		Hotkey &hot = *shk[i]; // For performance and convenience.
-
-		// HK_MOUSE_HOOK hotkeys, and most HK_KEYBD_HOOK hotkeys, are handled by the hotkey constructor.
-		// What we do here upgrade any NORMAL/registered hotkey to HK_KEYBD_HOOK if there are other
-		// hotkeys that interact or overlap with it in such a way that the hook is preferred.
-		// This evaluation is done here because only now that hotkeys are about to be activated do
-		// we know which ones are disabled or suspended, and thus don't need to be taken into account.
-		if (HK_TYPE_CAN_BECOME_KEYBD_HOOK(hot.mType))
-		{
-			if (vk_is_prefix[hot.mVK])
-				// If it's a suffix that is also used as a prefix, use hook (this allows ^!a to work without $ when "a & b" is a hotkey).
-				// v1.0.42: This was fixed so that mVK_WasSpecifiedByNumber dosn't affect it.  That is, a suffix that's
-				// also used as a prefix should become a hook hotkey even if the suffix is specified as "vkNNN::".
-				hot.mType = HK_KEYBD_HOOK;
-				// And if it's currently registered, it will be unregistered later below.
-			else
-			{
-				// v1.0.42: Any #HotIf keyboard hotkey must use the hook if it lacks an enabled,
-				// non-suspended, global variant.  Under those conditions, the hotkey is either:
-				// 1) Single-variant hotkey that has criteria (non-global).
-				// 2) Multi-variant hotkey but all variants have criteria (non-global).
-				// 3) A hotkey with a non-suppressed (~) variant (always, for code simplicity): already handled by AddVariant().
-				// In both cases above, the hook must handle the hotkey because there can be
-				// situations in which the hook should let the hotkey's keystroke pass through
-				// to the active window (i.e. the hook is needed to dynamically disable the hotkey).
-				// mHookAction isn't checked here since those hotkeys shouldn't reach this stage (since they're always hook hotkeys).
-				for (hot.mType = HK_KEYBD_HOOK, vp = hot.mFirstVariant; vp; vp = vp->mNextVariant)
-				{
-					if (   !vp->mHotCriterion && vp->mEnabled // It's a global variant (no criteria) and it's enabled...
-						&& (!g_IsSuspended || vp->mSuspendExempt)   )
-						// ... and this variant isn't suspended (we already know IsCompletelyDisabled()==false from an earlier check).
-					{
-						hot.mType = HK_NORMAL; // Reset back to how it was before this loop started.  Hook not needed.
-						break;
-					}
-				}
-				// If the above promoted it from NORMAL to HOOK but the hotkey is currently registered,
-				// it will be unregistered later below.
-			}
-		}
-
-		// Check if this mouse hotkey also requires the keyboard hook (e.g. #LButton).
-		// Some mouse hotkeys, such as those with normal modifiers, don't require it
-		// since the mouse hook has logic to handle that situation.  But those that
-		// are composite hotkeys such as "RButton & Space" or "Space & RButton" need
-		// the keyboard hook:
-		if (hot.mType == HK_MOUSE_HOOK && (
-			hot.mModifierSC || hot.mSC // i.e. since it's an SC, the modifying key isn't a mouse button.
-			|| hot.mHookAction // v1.0.25.05: At least some alt-tab actions require the keyboard hook. For example, a script consisting only of "MButton::AltTabAndMenu" would not work properly otherwise.
-			// v1.0.25.05: The line below was added to prevent the Start Menu from appearing, which
-			// requires the keyboard hook. ALT hotkeys don't need it because the mouse hook sends
-			// a CTRL keystroke to disguise them, a trick that is unfortunately not reliable for
-			// when it happens while the while key is down (though it does disguise a Win-up).
-			|| ((hot.mModifiersConsolidatedLR & (MOD_LWIN|MOD_RWIN)) && !(hot.mModifiersConsolidatedLR & (MOD_LALT|MOD_RALT)))
-			// For v1.0.30, above has been expanded to include Win+Shift and Win+Control modifiers.
-			|| (hot.mVK && !IsMouseVK(hot.mVK)) // e.g. "RButton & Space"
-			|| (hot.mModifierVK && !IsMouseVK(hot.mModifierVK)))   ) // e.g. "Space & RButton"
-			hot.mType = HK_BOTH_HOOKS;  // Needed by ChangeHookState().
-			// For the above, the following types of mouse hotkeys do not need the keyboard hook:
-			// 1) mAllowExtraModifiers: Already handled since the mouse hook fetches the modifier state
-			//    manually when the keyboard hook isn't installed.
-			// 2) mModifiersConsolidatedLR (i.e. the mouse button is modified by a normal modifier
-			//    such as CTRL): Same reason as #1.
-			// 3) As a subset of #2, mouse hotkeys that use WIN as a modifier will not have the
-			//    Start Menu suppressed unless the keyboard hook is installed.  It's debatable,
-			//    but that seems a small price to pay (esp. given how rare it is just to have
-			//    the mouse hook with no keyboard hook) to avoid the overhead of the keyboard hook.
-		
-		// If the hotkey is normal, try to register it.  If the register fails, use the hook to try
-		// to override any other script or program that might have it registered (as documented):
-		if (hot.mType == HK_NORMAL)
-		{
-			if (!hot.Register()) // Can't register it, usually due to some other application or the OS using it.
-				hot.mType = HK_KEYBD_HOOK;
-		}
-		else // mType isn't NORMAL (possibly due to something above changing it), so ensure it isn't registered.
-			if (hot.mIsRegistered) // Improves typical performance since this hotkey could be mouse, joystick, etc.
-				// Although the hook effectively overrides registered hotkeys, they should be unregistered anyway
-				// to prevent the Send command from triggering the hotkey, and perhaps other side-effects.
-				hot.Unregister();
-
-		switch (hot.mType)
+		if (hk_is_inactive[i])
 		{
-		case HK_KEYBD_HOOK: sWhichHookNeeded |= HOOK_KEYBD; break;
-		case HK_MOUSE_HOOK: sWhichHookNeeded |= HOOK_MOUSE; break;
-		case HK_BOTH_HOOKS: sWhichHookNeeded |= HOOK_KEYBD|HOOK_MOUSE; break;
+			hot.mHookUsage = 0;
+			continue; // v1.0.40: Treat disabled hotkeys as though they're not even present.
 		}
+		if ((hot.mHookUsage = hot.Activate()) & HOOK_KEYBD)
+			++sKeybdHookUsers;
+		if (hot.mHookUsage & HOOK_MOUSE)
+			++sMouseHookUsers;
+		sWhichHookNeeded |= hot.mHookUsage;
 	} // for()
+	sManifestedCount = sHotkeyCount;
+	free(hk_next_same_vk);
 
 	// Check if anything else requires the hook.
 	// But do this part outside of the above block because these values may have changed since
-	// this function was first called.  By design, the Num/Scroll/CapsLock AlwaysOn/Off setting
-	// stays in effect even when Suspend in ON.
-	if (   Hotstring::sEnabledCount
-		|| g_input // v1.0.91: Hook is needed for collecting input.
-		|| !(g_ForceNumLock == NEUTRAL && g_ForceCapsLock == NEUTRAL && g_ForceScrollLock == NEUTRAL)   )
-		sWhichHookNeeded |= HOOK_KEYBD;
-	if (g_BlockMouseMove || (g_HSResetUponMouseClick && Hotstring::sEnabledCount))
-		sWhichHookNeeded |= HOOK_MOUSE;
+	// this function was first called.
+	sWhichHookNeeded |= OtherHooksNeeded();
 
 	// Install or deinstall either or both hooks, if necessary, based on these param values.
 	ChangeHookState(shk, sHotkeyCount, sWhichHookNeeded, sWhichHookAlways);
@@ -532,6 +547,206 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 
 
 
+HookType Hotkey::Activate()
+// Third pass of ManifestAllHotkeysHotstringsHooks(), also used by ManifestHotkey().  Caller has ensured
+// this hotkey is neither suspended nor completely disabled, and has reset mType as in the first pass.
+// Registers or unregisters the hotkey as appropriate and returns the hook(s) it requires.
+{
+	HotkeyVariant *vp;
+	// HK_MOUSE_HOOK hotkeys, and most HK_KEYBD_HOOK hotkeys, are handled by the hotkey constructor.
+	// What we do here upgrade any NORMAL/registered hotkey to HK_KEYBD_HOOK if there are other
+	// hotkeys that interact or overlap with it in such a way that the hook is preferred.
+	// This evaluation is done here because only now that hotkeys are about to be activated do
+	// we know which ones are disabled or suspended, and thus don't need to be taken into account.
+	if (HK_TYPE_CAN_BECOME_KEYBD_HOOK(mType))
+	{
+		if (sVKIsPrefix[mVK] || mEclipsed)
+			// If it's a suffix that is also used as a prefix, use hook (this allows ^!a to work without $ when "a & b" is a hotkey).
+			// v1.0.42: This was fixed so that mVK_WasSpecifiedByNumber dosn't affect it.  That is, a suffix that's
+			// also used as a prefix should become a hook hotkey even if the suffix is specified as "vkNNN::".
+			// mEclipsed is already reflected by mType during a full pass, but not when called by ManifestHotkey().
+			mType = HK_KEYBD_HOOK;
+			// And if it's currently registered, it will be unregistered later below.
+		else
+		{
+			// v1.0.42: Any #HotIf keyboard hotkey must use the hook if it lacks an enabled,
+			// non-suspended, global variant.  Under those conditions, the hotkey is either:
+			// 1) Single-variant hotkey that has criteria (non-global).
+			// 2) Multi-variant hotkey but all variants have criteria (non-global).
+			// 3) A hotkey with a non-suppressed (~) variant (always, for code simplicity): already handled by AddVariant().
+			// In both cases above, the hook must handle the hotkey because there can be
+			// situations in which the hook should let the hotkey's keystroke pass through
+			// to the active window (i.e. the hook is needed to dynamically disable the hotkey).
+			// mHookAction isn't checked here since those hotkeys shouldn't reach this stage (since they're always hook hotkeys).
+			for (mType = HK_KEYBD_HOOK, vp = mFirstVariant; vp; vp = vp->mNextVariant)
+			{
+				if (   !vp->mHotCriterion && vp->mEnabled // It's a global variant (no criteria) and it's enabled...
+					&& (!g_IsSuspended || vp->mSuspendExempt)   )
+					// ... and this variant isn't suspended (we already know IsCompletelyDisabled()==false from an earlier check).
+				{
+					mType = HK_NORMAL; // Reset back to how it was before this loop started.  Hook not needed.
+					break;
+				}
+			}
+			// If the above promoted it from NORMAL to HOOK but the hotkey is currently registered,
+			// it will be unregistered later below.
+		}
+	}
+
+	// Check if this mouse hotkey also requires the keyboard hook (e.g. #LButton).
+	// Some mouse hotkeys, such as those with normal modifiers, don't require it
+	// since the mouse hook has logic to handle that situation.  But those that
+	// are composite hotkeys such as "RButton & Space" or "Space & RButton" need
+	// the keyboard hook:
+	if (mType == HK_MOUSE_HOOK && (
+		mModifierSC || mSC // i.e. since it's an SC, the modifying key isn't a mouse button.
+		|| mHookAction // v1.0.25.05: At least some alt-tab actions require the keyboard hook. For example, a script consisting only of "MButton::AltTabAndMenu" would not work properly otherwise.
+		// v1.0.25.05: The line below was added to prevent the Start Menu from appearing, which
+		// requires the keyboard hook. ALT hotkeys don't need it because the mouse hook sends
+		// a CTRL keystroke to disguise them, a trick that is unfortunately not reliable for
+		// when it happens while the while key is down (though it does disguise a Win-up).
+		|| ((mModifiersConsolidatedLR & (MOD_LWIN|MOD_RWIN)) && !(mModifiersConsolidatedLR & (MOD_LALT|MOD_RALT)))
+		// For v1.0.30, above has been expanded to include Win+Shift and Win+Control modifiers.
+		|| (mVK && !IsMouseVK(mVK)) // e.g. "RButton & Space"
+		|| (mModifierVK && !IsMouseVK(mModifierVK)))   ) // e.g. "Space & RButton"
+		mType = HK_BOTH_HOOKS;  // Needed by ChangeHookState().
+		// For the above, the following types of mouse hotkeys do not need the keyboard hook:
+		// 1) mAllowExtraModifiers: Already handled since the mouse hook fetches the modifier state
+		//    manually when the keyboard hook isn't installed.
+		// 2) mModifiersConsolidatedLR (i.e. the mouse button is modified by a normal modifier
+		//    such as CTRL): Same reason as #1.
+		// 3) As a subset of #2, mouse hotkeys that use WIN as a modifier will not have the
+		//    Start Menu suppressed unless the keyboard hook is installed.  It's debatable,
+		//    but that seems a small price to pay (esp. given how rare it is just to have
+		//    the mouse hook with no keyboard hook) to avoid the overhead of the keyboard hook.
+	
+	// If the hotkey is normal, try to register it.  If the register fails, use the hook to try
+	// to override any other script or program that might have it registered (as documented):
+	if (mType == HK_NORMAL)
+	{
+		if (!Register()) // Can't register it, usually due to some other application or the OS using it.
+			mType = HK_KEYBD_HOOK;
+	}
+	else // mType isn't NORMAL (possibly due to something above changing it), so ensure it isn't registered.
+		if (mIsRegistered) // Improves typical performance since this hotkey could be mouse, joystick, etc.
+			// Although the hook effectively overrides registered hotkeys, they should be unregistered anyway
+			// to prevent the Send command from triggering the hotkey, and perhaps other side-effects.
+			Unregister();
+
+	switch (mType)
+	{
+	case HK_KEYBD_HOOK: return HOOK_KEYBD;
+	case HK_MOUSE_HOOK: return HOOK_MOUSE;
+	case HK_BOTH_HOOKS: return HOOK_KEYBD|HOOK_MOUSE;
+	}
+	return 0;
+}
+
+
+
+HookType Hotkey::OtherHooksNeeded()
+// Returns the hook(s) required by things other than hotkeys.
+// By design, the Num/Scroll/CapsLock AlwaysOn/Off setting stays in effect even when Suspend in ON.
+{
+	HookType which_hook = 0;
+	if (   Hotstring::sEnabledCount
+		|| g_input // v1.0.91: Hook is needed for collecting input.
+		|| !(g_ForceNumLock == NEUTRAL && g_ForceCapsLock == NEUTRAL && g_ForceScrollLock == NEUTRAL)   )
+		which_hook |= HOOK_KEYBD;
+	if (g_BlockMouseMove || (g_HSResetUponMouseClick && Hotstring::sEnabledCount))
+		which_hook |= HOOK_MOUSE;
+	return which_hook;
+}
+
+
+
+void Hotkey::ManifestHotkey(Hotkey &aHotkey)
+// Incremental counterpart of ManifestAllHotkeysHotstringsHooks(), for use when only aHotkey's enabled
+// state has changed (such as by the Hotkey function's On/Off options).  If aHotkey can affect other
+// hotkeys, or hotkeys have been added since the last full pass, this falls back to a full pass.
+// Otherwise the results of the last full pass for other hotkeys are still valid, so only aHotkey
+// needs to be reevaluated, and the hook's tables are rebuilt only if aHotkey uses or used the hook.
+{
+	if (sManifestBatchDepth || sManifestedCount != sHotkeyCount || aHotkey.AffectsOtherHotkeys())
+	{
+		ManifestDynamic();
+		return;
+	}
+	Hotkey &hot = aHotkey; // For consistency with the above.
+	HookType prev_usage = hot.mHookUsage;
+	if ((g_IsSuspended && !hot.IsExemptFromSuspend()) || hot.IsCompletelyDisabled())
+	{
+		// This section should be kept in sync with the first pass of ManifestAllHotkeysHotstringsHooks().
+		if (hot.mIsRegistered)
+		{
+			hot.Unregister();
+			for (HotkeyVariant *vp = hot.mFirstVariant; vp; vp = vp->mNextVariant)
+				vp->mRunAgainAfterFinished = false;
+		}
+		hot.mHookUsage = 0;
+	}
+	else
+	{
+		if (hot.mKeybdHookMandatory)
+		{
+			if (HK_TYPE_CAN_BECOME_KEYBD_HOOK(hot.mType))
+				hot.mType = HK_KEYBD_HOOK;
+		}
+		else if (hot.mType == HK_KEYBD_HOOK)
+			hot.mType = HK_NORMAL; // To possibly be overridden back to HK_KEYBD_HOOK by Activate().
+		hot.mHookUsage = hot.Activate();
+	}
+
+	if (prev_usage & HOOK_KEYBD) --sKeybdHookUsers;
+	if (prev_usage & HOOK_MOUSE) --sMouseHookUsers;
+	if (hot.mHookUsage & HOOK_KEYBD) ++sKeybdHookUsers;
+	if (hot.mHookUsage & HOOK_MOUSE) ++sMouseHookUsers;
+
+	HookType which_hook_needed = OtherHooksNeeded();
+	if (sKeybdHookUsers)
+		which_hook_needed |= HOOK_KEYBD;
+	if (sMouseHookUsers)
+		which_hook_needed |= HOOK_MOUSE;
+	// A hotkey which is registered (or a joystick hotkey) before and after doesn't appear in the hook's
+	// tables, so unless the set of required hooks has changed, there's no need to rebuild them.
+	if (prev_usage || hot.mHookUsage || which_hook_needed != sWhichHookNeeded)
+	{
+		sWhichHookNeeded = which_hook_needed;
+		ChangeHookState(shk, sHotkeyCount, sWhichHookNeeded, sWhichHookAlways);
+	}
+	if (sJoyHotkeyCount) // See comments in ManifestAllHotkeysHotstringsHooks().
+		SET_MAIN_TIMER
+}
+
+
+
+void Hotkey::ManifestDynamic()
+// Used in place of ManifestAllHotkeysHotstringsHooks() by the Hotkey and Hotstring functions, which
+// are the only changes a batch started by BeginManifestBatch() defers.  Other callers, such as Suspend
+// and reinstallation of the hook, must take effect immediately and so call the above directly.
+{
+	if (sManifestBatchDepth)
+		sManifestPending = true; // Done by EndManifestBatch().
+	else
+		ManifestAllHotkeysHotstringsHooks();
+}
+
+
+
+int Hotkey::EndManifestBatch(bool aAll)
+// Ends the innermost batch started by BeginManifestBatch(), or all batches if aAll is true.
+// Performs any manifestation which was deferred while the batch was in progress.
+// Returns the number of batches still in progress.
+{
+	if (sManifestBatchDepth)
+		sManifestBatchDepth = aAll ? 0 : sManifestBatchDepth - 1;
+	if (!sManifestBatchDepth && sManifestPending)
+		ManifestAllHotkeysHotstringsHooks();
+	return sManifestBatchDepth;
+}
+
+
+
 void Hotkey::MaybeUninstallHook()
 // Caller knows that one of the users of the keyboard hook no longer requires it,
 // and wants it uninstalled if it is no longer needed by anything else.
@@ -1130,6 +1345,7 @@ FResult Hotkey::Dynamic(LPCTSTR aHotkeyName, LPCTSTR aOptions, IObject *aCallbac
 	Hotkey *hk = FindHotkeyByTrueNature(aHotkeyName, no_suppress, hook_is_mandatory); // NULL if not found.
 	HotkeyVariant *variant = hk ? hk->FindVariant() : NULL;
 	bool update_all_hotkeys = false;  // This method avoids multiple calls to ManifestAllHotkeysHotstringsHooks() (which is high-overhead).
+	bool update_this_hotkey = false; // Only the enabled state of hk has changed, so ManifestHotkey() may suffice.
 	bool variant_was_just_created = false;
 
 	switch (aHookAction)
@@ -1290,18 +1506,20 @@ FResult Hotkey::Dynamic(LPCTSTR aHotkeyName, LPCTSTR aOptions, IObject *aCallbac
 	if (on_off == HOTKEY_ID_ON)
 	{
 		if (variant ? hk->Enable(*variant) : hk->EnableParent())
-			update_all_hotkeys = true; // Do it this way so that any previous "true" value isn't lost.
+			update_this_hotkey = true;
 	}
 	else if (on_off == HOTKEY_ID_OFF)
 	{
 		if (variant ? hk->Disable(*variant) : hk->DisableParent())
-			update_all_hotkeys = true; // Do it this way so that any previous "true" value isn't lost.
+			update_this_hotkey = true;
 		if (variant_was_just_created) // This variant (and possibly its parent hotkey) was just created above.
-			update_all_hotkeys = false; // Override the "true" that was set (either right above *or* anywhere earlier) because this new hotkey/variant won't affect other hotkeys.
+			update_all_hotkeys = update_this_hotkey = false; // Override the "true" that was set (either right above *or* anywhere earlier) because this new hotkey/variant won't affect other hotkeys.
 	}
 
 	if (update_all_hotkeys)
-		ManifestAllHotkeysHotstringsHooks(); // See its comments for why it's done in so many of the above situations.
+		ManifestDynamic(); // See ManifestAllHotkeysHotstringsHooks() for why it's done in so many of the above situations.
+	else if (update_this_hotkey)
+		ManifestHotkey(*hk); // Falls back to the above if hk can affect other hotkeys.
 
 	return OK;
 }
@@ -1325,6 +1543,7 @@ Hotkey *Hotkey::AddHotkey(IObject *aCallback, HookActionType aHookAction, LPCTST
 		delete shk[sNextID];  // SimpleHeap allows deletion of most recently added item.
 		return NULL;  // The constructor already displayed the error.
 	}
+	AddToNatureIndex(*shk[sNextID]);
 	++sNextID;
 	return shk[sNextID - 1]; // Indicate success by returning the new hotkey.
 }
@@ -1353,6 +1572,7 @@ Hotkey::Hotkey(HotkeyIDType aID, IObject *aCallback, HookActionType aHookAction,
 	, mHookAction(aHookAction)   // Alt-tab and possibly other uses.
 	, mFirstVariant(NULL), mLastVariant(NULL)  // Init linked list early for maintainability.
 	, mConstructedOK(false)
+	, mEclipsed(false), mHookUsage(0)
 
 // It's better to receive the hotkey_id as a param, since only the caller has better knowledge and
 // verification of the fact that this hotkey's id is always set equal to it's index in the array
@@ -2000,6 +2220,9 @@ ResultType Hotkey::Register()
 	if (mType != HK_NORMAL) // Caller normally checks this for performance, but it's checked again for maintainability.
 		return FAIL; // Don't attempt to register joystick or hook hotkeys, since their VK/modifiers aren't intended for that.
 
+	if (mID > HOTKEY_ID_MAX_REGISTERED) // RegisterHotKey() can't accept this ID, so the caller will fall back to the hook.
+		return FAIL;
+
 	// Indicate that the key modifies itself because RegisterHotkey() requires that +SHIFT,
 	// for example, be used to register the naked SHIFT key.  So what we do here saves the
 	// user from having to specify +SHIFT in the script:
@@ -2088,32 +2311,29 @@ Hotkey *Hotkey::FindHotkeyByTrueNature(LPCTSTR aName, UCHAR &aNoSuppress, bool &
 				| (prop_candidate.suffix_has_tilde ? AT_LEAST_ONE_VARIANT_HAS_TILDE : 0);
 	aHookIsMandatory = prop_candidate.hook_is_mandatory; // Set for caller.
 	// Both suffix_has_tilde and prefix_has_tilde are ignored during dupe-checking below.
-	// See comments inside the loop for details.
+	// See comments in NatureMatches() for details.
 
+	if (sNatureIndexCount == sHotkeyCount && sNatureIndexSize)
+	{
+		UINT hash = NatureHash(prop_candidate);
+		for (UINT i = hash; ; ++i)
+		{
+			NatureIndexItem &item = sNatureIndex[i & (sNatureIndexSize - 1)];
+			if (item.id == HOTKEY_ID_INVALID)
+				return NULL; // No match found.
+			if (item.hash != hash)
+				continue;
+			TextToModifiers(shk[item.id]->mName, NULL, &prop_existing);
+			if (NatureMatches(prop_existing, prop_candidate))
+				return shk[item.id];
+		}
+	}
+
+	// Otherwise, the index couldn't be maintained due to lack of memory.
 	for (int i = 0; i < sHotkeyCount; ++i)
 	{
 		TextToModifiers(shk[i]->mName, NULL, &prop_existing);
-		if (   prop_existing.modifiers == prop_candidate.modifiers
-			&& prop_existing.modifiersLR == prop_candidate.modifiersLR
-			&& prop_existing.is_key_up == prop_candidate.is_key_up
-			// Treat wildcard (*) as an entirely separate hotkey from one without a wildcard.  This is because
-			// the hook has special handling for wildcards that allow non-wildcard hotkeys that overlap them to
-			// take precedence, sort of like "clip children".  The logic that builds the eclipsing array would
-			// need to be redesigned, which might not even be possible given the complexity of interactions
-			// between variant-precedence and hotkey/wildcard-precedence.
-			// By contrast, in v1.0.44 pass-through (~) is considered an attribute of each variant of a
-			// particular hotkey, not something that makes an entirely new hotkey.
-			// This was done because the old method of having them distinct appears to have only one advantage:
-			// the ability to dynamically enable/disable ~x separately from x (since if both were in effect
-			// simultaneously, one would override the other due to two different hotkey IDs competing for the same
-			// ID slot within the VK/SC hook arrays).  The advantages of allowing tilde to be a per-variant attribute
-			// seem substantial, namely to have some variant/siblings pass-through while others do not.
-			&& prop_existing.has_asterisk == prop_candidate.has_asterisk
-			// v1.0.43.05: Use stricmp not lstrcmpi because an uppercase high ANSI letter isn't necessarily
-			// produced by holding down the shift key and pressing the lowercase letter.  In addition, it
-			// preserves backward compatibility and may improve flexibility.
-			&& !_tcsicmp(prop_existing.prefix_text, prop_candidate.prefix_text)
-			&& !_tcsicmp(prop_existing.suffix_text, prop_candidate.suffix_text)   )
+		if (NatureMatches(prop_existing, prop_candidate))
 			return shk[i]; // Match found.
 	}
 
@@ -2122,6 +2342,92 @@ Hotkey *Hotkey::FindHotkeyByTrueNature(LPCTSTR aName, UCHAR &aNoSuppress, bool &
 
 
 
+bool Hotkey::NatureMatches(const HotkeyProperties &aProp1, const HotkeyProperties &aProp2)
+{
+	return aProp1.modifiers == aProp2.modifiers
+		&& aProp1.modifiersLR == aProp2.modifiersLR
+		&& aProp1.is_key_up == aProp2.is_key_up
+		// Treat wildcard (*) as an entirely separate hotkey from one without a wildcard.  This is because
+		// the hook has special handling for wildcards that allow non-wildcard hotkeys that overlap them to
+		// take precedence, sort of like "clip children".  The logic that builds the eclipsing array would
+		// need to be redesigned, which might not even be possible given the complexity of interactions
+		// between variant-precedence and hotkey/wildcard-precedence.
+		// By contrast, in v1.0.44 pass-through (~) is considered an attribute of each variant of a
+		// particular hotkey, not something that makes an entirely new hotkey.
+		// This was done because the old method of having them distinct appears to have only one advantage:
+		// the ability to dynamically enable/disable ~x separately from x (since if both were in effect
+		// simultaneously, one would override the other due to two different hotkey IDs competing for the same
+		// ID slot within the VK/SC hook arrays).  The advantages of allowing tilde to be a per-variant attribute
+		// seem substantial, namely to have some variant/siblings pass-through while others do not.
+		&& aProp1.has_asterisk == aProp2.has_asterisk
+		// v1.0.43.05: Use stricmp not lstrcmpi because an uppercase high ANSI letter isn't necessarily
+		// produced by holding down the shift key and pressing the lowercase letter.  In addition, it
+		// preserves backward compatibility and may improve flexibility.
+		&& !_tcsicmp(aProp1.prefix_text, aProp2.prefix_text)
+		&& !_tcsicmp(aProp1.suffix_text, aProp2.suffix_text);
+}
+
+
+
+UINT Hotkey::NatureHash(const HotkeyProperties &aProp)
+// Returns a hash of the properties compared by NatureMatches().  Key names are folded the same way
+// as _tcsicmp() folds them in the "C" locale, so that names which match have the same hash.
+{
+	UINT hash = 2166136261U; // FNV-1a.
+	hash = (hash ^ aProp.modifiers) * 16777619U;
+	hash = (hash ^ aProp.modifiersLR) * 16777619U;
+	hash = (hash ^ (aProp.is_key_up | (aProp.has_asterisk << 1))) * 16777619U;
+	LPCTSTR cp;
+	for (cp = aProp.prefix_text; *cp; ++cp)
+		hash = (hash ^ ctolower(*cp)) * 16777619U;
+	hash *= 16777619U; // Separate the prefix from the suffix.
+	for (cp = aProp.suffix_text; *cp; ++cp)
+		hash = (hash ^ ctolower(*cp)) * 16777619U;
+	return hash;
+}
+
+
+
+void Hotkey::AddToNatureIndex(Hotkey &aHotkey)
+// Called by AddHotkey() for each new hotkey.  If the index can't be expanded, it is left out of date
+// so that FindHotkeyByTrueNature() falls back to a linear search.
+{
+	if (sNatureIndexCount != aHotkey.mID) // The index is already out of date.
+		return;
+	if ((sNatureIndexCount + 1) * 2 > sNatureIndexSize) // Keep the load factor at or below 50%.
+	{
+		UINT new_size = sNatureIndexSize ? sNatureIndexSize * 2 : INITIAL_MAX_HOTKEYS * 2;
+		auto new_index = (NatureIndexItem *)malloc(new_size * sizeof(NatureIndexItem));
+		if (!new_index)
+			return;
+		for (UINT i = 0; i < new_size; ++i)
+			new_index[i].id = HOTKEY_ID_INVALID;
+		for (UINT j = 0; j < sNatureIndexSize; ++j)
+		{
+			if (sNatureIndex[j].id == HOTKEY_ID_INVALID)
+				continue;
+			UINT i = sNatureIndex[j].hash;
+			while (new_index[i & (new_size - 1)].id != HOTKEY_ID_INVALID)
+				++i;
+			new_index[i & (new_size - 1)] = sNatureIndex[j];
+		}
+		free(sNatureIndex);
+		sNatureIndex = new_index;
+		sNatureIndexSize = new_size;
+	}
+	HotkeyProperties prop;
+	TextToModifiers(aHotkey.mName, NULL, &prop);
+	UINT hash = NatureHash(prop);
+	UINT i = hash;
+	while (sNatureIndex[i & (sNatureIndexSize - 1)].id != HOTKEY_ID_INVALID)
+		++i;
+	sNatureIndex[i & (sNatureIndexSize - 1)].hash = hash;
+	sNatureIndex[i & (sNatureIndexSize - 1)].id = aHotkey.mID;
+	++sNatureIndexCount;
+}
+
+
+
 Hotkey *Hotkey::FindHotkeyContainingModLR(modLR_type aModifiersLR) // , HotkeyIDType hotkey_id_to_omit)
 // Returns the address of the hotkey if found, NULL otherwise.
 // Find the first hotkey whose modifiersLR contains *any* of the modifiers shows in the parameter value.
@@ -2277,6 +2583,19 @@ LPTSTR Hotkey::ToText(LPTSTR aBuf, int aBufSize, bool aAppendNewline)
 Hotstring **Hotstring::shs = NULL;
 HotstringIDType Hotstring::sHotstringCount = 0;
 HotstringIDType Hotstring::sHotstringCountMax = 0;
+HotstringIDType Hotstring::sDefinedCount = 0;
+UINT Hotstring::sGeneration = 0;
+SimpleHeap::Arena Hotstring::sDynamicArena;
+
+// Hotstrings removed by Hotstring::DeleteDynamic() which are yet to be freed.
+struct DeletedHotstrings
+{
+	SimpleHeap::Arena arena; // The memory of these hotstrings and their names.
+	Hotstring **hs;
+	HotstringIDType count;
+	DeletedHotstrings *next;
+};
+static DeletedHotstrings *sDeletedHotstrings = NULL;
 UINT Hotstring::sEnabledCount = 0;
 
 
@@ -2462,6 +2781,8 @@ ResultType Hotstring::AddHotstring(LPCTSTR aName, IObjectPtr aCallback, LPCTSTR
 	// memory around in the buffer it uses to watch for hotstrings:
 	if (_tcslen(aHotstring) > MAX_HOTSTRING_LENGTH)
 		return ValueError(_T("Hotstring max abbreviation length is ") MAX_HOTSTRING_LENGTH_STR _T("."), aHotstring, FAIL);
+	if (sHotstringCount > HOTSTRING_INDEX_MAX)
+		return MemoryError(); // See HOTSTRING_INDEX_BITS.
 
 	if (!shs)
 	{
@@ -2480,22 +2801,131 @@ ResultType Hotstring::AddHotstring(LPCTSTR aName, IObjectPtr aCallback, LPCTSTR
 		sHotstringCountMax += HOTSTRING_BLOCK_SIZE;
 	}
 
-	if (   !(shs[sHotstringCount] = new Hotstring(aName, aCallback, aOptions, aHotstring, aReplacement, aHasContinuationSection, aSuspend))   )
+	// Hotstrings created at runtime are kept in their own arena so that DeleteDynamic() can free them.
+	SimpleHeap::Arena *prev_arena = g_script.mIsReadyToExecute ? SimpleHeap::SetArena(&sDynamicArena) : NULL;
+	Hotstring *hs = new Hotstring(aName, aCallback, aOptions, aHotstring, aReplacement, aHasContinuationSection, aSuspend);
+	if (prev_arena)
+		SimpleHeap::SetArena(prev_arena);
+	if (!hs)
 		return MemoryError(); // Short msg. since so rare.
-	if (!shs[sHotstringCount]->mConstructedOK)
+	if (!hs->mConstructedOK)
 	{
-		delete shs[sHotstringCount];  // SimpleHeap allows deletion of most recently added item.
+		delete hs;  // SimpleHeap allows deletion of most recently added item.
 		return FAIL;  // The constructor already displayed the error.
 	}
 
-	++sHotstringCount;
+	shs[sHotstringCount++] = hs;
 	if (!g_script.mIsReadyToExecute) // Caller is LoadIncludedFile(); allow BIF_Hotstring to manage this at runtime.
+	{
 		++sEnabledCount; // This works because the script can't be suspended during startup (aSuspend is always FALSE).
+		sDefinedCount = sHotstringCount;
+	}
 	return OK;
 }
 
 
 
+bool Hotstring::DeleteDynamic()
+// Deletes all hotstrings created by Hotstring() (rather than defined in the script).  They are removed
+// from shs immediately, but freeing their memory and releasing their callbacks is left to FreeDeleted(),
+// since one of them might have a thread running.  Returns false on failure (out of memory).
+{
+	HotstringIDType count = sHotstringCount - sDefinedCount;
+	if (!count)
+		return true;
+	auto deleted = (DeletedHotstrings *)malloc(sizeof(DeletedHotstrings) + count * sizeof(Hotstring *));
+	if (!deleted)
+		return false;
+	deleted->hs = (Hotstring **)(deleted + 1);
+	deleted->count = count;
+	UINT enabled_count = 0;
+	for (HotstringIDType u = 0; u < count; ++u)
+	{
+		deleted->hs[u] = shs[sDefinedCount + u];
+		if (!deleted->hs[u]->mSuspended)
+			++enabled_count;
+	}
+	sHotstringCount = sDefinedCount;
+	WaitHookIdle(); // Ensure the hook is no longer examining any of the deleted hotstrings.
+	// Any messages which the hook posted for the deleted hotstrings are still queued (or buffered by
+	// MsgSleep), and their indexes will be reused by hotstrings created later.  Rather than removing
+	// them from the queue, which would reorder the messages left in it, start a new generation so
+	// that FromMessageParam() discards them when they arrive.  This is done after WaitHookIdle() so
+	// that no message for a deleted hotstring can carry the new generation.
+	++sGeneration;
+
+	sDynamicArena.MoveTo(deleted->arena);
+	deleted->next = sDeletedHotstrings;
+	sDeletedHotstrings = deleted;
+
+	UINT previously_enabled = sEnabledCount;
+	sEnabledCount -= enabled_count;
+	if (previously_enabled && !sEnabledCount) // The hotstring recognizer might not be needed anymore.
+		Hotkey::ManifestDynamic();
+	return true;
+}
+
+
+
+static bool IsDeletedHotstringName(LPTSTR aName)
+{
+	for (auto deleted = sDeletedHotstrings; deleted; deleted = deleted->next)
+		for (HotstringIDType u = 0; u < deleted->count; ++u)
+			if (deleted->hs[u]->mName == aName)
+				return true;
+	return false;
+}
+
+
+
+void Hotstring::FreeDeleted()
+// Frees the hotstrings deleted by DeleteDynamic().  Must be called only when no threads are running,
+// since each thread launched by a hotstring refers to it until the thread finishes.
+{
+	if (!sDeletedHotstrings)
+		return;
+
+	// A_ThisHotkey and A_PriorHotkey may still refer to the name of a deleted hotstring, so give them
+	// their own copies.  Copies made by a previous call are freed once they're no longer referenced.
+	static LPTSTR sNameCopy[2];
+	LPTSTR old_copy[] = { sNameCopy[0], sNameCopy[1] };
+	LPTSTR *name_var[] = { &g_script.mThisHotkeyName, &g_script.mPriorHotkeyName };
+	for (int i = 0; i < 2; ++i)
+	{
+		LPTSTR &name = *name_var[i];
+		sNameCopy[i] = NULL;
+		if (IsDeletedHotstringName(name))
+		{
+			sNameCopy[i] = _tcsdup(name);
+			if (sNameCopy[i])
+				name = sNameCopy[i];
+			else
+				name = _T(""); // Out of memory, so just clear it.
+		}
+		else if (name == old_copy[0] || name == old_copy[1])
+			sNameCopy[i] = name;
+	}
+	if (old_copy[0] && old_copy[0] != sNameCopy[0] && old_copy[0] != sNameCopy[1])
+		free(old_copy[0]);
+	if (old_copy[1] && old_copy[1] != old_copy[0] && old_copy[1] != sNameCopy[0] && old_copy[1] != sNameCopy[1])
+		free(old_copy[1]);
+
+	while (auto deleted = sDeletedHotstrings)
+	{
+		sDeletedHotstrings = deleted->next;
+		for (HotstringIDType u = 0; u < deleted->count; ++u)
+		{
+			Hotstring *hs = deleted->hs[u];
+			free(hs->mReplacement);
+			hs->~Hotstring(); // Release the callback.  This could call __Delete, which could create or delete hotstrings.
+		}
+		deleted->arena.Release();
+		free(deleted);
+	}
+}
+
+
+
 Hotstring::Hotstring(LPCTSTR aName, IObjectPtr aCallback, LPCTSTR aOptions, LPCTSTR aHotstring, LPCTSTR aReplacement
 	, bool aHasContinuationSection, UCHAR aSuspend)
 	: mCallback(aCallback)
@@ -2689,6 +3119,11 @@ bif_impl FResult BIF_Hotstring(StrArg name, ExprTokenType *aReplacement, optl<St
 		g_HSBufLength = 0;
 		return OK;
 	}
+	else if (!_tcsicmp(name, _T("DeleteAll")))
+	{
+		// Delete all hotstrings previously created by this function, so that their memory can be reclaimed.
+		return Hotstring::DeleteDynamic() ? OK : FR_E_OUTOFMEM;
+	}
 	else if (!aReplacement && !aOnOff.has_value() && *name != ':') // Equivalent to #Hotstring <name>
 	{
 		// TODO: Build string of current options and return it?
@@ -2838,7 +3273,7 @@ bif_impl FResult BIF_Hotstring(StrArg name, ExprTokenType *aReplacement, optl<St
 				g_HSBufLength = 0;
 			}
 			if (!is_enabled || !g_KeybdHook) // Hook may not be needed anymore || hook is needed but not present.
-				Hotkey::ManifestAllHotkeysHotstringsHooks();
+				Hotkey::ManifestDynamic();
 		}
 	}
 	return OK;
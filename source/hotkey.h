@@ -26,18 +26,22 @@ EXTERN_SCRIPT;  // For g_script.
 // time its capacity is reached (making the need for expansion rare).
 #define INITIAL_MAX_HOTKEYS 256
 
-// Note: 0xBFFF is the largest ID that can be used with RegisterHotkey().
-// But further limit this to 0x7FFF (32,767) so that the highest order bit
-// is reserved for our other use:
-#define HOTKEY_KEY_UP                  0x8000
-#define HOTKEY_ID_MASK                 0x7FFF
+// IDs are limited to 23 bits so that an ID, HOTKEY_KEY_UP and the one-based index of a variant
+// (see HOTKEY_VARIANT_SHIFT) can all be packed into the 32-bit wParam of AHK_HOOK_HOTKEY.
+// Note: 0xBFFF is the largest ID that can be used with RegisterHotkey(), so hotkeys with
+// higher IDs always use the hook (see Register()).
+#define HOTKEY_KEY_UP                  0x800000
+#define HOTKEY_ID_MASK                 0x7FFFFF
 #define HOTKEY_ID_INVALID              HOTKEY_ID_MASK
-#define HOTKEY_ID_ALT_TAB              0x7FFE
-#define HOTKEY_ID_ALT_TAB_SHIFT        0x7FFD
-#define HOTKEY_ID_ALT_TAB_MENU         0x7FFC
-#define HOTKEY_ID_ALT_TAB_AND_MENU     0x7FFB
-#define HOTKEY_ID_ALT_TAB_MENU_DISMISS 0x7FFA
-#define HOTKEY_ID_MAX                  0x7FF9  // 32762 hotkeys
+#define HOTKEY_ID_ALT_TAB              0x7FFFFE
+#define HOTKEY_ID_ALT_TAB_SHIFT        0x7FFFFD
+#define HOTKEY_ID_ALT_TAB_MENU         0x7FFFFC
+#define HOTKEY_ID_ALT_TAB_AND_MENU     0x7FFFFB
+#define HOTKEY_ID_ALT_TAB_MENU_DISMISS 0x7FFFFA
+#define HOTKEY_ID_MAX                  0x7FFFF9  // 8388602 hotkeys
+#define HOTKEY_ID_MAX_REGISTERED       0xBFFF
+#define HOTKEY_VARIANT_SHIFT           24    // Bits above this in the wParam of AHK_HOOK_HOTKEY hold the variant's mIndex, or 0 if undetermined.
+#define HOTKEY_VARIANT_MAX             0xFF
 #define HOTKEY_ID_ON                   0x01  // This and the next 2 are used only for convenience by ConvertAltTab().
 #define HOTKEY_ID_OFF                  0x02
 #define HOTKEY_ID_TOGGLE               0x03
@@ -53,8 +57,13 @@ EXTERN_SCRIPT;  // For g_script.
 #define COMPOSITE_DELIMITER _T(" & ")
 #define COMPOSITE_DELIMITER_LENGTH 3
 
-// Smallest workable size: to save mem in some large arrays that use this:
-typedef USHORT HotkeyIDType; // This is relied upon to be unsigned; e.g. many places omit a check for ID < 0.
+// UINT rather than USHORT: with HOTKEY_KEY_UP taken from the top bit, 16-bit IDs limited a script to
+// 32762 hotkeys, which generated keymaps can exceed (see tests/bench/HotkeyLoad.ahk).  No narrower
+// type fits 23 bits.  The cost is mainly in the hook's kvkm and kscm tables, which hold one ID for
+// each combination of modifiers and key (196608 entries), so they take 768 KB rather than 384 KB
+// while the keyboard hook is installed.  The other ID members (in Hotkey and key_type) add only a
+// few KB even for large scripts, and the IDs already travel in a 32-bit wParam.
+typedef UINT HotkeyIDType; // This is relied upon to be unsigned; e.g. many places omit a check for ID < 0.
 typedef HotkeyIDType HookActionType;
 
 typedef UCHAR HotkeyTypeType;
@@ -118,6 +127,24 @@ private:
 	static DWORD sTimeNow;
 	static HotkeyIDType sNextID;
 
+	// State retained from the most recent full pass of ManifestAllHotkeysHotstringsHooks(), so that
+	// ManifestHotkey() can reevaluate a single hotkey without examining all the others:
+	static bool sVKIsPrefix[VK_MAX + 1];
+	static HotkeyIDType sManifestedCount; // sHotkeyCount as of the last full pass.
+	static int sKeybdHookUsers, sMouseHookUsers; // Number of active hotkeys which require each hook.
+	static int sManifestBatchDepth;
+	static bool sManifestPending;
+
+	static HookType OtherHooksNeeded();
+	HookType Activate();
+	bool AffectsOtherHotkeys()
+	// Returns true if enabling or disabling this hotkey can change how other hotkeys are handled.
+	{
+		return mModifierVK // Prefix key; see sVKIsPrefix.
+			|| (mKeyUp && mVK) // Its down counterpart must use the hook.
+			|| (mAllowExtraModifiers && mVK && !mModifiersLR && !mModifierSC); // Wildcard which can eclipse other hotkeys.
+	}
+
 	bool Enable(HotkeyVariant &aVariant) // Returns true if the variant needed to be disabled, in which case caller should generally call ManifestAllHotkeysHotstringsHooks().
 	{
 		if (aVariant.mEnabled) // Added for v1.0.23 to greatly improve performance when hotkey is already in the right state.
@@ -170,13 +197,13 @@ public:
 
 	// 32-bit members:
 	mod_type mModifiers;  // MOD_ALT, MOD_CONTROL, MOD_SHIFT, MOD_WIN, or some additive or bitwise-or combination of these.
-
-	// 16-bit members:
 	HotkeyIDType mID;  // Must be unique for each hotkey of a given thread.
 	HookActionType mHookAction;
+	HotkeyIDType mNextHotkey; // ID of the next hotkey with the same suffix as this one (initialized by the hook).
+
+	// 16-bit members:
 	sc_type mSC; // Scan code.  All vk's have a scan code, but not vice versa.
 	sc_type mModifierSC; // If mModifierVK is zero, this scan code, if non-zero, will be used as the modifier.
-	HotkeyIDType mNextHotkey; // ID of the next hotkey with the same suffix as this one (initialized by the hook).
 
 	// Keep single-byte attributes adjacent to each other to conserve memory within byte-aligned class/struct:
 	modLR_type mModifiersLR;  // Left-right centric versions of the above.
@@ -199,6 +226,8 @@ public:
 	bool mIsRegistered;  // Whether this hotkey has been successfully registered.
 	bool mParentEnabled; // When true, the individual variants' mEnabled flags matter. When false, the entire hotkey is disabled.
 	bool mConstructedOK;
+	bool mEclipsed; // Set by ManifestAllHotkeysHotstringsHooks() if a wildcard or key-up hotkey requires this one to use the hook.
+	HookType mHookUsage; // The hook(s) this hotkey required when it was last manifested; 0 if it was inactive.
 	
 	// 64- or 32-bit members:
 	LPTSTR mName; // Points to the label name for static hotkeys, or a dynamically-allocated string for dynamic hotkeys.
@@ -226,6 +255,11 @@ public:
 	static void TriggerJoyHotkeys(int aJoystickID, DWORD aButtonsNewlyDown);
 	void PerformInNewThreadMadeByCaller(HotkeyVariant &aVariant);
 	static void ManifestAllHotkeysHotstringsHooks();
+	static void ManifestHotkey(Hotkey &aHotkey);
+	static void ManifestDynamic();
+	static int BeginManifestBatch() { return ++sManifestBatchDepth; }
+	static int ManifestBatchDepth() { return sManifestBatchDepth; }
+	static int EndManifestBatch(bool aAll = false);
 	static void RequireHook(HookType aWhichHook, bool aRequire = true) { aRequire ? sWhichHookAlways |= aWhichHook : sWhichHookAlways &= ~aWhichHook; }
 	static void MaybeUninstallHook();
 	static ResultType TextInterpret(LPCTSTR aName, Hotkey *aThisHotkey, bool aSyntaxCheckOnly = false);
@@ -329,6 +363,20 @@ public:
 private:
 	static HotkeyVariant *CriterionFiringIsCertainHelper(HotkeyIDType &aHotkeyIDwithFlags, bool aKeyUp, UCHAR &aNoSuppress
 		, bool &aFireWithNoSuppress, LPTSTR aSingleChar);
+
+	// Open-addressed hash table of hotkeys keyed by the properties compared by FindHotkeyByTrueNature(),
+	// so that defining a large number of hotkeys doesn't require comparing each to all of the others.
+	struct NatureIndexItem
+	{
+		UINT hash;
+		HotkeyIDType id; // HOTKEY_ID_INVALID if the slot is empty.
+	};
+	static NatureIndexItem *sNatureIndex;
+	static UINT sNatureIndexSize; // Power of 2, or zero if not yet allocated.
+	static HotkeyIDType sNatureIndexCount; // If less than sHotkeyCount (such as due to lack of memory), the index is not used.
+	static UINT NatureHash(const HotkeyProperties &aProp);
+	static bool NatureMatches(const HotkeyProperties &aProp1, const HotkeyProperties &aProp2);
+	static void AddToNatureIndex(Hotkey &aHotkey);
 };
 
 
@@ -338,6 +386,11 @@ private:
 #define MAX_HOTSTRING_LENGTH_STR _T("40")  // Keep in sync with the above.
 #define HOTSTRING_BLOCK_SIZE 1024
 typedef UINT HotstringIDType;
+// The wParam of AHK_HOTSTRING holds the hotstring's index in its low bits and the deletion generation
+// in the bits above.  The limits keep it below HOTSTRING_INDEX_INVALID (INT_MAX) on 32-bit builds.
+#define HOTSTRING_INDEX_BITS 24
+#define HOTSTRING_INDEX_MAX ((1 << HOTSTRING_INDEX_BITS) - 1)
+#define HOTSTRING_GENERATION_MASK 0x3F
 
 enum CaseConformModes {CASE_CONFORM_NONE, CASE_CONFORM_ALL_CAPS, CASE_CONFORM_FIRST_CAP};
 
@@ -349,6 +402,29 @@ public:
 	static HotstringIDType sHotstringCount;
 	static HotstringIDType sHotstringCountMax;
 	static UINT sEnabledCount; // v1.1.28.00: For performance, such as avoiding calling ToAsciiEx() in the hook.
+	static HotstringIDType sDefinedCount; // Number of hotstrings defined in the script, which always come first in shs.
+	static SimpleHeap::Arena sDynamicArena; // Memory of hotstrings created by Hotstring(), released by DeleteDynamic().
+	static UINT sGeneration; // Incremented by each DeleteDynamic() which deletes anything.
+
+	// Returns the wParam which the hook posts with AHK_HOTSTRING for the hotstring at aIndex.
+	static WPARAM MessageParam(HotstringIDType aIndex)
+	{
+		return aIndex | ((WPARAM)(sGeneration & HOTSTRING_GENERATION_MASK) << HOTSTRING_INDEX_BITS);
+	}
+
+	// Returns the hotstring an AHK_HOTSTRING message was posted for, or NULL if the message is invalid
+	// (perhaps spoofed by an external app) or was posted for a hotstring which has since been deleted
+	// by DeleteDynamic().  The indexes of deleted hotstrings are reused, so a message posted before
+	// the deletion is recognized by its generation.  Script-defined hotstrings are never deleted.
+	static Hotstring *FromMessageParam(WPARAM aParam)
+	{
+		auto index = (HotstringIDType)(aParam & HOTSTRING_INDEX_MAX);
+		if (index >= sHotstringCount || (aParam >> HOTSTRING_INDEX_BITS) > HOTSTRING_GENERATION_MASK)
+			return NULL;
+		if (index >= sDefinedCount && (aParam >> HOTSTRING_INDEX_BITS) != (sGeneration & HOTSTRING_GENERATION_MASK))
+			return NULL;
+		return shs[index];
+	}
 
 	IObjectRef mCallback;
 	LPTSTR mName;
@@ -379,11 +455,13 @@ public:
 		, bool &aCaseSensitive, bool &aConformToCase, bool &aDoBackspace, bool &aOmitEndChar, SendRawType &aSendRaw
 		, bool &aEndCharRequired, bool &aDetectWhenInsideWord, bool &aDoReset, bool &aExecuteAction, bool &aSuspendExempt);
 	void ParseOptions(LPCTSTR aOptions);
+	static bool DeleteDynamic();
+	static void FreeDeleted();
 
 	// Constructor & destructor:
 	Hotstring(LPCTSTR aName, IObjectPtr aCallback, LPCTSTR aOptions, LPCTSTR aHotstring, LPCTSTR aReplacement
 		, bool aHasContinuationSection, UCHAR aSuspend);
-	~Hotstring() {}  // Note that mReplacement is sometimes malloc'd, sometimes from SimpleHeap, and sometimes the empty string.
+	~Hotstring() {}  // Note that mReplacement is either malloc'd or NULL, and is freed by FreeDeleted() if needed.
 
 	void *operator new(size_t aBytes) {return SimpleHeap::Malloc(aBytes);}
 	void *operator new[](size_t aBytes) {return SimpleHeap::Malloc(aBytes);}
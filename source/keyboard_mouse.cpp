@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include "util.h"  // for strlicmp()
 #include "window.h" // for IsWindowHung()
 #include "abi.h"
+#include "SendProgram.h"
 
 
 // Added for v1.0.25.  Search on sPrevEventType for more comments:
@@ -43,19 +44,27 @@ static ResultType sTargetLayoutHasAltGr; //
 // v1.0.43: Support for SendInput() and journal-playback hook:
 #define MAX_INITIAL_EVENTS_SI 500UL  // sizeof(INPUT) == 28 as of 2006. Since Send is called so often, and since most Sends are short, reducing the load on the stack is also a deciding factor for these.
 #define MAX_INITIAL_EVENTS_PB 1500UL // sizeof(PlaybackEvent) == 8, so more events are justified before resorting to malloc().
-static LPINPUT sEventSI;        // No init necessary.  An array that's allocated/deallocated by SendKeys().
-static PlaybackEvent *&sEventPB = (PlaybackEvent *&)sEventSI;
-static UINT sEventCount, sMaxEvents; // Number of items in the above arrays and the current array capacity.
+static InputEventArray sEvents;  // No init necessary.  An array that's allocated/deallocated by SendKeys().  See SendProgram.h.
+static LPINPUT &sEventSI = sEvents.mInput;
+static PlaybackEvent *&sEventPB = (PlaybackEvent *&)sEvents.mInput;
+static UINT &sEventCount = sEvents.mCount, &sMaxEvents = sEvents.mMax; // Number of items in the above arrays and the current array capacity.
 static UINT sCurrentEvent;
-static modLR_type sEventModifiersLR; // Tracks the modifier state to following the progress/building of the SendInput array.
+static modLR_type &sEventModifiersLR = sEvents.mModifiersLR; // Tracks the modifier state to following the progress/building of the SendInput array.
 static POINT sSendInputCursorPos;    // Tracks/predicts cursor position as SendInput array is built.
-static HookType sHooksToRemoveDuringSendInput;
+static HookType &sHooksToRemoveDuringSendInput = sEvents.mHooksToRemove;
 static SendModes sSendMode = SM_EVENT; // Whether a SendInput or Hook array is currently being constructed.
-static bool sAbortArraySend;         // No init needed.
+static bool &sAbortArraySend = sEvents.mAbort;
 static bool sFirstCallForThisEvent;  //
 static bool sInBlindMode;            //
 static DWORD sThisEventTime;         //
 
+// Compiled Send strings are cached so that frequently repeated Sends don't need to be parsed and
+// resolved for the keyboard layout each time.  The cache is direct-mapped and used only by the main
+// thread.  Longer strings are typically variable text rather than key sequences, so they aren't cached.
+#define SEND_PROGRAM_CACHE_SIZE 64 // Must be a power of 2.
+#define SEND_PROGRAM_CACHE_MAX_LENGTH 256
+static SendProgram *sSendProgramCache[SEND_PROGRAM_CACHE_SIZE];
+
 
 void DisguiseWinAltIfNeeded(vk_type aVK)
 // For v1.0.25, the following situation is fixed by the code below: If LWin or LAlt
@@ -133,6 +142,72 @@ void SendUnicodeChar(wchar_t aChar, modLR_type aModifiers)
 
 
 
+static void ResolveSendProgram(SendProgram &aProgram, HKL aKeybdLayout)
+// Resolves the key names and characters of aProgram to VK/SC codes for aKeybdLayout.
+// Modifiers required by characters are applied by SendKeys(), since they depend on which
+// modifiers are already in effect.
+{
+	aProgram.mLayout = aKeybdLayout;
+	for (UINT i = 0; i < aProgram.mOpCount; ++i)
+	{
+		SendOp &op = aProgram.mOp[i];
+		switch (op.type)
+		{
+		case SOP_KEY:
+			if (op.name_length == 1) // See the single-character case in TextToVK().
+			{
+				op.key_scan = CharToKeyScan(op.ch, aKeybdLayout);
+				op.sc = TextToSC(aProgram.Text(op)); // Used only if key_scan doesn't produce a VK.
+			}
+			else
+				TextToVKandSC(aProgram.Text(op), op.vk, op.sc, NULL, aKeybdLayout);
+			break;
+		case SOP_CHAR:
+			if (op.send_raw != SCM_RAW_TEXT)
+				op.key_scan = CharToKeyScan(op.ch, aKeybdLayout);
+			break;
+		}
+	}
+}
+
+
+
+static SendProgram *GetSendProgram(LPCTSTR aKeys, SendRawModes aSendRaw, HKL aKeybdLayout)
+// Returns a program for aKeys which has been resolved for aKeybdLayout, or NULL if out of memory.
+// Caller must call Release() when finished with it.
+{
+	size_t length = _tcslen(aKeys);
+	SendProgram **slot = NULL;
+	UINT hash = 0;
+	if (length <= SEND_PROGRAM_CACHE_MAX_LENGTH && GetCurrentThreadId() == g_MainThreadID)
+	{
+		hash = SendProgram::Hash(aKeys, length, aSendRaw, aKeybdLayout);
+		slot = &sSendProgramCache[hash & (SEND_PROGRAM_CACHE_SIZE - 1)];
+		if (*slot && (*slot)->Matches(aKeys, length, aSendRaw, aKeybdLayout, hash))
+		{
+			(*slot)->AddRef();
+			return *slot;
+		}
+	}
+	auto program = SendProgram::Compile(aKeys, aSendRaw);
+	if (!program)
+		return NULL;
+	ResolveSendProgram(*program, aKeybdLayout);
+	program->mHash = hash;
+	if (slot)
+	{
+		// The previous program may still be in use by an interrupted Send, in which case
+		// it is freed when that Send releases it.
+		if (*slot)
+			(*slot)->Release();
+		program->AddRef();
+		*slot = program;
+	}
+	return program;
+}
+
+
+
 void SendKeys(LPCTSTR aKeys, SendRawModes aSendRaw, SendModes aSendModeOrig, HWND aTargetWindow)
 // The aKeys string must be modifiable (not constant), since for performance reasons,
 // it's allowed to be temporarily altered by this function.  mThisHotkeyModifiersLR, if non-zero,
@@ -307,6 +382,16 @@ void SendKeys(LPCTSTR aKeys, SendRawModes aSendRaw, SendModes aSendModeOrig, HWN
 	sTargetKeybdLayout = GetKeyboardLayout(keybd_layout_thread); // If keybd_layout_thread==0, this will get our thread's own layout, which seems like the best/safest default.
 	sTargetLayoutHasAltGr = LayoutHasAltGr(sTargetKeybdLayout);  // Note that WM_INPUTLANGCHANGEREQUEST is not monitored by MsgSleep for the purpose of caching our thread's keyboard layout.  This is because it would be unreliable if another msg pump such as MsgBox is running.  Plus it hardly helps perf. at all, and hurts maintainability.
 
+	SendProgram *program = GetSendProgram(aKeys, aSendRaw, sTargetKeybdLayout);
+	if (!program) // Out of memory.
+	{
+		if (threads_are_attached)
+			AttachThreadInput(g_MainThreadID, target_thread, FALSE);
+		g.KeyDelay = orig_key_delay;
+		g.PressDuration = orig_press_duration;
+		return;
+	}
+
 	// Below is now called with "true" so that the hook's modifier state will be corrected (if necessary)
 	// prior to every send.
 	modLR_type mods_current = GetModifierLRState(true); // Current "logical" modifier state.
@@ -454,351 +539,242 @@ void SendKeys(LPCTSTR aKeys, SendRawModes aSendRaw, SendModes aSendModeOrig, HWN
 	// which ALT key is held down to produce the character.
 	vk_type this_event_modifier_down;
 	size_t key_text_length, key_name_length;
-	LPCTSTR end_pos, next_word;
-	TCHAR key_text[1024]; // Make it reasonably large to support any conceivable {Click ...} usage.
+	LPTSTR key_text, next_word;
 	KeyEventTypes event_type;
 	int repeat_count, click_x, click_y;
 	bool move_offset;
-	enum { KEYDOWN_TEMP = 0, KEYDOWN_PERSISTENT, KEYDOWN_REMAP } key_down_type;
+	SendKeyDownTypes key_down_type;
 	DWORD placeholder;
 
 	LONG_OPERATION_INIT  // Needed even for SendInput/Play.
 
-	for (; *aKeys; ++aKeys, sPrevEventModifierDown = this_event_modifier_down)
+	// The string was parsed into operations by SendProgram::Compile() and resolved for sTargetKeybdLayout
+	// above.  See SendProgram.cpp for how the items of the string map to the operations below.
+	SendOp *op_end = program->mOp + program->mOpCount;
+	for (SendOp *op = program->mOp; op < op_end; ++op, sPrevEventModifierDown = this_event_modifier_down)
 	{
 		this_event_modifier_down = 0; // Set default for this iteration, overridden selectively below.
 		if (!sSendMode)
 			LONG_OPERATION_UPDATE_FOR_SENDKEYS // This does not measurably affect the performance of SendPlay/Event.
 
-		if (!aSendRaw && _tcschr(_T("^+!#{}"), *aKeys))
+		switch (op->type)
 		{
-			switch (*aKeys)
+		case SOP_SKIP:
+			continue;
+
+		case SOP_MODIFIER:
+			if (!(persistent_modifiers_for_this_SendKeys & op->mod_mask))
+				mods_for_next_key |= op->mod;
+			// else don't add it, because the value of mods_for_next_key may also used to determine
+			// which keys to release after the key to which this modifier applies is sent.
+			// We don't want persistent modifiers to ever be released because that's how
+			// AutoIt2 behaves and it seems like a reasonable standard.
+			continue;
+
+		case SOP_CLICK:
+			ParseClickOptions(omit_leading_whitespace(program->Text(*op) + 5), click_x, click_y, vk
+				, event_type, repeat_count, move_offset);
+			if (repeat_count < 1) // Allow {Click 100, 100, 0} to do a mouse-move vs. click (but modifiers like ^{Click..} aren't supported in this case.
+				MouseMove(click_x, click_y, placeholder, g.DefaultMouseSpeed, move_offset);
+			else // Use SendKey because it supports modifiers (e.g. ^{Click}) SendKey requires repeat_count>=1.
+				SendKey(vk, 0, mods_for_next_key, persistent_modifiers_for_this_SendKeys
+					, repeat_count, event_type, 0, aTargetWindow, click_x, click_y, move_offset);
+			break;
+
+		case SOP_KEY:
+		{
+			key_text = program->Text(*op);
+			key_text_length = op->text_length;
+			key_name_length = op->name_length;
+			next_word = program->mText + op->next_word;
+			event_type = (KeyEventTypes)op->event_type;
+			key_down_type = (SendKeyDownTypes)op->key_down_type;
+			repeat_count = op->repeat_count; // Always > 0 for SOP_KEY.
+			if (key_name_length == 1)
 			{
-			case '^':
-				if (!(persistent_modifiers_for_this_SendKeys & (MOD_LCONTROL|MOD_RCONTROL)))
-					mods_for_next_key |= MOD_LCONTROL;
-				// else don't add it, because the value of mods_for_next_key may also used to determine
-				// which keys to release after the key to which this modifier applies is sent.
-				// We don't want persistent modifiers to ever be released because that's how
-				// AutoIt2 behaves and it seems like a reasonable standard.
-				continue;
-			case '+':
-				if (!(persistent_modifiers_for_this_SendKeys & (MOD_LSHIFT|MOD_RSHIFT)))
-					mods_for_next_key |= MOD_LSHIFT;
-				continue;
-			case '!':
-				if (!(persistent_modifiers_for_this_SendKeys & (MOD_LALT|MOD_RALT)))
-					mods_for_next_key |= MOD_LALT;
-				continue;
-			case '#':
-				if (!(persistent_modifiers_for_this_SendKeys & (MOD_LWIN|MOD_RWIN)))
-					mods_for_next_key |= MOD_LWIN;
-				continue;
-			case '}': continue;  // Important that these be ignored.  Be very careful about changing this, see below.
-			case '{':
+				// Same as TextToVKandSC(), but using the result of VkKeyScanEx() which was cached above.
+				vk = KeyScanToVKAndModifiers(op->ch, op->key_scan, &mods_for_next_key);
+				sc = vk ? 0 : op->sc;
+			}
+			else
 			{
-				if (   !(end_pos = _tcschr(aKeys + 1, '}'))   ) // Ignore it and due to rarity, don't reset mods_for_next_key.
-					continue; // This check is relied upon by some things below that assume a '}' is present prior to the terminator.
-				aKeys = omit_leading_whitespace(aKeys + 1); // v1.0.43: Skip leading whitespace inside the braces to be more flexible.
-				if (   !(key_text_length = end_pos - aKeys)   )
+				vk = op->vk;
+				sc = op->sc;
+			}
+
+			if (vk || sc)
+			{
+				if (key_as_modifiersLR = KeyToModifiersLR(vk, sc)) // Assign
 				{
-					if (end_pos[1] == '}')
-					{
-						// The literal string "{}}" has been encountered, which is interpreted as a single "}".
-						++end_pos;
-						key_text_length = 1;
-					}
-					else if (IS_SPACE_OR_TAB(end_pos[1])) // v1.0.48: Support "{} down}", "{} downtemp}" and "{} up}".
+					if (!aTargetWindow)
 					{
-						next_word = omit_leading_whitespace(end_pos + 1);
-						if (   !_tcsnicmp(next_word, _T("Down"), 4) // "Down" or "DownTemp" (or likely enough).
-							|| !_tcsnicmp(next_word, _T("Up"), 2)   )
+						if (event_type == KEYDOWN) // i.e. make {Shift down} have the same effect {ShiftDown}
 						{
-							if (   !(end_pos = _tcschr(next_word, '}'))   ) // See comments at similar section above.
-								continue;
-							key_text_length = end_pos - aKeys; // This result must be non-zero due to the checks above.
+							this_event_modifier_down = vk;
+							if (key_down_type == KEYDOWN_PERSISTENT) // v1.0.44.05.
+								sModifiersLR_persistent |= key_as_modifiersLR;
+							else if (key_down_type == KEYDOWN_REMAP) // v1.1.27.00
+								sModifiersLR_remapped |= key_as_modifiersLR;
+							persistent_modifiers_for_this_SendKeys |= key_as_modifiersLR; // v1.0.44.06: Added this line to fix the fact that "DownTemp" should keep the key pressed down after the send.
 						}
-						else
-							goto brace_case_end;  // The loop's ++aKeys will now skip over the '}', ignoring it.
-					}
-					else // Empty braces {} were encountered (or all whitespace, but literal whitespace isn't sent).
-						goto brace_case_end;  // The loop's ++aKeys will now skip over the '}', ignoring it.
-				}
-
-				// Make a modifiable null-terminated copy to simplify comparisons etc.
-				if (key_text_length >= _countof(key_text))
-					goto brace_case_end; // Skip this unreasonably long (probably invalid) item.
-				tmemcpy(key_text, aKeys, key_text_length);
-				key_text[key_text_length] = '\0';
-
-				if (!_tcsnicmp(key_text, _T("Click"), 5))
-				{
-					ParseClickOptions(omit_leading_whitespace(key_text + 5), click_x, click_y, vk
-						, event_type, repeat_count, move_offset);
-					if (repeat_count < 1) // Allow {Click 100, 100, 0} to do a mouse-move vs. click (but modifiers like ^{Click..} aren't supported in this case.
-						MouseMove(click_x, click_y, placeholder, g.DefaultMouseSpeed, move_offset);
-					else // Use SendKey because it supports modifiers (e.g. ^{Click}) SendKey requires repeat_count>=1.
-						SendKey(vk, 0, mods_for_next_key, persistent_modifiers_for_this_SendKeys
-							, repeat_count, event_type, 0, aTargetWindow, click_x, click_y, move_offset);
-					goto brace_case_end; // This {} item completely handled, so move on to next.
-				}
-				else if (!_tcsicmp(key_text, _T("Raw"))) // This is used by auto-replace hotstrings too.
-				{
-					// As documented, there's no way to switch back to non-raw mode afterward since there's no
-					// correct way to support special (non-literal) strings such as {Raw Off} while in raw mode.
-					aSendRaw = SCM_RAW;
-					goto brace_case_end; // This {} item completely handled, so move on to next.
-				}
-				else if (!_tcsicmp(key_text, _T("Text"))) // Added in v1.1.27
-				{
-					aSendRaw = SCM_RAW_TEXT;
-					goto brace_case_end; // This {} item completely handled, so move on to next.
-				}
-
-				// Since above didn't "goto", this item isn't {Click}.
-				event_type = KEYDOWNANDUP;         // Set defaults.
-				repeat_count = 1;                  //
-				key_name_length = key_text_length; //
-
-				if (auto space_pos = StrChrAny(key_text, _T(" \t"))) // Assign. Also, it relies on the fact that {} key names contain no spaces.
-				{
-					*space_pos = '\0';  // Terminate here so that TextToVK() can properly resolve a single char.
-					key_name_length = space_pos - key_text; // Override the default value set above.
-					next_word = omit_leading_whitespace(space_pos + 1);
-					UINT next_word_length = (UINT)(end_pos - next_word);
-					if (next_word_length > 0)
-					{
-						if (!_tcsnicmp(next_word, _T("Down"), 4))
+						else if (event_type == KEYUP) // *not* KEYDOWNANDUP, since that would be an intentional activation of the Start Menu or menu bar.
 						{
-							event_type = KEYDOWN;
-							// v1.0.44.05: Added key_down_is_persistent (which is not initialized except here because
-							// it's only applicable when event_type==KEYDOWN).  It avoids the following problem:
-							// When a key is remapped to become a modifier (such as F1::Control), launching one of
-							// the script's own hotkeys via F1 would lead to bad side-effects if that hotkey uses
-							// the Send command. This is because the Send command assumes that any modifiers pressed
-							// down by the script itself (such as Control) are intended to stay down during all
-							// keystrokes generated by that script. To work around this, something like KeyWait F1
-							// would otherwise be needed. within any hotkey triggered by the F1 key.
-							if (!_tcsnicmp(next_word + 4, _T("Temp"), 4)) // "DownTemp" means non-persistent.
-								key_down_type = KEYDOWN_TEMP;
-							else if (toupper(next_word[4] == 'R')) // "DownR" means treated as a physical modifier (R = remap); i.e. not kept down during Send, but restored after Send (unlike Temp).
-								key_down_type = KEYDOWN_REMAP;
-							else
-								key_down_type = KEYDOWN_PERSISTENT;
+							DisguiseWinAltIfNeeded(vk);
+							sModifiersLR_persistent &= ~key_as_modifiersLR;
+							sModifiersLR_remapped &= ~key_as_modifiersLR;
+							persistent_modifiers_for_this_SendKeys &= ~key_as_modifiersLR;
+							// Fix for v1.0.43: Also remove LControl if this key happens to be AltGr.
+							if (vk == VK_RMENU && sTargetLayoutHasAltGr == CONDITION_TRUE) // It is AltGr.
+								persistent_modifiers_for_this_SendKeys &= ~MOD_LCONTROL;
 						}
-						else if (!_tcsicmp(next_word, _T("Up")))
-							event_type = KEYUP;
-						else
-							repeat_count = ATOI(next_word);
-							// Above: If negative or zero, that is handled further below.
-							// There is no complaint for values <1 to support scripts that want to conditionally send
-							// zero keystrokes, e.g. Send {a %Count%}
+						// else must never change sModifiersLR_persistent in response to KEYDOWNANDUP
+						// because that would break existing scripts.  This is because that same
+						// modifier key may have been pushed down via {ShiftDown} rather than "{Shift Down}".
+						// In other words, {Shift} should never undo the effects of a prior {ShiftDown}
+						// or {Shift down}.
 					}
+					//else don't add this event to sModifiersLR_persistent because it will not be
+					// manifest via keybd_event.  Instead, it will done via less intrusively
+					// (less interference with foreground window) via SetKeyboardState() and
+					// PostMessage().  This change is for ControlSend in v1.0.21 and has been
+					// documented.
 				}
+				// Below: sModifiersLR_persistent stays in effect (pressed down) even if the key
+				// being sent includes that same modifier.  Surprisingly, this is how AutoIt2
+				// behaves also, which is good.  Example: Send, {AltDown}!f  ; this will cause
+				// Alt to still be down after the command is over, even though F is modified
+				// by Alt.
+				SendKey(vk, sc, mods_for_next_key, persistent_modifiers_for_this_SendKeys
+					, repeat_count, event_type, key_as_modifiersLR, aTargetWindow);
+			}
 
-				TextToVKandSC(key_text, vk, sc, &mods_for_next_key, sTargetKeybdLayout);
-
-				if (repeat_count < 1)
-					goto brace_case_end; // Gets rid of one level of indentation. Well worth it.
-
-				if (vk || sc)
+			else if (key_name_length == 1) // No vk/sc means a char of length one is sent via special method.
+			{
+				// v1.0.40: SendKeySpecial sends only keybd_event keystrokes, not ControlSend style
+				// keystrokes.
+				// v1.0.43.07: Added check of event_type!=KEYUP, which causes something like Send {ð up} to
+				// do nothing if the curr. keyboard layout lacks such a key.  This is relied upon by remappings
+				// such as F1::ð (i.e. a destination key that doesn't have a VK, at least in English).
+				if (event_type != KEYUP) // In this mode, mods_for_next_key and event_type are ignored due to being unsupported.
 				{
-					if (key_as_modifiersLR = KeyToModifiersLR(vk, sc)) // Assign
+					if (aTargetWindow)
 					{
-						if (!aTargetWindow)
-						{
-							if (event_type == KEYDOWN) // i.e. make {Shift down} have the same effect {ShiftDown}
-							{
-								this_event_modifier_down = vk;
-								if (key_down_type == KEYDOWN_PERSISTENT) // v1.0.44.05.
-									sModifiersLR_persistent |= key_as_modifiersLR;
-								else if (key_down_type == KEYDOWN_REMAP) // v1.1.27.00
-									sModifiersLR_remapped |= key_as_modifiersLR;
-								persistent_modifiers_for_this_SendKeys |= key_as_modifiersLR; // v1.0.44.06: Added this line to fix the fact that "DownTemp" should keep the key pressed down after the send.
-							}
-							else if (event_type == KEYUP) // *not* KEYDOWNANDUP, since that would be an intentional activation of the Start Menu or menu bar.
-							{
-								DisguiseWinAltIfNeeded(vk);
-								sModifiersLR_persistent &= ~key_as_modifiersLR;
-								sModifiersLR_remapped &= ~key_as_modifiersLR;
-								persistent_modifiers_for_this_SendKeys &= ~key_as_modifiersLR;
-								// Fix for v1.0.43: Also remove LControl if this key happens to be AltGr.
-								if (vk == VK_RMENU && sTargetLayoutHasAltGr == CONDITION_TRUE) // It is AltGr.
-									persistent_modifiers_for_this_SendKeys &= ~MOD_LCONTROL;
-							}
-							// else must never change sModifiersLR_persistent in response to KEYDOWNANDUP
-							// because that would break existing scripts.  This is because that same
-							// modifier key may have been pushed down via {ShiftDown} rather than "{Shift Down}".
-							// In other words, {Shift} should never undo the effects of a prior {ShiftDown}
-							// or {Shift down}.
-						}
-						//else don't add this event to sModifiersLR_persistent because it will not be
-						// manifest via keybd_event.  Instead, it will done via less intrusively
-						// (less interference with foreground window) via SetKeyboardState() and
-						// PostMessage().  This change is for ControlSend in v1.0.21 and has been
-						// documented.
+						// Although MSDN says WM_CHAR uses UTF-16, it seems to really do automatic
+						// translation between ANSI and UTF-16; we rely on this for correct results:
+						for (int i = 0; i < repeat_count; ++i)
+							PostMessage(aTargetWindow, WM_CHAR, key_text[0], 0);
 					}
-					// Below: sModifiersLR_persistent stays in effect (pressed down) even if the key
-					// being sent includes that same modifier.  Surprisingly, this is how AutoIt2
-					// behaves also, which is good.  Example: Send, {AltDown}!f  ; this will cause
-					// Alt to still be down after the command is over, even though F is modified
-					// by Alt.
-					SendKey(vk, sc, mods_for_next_key, persistent_modifiers_for_this_SendKeys
-						, repeat_count, event_type, key_as_modifiersLR, aTargetWindow);
+					else
+						SendKeySpecial(key_text[0], repeat_count, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
 				}
+			}
 
-				else if (key_name_length == 1) // No vk/sc means a char of length one is sent via special method.
+			// See comment "else must never change sModifiersLR_persistent" above about why
+			// !aTargetWindow is used below:
+			else if (vk = TextToSpecial(key_text, key_text_length, event_type
+				, persistent_modifiers_for_this_SendKeys, !aTargetWindow)) // Assign.
+			{
+				if (!aTargetWindow)
 				{
-					// v1.0.40: SendKeySpecial sends only keybd_event keystrokes, not ControlSend style
-					// keystrokes.
-					// v1.0.43.07: Added check of event_type!=KEYUP, which causes something like Send {ð up} to
-					// do nothing if the curr. keyboard layout lacks such a key.  This is relied upon by remappings
-					// such as F1::ð (i.e. a destination key that doesn't have a VK, at least in English).
-					if (event_type != KEYUP) // In this mode, mods_for_next_key and event_type are ignored due to being unsupported.
-					{
-						if (aTargetWindow)
-						{
-							// Although MSDN says WM_CHAR uses UTF-16, it seems to really do automatic
-							// translation between ANSI and UTF-16; we rely on this for correct results:
-							for (int i = 0; i < repeat_count; ++i)
-								PostMessage(aTargetWindow, WM_CHAR, key_text[0], 0);
-						}
-						else
-							SendKeySpecial(key_text[0], repeat_count, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
-					}
+					if (event_type == KEYDOWN)
+						this_event_modifier_down = vk;
+					else // It must be KEYUP because TextToSpecial() never returns KEYDOWNANDUP.
+						DisguiseWinAltIfNeeded(vk);
 				}
-
-				// See comment "else must never change sModifiersLR_persistent" above about why
-				// !aTargetWindow is used below:
-				else if (vk = TextToSpecial(key_text, key_text_length, event_type
-					, persistent_modifiers_for_this_SendKeys, !aTargetWindow)) // Assign.
+				// Since we're here, repeat_count > 0.
+				// v1.0.42.04: A previous call to SendKey() or SendKeySpecial() might have left modifiers
+				// in the wrong state (e.g. Send +{F1}{ControlDown}).  Since modifiers can sometimes affect
+				// each other, make sure they're in the state intended by the user before beginning:
+				SetModifierLRState(persistent_modifiers_for_this_SendKeys
+					, sSendMode ? sEventModifiersLR : GetModifierLRState()
+					, aTargetWindow, false, false); // It also does DoKeyDelay(g->PressDuration).
+				for (int i = 0; i < repeat_count; ++i)
 				{
-					if (!aTargetWindow)
-					{
-						if (event_type == KEYDOWN)
-							this_event_modifier_down = vk;
-						else // It must be KEYUP because TextToSpecial() never returns KEYDOWNANDUP.
-							DisguiseWinAltIfNeeded(vk);
-					}
-					// Since we're here, repeat_count > 0.
-					// v1.0.42.04: A previous call to SendKey() or SendKeySpecial() might have left modifiers
-					// in the wrong state (e.g. Send +{F1}{ControlDown}).  Since modifiers can sometimes affect
-					// each other, make sure they're in the state intended by the user before beginning:
-					SetModifierLRState(persistent_modifiers_for_this_SendKeys
-						, sSendMode ? sEventModifiersLR : GetModifierLRState()
-						, aTargetWindow, false, false); // It also does DoKeyDelay(g->PressDuration).
-					for (int i = 0; i < repeat_count; ++i)
-					{
-						// Don't tell it to save & restore modifiers because special keys like this one
-						// should have maximum flexibility (i.e. nothing extra should be done so that the
-						// user can have more control):
-						KeyEvent(event_type, vk, 0, aTargetWindow, true);
-						if (!sSendMode)
-							LONG_OPERATION_UPDATE_FOR_SENDKEYS
-					}
+					// Don't tell it to save & restore modifiers because special keys like this one
+					// should have maximum flexibility (i.e. nothing extra should be done so that the
+					// user can have more control):
+					KeyEvent(event_type, vk, 0, aTargetWindow, true);
+					if (!sSendMode)
+						LONG_OPERATION_UPDATE_FOR_SENDKEYS
 				}
+			}
 
-				else if (key_text_length > 4 && !_tcsicmp(key_text, _T("ASC")) && !aTargetWindow) // {ASC nnnnn}
+			else if (key_text_length > 4 && !_tcsicmp(key_text, _T("ASC")) && !aTargetWindow) // {ASC nnnnn}
+			{
+				// Include the trailing space in "ASC " to increase uniqueness (selectivity).
+				// Also, sending the ASC sequence to window doesn't work, so don't even try:
+				SendASC(next_word);
+				// Do this only once at the end of the sequence:
+				DoKeyDelay(); // It knows not to do the delay for SM_INPUT.
+			}
+
+			else if (key_text_length > 2 && !_tcsnicmp(key_text, _T("U+"), 2))
+			{
+				// L24: Send a unicode value as shown by Character Map.
+				UINT u_code = (UINT) _tcstol(key_text + 2, NULL, 16);
+				wchar_t wc1, wc2;
+				if (u_code >= 0x10000)
 				{
-					// Include the trailing space in "ASC " to increase uniqueness (selectivity).
-					// Also, sending the ASC sequence to window doesn't work, so don't even try:
-					SendASC(next_word);
-					// Do this only once at the end of the sequence:
-					DoKeyDelay(); // It knows not to do the delay for SM_INPUT.
+					// Supplementary characters are encoded as UTF-16 and split into two messages.
+					u_code -= 0x10000;
+					wc1 = 0xd800 + ((u_code >> 10) & 0x3ff);
+					wc2 = 0xdc00 + (u_code & 0x3ff);
 				}
-
-				else if (key_text_length > 2 && !_tcsnicmp(key_text, _T("U+"), 2))
+				else
 				{
-					// L24: Send a unicode value as shown by Character Map.
-					UINT u_code = (UINT) _tcstol(key_text + 2, NULL, 16);
-					wchar_t wc1, wc2;
-					if (u_code >= 0x10000)
-					{
-						// Supplementary characters are encoded as UTF-16 and split into two messages.
-						u_code -= 0x10000;
-						wc1 = 0xd800 + ((u_code >> 10) & 0x3ff);
-						wc2 = 0xdc00 + (u_code & 0x3ff);
-					}
-					else
-					{
-						wc1 = (wchar_t) u_code;
-						wc2 = 0;
-					}
-					if (aTargetWindow)
+					wc1 = (wchar_t) u_code;
+					wc2 = 0;
+				}
+				if (aTargetWindow)
+				{
+					// Although MSDN says WM_CHAR uses UTF-16, PostMessageA appears to truncate it to 8-bit.
+					// This probably means it does automatic translation between ANSI and UTF-16.  Since we
+					// specifically want to send a Unicode character value, use PostMessageW:
+					PostMessageW(aTargetWindow, WM_CHAR, wc1, 0);
+					if (wc2)
+						PostMessageW(aTargetWindow, WM_CHAR, wc2, 0);
+				}
+				else
+				{
+					// Use SendInput in unicode mode if available, otherwise fall back to SendASC.
+					// To know why the following requires sSendMode != SM_PLAY, see SendUnicodeChar.
+					if (sSendMode != SM_PLAY)
 					{
-						// Although MSDN says WM_CHAR uses UTF-16, PostMessageA appears to truncate it to 8-bit.
-						// This probably means it does automatic translation between ANSI and UTF-16.  Since we
-						// specifically want to send a Unicode character value, use PostMessageW:
-						PostMessageW(aTargetWindow, WM_CHAR, wc1, 0);
+						SendUnicodeChar(wc1, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
 						if (wc2)
-							PostMessageW(aTargetWindow, WM_CHAR, wc2, 0);
+							SendUnicodeChar(wc2, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
 					}
-					else
-					{
-						// Use SendInput in unicode mode if available, otherwise fall back to SendASC.
-						// To know why the following requires sSendMode != SM_PLAY, see SendUnicodeChar.
-						if (sSendMode != SM_PLAY)
-						{
-							SendUnicodeChar(wc1, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
-							if (wc2)
-								SendUnicodeChar(wc2, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
-						}
-						else // Note that this method generally won't work with Unicode characters except
-						{	 // with specific controls which support it, such as RichEdit (tested on WordPad).
-							TCHAR asc[8];
-							*asc = '0';
-							_itot(u_code, asc + 1, 10);
-							SendASC(asc);
-						}
+					else // Note that this method generally won't work with Unicode characters except
+					{	 // with specific controls which support it, such as RichEdit (tested on WordPad).
+						TCHAR asc[8];
+						*asc = '0';
+						_itot(u_code, asc + 1, 10);
+						SendASC(asc);
 					}
-					DoKeyDelay();
 				}
+				DoKeyDelay();
+			}
 
-				//else do nothing since it isn't recognized as any of the above "else if" cases (see below).
-
-				// If what's between {} is unrecognized, such as {Bogus}, it's safest not to send
-				// the contents literally since that's almost certainly not what the user intended.
-				// In addition, reset the modifiers, since they were intended to apply only to
-				// the key inside {}.  Also, the below is done even if repeat-count is zero.
+			//else do nothing since it isn't recognized as any of the above "else if" cases (see below).
 
-brace_case_end: // This label is used to simplify the code without sacrificing performance.
-				aKeys = end_pos;  // In prep for aKeys++ done by the loop.
-				mods_for_next_key = 0;
-				continue;
-			} // case '{'
-			} // switch()
-		} // if (!aSendRaw && strchr("^+!#{}", *aKeys))
+			// If what's between {} is unrecognized, such as {Bogus}, it's safest not to send
+			// the contents literally since that's almost certainly not what the user intended.
+			// In addition, reset the modifiers, since they were intended to apply only to
+			// the key inside {}.
+			break;
+		} // case SOP_KEY
 
-		else // Encountered a character other than ^+!#{} ... or we're in raw mode.
-		{
-			if (aSendRaw == SCM_RAW_TEXT)
-			{
-				// \b needs to produce VK_BACK for auto-replace hotstrings to work (this is more useful anyway).
-				// \r and \n need to produce VK_RETURN for decent compatibility.  SendKeySpecial('\n') works for
-				// some controls (such as Scintilla) but has no effect in other common applications.
-				// \t has more utility if translated to VK_TAB.  SendKeySpecial('\t') has no effect in many
-				// common cases, and seems to only work in cases where {tab} would work just as well.
-				switch (*aKeys)
-				{
-				case '\r': // Translate \r but ignore any trailing \n, since \r\n -> {Enter 2} is counter-intuitive.
-					if (aKeys[1] == '\n')
-						++aKeys;
-					// Fall through:
-				case '\n': vk = VK_RETURN; break;
-				case '\b': vk = VK_BACK; break;
-				case '\t': vk = VK_TAB; break;
-				default: vk = 0; break; // Send all other characters via SendKeySpecial()/WM_CHAR.
-				}
-			}
+		case SOP_CHAR: // A character other than ^+!#{} ... or we're in raw mode.
+			if (op->send_raw == SCM_RAW_TEXT)
+				vk = op->vk; // \r, \n, \b and \t were translated by the parser; all other characters are sent via SendKeySpecial()/WM_CHAR.
 			else
 			{
 				// Best to call this separately, rather than as first arg in SendKey, since it changes the
 				// value of modifiers and the updated value is *not* guaranteed to be passed.
 				// In other words, SendKey(TextToVK(...), modifiers, ...) would often send the old
 				// value for modifiers.
-				vk = CharToVKAndModifiers(*aKeys, &mods_for_next_key, sTargetKeybdLayout
-					, (mods_for_next_key | persistent_modifiers_for_this_SendKeys) != 0 && !aSendRaw); // v1.1.27.00: Disable the a-z to vk41-vk5A fallback translation when modifiers are present since it would produce the wrong printable characters.
-				// CharToVKAndModifiers() takes no measurable time compared to the amount of time SendKey takes.
+				vk = KeyScanToVKAndModifiers(op->ch, op->key_scan, &mods_for_next_key
+					, (mods_for_next_key | persistent_modifiers_for_this_SendKeys) != 0 && !op->send_raw); // v1.1.27.00: Disable the a-z to vk41-vk5A fallback translation when modifiers are present since it would produce the wrong printable characters.
 			}
 			if (vk)
 				SendKey(vk, 0, mods_for_next_key, persistent_modifiers_for_this_SendKeys, 1, KEYDOWNANDUP
@@ -809,12 +785,15 @@ brace_case_end: // This label is used to simplify the code without sacrificing p
 				if (aTargetWindow) 
 					// Although MSDN says WM_CHAR uses UTF-16, it seems to really do automatic
 					// translation between ANSI and UTF-16; we rely on this for correct results:
-					PostMessage(aTargetWindow, WM_CHAR, *aKeys, 0);
+					PostMessage(aTargetWindow, WM_CHAR, op->ch, 0);
 				else
-					SendKeySpecial(*aKeys, 1, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
+					SendKeySpecial(op->ch, 1, mods_for_next_key | persistent_modifiers_for_this_SendKeys);
 			}
-			mods_for_next_key = 0;  // Safest to reset this regardless of whether a key was sent.
+			break;
+
+		//case SOP_RESET: Nothing is sent, but pending modifiers are reset below.
 		}
+		mods_for_next_key = 0;  // Safest to reset this regardless of whether a key was sent.
 	} // for()
 
 	modLR_type mods_to_set;
@@ -985,6 +964,8 @@ brace_case_end: // This label is used to simplify the code without sacrificing p
 	if (threads_are_attached)
 		AttachThreadInput(g_MainThreadID, target_thread, FALSE);
 
+	program->Release();
+
 	if (do_selective_blockinput && !blockinput_prev) // Turn it back off only if it was off before we started.
 		OurBlockInput(false);
 
@@ -2508,85 +2489,7 @@ void PutKeybdEventIntoArray(modLR_type aKeyAsModifiersLR, vk_type aVK, sc_type a
 // Playback hook only supports sending neutral modifiers.  Caller must ensure that any left/right modifiers
 // such as VK_RCONTROL are translated into neutral (e.g. VK_CONTROL).
 {
-	bool key_up = aEventFlags & KEYEVENTF_KEYUP;
-	// To make the SendPlay method identical in output to the other keystroke methods, have it generate
-	// a leading down/up LControl event immediately prior to each RAlt event (with no key-delay).
-	// This avoids having to add special handling to places like SetModifierLRState() to do AltGr things
-	// differently when sending via playback vs. other methods.  The event order recorded by the journal
-	// record hook is a little different than what the low-level keyboard hook sees, but I don't think
-	// the order should matter in this case:
-	//   sc  vk key	 msg
-	//   138 12 Alt	 syskeydown (right vs. left scan code)
-	//   01d 11 Ctrl keydown (left scan code) <-- In keyboard hook, normally this precedes Alt, not follows it. Seems inconsequential (testing confirms).
-	//   01d 11 Ctrl keyup	(left scan code)
-	//   138 12 Alt	 syskeyup (right vs. left scan code)
-	// Check for VK_MENU not VK_RMENU because caller should have translated it to neutral:
-	if (aVK == VK_MENU && aSC == SC_RALT && sTargetLayoutHasAltGr == CONDITION_TRUE && sSendMode == SM_PLAY)
-		// Must pass VK_CONTROL rather than VK_LCONTROL because playback hook requires neutral modifiers.
-		PutKeybdEventIntoArray(MOD_LCONTROL, VK_CONTROL, SC_LCONTROL, aEventFlags, aExtraInfo); // Recursive call to self.
-
-	// Above must be done prior to the capacity check below because above might add a new array item.
-	if (sEventCount == sMaxEvents) // Array's capacity needs expanding.
-		if (!ExpandEventArray())
-			return;
-
-	// Keep track of the predicted modifier state for use in other places:
-	if (key_up)
-		sEventModifiersLR &= ~aKeyAsModifiersLR;
-	else
-		sEventModifiersLR |= aKeyAsModifiersLR;
-
-	if (sSendMode == SM_INPUT)
-	{
-		INPUT &this_event = sEventSI[sEventCount]; // For performance and convenience.
-		this_event.type = INPUT_KEYBOARD;
-		this_event.ki.wVk = aVK;
-		this_event.ki.wScan = (aEventFlags & KEYEVENTF_UNICODE) ? aSC : LOBYTE(aSC);
-		this_event.ki.dwFlags = aEventFlags;
-		this_event.ki.dwExtraInfo = aExtraInfo; // Although our hook won't be installed (or won't detect, in the case of playback), that of other scripts might be, so set this for them.
-		this_event.ki.time = 0; // Let the system provide its own timestamp, which might be more accurate for individual events if this will be a very long SendInput.
-		sHooksToRemoveDuringSendInput |= HOOK_KEYBD; // Presence of keyboard hook defeats uninterruptibility of keystrokes.
-	}
-	else // Playback hook.
-	{
-		PlaybackEvent &this_event = sEventPB[sEventCount]; // For performance and convenience.
-		if (!(aVK || aSC)) // Caller is signaling that aExtraInfo contains a delay/sleep event.
-		{
-			// Although delays at the tail end of the playback array can't be implemented by the playback
-			// itself, caller wants them put in too.
-			this_event.message = 0; // Message number zero flags it as a delay rather than an actual event.
-			this_event.time_to_wait = aExtraInfo;
-		}
-		else // A normal (non-delay) event for playback.
-		{
-			// By monitoring incoming events in a message/event loop, the following key combinations were
-			// confirmed to be WM_SYSKEYDOWN vs. WM_KEYDOWN (up events weren't tested, so are assumed to
-			// be the same as down-events):
-			// Alt+Win
-			// Alt+Shift
-			// Alt+Capslock/Numlock/Scrolllock
-			// Alt+AppsKey
-			// Alt+F2/Delete/Home/End/Arrow/BS
-			// Alt+Space/Enter
-			// Alt+Numpad (tested all digits & most other keys, with/without Numlock ON)
-			// F10 (by itself) / Win+F10 / Alt+F10 / Shift+F10 (but not Ctrl+F10)
-			// By contrast, the following are not SYS: Alt+Ctrl, Alt+Esc, Alt+Tab (the latter two
-			// are never received by msg/event loop probably because the system intercepts them).
-			// So the rule appears to be: It's a normal (non-sys) key if Alt isn't down and the key
-			// isn't F10, or if Ctrl is down. Though a press of the Alt key itself is a syskey unless Ctrl is down.
-			// Update: The release of ALT is WM_KEYUP vs. WM_SYSKEYUP when it modified at least one key while it was down.
-			if (sEventModifiersLR & (MOD_LCONTROL | MOD_RCONTROL) // Control is down...
-				|| !(sEventModifiersLR & (MOD_LALT | MOD_RALT))   // ... or: Alt isn't down and this key isn't Alt or F10...
-					&& aVK != VK_F10 && !(aKeyAsModifiersLR & (MOD_LALT | MOD_RALT))
-				|| (sEventModifiersLR & (MOD_LALT | MOD_RALT)) && key_up) // ... or this is the release of Alt (for simplicity, assume that Alt modified something while it was down).
-				this_event.message = key_up ? WM_KEYUP : WM_KEYDOWN;
-			else
-				this_event.message = key_up ? WM_SYSKEYUP : WM_SYSKEYDOWN;
-			this_event.vk = aVK;
-			this_event.sc = aSC; // Don't omit the extended-key-bit because it is used later on.
-		}
-	}
-	++sEventCount;
+	sEvents.PutKeybd(aKeyAsModifiersLR, aVK, aSC, aEventFlags, aExtraInfo, sTargetLayoutHasAltGr == CONDITION_TRUE);
 }
 
 
@@ -2596,64 +2499,7 @@ void PutMouseEventIntoArray(DWORD aEventFlags, DWORD aData, DWORD aX, DWORD aY)
 // If the array-type is journal playback, caller should include MOUSEEVENTF_ABSOLUTE in aEventFlags if the
 // the mouse coordinates aX and aY are relative to the screen rather than the active window.
 {
-	if (sEventCount == sMaxEvents) // Array's capacity needs expanding.
-		if (!ExpandEventArray())
-			return;
-
-	if (sSendMode == SM_INPUT)
-	{
-		INPUT &this_event = sEventSI[sEventCount]; // For performance and convenience.
-		this_event.type = INPUT_MOUSE;
-		this_event.mi.dx = (aX == COORD_UNSPECIFIED) ? 0 : aX; // v1.0.43.01: Must be zero if no change in position is
-		this_event.mi.dy = (aY == COORD_UNSPECIFIED) ? 0 : aY; // desired (fixes compatibility with certain apps/games).
-		this_event.mi.dwFlags = aEventFlags;
-		this_event.mi.mouseData = aData;
-		this_event.mi.dwExtraInfo = KEY_IGNORE_LEVEL(g->SendLevel); // Although our hook won't be installed (or won't detect, in the case of playback), that of other scripts might be, so set this for them.
-		this_event.mi.time = 0; // Let the system provide its own timestamp, which might be more accurate for individual events if this will be a very long SendInput.
-		sHooksToRemoveDuringSendInput |= HOOK_MOUSE; // Presence of mouse hook defeats uninterruptibility of mouse clicks/moves.
-	}
-	else // Playback hook.
-	{
-		// Note: Delay events (sleeps), which are supported in playback mode but not SendInput, are always inserted
-		// via PutKeybdEventIntoArray() rather than this function.
-		PlaybackEvent &this_event = sEventPB[sEventCount]; // For performance and convenience.
-		// Determine the type of event specified by caller, but also omit MOUSEEVENTF_MOVE so that the
-		// follow variations can be differentiated:
-		// 1) MOUSEEVENTF_MOVE by itself.
-		// 2) MOUSEEVENTF_MOVE with a click event or wheel turn (in this case MOUSEEVENTF_MOVE is permitted but
-		//    not required, since all mouse events in playback mode must have explicit coordinates at the
-		//    time they're played back).
-		// 3) A click event or wheel turn by itself (same remark as above).
-		// Bits are isolated in what should be a future-proof way (also omits MSG_OFFSET_MOUSE_MOVE bit).
-		switch (aEventFlags & (0x1FFF & ~MOUSEEVENTF_MOVE)) // v1.0.48: 0x1FFF vs. 0xFFF to support MOUSEEVENTF_HWHEEL.
-		{
-		case 0:                      this_event.message = WM_MOUSEMOVE; break; // It's a movement without a click.
-		// In cases other than the above, it's a click or wheel turn with optional WM_MOUSEMOVE too.
-		case MOUSEEVENTF_LEFTDOWN:   this_event.message = WM_LBUTTONDOWN; break;
-		case MOUSEEVENTF_LEFTUP:     this_event.message = WM_LBUTTONUP; break;
-		case MOUSEEVENTF_RIGHTDOWN:  this_event.message = WM_RBUTTONDOWN; break;
-		case MOUSEEVENTF_RIGHTUP:    this_event.message = WM_RBUTTONUP; break;
-		case MOUSEEVENTF_MIDDLEDOWN: this_event.message = WM_MBUTTONDOWN; break;
-		case MOUSEEVENTF_MIDDLEUP:   this_event.message = WM_MBUTTONUP; break;
-		case MOUSEEVENTF_XDOWN:      this_event.message = WM_XBUTTONDOWN; break;
-		case MOUSEEVENTF_XUP:        this_event.message = WM_XBUTTONUP; break;
-		case MOUSEEVENTF_WHEEL:      this_event.message = WM_MOUSEWHEEL; break;
-		case MOUSEEVENTF_HWHEEL:     this_event.message = WM_MOUSEHWHEEL; break; // v1.0.48
-		// WHEEL: No info comes into journal-record about which direction the wheel was turned (nor by how many
-		// notches).  In addition, it appears impossible to specify such info when playing back the event.
-		// Therefore, playback usually produces downward wheel movement (but upward in some apps like
-		// Visual Studio).
-		}
-		// COORD_UNSPECIFIED_SHORT is used so that the very first event can be a click with unspecified
-		// coordinates: it seems best to have the cursor's position fetched during playback rather than
-		// here because if done here, there might be time for the cursor to move physically before
-		// playback begins (especially if our thread is preempted while building the array).
-		this_event.x = (aX == COORD_UNSPECIFIED) ? COORD_UNSPECIFIED_SHORT : (WORD)aX;
-		this_event.y = (aY == COORD_UNSPECIFIED) ? COORD_UNSPECIFIED_SHORT : (WORD)aY;
-		if (aEventFlags & MSG_OFFSET_MOUSE_MOVE) // Caller wants this event marked as a movement relative to cursor's current position.
-			this_event.message |= MSG_OFFSET_MOUSE_MOVE;
-	}
-	++sEventCount;
+	sEvents.PutMouse(aEventFlags, aData, aX, aY, KEY_IGNORE_LEVEL(g->SendLevel));
 }
 
 
@@ -2661,45 +2507,19 @@ void PutMouseEventIntoArray(DWORD aEventFlags, DWORD aData, DWORD aX, DWORD aY)
 ResultType ExpandEventArray()
 // Returns OK or FAIL.
 {
-	if (sAbortArraySend) // A prior call failed (might be impossible).  Avoid malloc() in this case.
-		return FAIL;
-	#define EVENT_EXPANSION_MULTIPLIER 2  // Should be very rare for array to need to expand more than a few times.
-	size_t event_size = (sSendMode == SM_INPUT) ? sizeof(INPUT) : sizeof(PlaybackEvent);
-	void *new_mem;
-	// SendInput() appears to be limited to 5000 chars (10000 events in array), at least on XP.  This is
-	// either an undocumented SendInput limit or perhaps it's due to the system setting that determines
-	// how many messages can get backlogged in each thread's msg queue before some start to get dropped.
-	// Note that SendInput()'s return value always seems to indicate that all the characters were sent
-	// even when the ones beyond the limit were clearly never received by the target window.
-	// In any case, it seems best not to restrict to 5000 here in case the limit can vary for any reason.
-	// The 5000 limit is documented in the help file.
-	if (   !(new_mem = malloc(EVENT_EXPANSION_MULTIPLIER * sMaxEvents * event_size))   )
-	{
-		sAbortArraySend = true; // Usually better to send nothing rather than partial.
-		// Leave sEventSI and sMaxEvents in their current valid state, to be freed by CleanupEventArray().
-		return FAIL;
-	}
-	else // Copy old array into new memory area (note that sEventSI and sEventPB are different views of the same variable).
-		memcpy(new_mem, sEventSI, sEventCount * event_size);
-	if (sMaxEvents > (sSendMode == SM_INPUT ? MAX_INITIAL_EVENTS_SI : MAX_INITIAL_EVENTS_PB))
-		free(sEventSI); // Previous block was malloc'd vs. _alloc'd, so free it.
-	sEventSI = (LPINPUT)new_mem; // Note that sEventSI and sEventPB are different views of the same variable.
-	sMaxEvents *= EVENT_EXPANSION_MULTIPLIER;
-	return OK;
+	return sEvents.Expand() ? OK : FAIL;
 }
 
 
 
 void InitEventArray(void *aMem, UINT aMaxEvents, modLR_type aModifiersLR)
+// Caller must have set sSendMode.
 {
-	sEventPB = (PlaybackEvent *)aMem; // Sets sEventSI too, since both are the same.
-	sMaxEvents = aMaxEvents;
-	sEventModifiersLR = aModifiersLR;
+	// If expanding the array ever fails, sAbortArraySend is set, which allows us to send nothing at
+	// all rather than a partial send.
+	sEvents.Init(aMem, aMaxEvents, aModifiersLR, sSendMode == SM_PLAY);
 	sSendInputCursorPos.x = COORD_UNSPECIFIED;
 	sSendInputCursorPos.y = COORD_UNSPECIFIED;
-	sHooksToRemoveDuringSendInput = 0;
-	sEventCount = 0;
-	sAbortArraySend = false; // If KeyEvent() ever sets it to true, that allows us to send nothing at all rather than a partial send.
 	sFirstCallForThisEvent = true;
 	// The above isn't a local static inside PlaybackProc because PlaybackProc might get aborted in the
 	// middle of a NEXT/SKIP pair by user pressing Ctrl-Esc, etc, which would make it unreliable.
@@ -2841,8 +2661,7 @@ void SendEventArray(int &aFinalKeyDelay, modLR_type aModsDuringSend)
 
 void CleanupEventArray(int aFinalKeyDelay)
 {
-	if (sMaxEvents > (sSendMode == SM_INPUT ? MAX_INITIAL_EVENTS_SI : MAX_INITIAL_EVENTS_PB))
-		free(sEventSI); // Previous block was malloc'd vs. _alloc'd, so free it.  Note that sEventSI and sEventPB are different views of the same variable.
+	sEvents.Free(); // Frees the array if it was expanded beyond the caller's stack memory.
 	// The following must be done only after functions called above are done using it.  But it must also be done
 	// prior to our caller toggling capslock back on , to avoid the capslock keystroke from going into the array.
 	sSendMode = SM_EVENT;
@@ -4069,14 +3888,29 @@ vk_type TextToVK(LPCTSTR aText, modLR_type *pModifiersLR, bool aExcludeThoseHand
 vk_type CharToVKAndModifiers(TCHAR aChar, modLR_type *pModifiersLR, HKL aKeybdLayout, bool aEnableAZFallback)
 // If non-NULL, pModifiersLR contains the initial set of modifiers provided by the caller, to which
 // we add any extra modifiers required to realize aChar.
+{
+	return KeyScanToVKAndModifiers(aChar, CharToKeyScan(aChar, aKeybdLayout), pModifiersLR, aEnableAZFallback);
+}
+
+
+
+SHORT CharToKeyScan(TCHAR aChar, HKL aKeybdLayout)
+// Returns the VkKeyScanEx() result for aChar, for use with KeyScanToVKAndModifiers().
 {
 	// For v1.0.25.12, it seems best to avoid the many recent problems with linefeed (`n) being sent
 	// as Ctrl+Enter by changing it to always send a plain Enter, just like carriage return (`r).
 	if (aChar == '\n')
-		return VK_RETURN;
+		return VK_RETURN; // No modifiers.
+	return VkKeyScanEx(aChar, aKeybdLayout); // v1.0.44.03: Benchmark shows that VkKeyScanEx() is the same speed as VkKeyScan() when the layout has been pre-fetched.
+}
+
 
-	// Otherwise:
-	SHORT mod_plus_vk = VkKeyScanEx(aChar, aKeybdLayout); // v1.0.44.03: Benchmark shows that VkKeyScanEx() is the same speed as VkKeyScan() when the layout has been pre-fetched.
+
+vk_type KeyScanToVKAndModifiers(TCHAR aChar, SHORT aKeyScan, modLR_type *pModifiersLR, bool aEnableAZFallback)
+// Same as CharToVKAndModifiers(), but aKeyScan is the result of CharToKeyScan(aChar, ...).
+// This allows SendKeys() to cache the layout lookup.
+{
+	SHORT mod_plus_vk = aKeyScan;
 	vk_type vk = LOBYTE(mod_plus_vk);
 	char keyscan_modifiers = HIBYTE(mod_plus_vk);
 	if (keyscan_modifiers == -1 && vk == (UCHAR)-1) // No translation could be made.
@@ -17,6 +17,8 @@ GNU General Public License for more details.
 #include "stdafx.h"
 #include "script.h"
 #include "script_gui.h"
+#include "globaldata.h"
+#include "application.h"
 
 
 
@@ -167,6 +169,8 @@ FResult GuiControlType::LV_AddInsertModify(optl<int> aRow, optl<StrArg> aOptions
 // In Add/Insert mode, if there are no text fields present, a blank for is appended/inserted.
 {
 	CTRL_THROW_IF_DESTROYED;
+	if (!aModify && LV_IsVirtual()) // The rows of a virtual ListView are determined by its data source.
+		return FError(ERR_LV_VIRTUAL);
 	TCHAR buf[MAX_NUMBER_SIZE];
 	GuiControlType &control = *this;
 
@@ -413,6 +417,8 @@ FResult GuiControlType::LV_Delete(optl<int> aRow)
 // 1: Row index (one-based when it comes in).
 {
 	CTRL_THROW_IF_DESTROYED;
+	if (LV_IsVirtual()) // Deleting items would leave the control out of step with data_row_count.
+		return FError(ERR_LV_VIRTUAL);
 	if (!aRow.has_value())
 	{
 		SendMessage(hwnd, LVM_DELETEALLITEMS, 0, 0);
@@ -757,3 +763,219 @@ FResult GuiControlType::LV_SetImageList(UINT_PTR aImageListID, optl<int> aIconTy
 	aRetVal = (UINT_PTR)ListView_SetImageList(hwnd, himl, list_type);
 	return OK;
 }
+
+
+
+FResult GuiControlType::LV_AddRows(IObject *aRows, optl<StrArg> aOptions, int &aRetVal)
+// Returns: The number of rows added.
+// Parameters:
+// 1: An Array of rows.  Each row is either an Array of field values or a single value for the first field.
+// 2: Options to apply to each row, as for LV.Add().
+// This is equivalent to calling LV.Add() for each row, but redraw is suppressed until all rows have been
+// added and the control is told in advance how many rows to expect.
+{
+	CTRL_THROW_IF_DESTROYED;
+	if (LV_IsVirtual())
+		return FError(ERR_LV_VIRTUAL);
+	auto rows = dynamic_cast<Array *>(aRows);
+	if (!rows)
+	{
+		ExprTokenType value(aRows);
+		return FTypeError(_T("Array"), value);
+	}
+	auto row_count = rows->Length();
+	aRetVal = 0;
+	if (!row_count)
+		return OK;
+
+	ExprTokenType col_value[LV_MAX_COLUMNS], *col_param[LV_MAX_COLUMNS];
+	for (int i = 0; i < LV_MAX_COLUMNS; ++i)
+		col_param[i] = &col_value[i];
+
+	SendMessage(hwnd, WM_SETREDRAW, FALSE, 0);
+	// Let the control allocate memory for all of the rows at once:
+	SendMessage(hwnd, LVM_SETITEMCOUNT, ListView_GetItemCount(hwnd) + row_count, 0);
+
+	FResult fr = OK;
+	for (Array::index_t r = 0; r < row_count; ++r)
+	{
+		ExprTokenType row;
+		rows->ItemToToken(r, row);
+		VariantParams cols { col_param, 0 };
+		if (auto row_array = dynamic_cast<Array *>(TokenToObject(row)))
+		{
+			cols.count = row_array->Length() < LV_MAX_COLUMNS ? (int)row_array->Length() : LV_MAX_COLUMNS;
+			for (int i = 0; i < cols.count; ++i)
+				row_array->ItemToToken(i, col_value[i]);
+		}
+		else if (row.symbol != SYM_MISSING) // Single value rather than an Array.
+		{
+			col_value[0].CopyValueFrom(row);
+			cols.count = 1;
+		}
+		int row_number = 0;
+		if ((fr = LV_AddInsertModify(nullptr, aOptions, cols, &row_number, false)) != OK)
+			break;
+		if (!row_number) // The row couldn't be inserted, so there's no point trying the rest.
+			break;
+		++aRetVal;
+	}
+
+	SendMessage(hwnd, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect(hwnd, NULL, TRUE);
+	return fr;
+}
+
+
+
+FResult GuiControlType::LV_SetDataSource(IObject *aSource, optl<int> aRowCount)
+// Parameters:
+// 1: An Array of rows (see LV_AddRows), or a function which accepts a row number and returns a row.
+// 2: The number of rows.  Optional if Source is an Array, in which case its length is used.
+// The ListView must have been created with the Virtual option (LVS_OWNERDATA).  Rows are retrieved only
+// as they are displayed.  This can be called again to refresh the control after the data has changed.
+{
+	CTRL_THROW_IF_DESTROYED;
+	if (!LV_IsVirtual())
+		return FError(_T("The ListView must have the Virtual option."));
+	auto array = dynamic_cast<Array *>(aSource);
+	int row_count;
+	if (aRowCount.has_value())
+	{
+		row_count = aRowCount.value();
+		if (row_count < 0)
+			return FR_E_ARG(1);
+	}
+	else if (array)
+		row_count = (int)array->Length();
+	else
+		return FR_E_ARG(1); // Row count is required for a function.
+
+	lv_attrib_type &lv_attrib = *union_lv_attrib;
+	if (!array && !lv_attrib.row_cache)
+	{
+		// The cache is retained until the control is destroyed, in case a callback calls this function.
+		if (  !(lv_attrib.row_cache = new (std::nothrow) ListViewRowCache)  )
+			return FR_E_OUTOFMEM;
+	}
+	aSource->AddRef(); // Before LV_FreeDataSource() in case aSource is the current data source.
+	LV_FreeDataSource();
+	lv_attrib.data_source = aSource;
+	lv_attrib.data_row_count = row_count;
+	// LVSICF_NOSCROLL retains the scroll position, which is preferable when refreshing the same data.
+	SendMessage(hwnd, LVM_SETITEMCOUNT, row_count, LVSICF_NOSCROLL);
+	InvalidateRect(hwnd, NULL, TRUE);
+	return OK;
+}
+
+
+
+void GuiControlType::LV_FreeDataSource()
+{
+	lv_attrib_type &lv_attrib = *union_lv_attrib;
+	if (lv_attrib.row_cache)
+		lv_attrib.row_cache->Clear();
+	if (auto source = lv_attrib.data_source)
+	{
+		lv_attrib.data_source = nullptr;
+		lv_attrib.data_row_count = 0;
+		source->Release(); // Done last since it might call __delete.
+	}
+}
+
+
+
+static LPCTSTR LV_RowFieldText(ExprTokenType &aRow, int aColumn, LPTSTR aBuf)
+// Returns the text of the given zero-based column of a row retrieved from a data source.
+{
+	if (auto row_array = dynamic_cast<Array *>(TokenToObject(aRow)))
+	{
+		ExprTokenType field;
+		if (!row_array->ItemToToken(aColumn, field))
+			return _T("");
+		return TokenToString(field, aBuf);
+	}
+	return aColumn == 0 ? TokenToString(aRow, aBuf) : _T(""); // TokenToString() returns "" for SYM_MISSING.
+}
+
+
+
+bool GuiControlType::LV_CacheRow(int aRow)
+// Ensures the text of the given zero-based row from a function data source is in the row cache.
+// Returns false if the row couldn't be retrieved, such as when the script can't be interrupted.
+// Caller must hold a reference to the control and check hwnd afterward, since the callback might
+// destroy the control.
+{
+	lv_attrib_type &lv_attrib = *union_lv_attrib;
+	if (lv_attrib.row_cache->Contains(aRow))
+		return true;
+
+	// See ControlWmNotify() for comments about these conditions.
+	if (!INTERRUPTIBLE_IN_EMERGENCY || g_nThreads >= g_MaxThreadsTotal)
+		return false;
+
+	IObject *source = lv_attrib.data_source;
+	source->AddRef(); // In case the callback replaces the data source.
+	InitNewThread(0, false, true);
+	g_script.mLastPeekTime = GetTickCount();
+
+	ResultToken result_token;
+	TCHAR result_buf[MAX_NUMBER_SIZE];
+	result_token.InitResult(result_buf);
+	ExprTokenType this_token(source), row_param((__int64)aRow + 1), *param = &row_param;
+	auto result = source->Invoke(result_token, IT_CALL, nullptr, this_token, &param, 1);
+
+	bool cached = false;
+	// Store the result only if the control still exists and the data source hasn't changed.
+	if (result != FAIL && result != EARLY_EXIT && hwnd && lv_attrib.data_source == source)
+	{
+		int col_count = lv_attrib.col_count > 0 ? lv_attrib.col_count : 1;
+		cached = lv_attrib.row_cache->Store(aRow, col_count
+			, [&](int aColumn, LPTSTR aBuf) { return LV_RowFieldText(result_token, aColumn, aBuf); });
+	}
+	result_token.Free();
+
+	ResumeUnderlyingThread();
+	source->Release();
+	return cached;
+}
+
+
+
+void GuiControlType::LV_GetDispInfo(NMLVDISPINFO &aInfo)
+{
+	LVITEM &item = aInfo.item;
+	lv_attrib_type &lv_attrib = *union_lv_attrib;
+	if (!(item.mask & LVIF_TEXT) || !item.cchTextMax || !lv_attrib.data_source
+		|| item.iItem < 0 || item.iItem >= lv_attrib.data_row_count)
+		return;
+	if (auto array = dynamic_cast<Array *>(lv_attrib.data_source))
+	{
+		// Array elements can be accessed directly, so no caching is needed.
+		*item.pszText = '\0';
+		TCHAR buf[MAX_NUMBER_SIZE];
+		ExprTokenType row;
+		if (array->ItemToToken(item.iItem, row))
+			tcslcpy(item.pszText, LV_RowFieldText(row, item.iSubItem, buf), item.cchTextMax);
+		return;
+	}
+	AddRef();
+	lv_attrib.row_cache->CopyField(item.iItem, item.iSubItem, lv_attrib.data_row_count, item.pszText, item.cchTextMax
+		, [&](int aRow) { return LV_CacheRow(aRow) && hwnd; }); // !hwnd: The callback destroyed the control.
+	Release();
+}
+
+
+
+void GuiControlType::LV_CacheHint(NMLVCACHEHINT &aHint)
+// Prefetches the rows which the control is about to display, so that the data source function
+// is called once per row rather than once per field and repaint.
+{
+	lv_attrib_type &lv_attrib = *union_lv_attrib;
+	if (!lv_attrib.row_cache || !lv_attrib.data_source || dynamic_cast<Array *>(lv_attrib.data_source))
+		return;
+	AddRef();
+	lv_attrib.row_cache->Prefetch(aHint.iFrom, aHint.iTo, lv_attrib.data_row_count
+		, [&](int aRow) { return LV_CacheRow(aRow) && hwnd && lv_attrib.data_source; });
+	Release();
+}
@@ -746,7 +746,7 @@ static void FilePatternApply(FilePatternStruct &fps)
 	LONG_OPERATION_INIT
 	int failure_count = 0;
 	WIN32_FIND_DATA current_file;
-	HANDLE file_search = FindFirstFile(fps.path, &current_file);
+	HANDLE file_search = FindFirstFileBatched(fps.path, &current_file, false); // None of the callbacks need short names.
 
 	if (file_search != INVALID_HANDLE_VALUE)
 	{
@@ -794,7 +794,7 @@ static void FilePatternApply(FilePatternStruct &fps)
 	if (fps.aDoRecurse && space_remaining > 1) // The space_remaining check ensures there's enough room to append "*", though if false, that would imply lfs.pattern is empty.
 	{
 		_tcscpy(append_pos, _T("*")); // Above has ensured this won't overflow.
-		file_search = FindFirstFile(fps.path, &current_file);
+		file_search = FindFirstFileBatched(fps.path, &current_file, false);
 
 		if (file_search != INVALID_HANDLE_VALUE)
 		{
@@ -51,6 +51,7 @@ md_func(ControlShowDropDown, MD_CONTROL_ARGS)
 
 md_func(CoordMode, (In, String, TargetType), (In_Opt, String, RelativeTo), (Ret, String, RetVal))
 md_func_v(Critical, (In_Opt, String, OnOffNumber), (Ret, Int32, RetVal))
+md_func(CSVParse, (In, String, Text), (In_Opt, Variant, Columns), (In_Opt, String, OmitChars), (Ret, Object, RetVal))
 
 md_func(DateAdd, (In, String, DateTime), (In, Float64, Time), (In, String, TimeUnits), (Ret, String, RetVal))
 md_func(DateDiff, (In, String, DateTime1), (In, String, DateTime2), (In, String, TimeUnits), (Ret, Int64, RetVal))
@@ -134,12 +135,15 @@ md_func(GroupDeactivate, (In, String, GroupName), (In_Opt, String, Mode))
 md_func_v(GuiCtrlFromHwnd, (In, UInt32, Hwnd), (Ret, Object, Gui))
 md_func_v(GuiFromHwnd, (In, UInt32, Hwnd), (In_Opt, Bool32, Recurse), (Ret, Object, Gui))
 
+md_func(HookEventStats, (In_Opt, Bool32, Reset), (Ret, Object, RetVal))
 md_func(HotIf, (In_Opt, Variant, Criterion), (Ret, Variant, RetVal))
+md_func(HotIfCache, (In_Opt, Int32, TTL), (Ret, Object, RetVal))
 md_func(HotIfWinActive, (In_Opt, String, WinTitle), (In_Opt, String, WinText), (Ret, Variant, RetVal))
 md_func(HotIfWinExist, (In_Opt, String, WinTitle), (In_Opt, String, WinText), (Ret, Variant, RetVal))
 md_func(HotIfWinNotActive, (In_Opt, String, WinTitle), (In_Opt, String, WinText), (Ret, Variant, RetVal))
 md_func(HotIfWinNotExist, (In_Opt, String, WinTitle), (In_Opt, String, WinText), (Ret, Variant, RetVal))
 md_func_x(Hotkey, BIF_Hotkey, FResult, (In, String, KeyName), (In_Opt, Variant, Action), (In_Opt, String, Options))
+md_func(HotkeyBatch, (In_Opt, Bool32, Begin), (Ret, Int32, RetVal))
 md_func_x(Hotstring, BIF_Hotstring, FResult, (In, String, String), (In_Opt, Variant, Replacement), (In_Opt, String, OnOffToggle), (Ret, Variant, RetVal))
 
 md_func(IL_Add, (In, UIntPtr, ImageList), (In, String, Filename), (In_Opt, Int32, IconNumber), (In_Opt, Bool32, ResizeNonIcon), (Ret, Int32, Index))
@@ -160,6 +164,8 @@ md_func_v(InstallMouseHook, (In_Opt, Bool32, Install), (In_Opt, Bool32, Force))
 md_func_x(IsLabel, IsLabel, Bool32, (In, String, Name))
 
 md_func(KeyHistory, (In_Opt, Int32, MaxEvents))
+md_func(KeyLog, (In_Opt, Int32, Capacity), (Ret, Object, RetVal))
+md_func(KeyLogExport, (In, String, FileName), (In_Opt, String, Format), (In_Opt, Int64, Start), (In_Opt, Int64, Count), (Ret, Int64, RetVal))
 
 md_func(KeyWait, (In, String, KeyName), (In_Opt, String, Options), (Ret, Bool32, RetVal))
 
@@ -205,10 +211,15 @@ md_func(MsgBox, (In_Opt, String, Text), (In_Opt, String, Title), (In_Opt, String
 
 #ifdef ENABLE_OBJALLOCDATA
 md_func(ObjAllocData, (In, Object, Obj), (In, UIntPtr, Size))
+#endif
+md_func(ObjCollectCycles, md_arg_none)
+md_func(ObjCycleCollector, (In_Opt, Int32, Threshold), (Ret, Object, Stats))
+#ifdef ENABLE_OBJALLOCDATA
 md_func(ObjFreeData, (In, Object, Obj))
 #endif
 md_func(ObjGetDataPtr, (In, Object, Obj), (Ret, UIntPtr, Ptr))
 md_func(ObjGetDataSize, (In, Object, Obj), (Ret, UIntPtr, Size))
+md_func(ObjPoolStats, (Ret, Object, Stats))
 md_func(ObjSetDataPtr, (In, Object, Obj), (In, UIntPtr, Ptr))
 
 md_func(OnClipboardChange, (In, Object, Function), (In_Opt, Int32, AddRemove))
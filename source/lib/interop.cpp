@@ -239,6 +239,180 @@ BIF_DECL(BIF_NumPut)
 
 
 
+// Bulk conversion helpers for NumGetArray and NumPutArray.  Each is instantiated once per type, so
+// the inner loops contain no per-item type dispatch and the compiler can unroll or vectorize them.
+template<typename T> inline void NumToToken(ExprTokenType &aToken, T aValue) { aToken.SetValue((__int64)aValue); }
+template<> inline void NumToToken(ExprTokenType &aToken, float aValue) { aToken.SetValue((double)aValue); }
+template<> inline void NumToToken(ExprTokenType &aToken, double aValue) { aToken.SetValue(aValue); }
+
+template<typename T> inline T TokenToNum(ExprTokenType &aToken) { return (T)TokenToInt64(aToken); }
+template<> inline float TokenToNum<float>(ExprTokenType &aToken) { return (float)TokenToDouble(aToken); }
+template<> inline double TokenToNum<double>(ExprTokenType &aToken) { return TokenToDouble(aToken); }
+
+template<typename T>
+static bool NumGetArrayOf(Array *aArray, const T *aSource, Array::index_t aCount)
+{
+	// Convert in chunks so that the values can be appended with only one call per chunk.
+	const Array::index_t CHUNK_SIZE = 256;
+	ExprTokenType token[CHUNK_SIZE];
+	while (aCount)
+	{
+		Array::index_t n = aCount < CHUNK_SIZE ? aCount : CHUNK_SIZE;
+		for (Array::index_t i = 0; i < n; ++i)
+			NumToToken(token[i], aSource[i]);
+		if (!aArray->InsertAt(aArray->Length(), token, n))
+			return false;
+		aSource += n;
+		aCount -= n;
+	}
+	return true;
+}
+
+template<typename T>
+static void NumPutArrayOf(Array *aArray, T *aTarget)
+{
+	// The caller has already checked that every value is numeric.
+	ExprTokenType token;
+	for (Array::index_t i = 0, count = aArray->Length(); i < count; ++i)
+	{
+		aArray->ItemToToken(i, token);
+		aTarget[i] = TokenToNum<T>(token);
+	}
+}
+
+
+
+BIF_DECL(BIF_NumGetArray)
+{
+	// NumGetArray(Source, [Offset,] Type, Count)
+	NumGetParams op;
+	ConvertNumGetTarget(aResultToken, *aParam[0], op);
+	if (aResultToken.Exited())
+		return;
+	if (aParamCount > 3) // Offset was specified.
+	{
+		op.target += (ptrdiff_t)TokenToInt64(*aParam[1]);
+		aParam++;
+	}
+	ConvertNumGetType(*aParam[1], op);
+	if (!TokenIsNumeric(*aParam[2]))
+		_f_throw_param(aParamCount - 1, _T("Number"));
+	__int64 count = TokenToInt64(*aParam[2]);
+
+	// See comments in BIF_NumGet about these checks.
+	if (!op.num_size
+		|| op.target < 65536
+		|| op.target > op.right_side_bound
+		|| count < 0 || count > Array::MaxIndex
+		|| (size_t)count > (op.right_side_bound - op.target) / op.num_size)
+	{
+		_f_throw_value(ERR_PARAM_INVALID);
+	}
+
+	auto arr = Array::Create();
+	if (!arr || !arr->EnsureCapacity((Array::index_t)count))
+	{
+		if (arr)
+			arr->Release();
+		_f_throw_oom;
+	}
+	bool ok;
+	auto n = (Array::index_t)count;
+	switch (op.num_size)
+	{
+	case 8:
+		if (op.is_integer)
+			ok = NumGetArrayOf(arr, (__int64 *)op.target, n);
+		else
+			ok = NumGetArrayOf(arr, (double *)op.target, n);
+		break;
+	case 4:
+		if (!op.is_integer)
+			ok = NumGetArrayOf(arr, (float *)op.target, n);
+		else if (op.is_signed)
+			ok = NumGetArrayOf(arr, (INT32 *)op.target, n);
+		else
+			ok = NumGetArrayOf(arr, (UINT32 *)op.target, n);
+		break;
+	case 2:
+		if (op.is_signed)
+			ok = NumGetArrayOf(arr, (INT16 *)op.target, n);
+		else
+			ok = NumGetArrayOf(arr, (UINT16 *)op.target, n);
+		break;
+	default: // 1
+		if (op.is_signed)
+			ok = NumGetArrayOf(arr, (INT8 *)op.target, n);
+		else
+			ok = NumGetArrayOf(arr, (UINT8 *)op.target, n);
+		break;
+	}
+	if (!ok)
+	{
+		arr->Release();
+		_f_throw_oom;
+	}
+	_f_return(arr);
+}
+
+
+
+BIF_DECL(BIF_NumPutArray)
+{
+	// NumPutArray(Type, Values, Target [, Offset])
+	auto arr = dynamic_cast<Array *>(TokenToObject(*aParam[1]));
+	if (!arr)
+		_f_throw_param(1, _T("Array"));
+
+	NumGetParams op;
+	ConvertNumGetTarget(aResultToken, *aParam[2], op);
+	if (aResultToken.Exited())
+		return;
+	if (aParamCount > 3)
+		op.target += (ptrdiff_t)TokenToInt64(*aParam[3]);
+	ConvertNumGetType(*aParam[0], op);
+
+	// See comments in BIF_NumGet about these checks.
+	size_t count = arr->Length();
+	if (!op.num_size
+		|| op.target < 65536
+		|| op.target > op.right_side_bound
+		|| count > (op.right_side_bound - op.target) / op.num_size)
+	{
+		_f_throw_value(ERR_PARAM_INVALID);
+	}
+
+	// Check every value before writing any, so that an error leaves the target unchanged.
+	ExprTokenType token;
+	for (Array::index_t i = 0; i < (Array::index_t)count; ++i)
+	{
+		arr->ItemToToken(i, token);
+		if (!TokenIsNumeric(token))
+			_f_throw_value(ERR_PARAM_INVALID);
+	}
+
+	switch (op.num_size)
+	{
+	case 8:
+		if (op.is_integer)
+			NumPutArrayOf(arr, (__int64 *)op.target);
+		else
+			NumPutArrayOf(arr, (double *)op.target);
+		break;
+	case 4:
+		if (op.is_integer)
+			NumPutArrayOf(arr, (UINT32 *)op.target);
+		else
+			NumPutArrayOf(arr, (float *)op.target);
+		break;
+	case 2: NumPutArrayOf(arr, (UINT16 *)op.target); break;
+	default: NumPutArrayOf(arr, (UINT8 *)op.target); break; // 1
+	}
+	aResultToken.value_int64 = op.target + count * op.num_size; // The address to the right of the last item, as for NumPut.
+}
+
+
+
 BIF_DECL(BIF_StrGetPut) // BIF_DECL(BIF_StrGet), BIF_DECL(BIF_StrPut)
 {
 	// To simplify flexible handling of parameters:
@@ -18,6 +18,8 @@ GNU General Public License for more details.
 #include "script.h"
 #include "globaldata.h"
 #include "script_func_impl.h"
+#include "FormatProgram.h"
+#include "CsvParse.h"
 #include <shlwapi.h> // StrCmpLogicalW
 
 
@@ -451,21 +453,37 @@ bif_impl FResult StrSplit(StrArg aInputString, ExprTokenType *aDelimiters, optl<
 	
 	LPCTSTR contents_of_next_element, delimiter, new_starting_pos;
 	size_t element_length, delimiter_length;
+	CharSet omit_set(aOmitList);
 
 	if (aDelimiterCount) // The user provided a list of delimiters, so process the input variable normally.
 	{
+		// If every delimiter is a single character (the usual case), the next delimiter can be found
+		// with a character set rather than by comparing each delimiter at each position.
+		LPTSTR delimiter_chars = (LPTSTR)_alloca((aDelimiterCount + 1) * sizeof(TCHAR));
+		int i;
+		for (i = 0; i < aDelimiterCount && !aDelimiterList[i][1]; ++i)
+			delimiter_chars[i] = *aDelimiterList[i];
+		bool single_char_delimiters = i == aDelimiterCount;
+		delimiter_chars[single_char_delimiters ? i : 0] = '\0';
+		CharSet delimiter_set(delimiter_chars);
+
 		for (contents_of_next_element = aInputString; ; )
 		{
-			if (   !splits_left // Limit reached.
-				|| !(delimiter = InStrAny(contents_of_next_element, aDelimiterList, aDelimiterCount, delimiter_length))   ) // No delimiter found.
+			if (!splits_left) // Limit reached.
 				break; // This is the only way out of the loop other than critical errors.
+			if (single_char_delimiters)
+				delimiter = delimiter_set.Find(contents_of_next_element), delimiter_length = 1;
+			else
+				delimiter = InStrAny(contents_of_next_element, aDelimiterList, aDelimiterCount, delimiter_length);
+			if (!delimiter) // No delimiter found.
+				break;
 			element_length = delimiter - contents_of_next_element;
 			if (*aOmitList && element_length > 0)
 			{
-				contents_of_next_element = omit_leading_any(contents_of_next_element, aOmitList, element_length);
+				contents_of_next_element = omit_leading_any(contents_of_next_element, omit_set, element_length);
 				element_length = delimiter - contents_of_next_element; // Update in case above changed it.
 				if (element_length)
-					element_length = omit_trailing_any(contents_of_next_element, aOmitList, delimiter - 1);
+					element_length = omit_trailing_any(contents_of_next_element, omit_set, delimiter - 1);
 			}
 			// If there are no chars to the left of the delim, or if they were all in the list of omitted
 			// chars, the variable will be assigned the empty string:
@@ -479,7 +497,7 @@ bif_impl FResult StrSplit(StrArg aInputString, ExprTokenType *aDelimiters, optl<
 	else
 	{
 		// Otherwise aDelimiterList is empty, so store each char of aInputString in its own array element.
-		LPCTSTR cp, dp;
+		LPCTSTR cp;
 		for (cp = aInputString; ; ++cp)
 		{
 			if (!*cp)
@@ -487,10 +505,7 @@ bif_impl FResult StrSplit(StrArg aInputString, ExprTokenType *aDelimiters, optl<
 				aRetVal = output_array;
 				return OK;
 			}
-			for (dp = aOmitList; *dp; ++dp)
-				if (*cp == *dp) // This char is a member of the omitted list, thus it is not included in the output array.
-					break; // (inner loop)
-			if (*dp) // Omitted.
+			if (omit_set.Contains(*cp)) // This char is a member of the omitted list, thus it is not included in the output array.
 				continue;
 			if (!splits_left) // Limit reached (checked only after excluding omitted chars).
 				break; // This is the only way out of the loop other than critical errors.
@@ -506,13 +521,13 @@ bif_impl FResult StrSplit(StrArg aInputString, ExprTokenType *aDelimiters, optl<
 	element_length = _tcslen(contents_of_next_element);
 	if (*aOmitList && element_length > 0)
 	{
-		new_starting_pos = omit_leading_any(contents_of_next_element, aOmitList, element_length);
+		new_starting_pos = omit_leading_any(contents_of_next_element, omit_set, element_length);
 		element_length -= (new_starting_pos - contents_of_next_element); // Update in case above changed it.
 		contents_of_next_element = new_starting_pos;
 		if (element_length)
 			// If this is true, the string must contain at least one char that isn't in the list
 			// of omitted chars, otherwise omit_leading_any() would have already omitted them:
-			element_length = omit_trailing_any(contents_of_next_element, aOmitList
+			element_length = omit_trailing_any(contents_of_next_element, omit_set
 				, contents_of_next_element + element_length - 1);
 	}
 	// If there are no chars to the left of the delim, or if they were all in the list of omitted
@@ -532,6 +547,141 @@ outofmem:
 
 
 
+static int CSVColumnNumber(ExprTokenType &aToken)
+// Returns the column number contained by aToken, or 0 if it isn't a positive integer.
+{
+	if (TokenIsNumeric(aToken) != PURE_INTEGER)
+		return 0;
+	__int64 n = TokenToInt64(aToken);
+	return n > 0 && n <= INT_MAX ? (int)n : 0;
+}
+
+
+
+// Rows := CSVParse(Text [, Columns, OmitChars])
+bif_impl FResult CSVParse(StrArg aText, ExprTokenType *aColumns, optl<StrArg> aOmitChars, IObject *&aRetVal)
+// Parses each line of Text the same way Loop Parse CSV parses a string, except that a newline
+// within a quoted field belongs to the field, as in RFC 4180.  Returns an Array of rows, each an
+// Array of fields.  If Columns is an Array of column numbers, each row contains only those columns,
+// in that order.  If Columns is a single column number, the result is an Array of that column's
+// values instead.  A row which is too short for a column has "" in its place.
+{
+	struct FieldSpan { LPCTSTR value; size_t length; };
+	int single_column = 0, column_count = 0, max_column = 0;
+	int *column = NULL;
+	FieldSpan *span = NULL;
+	LPTSTR buf = NULL;
+	Array *rows = NULL, *row = NULL;
+
+	if (aColumns)
+	{
+		if (auto obj = TokenToObject(*aColumns))
+		{
+			auto arr = dynamic_cast<Array *>(obj);
+			if (!arr || !arr->Length() || arr->Length() > INT_MAX)
+				return FR_E_ARG(1);
+			column_count = (int)arr->Length();
+			if (  !(column = (int *)malloc(column_count * sizeof(int)))  )
+				return FR_E_OUTOFMEM;
+			for (int i = 0; i < column_count; ++i)
+			{
+				ExprTokenType item;
+				if (!arr->ItemToToken(i, item) || !(column[i] = CSVColumnNumber(item)))
+				{
+					free(column);
+					return FR_E_ARG(1);
+				}
+				if (max_column < column[i])
+					max_column = column[i];
+			}
+		}
+		else if (  !(single_column = CSVColumnNumber(*aColumns))  )
+			return FR_E_ARG(1);
+	}
+
+	auto omit_list = aOmitChars.value_or_empty();
+	CharSet omit_set(omit_list);
+	size_t length = _tcslen(aText);
+	FResult fr = FR_E_OUTOFMEM;
+	// Fields are parsed in place, so work on a copy.  span holds the fields of the current row
+	// which are needed for Columns, since they can be listed in any order.
+	if (  !(buf = tmalloc(length + 1))
+		|| max_column && !(span = (FieldSpan *)malloc(max_column * sizeof(FieldSpan)))
+		|| !(rows = Array::Create())  )
+		goto done;
+	tmemcpy(buf, aText, length + 1);
+
+	for (LPTSTR field = buf; *field; )
+	{
+		if (!single_column && !(row = Array::Create()))
+			goto done;
+		int field_number = 0;
+		if (*field == '\n' || *field == '\r' && field[1] == '\n')
+			// An empty line, which contains no fields, as for Loop Parse CSV with an empty string.
+			field += 1 + (*field == '\r');
+		else for (;;)
+		{
+			LPTSTR value, value_end;
+			LPTSTR field_end = CsvParseField(field, value, value_end, true);
+			if (*omit_list && value < value_end)
+			{
+				value = omit_leading_any(value, omit_set, value_end - value);
+				if (value < value_end)
+					value_end = value + omit_trailing_any(value, omit_set, value_end - 1);
+			}
+			++field_number;
+			if (single_column)
+			{
+				if (field_number == single_column && !rows->Append(value, value_end - value))
+					goto done;
+			}
+			else if (span)
+			{
+				if (field_number <= max_column)
+					span[field_number - 1] = { value, (size_t)(value_end - value) };
+			}
+			else if (!row->Append(value, value_end - value))
+				goto done;
+			TCHAR delimiter = *field_end;
+			field = delimiter ? field_end + 1 : field_end;
+			if (delimiter != ',') // The end of the row.
+				break;
+		}
+		if (single_column)
+		{
+			if (field_number < single_column && !rows->Append(_T(""), 0))
+				goto done;
+			continue;
+		}
+		for (int i = 0; i < column_count; ++i)
+		{
+			bool present = column[i] <= field_number;
+			if (!row->Append(present ? span[column[i] - 1].value : _T(""), present ? span[column[i] - 1].length : 0))
+				goto done;
+		}
+		ExprTokenType row_token(row);
+		bool appended = rows->Append(row_token);
+		row->Release();
+		row = NULL;
+		if (!appended)
+			goto done;
+	}
+	aRetVal = rows;
+	rows = NULL;
+	fr = OK;
+done:
+	if (row)
+		row->Release();
+	if (rows)
+		rows->Release();
+	free(span);
+	free(column);
+	free(buf);
+	return fr;
+}
+
+
+
 // SplitPath outputs:
 //  aName: non-null, either constant _T("") or points into aFileSpec.
 //  all others: null if no such component, otherwise points into aFileSpec.
@@ -1376,166 +1526,33 @@ BIF_DECL(BIF_Format)
 	if (ParamIndexToObject(0))
 		_f_throw_param(0, _T("String"));
 
-	LPCTSTR fmt = ParamIndexToString(0), lit, cp, cp_end, cp_spec;
-	LPTSTR target = NULL;
-	int size = 0, spec_len;
-	int param, last_param;
-	TCHAR number_buf[MAX_NUMBER_SIZE];
-	TCHAR spec[12+MAX_INTEGER_LENGTH*2];
-	TCHAR custom_format;
-	ExprTokenType value;
-	*spec = '%';
-
-	for (;;)
-	{
-		last_param = 0;
-
-		for (lit = cp = fmt;; )
-		{
-			// Find next placeholder.
-			for (cp_end = cp; *cp_end && *cp_end != '{'; ++cp_end);
-			if (cp_end > lit)
-			{
-				// Handle literal text to the left of the placeholder.
-				if (target)
-					tmemcpy(target, lit, cp_end - lit), target += cp_end - lit;
-				else
-					size += int(cp_end - lit);
-				lit = cp_end; // Mark this as the next literal character (to be overridden below if it's a valid placeholder).
-			}
-			cp = cp_end;
-			if (!*cp)
-				break;
-			// else: Implies *cp == '{'.
-			++cp;
-			if ((*cp == '{' || *cp == '}') && cp[1] == '}') // {{} or {}}
-			{
-				if (target)
-					*target++ = *cp;
-				else
-					++size;
-				cp += 2;
-				lit = cp; // Mark this as the next literal character.
-				continue;
-			}
-			
-			// Index.
-			for (cp_end = cp; *cp_end >= '0' && *cp_end <= '9'; ++cp_end);
-			if (cp_end > cp)
-				param = ATOI(cp), cp = cp_end;
-			else
-				param = last_param + 1;
-			if (param >= aParamCount || param < 1) // Invalid parameter index.
-				continue;
-
-			custom_format = 0; // Set default.
+	size_t fmt_length;
+	LPCTSTR fmt = ParamIndexToString(0, NULL, &fmt_length);
 
-			// Optional format specifier.
-			if (*cp == ':')
-			{
-				cp_spec = ++cp;
-				// Skip valid format specifier options.
-				for (cp = cp_spec; *cp && _tcschr(_T("-+0 #"), *cp); ++cp); // flags
-				for ( ; *cp >= '0' && *cp <= '9'; ++cp); // width
-				if (*cp == '.') do ++cp; while (*cp >= '0' && *cp <= '9'); // .precision
-				spec_len = int(cp - cp_spec);
-				// For now, size specifiers (h | l | ll | w | I | I32 | I64) are not supported.
-				
-				if (spec_len + 4 >= _countof(spec)) // Format specifier too long (probably invalid).
-					continue;
-				// Copy options, if any (+1 to leave the leading %).
-				tmemcpy(spec + 1, cp_spec, spec_len);
-				++spec_len; // Include the leading %.
+	bool cached;
+	FormatProgram *program = FormatProgram::Get(fmt, fmt_length, aParamCount, cached);
+	if (!program)
+		_f_throw_oom;
 
-				if (_tcschr(_T("diouxX"), *cp))
-				{
-					spec[spec_len++] = 'I';
-					spec[spec_len++] = '6';
-					spec[spec_len++] = '4';
-					// Integer value; apply I64 prefix to avoid truncation.
-					value.symbol = SYM_INTEGER;
-					spec[spec_len++] = *cp++;
-				}
-				else if (_tcschr(_T("eEfgGaA"), *cp))
-				{
-					value.symbol = SYM_FLOAT;
-					spec[spec_len++] = *cp++;
-				}
-				else if (_tcschr(_T("cCp"), *cp))
-				{
-					// Input is an integer or pointer, but I64 prefix should not be applied.
-					value.symbol = SYM_INTEGER;
-					spec[spec_len++] = *cp++;
-				}
-				else
-				{
-					value.symbol = SYM_STRING;
-					spec[spec_len++] = 's'; // Default to string if not specified.
-					if (_tcschr(_T("ULlTt"), *cp))
-						custom_format = toupper(*cp++);
-					if (*cp == 's')
-						++cp;
-				}
-			}
-			else
-			{
-				value.symbol = SYM_STRING;
-				// spec[0] contains '%'.
-				spec[1] = 's';
-				spec_len = 2;
-			}
-			if (value.symbol == SYM_STRING)
-			{
-				if (ParamIndexToObject(param))
-					_f_throw_param(param, _T("String"));
-				value.marker = ParamIndexToString(param, number_buf);
-			}
-			else
-			{
-				if (!ParamIndexIsNumeric(param))
-					_f_throw_param(param, _T("Number"));
-				if (value.symbol == SYM_INTEGER)
-					value.value_int64 = ParamIndexToInt64(param);
-				else
-					value.value_double = ParamIndexToDouble(param);
-			}
-			spec[spec_len] = '\0';
-			
-			if (*cp != '}') // Syntax error.
-				continue;
-			++cp;
-			lit = cp; // Mark this as the next literal character.
-
-			// Now that validation is complete, set last_param for use by the next {} or {:fmt}.
-			last_param = param;
-			
-			if (target)
-			{
-				int len = _stprintf(target, spec, value.value_int64);
-				switch (custom_format)
-				{
-				case 0: break; // Might help performance to list this first.
-				case 'U': CharUpper(target); break;
-				case 'L': CharLower(target); break;
-				case 'T': StrToTitleCase(target); break;
-				}
-				target += len;
-			}
-			else
-				size += _sctprintf(spec, value.value_int64);
-		}
-		if (target)
-		{
-			// Finished second pass.
-			*target = '\0';
-			return;
-		}
-		// Finished first pass (calculating required size).
-		if (!TokenSetResult(aResultToken, NULL, size))
-			return;
+	// The first pass calculates the required size.  The buffer is allocated at exactly this size,
+	// and the second pass writes directly into it.
+	size_t length;
+	int bad_param = 0;
+	LPCTSTR expected_type = NULL;
+	if (FormatItem *item = program->Run(aParam, NULL, length))
+	{
+		bad_param = item->param;
+		expected_type = item->symbol == SYM_STRING ? _T("String") : _T("Number");
+	}
+	else if (TokenSetResult(aResultToken, NULL, length))
+	{
 		aResultToken.symbol = SYM_STRING;
-		target = aResultToken.marker;
+		program->Run(aParam, aResultToken.marker, length);
 	}
+	if (!cached)
+		free(program);
+	if (bad_param)
+		_f_throw_param(bad_param, expected_type);
 }
 
 
@@ -22,6 +22,7 @@ GNU General Public License for more details.
 #include "window.h" // for a lot of things
 #include "application.h" // for MsgSleep()
 #include "TextIO.h"
+#include "CsvParse.h"
 
 #define NA MAX_FUNCTION_PARAMS
 #define BIFn(name, minp, maxp, bif, ...) {_T(#name), bif, minp, maxp, FID_##name, __VA_ARGS__}
@@ -86,7 +87,9 @@ FuncEntry g_BIF[] =
 	BIFn(Min, 1, NA, BIF_MinMax),
 	BIF1(Mod, 2, 2),
 	BIF1(NumGet, 2, 3),
+	BIF1(NumGetArray, 3, 4),
 	BIF1(NumPut, 3, NA),
+	BIF1(NumPutArray, 3, 4),
 	BIFn(ObjAddRef, 1, 1, BIF_ObjAddRefRelease),
 	BIF1(ObjBindMethod, 1, NA),
 	BIFn(ObjFromPtr, 1, 1, BIF_ObjPtr),
@@ -320,7 +323,7 @@ Script::Script()
 	, mIsReadyToExecute(false), mAutoExecSectionIsRunning(false)
 	, mIsRestart(false), mErrorStdOut(false), mErrorStdOutCP(0)
 #ifndef AUTOHOTKEYSC
-	, mValidateThenExit(false)
+	, mValidateThenExit(false), mProfileLoad(false), mDumpPostfix(false)
 	, mCmdLineInclude(NULL)
 #endif
 	, mUninterruptedLineCountMax(1000), mUninterruptibleTime(17)
@@ -1014,6 +1017,9 @@ ResultType Script::AutoExecSection()
 	mAutoExecSectionIsRunning = false;
 	--g_nThreads;
 
+	// Apply any hotkey changes deferred by a HotkeyBatch() which wasn't ended.
+	Hotkey::EndManifestBatch(true);
+
 	// Check if an exception has been thrown
 	if (g->ThrownToken)
 		g_script.FreeExceptionToken(g->ThrownToken);
@@ -1372,6 +1378,9 @@ UINT Script::LoadFromFile(LPCTSTR aFileSpec)
 		aFileSpec = mFileSpec;
 
 #ifndef AUTOHOTKEYSC  // When not in stand-alone mode, read an external script file.
+	if (mProfileLoad)
+		g_LoadProfiler.Start();
+
 	DWORD attr = mKind == ScriptKindFile ? GetFileAttributes(aFileSpec) : 0; // v1.1.17: Don't check if reading script from stdin.
 	if (attr == MAXDWORD) // File does not exist or lacking the authorization to get its attributes.
 	{
@@ -1419,6 +1428,7 @@ UINT Script::LoadFromFile(LPCTSTR aFileSpec)
 		|| !PreparseExpressions(mFuncs)
 		|| !PreparseVarRefs())
 		return LOADING_FAILED; // Error was already displayed by the above call.
+	Line::FreeInfixBuffer(); // All expressions have now been converted to postfix.
 
 	// Do some processing of local variables to support closures.
 	// This must be done after PreparseExpressions() has resolved all variable references.
@@ -1437,6 +1447,13 @@ UINT Script::LoadFromFile(LPCTSTR aFileSpec)
 		return LOADING_FAILED; // Error was already displayed by the above calls.
 	
 #ifndef AUTOHOTKEYSC
+	if (mProfileLoad)
+		PrintLoadProfile();
+	if (mDumpPostfix)
+	{
+		DumpPostfix();
+		return 0; // Tell our caller to do a normal exit.
+	}
 	if (mValidateThenExit)
 		return 0; // Tell our caller to do a normal exit.
 #endif
@@ -1446,6 +1463,105 @@ UINT Script::LoadFromFile(LPCTSTR aFileSpec)
 
 
 
+#ifndef AUTOHOTKEYSC
+void Script::PrintLoadProfile()
+// Prints the results of /ProfileLoad to stderr.
+{
+	g_LoadProfiler.Stop();
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	__int64 total = 0;
+	for (int i = 0; i < LOAD_PHASE_COUNT; ++i)
+		total += g_LoadProfiler.Time((LoadPhase)i);
+	TCHAR buf[1024];
+	int n = sntprintf(buf, _countof(buf), _T("%-20s %12s %10s\n"), _T("Phase"), _T("Time (ms)"), _T("Calls"));
+	for (int i = 0; i < LOAD_PHASE_COUNT; ++i)
+	{
+		LoadPhase phase = (LoadPhase)i;
+		n += sntprintf(buf + n, _countof(buf) - n, _T("%-20s %12.3f %10u\n"), LoadProfiler::PhaseName(phase)
+			, g_LoadProfiler.Time(phase) * 1000.0 / freq.QuadPart, g_LoadProfiler.Count(phase));
+	}
+	n += sntprintf(buf + n, _countof(buf) - n, _T("%-20s %12.3f\n"), _T("Total"), total * 1000.0 / freq.QuadPart);
+	n += sntprintf(buf + n, _countof(buf) - n, _T("\nConstant operators folded: %u\nConstant branches removed: %u\n")
+		, g_LoadProfiler.mFoldedOperators, g_LoadProfiler.mRemovedBranches);
+	PrintErrorStdOut(buf, n, _T("**"));
+}
+
+
+
+void Script::DumpPostfix()
+// Prints the postfix form of each arg to stdout for /DumpPostfix, one line per arg, so that the
+// output of the expression parser can be compared between builds (see tests/PostfixDiff.ahk).
+{
+	static LPCTSTR sSymbolName[] =
+	{
+		NULL, NULL, NULL, _T("unset"), NULL, NULL, NULL, _T("super"), NULL // Operands, handled below.
+		, _T("++post"), _T("--post"), _T("?maybe"), _T("."), _T(")"), _T("]"), _T("}"), _T("("), _T("["), _T("{"), _T(",")
+		, _T(":="), _T("+="), _T("-="), _T("*="), _T("/="), _T("//="), _T("|="), _T("^="), _T("&="), _T("<<="), _T(">>="), _T(">>>="), _T("??="), _T(".=")
+		, _T("else"), _T("then"), _T("??"), _T("||"), _T("&&"), _T("is")
+		, _T("="), _T("=="), _T("!="), _T("!=="), _T(">"), _T("<"), _T(">="), _T("<="), _T("~="), _T("concat"), _T("lowconcat")
+		, _T("|"), _T("^"), _T("&"), _T("<<"), _T(">>"), _T(">>>"), _T("//")
+		, _T("+"), _T("-"), _T("*"), _T("/"), _T("**")
+		, _T("not"), _T("neg"), _T("pos"), _T("&ref"), _T("!"), _T("~"), _T("isset"), _T("++pre"), _T("--pre")
+		, NULL, _T("reserved"), _T("reserved-op")
+	};
+	static_assert(_countof(sSymbolName) == SYM_COUNT, "sSymbolName must be kept in sync with SymbolType.");
+
+	TextFile tf;
+	if (!tf.Open(_T("*"), TextStream::APPEND, mErrorStdOutCP))
+		return;
+	for (auto module = mLastModule; module; module = module->mPrev)
+	for (Line *line = module->mFirstLine; line; line = line->mNextLine)
+	for (int a = 0; a < line->mArgc; ++a)
+	{
+		ArgStruct &arg = line->mArg[a];
+		if (!arg.postfix)
+			continue;
+		tf.Format(_T("%d:%d:%d:"), line->mFileIndex, line->mLineNumber, a);
+		for (ExprTokenType *token = arg.postfix; token->symbol != SYM_INVALID; ++token)
+		{
+			switch (token->symbol)
+			{
+			case SYM_STRING:
+				tf.Write(_T(" \""), 2);
+				for (LPCTSTR cp = token->marker; *cp; ++cp)
+				{
+					switch (*cp)
+					{
+					case '"': tf.Write(_T("`\""), 2); break;
+					case '`': tf.Write(_T("``"), 2); break;
+					case '\n': tf.Write(_T("`n"), 2); break;
+					case '\r': tf.Write(_T("`r"), 2); break;
+					case '\t': tf.Write(_T("`t"), 2); break;
+					default: tf.Write(cp, 1); break;
+					}
+				}
+				tf.Write(_T("\""), 1);
+				break;
+			case SYM_INTEGER: tf.Format(_T(" %I64d"), token->value_int64); break;
+			case SYM_FLOAT: tf.Format(_T(" %.17g"), token->value_double); break;
+			case SYM_VAR: tf.Format(_T(" $%s"), token->var->mName); break;
+			case SYM_DYNAMIC: tf.Write(_T(" %deref"), 7); break; // Its name is computed by the preceding tokens.
+			case SYM_OBJECT: tf.Format(_T(" <%s>"), token->object->Type()); break;
+			case SYM_FUNC:
+				tf.Format(_T(" call:%s%s%s/%d/%X"), token->callsite->func ? token->callsite->func->mName : _T("")
+					, token->callsite->member ? _T(".") : _T(""), token->callsite->member ? token->callsite->member : _T("")
+					, token->callsite->param_count, token->callsite->flags);
+				break;
+			default:
+				tf.Format(_T(" %s"), sSymbolName[token->symbol]);
+				if (SYM_USES_CIRCUIT_TOKEN(token->symbol)) // Show the relative position of the jump target.
+					tf.Format(_T(">%d"), (int)(token->circuit_token - token));
+			}
+		}
+		tf.Write(_T("\n"), 1);
+	}
+	tf.Close();
+}
+#endif
+
+
+
 bool Script::IsFunctionDefinition(LPTSTR aBuf, LPTSTR aNextBuf)
 // Helper function for LoadIncludedFile().
 // Caller passes in an aBuf containing a candidate line such as "function(x, y)"
@@ -3317,6 +3433,7 @@ ResultType Script::GetLineContinuation(TextStream *fp, LineBuffer &buf, LineBuff
 
 size_t Script::GetLine(LineBuffer &aBuf, int aInContinuationSection, bool aInBlockComment, TextStream *ts)
 {
+	LoadPhaseTimer timer(LOAD_PHASE_GET_LINE);
 	size_t aBuf_length = 0;
 	for (;;)
 	{
@@ -4126,7 +4243,7 @@ Label *Script::FindLabel(LPCTSTR aLabelName)
 {
 	if (!aLabelName || !*aLabelName) return NULL;
 	for (auto label = CurrentFirstLabel(); label; label = label->mNextLabel)
-		if (!_tcsicmp(label->mName, aLabelName)) // lstrcmpi() is not used: 1) avoids breaking existing scripts; 2) provides consistent behavior across multiple locales; 3) performance.
+		if (!ctcsicmp(label->mName, aLabelName)) // lstrcmpi() is not used: 1) avoids breaking existing scripts; 2) provides consistent behavior across multiple locales; 3) performance.
 			return label; // Match found.
 	return NULL; // No match found.
 }
@@ -4176,6 +4293,7 @@ ResultType Script::ParseAndAddLine(LPTSTR aLineText, ActionTypeType aActionType)
 // aLineText must point to a buffer with room to append "()" if it may contain a function call statement
 // (which is only possible when aActionType is ACT_INVALID/omitted or an ACT with possible subaction).
 {
+	LoadPhaseTimer timer(LOAD_PHASE_PARSE_AND_ADD_LINE);
 #ifdef _DEBUG
 	if (!aLineText || !*aLineText && !aActionType)
 		return ScriptError(_T("DEBUG: ParseAndAddLine() called incorrectly."));
@@ -4932,7 +5050,7 @@ inline ActionTypeType Script::ConvertActionType(LPCTSTR aActionTypeString)
 	// Use an int rather than ActionTypeType since it's sure to be large enough to go beyond
 	// 256 if there happen to be exactly 256 actions in the array:
  	for (int action_type = ACT_FIRST_NAMED_ACTION; action_type <= ACT_LAST_NAMED_ACTION; ++action_type)
-		if (!_tcsicmp(aActionTypeString, g_act[action_type].Name)) // Match found.
+		if (!ctcsicmp(aActionTypeString, g_act[action_type].Name)) // Match found.
 			return action_type;
 	return ACT_INVALID;  // On failure to find a match.
 }
@@ -5311,8 +5429,33 @@ ResultType DerefList::Push()
 
 
 
+// Table-driven equivalent of _tcschr(EXPR_OPERAND_TERMINATORS, c), which is evaluated for one or more
+// characters of each operand while loading.  As with _tcschr(), the null terminator is a member.
+struct ExprOperandTerminators
+{
+	bool is_member[128];
+	constexpr ExprOperandTerminators() : is_member()
+	{
+		for (LPCTSTR cp = EXPR_OPERAND_TERMINATORS; ; ++cp)
+		{
+			is_member[(TBYTE)*cp] = true;
+			if (!*cp)
+				break;
+		}
+	}
+};
+static constexpr ExprOperandTerminators sExprOperandTerminators;
+
+static inline bool IsExprOperandTerminator(TCHAR aChar)
+{
+	return (TBYTE)aChar < _countof(sExprOperandTerminators.is_member) && sExprOperandTerminators.is_member[(TBYTE)aChar];
+}
+
+
+
 ResultType Script::ParseOperands(LPTSTR aArgText, DerefList &aDeref, int *aPos, TCHAR aEndChar)
 {
+	LoadPhaseTimer timer(LOAD_PHASE_PARSE_OPERANDS);
 	LPTSTR op_begin, op_end;
 	size_t operand_length;
 	TCHAR close_char, *cp;
@@ -5326,7 +5469,7 @@ ResultType Script::ParseOperands(LPTSTR aArgText, DerefList &aDeref, int *aPos,
 		op_begin += *aPos;
 	for (; *op_begin; op_begin = op_end)
 	{
-		while (*op_begin && _tcschr(EXPR_OPERAND_TERMINATORS, *op_begin)) // Skip over whitespace, operators, and parentheses.
+		while (*op_begin && IsExprOperandTerminator(*op_begin)) // Skip over whitespace, operators, and parentheses.
 		{
 			if (*op_begin == aEndChar)
     		{
@@ -5467,13 +5610,13 @@ ResultType Script::ParseOperands(LPTSTR aArgText, DerefList &aDeref, int *aPos,
 			{
 				LPTSTR d_end;
 				_tcstod(op_begin, &d_end);
-				if (op_end < d_end && _tcschr(EXPR_OPERAND_TERMINATORS, *d_end))
+				if (op_end < d_end && IsExprOperandTerminator(*d_end))
 				{
 					op_end = d_end;
 					continue;
 				}
 			}
-			if (_tcschr(EXPR_OPERAND_TERMINATORS, *op_end))
+			if (IsExprOperandTerminator(*op_end))
 			{
 				// Do nothing further since pure numbers don't need any processing at this stage.
 				// If this number has a fractional part, it is handled by "case '.'" above.
@@ -5625,24 +5768,30 @@ SymbolType Script::ConvertWordOperator(LPCTSTR aWord, size_t aLength)
 	struct WordOp
 	{
 		LPCTSTR word;
+		size_t length;
 		SymbolType op;
 	};
+	#define WORD_OP(word, op) { word, _countof(word) - 1, op }
 	static WordOp sWordOp[] =
 	{
-		{ _T("or"), SYM_OR },
-		{ _T("and"), SYM_AND },
-		{ _T("not"), SYM_LOWNOT },
-		{ _T("is"), SYM_IS },
-		{ _T("IsSet"), SYM_ISSET },
-		{ SUPER_KEYWORD, SYM_SUPER },
-		{ _T("as"), SYM_RESERVED_OPERATOR },
-		{ _T("contains"), SYM_RESERVED_OPERATOR },
-		{ _T("in"), SYM_RESERVED_OPERATOR },
-		{ _T("unset"), SYM_MISSING },
+		WORD_OP(_T("or"), SYM_OR),
+		WORD_OP(_T("and"), SYM_AND),
+		WORD_OP(_T("not"), SYM_LOWNOT),
+		WORD_OP(_T("is"), SYM_IS),
+		WORD_OP(_T("IsSet"), SYM_ISSET),
+		WORD_OP(SUPER_KEYWORD, SYM_SUPER),
+		WORD_OP(_T("as"), SYM_RESERVED_OPERATOR),
+		WORD_OP(_T("contains"), SYM_RESERVED_OPERATOR),
+		WORD_OP(_T("in"), SYM_RESERVED_OPERATOR),
+		WORD_OP(_T("unset"), SYM_MISSING),
 	};
+	#undef WORD_OP
+	// Comparing the length and first letter first avoids calling _tcsnicmp() for most variable names.
+	TCHAR first = ctolower(*aWord);
 	for (int i = 0; i < _countof(sWordOp); ++i)
 	{
-		if (!_tcsnicmp(sWordOp[i].word, aWord, aLength) && !sWordOp[i].word[aLength])
+		if (sWordOp[i].length == aLength && ctolower(*sWordOp[i].word) == first
+			&& !_tcsnicmp(sWordOp[i].word, aWord, aLength))
 		{
 			return sWordOp[i].op;
 		}
@@ -6716,7 +6865,7 @@ T *ScriptItemList<T, S>::Find(LPCTSTR aName, int *apInsertPos)
 	for (left = 0, right = mCount - 1; left <= right;)
 	{
 		mid = (left + right) / 2;
-		result = _tcsicmp(aName, mItem[mid]->mName); // lstrcmpi() is not used: 1) avoids breaking existing scripts; 2) provides consistent behavior across multiple locales; 3) performance.
+		result = ctcsicmp(aName, mItem[mid]->mName); // lstrcmpi() is not used: 1) avoids breaking existing scripts; 2) provides consistent behavior across multiple locales; 3) performance.
 		if (result > 0)
 			left = mid + 1;
 		else if (result < 0)
@@ -6783,7 +6932,7 @@ Func *Script::GetBuiltInFunc(LPCTSTR aFuncName)
 	for (left = 0, right = _countof(g_BIF) - 1; left <= right;)
 	{
 		mid = (left + right) / 2;
-		result = _tcsicmp(aFuncName, g_BIF[mid].mName);
+		result = ctcsicmp(aFuncName, g_BIF[mid].mName);
 		if (result > 0)
 			left = mid + 1;
 		else if (result < 0)
@@ -7395,7 +7544,7 @@ VarEntry *Script::GetBuiltInVar(LPCTSTR aVarName)
 	for (left = 0, right = _countof(g_BIV_A) - 1; left <= right;)
 	{
 		mid = (left + right) / 2;
-		result = _tcsicmp(aVarName, g_BIV_A[mid].name);
+		result = ctcsicmp(aVarName, g_BIV_A[mid].name);
 		if (result > 0)
 			left = mid + 1;
 		else if (result < 0)
@@ -7425,7 +7574,7 @@ WinGroup *Script::FindGroup(LPCTSTR aGroupName, bool aCreateIfNotFound)
 		return NULL;
 	}
 	for (WinGroup *group = mFirstGroup; group != NULL; group = group->mNextGroup)
-		if (!_tcsicmp(group->mName, aGroupName)) // lstrcmpi() is not used: 1) avoids breaking existing scripts; 2) provides consistent behavior across multiple locales; 3) performance.
+		if (!ctcsicmp(group->mName, aGroupName)) // lstrcmpi() is not used: 1) avoids breaking existing scripts; 2) provides consistent behavior across multiple locales; 3) performance.
 			return group; // Match found.
 	// Otherwise, no match found, so create a new group.
 	if (!aCreateIfNotFound || AddGroup(aGroupName) != OK)
@@ -7842,17 +7991,398 @@ bool Script::IsLabelTarget(Line *aLine)
 
 
 
+// Constant folding.  The functions below operate on the temporary array of token pointers built by
+// ExpressionToPostfix(), before it is copied into the arg's postfix array.  Only literal operands are
+// folded, and any operation which would raise an error (such as division by zero or a type mismatch)
+// is left for run time so that the error is reported normally.  The results must be kept consistent
+// with ExpandExpression().
+
+static bool IsLiteralToken(ExprTokenType &aToken)
+{
+	return aToken.symbol == SYM_STRING || IS_NUMERIC(aToken.symbol);
+}
+
+static bool IsConstantOperator(SymbolType aSymbol)
+{
+	switch (aSymbol)
+	{
+	case SYM_NEGATIVE: case SYM_POSITIVE: case SYM_HIGHNOT: case SYM_LOWNOT: case SYM_BITNOT:
+	case SYM_CONCAT: case SYM_ADD: case SYM_SUBTRACT: case SYM_MULTIPLY: case SYM_DIVIDE: case SYM_POWER:
+		return true;
+	}
+	return IS_INTEGER_OPERATOR(aSymbol) || IS_RELATIONAL_OPERATOR(aSymbol);
+}
+
+static bool FoldUnaryOperator(ExprTokenType &aOp, ExprTokenType &aRight)
+// Replaces aOp with its result and returns true, or returns false if it can't be folded.
+{
+	switch (aOp.symbol)
+	{
+	case SYM_HIGHNOT:
+	case SYM_LOWNOT:
+		aOp.SetValue(!TokenToBOOL(aRight));
+		return true;
+	case SYM_NEGATIVE:
+		if (aRight.symbol == SYM_INTEGER)
+			aOp.SetValue(-aRight.value_int64);
+		else if (aRight.symbol == SYM_FLOAT)
+			aOp.SetValue(-aRight.value_double);
+		else // Numeric strings are left for run time.
+			return false;
+		return true;
+	case SYM_POSITIVE:
+		if (!IS_NUMERIC(aRight.symbol))
+			return false;
+		aOp.CopyValueFrom(aRight);
+		return true;
+	case SYM_BITNOT:
+		if (aRight.symbol != SYM_INTEGER)
+			return false;
+		aOp.SetValue(~aRight.value_int64);
+		return true;
+	}
+	return false;
+}
+
+static bool FoldBinaryOperator(ExprTokenType &aOp, ExprTokenType &aLeft, ExprTokenType &aRight)
+// Replaces aOp with its result and returns true, or returns false if it can't be folded.
+{
+	// SYM_CONCAT is handled by FoldConcatRun().
+	// Numeric strings and string comparisons are left for run time.
+	if (!IS_NUMERIC(aLeft.symbol) || !IS_NUMERIC(aRight.symbol))
+		return false;
+	if (aLeft.symbol == SYM_INTEGER && aRight.symbol == SYM_INTEGER && aOp.symbol != SYM_DIVIDE)
+	{
+		__int64 left = aLeft.value_int64, right = aRight.value_int64, result;
+		switch (aOp.symbol)
+		{
+		case SYM_ADD:			result = left + right; break;
+		case SYM_SUBTRACT:		result = left - right; break;
+		case SYM_MULTIPLY:		result = left * right; break;
+		case SYM_EQUALCASE:
+		case SYM_EQUAL:			result = left == right; break;
+		case SYM_NOTEQUALCASE:
+		case SYM_NOTEQUAL:		result = left != right; break;
+		case SYM_GT:			result = left > right; break;
+		case SYM_LT:			result = left < right; break;
+		case SYM_GTOE:			result = left >= right; break;
+		case SYM_LTOE:			result = left <= right; break;
+		case SYM_BITAND:		result = left & right; break;
+		case SYM_BITOR:			result = left | right; break;
+		case SYM_BITXOR:		result = left ^ right; break;
+		case SYM_BITSHIFTLEFT:
+		case SYM_BITSHIFTRIGHT:
+		case SYM_BITSHIFTRIGHT_LOGICAL:
+			if (right < 0 || right > 63)
+				return false;
+			if (aOp.symbol == SYM_BITSHIFTRIGHT_LOGICAL)
+				result = (unsigned __int64)left >> right;
+			else
+				result = aOp.symbol == SYM_BITSHIFTLEFT ? left << right : left >> right;
+			break;
+		case SYM_INTEGERDIVIDE:
+			if (right == 0 || right == -1 && left == _I64_MIN)
+				return false;
+			result = left / right;
+			break;
+		case SYM_POWER:
+			if (right < 0 || !left && !right) // Negative exponents produce a float, which is left for run time.
+				return false;
+			result = pow_ll(left, right);
+			break;
+		default:
+			return false;
+		}
+		aOp.SetValue(result);
+		return true;
+	}
+	if (IS_INTEGER_OPERATOR(aOp.symbol)) // Floats aren't supported by these.
+		return false;
+	double left = TokenToDouble(aLeft), right = TokenToDouble(aRight);
+	switch (aOp.symbol)
+	{
+	case SYM_ADD:			aOp.SetValue(left + right); break;
+	case SYM_SUBTRACT:		aOp.SetValue(left - right); break;
+	case SYM_MULTIPLY:		aOp.SetValue(left * right); break;
+	case SYM_DIVIDE:
+		if (right == 0.0)
+			return false;
+		aOp.SetValue(left / right);
+		break;
+	case SYM_EQUALCASE:
+	case SYM_EQUAL:			aOp.SetValue(left == right); break;
+	case SYM_NOTEQUALCASE:
+	case SYM_NOTEQUAL:		aOp.SetValue(left != right); break;
+	case SYM_GT:			aOp.SetValue(left > right); break;
+	case SYM_LT:			aOp.SetValue(left < right); break;
+	case SYM_GTOE:			aOp.SetValue(left >= right); break;
+	case SYM_LTOE:			aOp.SetValue(left <= right); break;
+	default: // SYM_POWER is left for run time.
+		return false;
+	}
+	return true;
+}
+
+static bool FoldConcatRun(ExprTokenType *aPostfix[], int aFirst, int aLast)
+// [aFirst, aLast] is a run of literals and SYM_CONCAT such as "a" "b" "c" (postfix: a b . c .).
+// Replaces aPostfix[aLast] with the result and returns true, or returns false if out of memory.
+// The whole run is folded with a single allocation, since SimpleHeap memory can't be freed and
+// each intermediate result would otherwise be kept for the life of the script.
+{
+	TCHAR buf[MAX_NUMBER_SIZE];
+	size_t length, total_length = 0;
+	int i;
+	for (i = aFirst; i < aLast; ++i)
+		if (aPostfix[i]->symbol != SYM_CONCAT)
+		{
+			TokenToString(*aPostfix[i], buf, &length);
+			total_length += length;
+		}
+	LPTSTR result = SimpleHeap::Alloc<TCHAR>(total_length + 1);
+	if (!result)
+		return false;
+	LPTSTR cp = result;
+	for (i = aFirst; i < aLast; ++i)
+		if (aPostfix[i]->symbol != SYM_CONCAT)
+		{
+			LPTSTR piece = TokenToString(*aPostfix[i], buf, &length);
+			tmemcpy(cp, piece, length);
+			cp += length;
+		}
+	*cp = '\0';
+	aPostfix[aLast]->SetValue(result, total_length);
+	return true;
+}
+
+static int GetCircuitOperators(ExprTokenType *aPostfix[], int aPostfixCount, ExprTokenType *aOp[])
+// Stores the short-circuit operators into aOp (if non-NULL) and returns how many there are.
+{
+	int count = 0;
+	for (int i = 0; i < aPostfixCount; ++i)
+		if (SYM_USES_CIRCUIT_TOKEN(aPostfix[i]->symbol))
+		{
+			if (aOp)
+				aOp[count] = aPostfix[i];
+			++count;
+		}
+	return count;
+}
+
+static bool IsCircuitTarget(ExprTokenType *aToken, ExprTokenType *aOp[], int aOpCount)
+// aOp contains the short-circuit operators, as returned by GetCircuitOperators().
+{
+	for (int i = 0; i < aOpCount; ++i)
+		if (aOp[i]->circuit_token == aToken)
+			return true;
+	return false;
+}
+
+static bool IsConstantRange(ExprTokenType *aPostfix[], int aFirst, int aLast)
+// Returns true if [aFirst, aLast] contains only literals and operators without side-effects.
+{
+	for (int i = aFirst; i <= aLast; ++i)
+		if (!IsLiteralToken(*aPostfix[i]) && !IsConstantOperator(aPostfix[i]->symbol))
+			return false;
+	return true;
+}
+
+static bool JumpsIntoRange(ExprTokenType *aPostfix[], int aPostfixCount, int aFirst, int aLast
+	, int aFirst2, int aLast2, ExprTokenType *aAllowedTarget)
+// Returns true if any token outside [aFirst, aLast] and [aFirst2, aLast2] has a circuit_token
+// inside either range, other than aAllowedTarget.  Pass aFirst2 > aLast2 to omit the second range.
+{
+	for (int i = 0; i < aPostfixCount; ++i)
+	{
+		if (i >= aFirst && i <= aLast || i >= aFirst2 && i <= aLast2)
+			continue;
+		if (!SYM_USES_CIRCUIT_TOKEN(aPostfix[i]->symbol) || aPostfix[i]->circuit_token == aAllowedTarget)
+			continue;
+		for (int j = aFirst; j <= aLast; ++j)
+			if (aPostfix[i]->circuit_token == aPostfix[j])
+				return true;
+		for (int j = aFirst2; j <= aLast2; ++j)
+			if (aPostfix[i]->circuit_token == aPostfix[j])
+				return true;
+	}
+	return false;
+}
+
+static int FindPostfixToken(ExprTokenType *aToken, ExprTokenType *aPostfix[], int aPostfixCount, int aStart)
+{
+	for (int i = aStart; i < aPostfixCount; ++i)
+		if (aPostfix[i] == aToken)
+			return i;
+	return -1;
+}
+
+static void RedirectCircuitTokens(ExprTokenType *aPostfix[], int aPostfixCount, ExprTokenType *aOld, ExprTokenType *aNew)
+{
+	for (int i = 0; i < aPostfixCount; ++i)
+		if (SYM_USES_CIRCUIT_TOKEN(aPostfix[i]->symbol) && aPostfix[i]->circuit_token == aOld)
+			aPostfix[i]->circuit_token = aNew;
+}
+
+static void RemovePostfixTokens(ExprTokenType *aPostfix[], int &aPostfixCount, int aFirst, int aLast)
+{
+	int count = aLast - aFirst + 1;
+	memmove(aPostfix + aFirst, aPostfix + aLast + 1, (aPostfixCount - aLast - 1) * sizeof(ExprTokenType *));
+	aPostfixCount -= count;
+}
+
+static void FoldConstants(ExprTokenType *aPostfix[], int &aPostfixCount)
+// Folds operators whose operands are all literals, and removes the unused branch of any ternary,
+// AND, OR or ?? whose condition is a literal, provided the removed branch is also constant (so that
+// removing it can't hide any load-time errors or warnings).  Since operands always precede their
+// operator, a single pass folds nested sub-expressions such as 60*60*1000.
+{
+	// A token which is the target of a short-circuit operator can't be removed.  The operators are
+	// gathered once so that checking this doesn't require a scan of the whole array.  Folding an
+	// operator removes only literals and non-short-circuit operators, so they need to be gathered
+	// again only after a branch is removed.
+	int circuit_count = GetCircuitOperators(aPostfix, aPostfixCount, NULL);
+	auto circuit_op = (ExprTokenType **)_alloca(circuit_count * sizeof(ExprTokenType *));
+	GetCircuitOperators(aPostfix, aPostfixCount, circuit_op);
+
+	for (int i = 1; i < aPostfixCount; ++i)
+	{
+		ExprTokenType &this_token = *aPostfix[i];
+		ExprTokenType &prev = *aPostfix[i - 1]; // The right operand, or the left operand/condition of a short-circuit operator.
+		if (!IsLiteralToken(prev))
+			continue;
+		if (IsConstantOperator(this_token.symbol))
+		{
+			if (IsCircuitTarget(&prev, circuit_op, circuit_count))
+				continue;
+			if (IS_PREFIX_OPERATOR(this_token.symbol))
+			{
+				if (!FoldUnaryOperator(this_token, prev))
+					continue;
+				RemovePostfixTokens(aPostfix, aPostfixCount, i - 1, i - 1);
+				i -= 1;
+			}
+			else
+			{
+				if (i < 2)
+					continue;
+				ExprTokenType &left = *aPostfix[i - 2];
+				if (!IsLiteralToken(left) || IsCircuitTarget(&left, circuit_op, circuit_count))
+					continue;
+				if (this_token.symbol == SYM_CONCAT)
+				{
+					// Extend the run for as long as another literal is concatenated onto the result.
+					int last = i;
+					while (last + 2 < aPostfixCount && aPostfix[last + 2]->symbol == SYM_CONCAT
+						&& IsLiteralToken(*aPostfix[last + 1])
+						&& !IsCircuitTarget(aPostfix[last], circuit_op, circuit_count)
+						&& !IsCircuitTarget(aPostfix[last + 1], circuit_op, circuit_count))
+						last += 2;
+					if (!FoldConcatRun(aPostfix, i - 2, last))
+						continue;
+					RemovePostfixTokens(aPostfix, aPostfixCount, i - 2, last - 1);
+					g_LoadProfiler.mFoldedOperators += (last - i) / 2 + 1;
+					i -= 2;
+					continue;
+				}
+				if (!FoldBinaryOperator(this_token, left, prev))
+					continue;
+				RemovePostfixTokens(aPostfix, aPostfixCount, i - 2, i - 1);
+				i -= 2;
+			}
+			++g_LoadProfiler.mFoldedOperators;
+			continue;
+		}
+		if (!SYM_USES_CIRCUIT_TOKEN(this_token.symbol) || IsCircuitTarget(&prev, circuit_op, circuit_count))
+			continue;
+		switch (this_token.symbol)
+		{
+		case SYM_IFF_THEN:
+		{
+			// THEN points to its ELSE, which points to the end of the ELSE branch.
+			int else_pos = FindPostfixToken(this_token.circuit_token, aPostfix, aPostfixCount, i + 1);
+			if (else_pos < 0)
+				continue;
+			ExprTokenType *else_end = aPostfix[else_pos]->circuit_token;
+			int end_pos = FindPostfixToken(else_end, aPostfix, aPostfixCount, else_pos + 1);
+			if (end_pos < 0)
+				continue;
+			if (TokenToBOOL(prev))
+			{
+				// Remove the condition, THEN and the ELSE branch, leaving the THEN branch.
+				if (!IsConstantRange(aPostfix, else_pos + 1, end_pos)
+					|| JumpsIntoRange(aPostfix, aPostfixCount, i - 1, i, else_pos, end_pos, else_end))
+					continue;
+				RedirectCircuitTokens(aPostfix, aPostfixCount, else_end, aPostfix[else_pos - 1]);
+				RemovePostfixTokens(aPostfix, aPostfixCount, else_pos, end_pos);
+			}
+			else
+			{
+				// Remove the condition, THEN, the THEN branch and ELSE, leaving the ELSE branch.
+				if (!IsConstantRange(aPostfix, i + 1, else_pos - 1)
+					|| JumpsIntoRange(aPostfix, aPostfixCount, i - 1, else_pos, 0, -1, nullptr))
+					continue;
+				RemovePostfixTokens(aPostfix, aPostfixCount, i + 1, else_pos);
+			}
+			RemovePostfixTokens(aPostfix, aPostfixCount, i - 1, i);
+			i = i > 1 ? i - 2 : 0; // Resume at the first token of the remaining branch.
+			break;
+		}
+		case SYM_AND:
+		case SYM_OR:
+		case SYM_OR_MAYBE:
+			// A literal is never unset, so ?? always yields its left operand.
+			if (this_token.symbol == SYM_OR_MAYBE || TokenToBOOL(prev) == (this_token.symbol == SYM_OR))
+			{
+				// Short-circuit: remove the operator and its right branch, leaving the left operand.
+				ExprTokenType *right_end = this_token.circuit_token;
+				int end_pos = FindPostfixToken(right_end, aPostfix, aPostfixCount, i + 1);
+				if (end_pos < 0
+					|| !IsConstantRange(aPostfix, i + 1, end_pos)
+					|| JumpsIntoRange(aPostfix, aPostfixCount, i, end_pos, 0, -1, right_end))
+					continue;
+				RedirectCircuitTokens(aPostfix, aPostfixCount, right_end, &prev);
+				RemovePostfixTokens(aPostfix, aPostfixCount, i, end_pos);
+				i -= 1;
+			}
+			else
+			{
+				// The right branch determines the result, so remove the left operand and the operator.
+				if (JumpsIntoRange(aPostfix, aPostfixCount, i - 1, i, 0, -1, nullptr))
+					continue;
+				RemovePostfixTokens(aPostfix, aPostfixCount, i - 1, i);
+				i = i > 1 ? i - 2 : 0; // Resume at the first token of the right branch.
+			}
+			break;
+		default:
+			continue;
+		}
+		++g_LoadProfiler.mRemovedBranches;
+		circuit_count = GetCircuitOperators(aPostfix, aPostfixCount, circuit_op);
+	}
+}
+
+
+
+ExprTokenType *Line::sInfix = NULL;
+int Line::sInfixSize = 0;
+
 ResultType Line::ExpressionToPostfix(ArgStruct &aArg)
 {
-	ExprTokenType *infix = NULL;
-	ResultType result = ExpressionToPostfix(aArg, infix);
-	// This approach produces smaller code than using RAII in the function below:
-	free(infix);
-	return result;
+	LoadPhaseTimer timer(LOAD_PHASE_EXPRESSION_TO_POSTFIX);
+	// The infix array is needed only while the postfix array is being built, so one buffer is
+	// reused for every expression rather than being allocated and freed for each one.
+	return ExpressionToPostfix(aArg, sInfix, sInfixSize);
+}
+
+void Line::FreeInfixBuffer()
+{
+	free(sInfix);
+	sInfix = NULL;
+	sInfixSize = 0;
 }
 
-ResultType Line::ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix)
+ResultType Line::ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix, int &aInfixSize)
 // Returns OK or FAIL.
+// aInfix and aInfixSize specify a buffer which is expanded as needed and retained for the next call.
 {
 	// Having a precedence array is required at least for SYM_POWER (since the order of evaluation
 	// of something like 2**1**2 does matter).  It also helps performance by avoiding unnecessary pushing
@@ -7911,9 +8441,9 @@ ResultType Line::ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix)
 	// or a name (which is displayed when the parameter count is invalid, for instance).
 	static BuiltInFunc *sIsSetFunc = new BuiltInFunc { _T("IsSet"), BIF_IsSet, 1, 1 };
 
-	ExprTokenType *infix = NULL;
-	int infix_size = 0, infix_count = 0, allow_for_extra_postfix = 0;
-	const int INFIX_GROWTH = 128; // Amount to grow by each time expansion is needed.  Rarely needed more than once (from zero).
+	ExprTokenType *infix = aInfix;
+	int infix_size = aInfixSize, infix_count = 0, allow_for_extra_postfix = 0;
+	const int INFIX_GROWTH = 128; // Amount to grow by each time expansion is needed.  Rarely needed more than once per script.
 	const int INFIX_MIN_SPACE = 5; // Minimum space to allow prior to each iteration or deref-processing.  Room for auto-concat, two tokens for `.id`, `. ("s")` for DT_STRING, and `f(fn)` for DT_FUNCREF; plus the final SYM_INVALID.
 
 	///////////////////////////////////////////////////////////////////////////////////////////////
@@ -7940,9 +8470,11 @@ ResultType Line::ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix)
 				// contained in the original infix array, only the infix array need be checked for overflow:
 				if (infix_count + INFIX_MIN_SPACE > infix_size)
 				{
-					infix_size += INFIX_GROWTH;
-					if (void *p = realloc(infix, infix_size * sizeof(ExprTokenType)))
+					if (void *p = realloc(infix, (infix_size + INFIX_GROWTH) * sizeof(ExprTokenType)))
+					{
 						aInfix = infix = (ExprTokenType *)p;
+						aInfixSize = infix_size += INFIX_GROWTH;
+					}
 					else
 						return LineError(ERR_OUTOFMEM);
 				}
@@ -8447,7 +8979,7 @@ ResultType Line::ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix)
 
 							// Find the end of the operand (".operand"):
 							op_end = find_identifier_end(cp);
-							if (!_tcschr(EXPR_OPERAND_TERMINATORS, *op_end))
+							if (!IsExprOperandTerminator(*op_end))
 								return LineError(ERR_EXP_ILLEGAL_CHAR, FAIL, op_end);
 
 							if (op_end == cp) // Missing identifier.
@@ -8503,7 +9035,7 @@ unquoted_literal:
 						if (!IsHex(cp))
 						{
 							double d = _tcstod(cp, &d_end);
-							if (d_end > i_end && _tcschr(EXPR_OPERAND_TERMINATORS, *d_end))
+							if (d_end > i_end && IsExprOperandTerminator(*d_end))
 							{
 								this_literal.symbol = SYM_FLOAT;
 								this_literal.value_double = d;
@@ -8513,7 +9045,7 @@ unquoted_literal:
 						}
 						if (*cp == '.') // Must be checked to avoid `(.foo)` being interpreted as `((0).foo)`.
 							return LineError(ERR_EXPR_SYNTAX, FAIL, cp);
-						if (_tcschr(EXPR_OPERAND_TERMINATORS, *i_end)
+						if (IsExprOperandTerminator(*i_end)
 							// Exclude property names composed of digits, in an object literal:
 							&& !(*omit_leading_whitespace(i_end) == ':' && infix_count
 								&& (infix[infix_count-1].symbol == SYM_OBRACE || infix[infix_count-1].symbol == SYM_COMMA)))
@@ -8546,9 +9078,11 @@ unquoted_literal:
 
 		if (infix_count + INFIX_MIN_SPACE > infix_size)
 		{
-			infix_size += INFIX_GROWTH;
-			if (void *p = realloc(infix, infix_size * sizeof(ExprTokenType)))
+			if (void *p = realloc(infix, (infix_size + INFIX_GROWTH) * sizeof(ExprTokenType)))
+			{
 				aInfix = infix = (ExprTokenType *)p;
+				aInfixSize = infix_size += INFIX_GROWTH;
+			}
 			else
 				return LineError(ERR_OUTOFMEM);
 		}
@@ -8732,7 +9266,7 @@ unquoted_literal:
 
 	if (infix_count == 0)
 		// Probably something like "Loop Parse, foo, `n" since an empty expression wouldn't make it this far.
-		// infix_size is 0 in this case, so cannot continue.  An alternative would be to treat this as a blank
+		// infix_size might be 0 in this case, so cannot continue.  An alternative would be to treat this as a blank
 		// parameter, but it's probably more useful to treat it as an error (maybe "`n" was intended).
 		return LineError(ERR_EXPR_SYNTAX);
 
@@ -9531,6 +10065,10 @@ end_of_infix_to_postfix:
 		if (postfix[postfix_count-1]->symbol == SYM_FUNC)
 			postfix[postfix_count-1]->callsite->flags |= EIF_UNSET_RETURN; // But not EIF_UNSET_PROP!
 
+	// Fold constant sub-expressions.  This is done before the check below so that an expression
+	// such as x := 60*60*1000 can be optimized in the same way as x := 3600000.
+	FoldConstants(postfix, postfix_count);
+
 	// The following enables ExpandExpression() to be skipped in common cases for ACT_ASSIGNEXPR
 	// and ACT_RETURN.  A similar optimization used to be done for simple literal integers by
 	// storing an __int64* in arg.postfix, but this new approach allows floating-point numbers
@@ -9630,6 +10168,7 @@ end_of_infix_to_postfix:
 
 ResultType Line::FinalizeExpression(ArgStruct &aArg)
 {
+	LoadPhaseTimer timer(LOAD_PHASE_FINALIZE_EXPRESSION);
 	auto stack = (ExprTokenType **)_alloca(aArg.max_stack * sizeof(ExprTokenType **));
 	int stack_count = 0;
 	// stack_count checks: Since missing operands are caught at an earlier stage, it doesn't
@@ -9934,6 +10473,13 @@ ResultType Line::ExecUntil(ExecUntilMode aMode, ResultToken *aResultToken, Line
 		if (g.IsPaused)
 			MsgWaitUnpause();
 
+		// Collect reference cycles here if a collection is due and this is the auto-execute thread running
+		// at global scope with no other threads, such as in a global loop which never ends.  Between lines
+		// at global scope there are no expressions in progress, so nothing holds uncounted references to
+		// objects.  Otherwise, collection waits until the script becomes idle (see ResumeUnderlyingThread).
+		if (CycleCollector::IsDue() && !g.CurrentFunc && g_nThreads == 1 && g_script.mAutoExecSectionIsRunning)
+			CycleCollector::Collect();
+
 		// Do these only after the above has had its opportunity to spend a significant amount
 		// of time doing what it needed to do.  i.e. do these immediately before the line will actually
 		// be run so that the time it takes to run will be reflected in the ListLines log.
@@ -11364,7 +11910,7 @@ ResultType Line::PerformLoopFilePattern(ResultToken *aResultToken, Line *&aJumpT
 	tmemcpy(file_path_end, lfs.pattern, lfs.pattern_length + 1); // file_path already includes the slash.
 
 	BOOL file_found;
-	HANDLE file_search = FindFirstFile(lfs.file_path, &lfs);
+	HANDLE file_search = FindFirstFileBatched(lfs.file_path, &lfs); // Short names are needed for A_LoopFileShortName and A_LoopFileShortPath.
 	for ( file_found = (file_search != INVALID_HANDLE_VALUE) // Convert FindFirst's return value into a boolean so that it's compatible with FindNext's.
 		; file_found && FileIsFilteredOut(lfs, aFileLoopMode)
 		; file_found = FindNextFile(file_search, &lfs));
@@ -11414,7 +11960,7 @@ ResultType Line::PerformLoopFilePattern(ResultToken *aResultToken, Line *&aJumpT
 	// We're only interested in the folders, but there's no special pattern that would filter out files.
 	file_path_end[0] = '*'; // There's always room for this since it's shorter than lfs.pattern.
 	file_path_end[1] = '\0';
-	file_search = FindFirstFile(lfs.file_path, &lfs);
+	file_search = FindFirstFileBatched(lfs.file_path, &lfs); // Short names are needed for lfs.short_path.
 	if (file_search == INVALID_HANDLE_VALUE)
 		return result; // Nothing more to do.
 	// Otherwise, recurse into any subdirectories found inside this parent directory.
@@ -11645,6 +12191,7 @@ ResultType Line::PerformLoopParse(ResultToken *aResultToken, Line *&aJumpToLine,
 	TCHAR delimiters[512], omit_list[512];
 	tcslcpy(delimiters, ARG2, _countof(delimiters));
 	tcslcpy(omit_list, ARG3, _countof(omit_list));
+	CharSet delimiter_set(delimiters), omit_set(omit_list);
 
 	ResultType result = CONDITION_FALSE;
 	Line *jump_to_line = nullptr;
@@ -11656,13 +12203,13 @@ ResultType Line::PerformLoopParse(ResultToken *aResultToken, Line *&aJumpToLine,
 	{ 
 		if (*delimiters)
 		{
-			if (   !(field_end = StrChrAny(field, delimiters))   ) // No more delimiters found.
+			if (   !(field_end = delimiter_set.Find(field))   ) // No more delimiters found.
 				field_end = field + _tcslen(field);  // Set it to the position of the zero terminator instead.
 		}
 		else // Since no delimiters, every char in the input string is treated as a separate field.
 		{
 			// But exclude this char if it's in the omit_list:
-			if (*omit_list && _tcschr(omit_list, *field))
+			if (omit_set.Contains(*field))
 			{
 				++field; // Move on to the next char.
 				if (!*field) // The end of the string has been reached.
@@ -11678,10 +12225,10 @@ ResultType Line::PerformLoopParse(ResultToken *aResultToken, Line *&aJumpToLine,
 		if (*omit_list && *field && *delimiters)  // If no delimiters, the omit_list has already been handled above.
 		{
 			// Process the omit list.
-			field = omit_leading_any(field, omit_list, field_end - field);
+			field = omit_leading_any(field, omit_set, field_end - field);
 			if (*field) // i.e. the above didn't remove all the chars due to them all being in the omit-list.
 			{
-				field_length = omit_trailing_any(field, omit_list, field_end - 1);
+				field_length = omit_trailing_any(field, omit_set, field_end - 1);
 				field[field_length] = '\0';  // Terminate here, but don't update field_end, since saved_char needs it.
 			}
 		}
@@ -11729,65 +12276,28 @@ ResultType Line::PerformLoopParseCSV(ResultToken *aResultToken, Line *&aJumpToLi
 
 	TCHAR omit_list[512];
 	tcslcpy(omit_list, ARG3, _countof(omit_list));
+	CharSet omit_set(omit_list);
 
 	ResultType result = CONDITION_FALSE;
 	Line *jump_to_line = nullptr;
-	TCHAR *field, *field_end, saved_char;
+	TCHAR *field, *field_end, *value_end, saved_char;
 	size_t field_length;
-	bool field_is_enclosed_in_quotes;
 	global_struct &g = *::g; // Primarily for performance in this case.
 
 	for (field = buf;;)
 	{
-		if (*field == '"')
-		{
-			// For each field, check if the optional leading double-quote is present.  If it is,
-			// skip over it since we always know it's the one that marks the beginning of
-			// the that field.  This assumes that a field containing escaped double-quote is
-			// always contained in double quotes, which is how Excel does it.  For example:
-			// """string with escaped quotes""" resolves to a literal quoted string:
-			field_is_enclosed_in_quotes = true;
-			++field;
-		}
-		else
-			field_is_enclosed_in_quotes = false;
-
-		for (field_end = field;;)
-		{
-			if (   !(field_end = _tcschr(field_end, field_is_enclosed_in_quotes ? '"' : ','))   )
-			{
-				// This is the last field in the string, so set field_end to the position of
-				// the zero terminator instead:
-				field_end = field + _tcslen(field);
-				break;
-			}
-			if (field_is_enclosed_in_quotes)
-			{
-				// The quote discovered above marks the end of the string if it isn't followed
-				// by another quote.  But if it is a pair of quotes, replace it with a single
-				// literal double-quote and then keep searching for the real ending quote:
-				if (field_end[1] == '"')  // A pair of quotes was encountered.
-				{
-					tmemmove(field_end, field_end + 1, _tcslen(field_end + 1) + 1); // +1 to include terminator.
-					++field_end; // Skip over the literal double quote that we just produced.
-					continue; // Keep looking for the "real" ending quote.
-				}
-				// Otherwise, this quote marks the end of the field, so just fall through and break.
-			}
-			// else field is not enclosed in quotes, so the comma discovered above must be a delimiter.
-			break;
-		}
-
-		saved_char = *field_end; // This can be the terminator, a comma, or a double-quote.
-		*field_end = '\0';  // Terminate here so that GetLoopField() will see the correct substring.
+		// See CsvParseField() for how quoted fields are handled.
+		field_end = CsvParseField(field, field, value_end, false);
+		saved_char = *field_end; // Either the terminator or a comma.
+		*value_end = '\0';  // Terminate here so that GetLoopField() will see the correct substring.
 
 		if (*omit_list && *field)
 		{
 			// Process the omit list.
-			field = omit_leading_any(field, omit_list, field_end - field);
+			field = omit_leading_any(field, omit_set, value_end - field);
 			if (*field) // i.e. the above didn't remove all the chars due to them all being in the omit-list.
 			{
-				field_length = omit_trailing_any(field, omit_list, field_end - 1);
+				field_length = omit_trailing_any(field, omit_set, value_end - 1);
 				field[field_length] = '\0';  // Terminate here, but don't update field_end, since we need its pos.
 			}
 		}
@@ -11799,20 +12309,7 @@ ResultType Line::PerformLoopParseCSV(ResultToken *aResultToken, Line *&aJumpToLi
 
 		if (!saved_char) // The last item in the list has just been processed, so the loop is done.
 			break;
-		if (saved_char == ',') // Set "field" to be the position of the next field.
-			field = field_end + 1;
-		else // saved_char must be a double-quote char.
-		{
-			field = field_end + 1;
-			if (!*field) // No more fields occur after this one.
-				break;
-			// Find the next comma, which must be a real delimiter since we're in between fields:
-			if (   !(field = _tcschr(field, ','))   ) // No more fields.
-				break;
-			// Set it to be the first character of the next field, which might be a double-quote
-			// or another comma (if the field is empty).
-			++field;
-		}
+		field = field_end + 1; // The first character of the next field, which might be a double-quote or another comma.
 		++g.mLoopIteration;
 	}
 	FREE_PARSE_MEMORY;
@@ -12380,6 +12877,7 @@ ResultType Script::PreprocessLocalVars(UserFunc &aFunc)
 
 ResultType Script::PreparseVarRefs()
 {
+	LoadPhaseTimer timer(LOAD_PHASE_PREPARSE_VAR_REFS);
 	for (mCurrentModule = mLastModule; mCurrentModule; mCurrentModule = mCurrentModule->mPrev)
 	{
 		if (!PreparseVarRefs(mCurrentModule->mFirstLine))
@@ -12563,10 +13061,18 @@ LPTSTR Script::ListKeyHistory(LPTSTR aBuf, int aBufSize) // aBufSize should be a
 			timer_list[--length] = '\0';  // Remove the last space if there was room enough for it to have been added.
 	}
 
+	UINT load_blocks, load_large, run_blocks, run_large, hs_blocks, hs_large;
+	size_t load_used, load_wasted, load_large_bytes, run_used, run_wasted, run_large_bytes, hs_used, hs_wasted, hs_large_bytes;
+	SimpleHeap::sDefault.GetStats(load_blocks, load_used, load_wasted, load_large, load_large_bytes);
+	SimpleHeap::sRuntime.GetStats(run_blocks, run_used, run_wasted, run_large, run_large_bytes);
+	Hotstring::sDynamicArena.GetStats(hs_blocks, hs_used, hs_wasted, hs_large, hs_large_bytes);
+
 	TCHAR LRtext[256];
 	aBuf += sntprintf(aBuf, aBufSize,
 		_T("Window: %s")
-		//"\r\nBlocks: %u"
+		_T("\r\nHeap (load): %u blocks, %u KB used, %u KB unused, %u large (%u KB)")
+		_T("\r\nHeap (runtime): %u blocks, %u KB used, %u KB unused, %u large (%u KB)")
+		_T("\r\nHeap (Hotstring()): %u blocks, %u KB used, %u KB unused, %u large (%u KB)")
 		_T("\r\nKeybd hook: %s")
 		_T("\r\nMouse hook: %s")
 		_T("\r\nEnabled Timers: %u of %u (%s)")
@@ -12576,7 +13082,9 @@ LPTSTR Script::ListKeyHistory(LPTSTR aBuf, int aBufSize) // aBufSize should be a
 		_T("\r\nModifiers (GetKeyState() now) = %s")
 		_T("\r\n")
 		, win_title
-		//, SimpleHeap::GetBlockCount()
+		, load_blocks, UINT(load_used / 1024), UINT(load_wasted / 1024), load_large, UINT(load_large_bytes / 1024)
+		, run_blocks, UINT(run_used / 1024), UINT(run_wasted / 1024), run_large, UINT(run_large_bytes / 1024)
+		, hs_blocks, UINT(hs_used / 1024), UINT(hs_wasted / 1024), hs_large, UINT(hs_large_bytes / 1024)
 		, g_KeybdHook == NULL ? _T("no") : _T("yes")
 		, g_MouseHook == NULL ? _T("no") : _T("yes")
 		, mTimerEnabledCount, mTimerCount, timer_list
@@ -28,6 +28,7 @@ GNU General Public License for more details.
 #include "resources/resource.h"  // For tray icon.
 #include "Debugger.h"
 #include "abi.h"
+#include "LoadProfiler.h"
 
 #include "os_version.h" // For the global OS_Version object
 EXTERN_OSVER; // For the access to the g_os version object without having to include globaldata.h
@@ -183,6 +184,7 @@ enum CommandIDs {CONTROL_ID_FIRST = IDCANCEL + 1
 #define ERR_INVALID_OPTION _T("Invalid option.") // Generic message used by the Gui system.
 #define ERR_GUI_NO_WINDOW _T("Gui has no window.")
 #define ERR_GUI_NOT_FOR_THIS_TYPE _T("Not supported for this control type.") // Used by GuiControl object and Control functions.
+#define ERR_LV_VIRTUAL _T("Not supported for a virtual ListView.") // Rows are determined by LV.SetDataSource().
 #define ERR_DYNAMIC_BLANK _T("This dynamic variable is blank.")
 #define ERR_DYNAMIC_UPVAR _T("This dynamic variable is not included in this closure.")
 #define ERR_DYNAMIC_NOT_FOUND _T("Variable not found.")
@@ -829,8 +831,11 @@ public:
 	LPTSTR ExpandExpression(int aArgIndex, ResultType &aResult, ResultToken *aResultToken
 		, LPTSTR &aTarget, LPTSTR &aDerefBuf, size_t &aDerefBufSize, LPTSTR aArgDeref[], size_t aExtraSize);
 	ResultType ExpandSingleArg(int aArgIndex, ResultToken &aResultToken, LPTSTR &aDerefBuf, size_t &aDerefBufSize);
+	static ExprTokenType *sInfix; // Buffer reused by ExpressionToPostfix() for each expression.
+	static int sInfixSize;
 	ResultType ExpressionToPostfix(ArgStruct &aArg);
-	ResultType ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix);
+	ResultType ExpressionToPostfix(ArgStruct &aArg, ExprTokenType *&aInfix, int &aInfixSize);
+	static void FreeInfixBuffer();
 	ResultType FinalizeExpression(ArgStruct &aArg);
 
 	static bool FileIsFilteredOut(LoopFilesStruct &aCurrentFile, FileLoopModeType aFileLoopMode);
@@ -1601,6 +1606,8 @@ class Closure : public Func
 	UserFunc *mFunc;
 	FreeVars *mVars;
 
+	friend class CycleCollector;
+
 public:
 	static Object *sPrototype;
 
@@ -1648,6 +1655,8 @@ class BoundFunc : public Func
 		SetBase(sPrototype);
 	}
 
+	friend class CycleCollector;
+
 public:
 	static Object *sPrototype;
 
@@ -2271,7 +2280,11 @@ public:
 	void PrintErrorStdOut(LPCTSTR aErrorText, int aLength = 0, LPCTSTR aFile = _T("*"));
 	void PrintErrorStdOut(LPCTSTR aErrorText, LPCTSTR aExtraInfo, FileIndexType aFileIndex, LineNumberType aLineNumber);
 #ifndef AUTOHOTKEYSC
+	void PrintLoadProfile();
+	void DumpPostfix();
 	bool mValidateThenExit;
+	bool mProfileLoad; // /ProfileLoad: Print the time spent in each phase of loading to stderr.
+	bool mDumpPostfix; // /DumpPostfix: Print the postfix form of each expression to stdout, then exit.
 	LPTSTR mCmdLineInclude;
 #endif
 
@@ -2586,7 +2599,9 @@ BIF_DECL(BIF_Chr);
 BIF_DECL(BIF_Format);
 BIF_DECL(BIF_FormatTime);
 BIF_DECL(BIF_NumGet);
+BIF_DECL(BIF_NumGetArray);
 BIF_DECL(BIF_NumPut);
+BIF_DECL(BIF_NumPutArray);
 BIF_DECL(BIF_StrGetPut);
 BIF_DECL(BIF_StrPtr);
 BIF_DECL(BIF_IsTypeish);
@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include "application.h" // for MsgSleep()
 #include "script_func_impl.h"
 #include "abi.h"
+#include "TextIO.h"
 
 
 
@@ -885,6 +886,43 @@ bif_impl void ListHotkeys()
 
 
 
+bif_impl FResult HookEventStats(optl<BOOL> aReset, IObject *&aRetVal)
+// Returns statistics about hotkey and hotstring events sent by the hook to the main thread.
+// Latencies are in microseconds, from the hook posting the event to the start of its thread.
+// Histogram[1] counts latencies below 1 microsecond, and Histogram[N] counts those from
+// 2**(N-2) up to 2**(N-1) microseconds (with the last element also counting anything larger).
+{
+	auto stats = Object::Create();
+	auto histogram = Array::Create();
+	if (!stats || !histogram)
+	{
+		if (stats)
+			stats->Release();
+		if (histogram)
+			histogram->Release();
+		return FR_E_OUTOFMEM;
+	}
+	auto &latency = g_HookEvents.mLatency;
+	for (int i = 0; i < LatencyHistogram::BucketCount; ++i)
+		histogram->Append((__int64)latency.mBucket[i]);
+	stats->SetOwnProp(_T("Count"), latency.mCount);
+	stats->SetOwnProp(_T("TotalLatency"), latency.mTotal);
+	stats->SetOwnProp(_T("MaxLatency"), latency.mMax);
+	stats->SetOwnProp(_T("Histogram"), histogram);
+	histogram->Release();
+	stats->SetOwnProp(_T("QueueDepth"), (__int64)g_HookEvents.Depth());
+	stats->SetOwnProp(_T("QueueHighWater"), (__int64)g_HookEvents.HighWater());
+	stats->SetOwnProp(_T("QueueCapacity"), (__int64)HookEventQueue::Capacity);
+	stats->SetOwnProp(_T("Overflows"), (__int64)g_HookEvents.Overflows());
+	stats->SetOwnProp(_T("Skipped"), (__int64)g_HookEvents.mSkipped);
+	if (aReset.value_or(FALSE))
+		g_HookEvents.ResetStats();
+	aRetVal = stats;
+	return OK;
+}
+
+
+
 bif_impl FResult KeyHistory(optl<int> aMaxEvents)
 {
 	if (!aMaxEvents.has_value())
@@ -908,6 +946,119 @@ bif_impl FResult KeyHistory(optl<int> aMaxEvents)
 
 
 
+bif_impl FResult KeyLog(optl<int> aCapacity, IObject *&aRetVal)
+// Sets the capacity of g_KeyEventLog if specified, discarding its records if the capacity changes,
+// and returns its status.  Records are numbered from 0 in the order they were logged; Oldest is
+// the number of the oldest record still available and Next is the number of the next one.
+{
+	if (aCapacity.has_value())
+	{
+		if (*aCapacity < 0 || *aCapacity > KEY_EVENT_LOG_MAX_CAPACITY)
+			return FR_E_ARG(0);
+		if (!g_KeyEventLog.SetCapacity(*aCapacity))
+			return FR_E_OUTOFMEM;
+	}
+	auto stats = Object::Create();
+	if (!stats)
+		return FR_E_OUTOFMEM;
+	stats->SetOwnProp(_T("Capacity"), (__int64)g_KeyEventLog.Capacity());
+	stats->SetOwnProp(_T("Oldest"), (__int64)g_KeyEventLog.Oldest());
+	stats->SetOwnProp(_T("Next"), (__int64)g_KeyEventLog.Next());
+	aRetVal = stats;
+	return OK;
+}
+
+
+
+bif_impl FResult KeyLogExport(StrArg aFileName, optl<StrArg> aFormat, optl<__int64> aStart, optl<__int64> aCount, __int64 &aRetVal)
+// Writes records from g_KeyEventLog to a file, either as CSV or in binary (the format and header are
+// described below).  Start defaults to the oldest available record and Count to all records from
+// there.  Returns the number of records written, which may be fewer than requested if some were
+// overwritten or had not been logged yet.
+{
+	bool binary = false;
+	if (aFormat.has_value() && *aFormat.value())
+	{
+		if (!_tcsicmp(aFormat.value(), _T("Bin")))
+			binary = true;
+		else if (_tcsicmp(aFormat.value(), _T("CSV")))
+			return FR_E_ARG(1);
+	}
+	if (aStart.has_value() && *aStart < 0)
+		return FR_E_ARG(2);
+	if (aCount.has_value() && *aCount < 0)
+		return FR_E_ARG(3);
+
+	unsigned __int64 oldest = g_KeyEventLog.Oldest(), next = g_KeyEventLog.Next();
+	unsigned __int64 start = aStart.has_value() && (unsigned __int64)*aStart > oldest ? *aStart : oldest;
+	unsigned __int64 end = aCount.has_value() && *aCount < (__int64)(next - start) ? start + *aCount : next;
+	if (start > end)
+		start = end;
+	KeyEventRecord *record = NULL;
+	if (end > start)
+	{
+		if (  !(record = (KeyEventRecord *)malloc((size_t)(end - start) * sizeof(KeyEventRecord)))  )
+			return FR_E_OUTOFMEM;
+		auto first_intact = g_KeyEventLog.Copy(start, end, record);
+		memmove(record, record + (first_intact - start), (size_t)(end - first_intact) * sizeof(KeyEventRecord));
+		start = first_intact;
+	}
+	size_t count = (size_t)(end - start);
+
+	TextFile tf;
+	if (!tf.Open(aFileName, TextStream::WRITE | TextStream::SHARE_READ, CP_UTF8))
+	{
+		free(record);
+		return FR_E_WIN32;
+	}
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	if (binary)
+	{
+		struct
+		{
+			char signature[8];
+			UINT version, record_size;
+			__int64 frequency; // Performance counter frequency for KeyEventRecord::time.
+			unsigned __int64 first_record, record_count;
+		} header = { {'A','H','K','K','E','Y','L','G'}, 3, sizeof(KeyEventRecord), freq.QuadPart, start, count };
+		tf.Write(&header, sizeof(header));
+		if (count)
+			tf.Write(record, (DWORD)(count * sizeof(KeyEventRecord)));
+	}
+	else
+	{
+		char buf[8192];
+		int length = sprintf_s(buf, "Record,Time,VK,SC,Type,Up,Mouse,Artificial,Ignored,Suppressed,InputLevel,HotkeyID\r\n");
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (length > (int)sizeof(buf) - 128) // Enough room for any line.
+			{
+				tf.Write((LPCVOID)buf, length);
+				length = 0;
+			}
+			auto &r = record[i];
+			__int64 us = r.time / freq.QuadPart * 1000000 + r.time % freq.QuadPart * 1000000 / freq.QuadPart;
+			char type[2] = { r.event_type == ' ' ? '\0' : (char)r.event_type, '\0' };
+			char hotkey_id[12] = "";
+			if (r.hotkey_id != HOTKEY_ID_INVALID)
+				sprintf_s(hotkey_id, "%u", (UINT)r.hotkey_id);
+			length += sprintf_s(buf + length, sizeof(buf) - length, "%I64u,%I64d,%u,%u,%s,%d,%d,%d,%d,%d,%u,%s\r\n"
+				, start + i, us, (UINT)r.vk, (UINT)r.sc, type
+				, (r.flags & KeyEventRecord::UP) != 0, (r.flags & KeyEventRecord::MOUSE) != 0
+				, (r.flags & KeyEventRecord::ARTIFICIAL) != 0, (r.flags & KeyEventRecord::IGNORED) != 0
+				, (r.flags & KeyEventRecord::SUPPRESSED) != 0, (UINT)r.input_level, hotkey_id);
+		}
+		tf.Write((LPCVOID)buf, length);
+	}
+	tf.Close();
+	free(record);
+	aRetVal = (__int64)count;
+	return OK;
+}
+
+
+
 DWORD GetAHKInstallDir(LPTSTR aBuf)
 // Caller must pass a buffer of MAX_PATH characters.
 // Returns the length of the string (0 if empty).
@@ -2472,6 +2623,20 @@ bif_impl FResult BIF_Hotkey(StrArg aName, ExprTokenType *aAction, optl<StrArg> a
 
 
 
+bif_impl void HotkeyBatch(optl<BOOL> aBegin, int &aRetVal)
+// Begins or ends a batch of Hotkey() and Hotstring() calls, during which the (potentially costly)
+// reevaluation of all hotkeys and hooks is deferred until the outermost batch ends.  Other changes,
+// such as Suspend, still take effect immediately.  Any batches left open are ended when the script
+// becomes idle.  Returns the number of batches in progress.
+{
+	if (!aBegin.has_value())
+		aRetVal = Hotkey::ManifestBatchDepth();
+	else
+		aRetVal = aBegin.value() ? Hotkey::BeginManifestBatch() : Hotkey::EndManifestBatch();
+}
+
+
+
 void SetHotIfReturnValue(ResultToken &aResultToken);
 
 bif_impl FResult HotIf(ExprTokenType *aCriterion, ResultToken &aResultToken)
@@ -3541,18 +3706,8 @@ ResultType TokenToDoubleOrInt64(const ExprTokenType &aInput, ExprTokenType &aOut
 			return FAIL;
 	}
 	// Since above didn't return, interpret "str" as a number.
-	switch (aOutput.symbol = IsNumeric(str, true, false, true))
-	{
-	case PURE_INTEGER:
-		aOutput.value_int64 = ATOI64(str);
-		break;
-	case PURE_FLOAT:
-		aOutput.value_double = _tstof(str); // _tstof() vs. ATOF() because PURE_FLOAT is never hexadecimal.
-		break;
-	default: // Not a pure number.
-		return FAIL;
-	}
-	return OK; // Since above didn't return, indicate success.
+	aOutput.symbol = ParseNumeric(str, aOutput.value_int64, aOutput.value_double);
+	return aOutput.symbol == PURE_NOT_NUMERIC ? FAIL : OK;
 }
 
 
@@ -639,7 +639,9 @@ ObjectMemberMd GuiControlType::sMembersLV[] =
 	md_member_x(GuiControlType, InsertCol, LV_InsertCol, CALL, (In_Opt, Int32, Column), (In_Opt, String, Options), (In_Opt, String, Title), (Ret, Int32, RetVal)),
 	md_member_x(GuiControlType, ModifyCol, LV_ModifyCol, CALL, (In_Opt, Int32, Column), (In_Opt, String, Options), (In_Opt, String, Title)),
 	md_member_x(GuiControlType, DeleteCol, LV_DeleteCol, CALL, (In, Int32, Column)),
-	md_member_x(GuiControlType, SetImageList, LV_SetImageList, CALL, (In, UIntPtr, ImageListID), (In_Opt, Int32, IconType), (Ret, UIntPtr, RetVal))
+	md_member_x(GuiControlType, SetImageList, LV_SetImageList, CALL, (In, UIntPtr, ImageListID), (In_Opt, Int32, IconType), (Ret, UIntPtr, RetVal)),
+	md_member_x(GuiControlType, AddRows, LV_AddRows, CALL, (In, Object, Rows), (In_Opt, String, Options), (Ret, Int32, RetVal)),
+	md_member_x(GuiControlType, SetDataSource, LV_SetDataSource, CALL, (In, Object, Source), (In_Opt, Int32, RowCount))
 };
 
 ObjectMemberMd GuiControlType::sMembersTV[] =
@@ -2371,7 +2373,11 @@ void GuiControlType::Dispose()
 			DeleteObject(union_hbitmap);
 	}
 	else if (type == GUI_CONTROL_LISTVIEW) // It was ensured at an earlier stage that union_lv_attrib != NULL.
+	{
+		LV_FreeDataSource();
+		delete union_lv_attrib->row_cache;
 		free(union_lv_attrib);
+	}
 	else if (type == GUI_CONTROL_ACTIVEX && union_object)
 		union_object->Release();
 	//else do nothing, since this type has nothing more than a color stored in the union.
@@ -5656,6 +5662,8 @@ ResultType GuiType::ControlParseOptions(LPCTSTR aOptions, GuiControlOptionsType
 		}
 		else if (aControl.type == GUI_CONTROL_LISTVIEW && !_tcsicmp(option, _T("Grid")))
 			if (adding) aOpt.listview_style |= LVS_EX_GRIDLINES; else aOpt.listview_style &= ~LVS_EX_GRIDLINES;
+		else if (aControl.type == GUI_CONTROL_LISTVIEW && !_tcsicmp(option, _T("Virtual"))) // Rows are provided by LV.SetDataSource().
+			if (adding) aOpt.style_add |= LVS_OWNERDATA; else aOpt.style_remove |= LVS_OWNERDATA; // Can't be changed after the control is created.
 		else if (!_tcsnicmp(option, _T("Count"), 5)) // Script should only provide the option for ListViews.
 			aOpt.limit = ATOI(option + 5); // For simplicity, the value of "adding" is ignored.
 		else if (!_tcsnicmp(option, _T("LV"), 2) && ParsePositiveInteger(option + 2, option_dword))
@@ -8623,6 +8631,16 @@ LRESULT CALLBACK GuiWindowProc(HWND hWnd, UINT iMsg, WPARAM wParam, LPARAM lPara
 
 			case LVN_DELETEALLITEMS:
 				return TRUE; // For performance, tell it not to notify us as each individual item is deleted.
+
+			// Virtual ListView notifications:
+			case LVN_GETDISPINFO:
+				control.LV_GetDispInfo(*(NMLVDISPINFO *)lParam);
+				return 0;
+			case LVN_ODCACHEHINT:
+				control.LV_CacheHint(*(NMLVCACHEHINT *)lParam);
+				return 0;
+			case LVN_ODFINDITEM:
+				return -1; // Incremental search by typing isn't supported, so report that no item was found.
 			} // switch(nmhdr.code).
 			break;
 
@@ -10894,6 +10912,8 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 	lv_attrib_type &lv_attrib = *aControl.union_lv_attrib;
 	lv_col_type &col = lv_attrib.col[aColumnIndex];
 
+	if (aControl.LV_IsVirtual()) // Virtual ListViews can't be sorted by the control; the data source determines the order.
+		return;
 	int item_count = ListView_GetItemCount(aControl.hwnd);
 	if ((col.sort_disabled && aSortOnlyIfEnabled) || item_count < 2) // This column cannot be sorted or doesn't need to be.
 		return; // Below relies on having returned here when control is empty or contains 1 item.
@@ -18,6 +18,7 @@ GNU General Public License for more details.
 
 #include "stdafx.h" // pre-compiled headers
 #include "script.h"
+#include "ListViewRowCache.h"
 
 
 #define GUI_INDEX_TO_ID(index) (index + CONTROL_ID_FIRST)
@@ -85,6 +86,9 @@ struct lv_attrib_type
 	lv_col_type col[LV_MAX_COLUMNS];
 	int col_count; // Number of columns currently in the above array.
 	int row_count_hint;
+	IObject *data_source; // For virtual (LVS_OWNERDATA) ListViews: an Array of rows or a function which returns a row.
+	int data_row_count;
+	ListViewRowCache *row_cache; // Only allocated when data_source is a function.
 };
 
 typedef UCHAR TabControlIndexType;
@@ -287,6 +291,13 @@ struct GuiControlType : public Object
 	FResult LV_GetNext(optl<int> aStartIndex, optl<StrArg> aRowType, int &aRetVal);
 	FResult LV_GetText(int aRow, optl<int> aColumn, StrRet &aRetVal);
 	FResult LV_SetImageList(UINT_PTR aImageListID, optl<int> aIconType, UINT_PTR &aRetVal);
+	FResult LV_AddRows(IObject *aRows, optl<StrArg> aOptions, int &aRetVal);
+	FResult LV_SetDataSource(IObject *aSource, optl<int> aRowCount);
+	void LV_GetDispInfo(NMLVDISPINFO &aInfo);
+	void LV_CacheHint(NMLVCACHEHINT &aHint);
+	void LV_FreeDataSource();
+	bool LV_IsVirtual() { return (GetWindowLong(hwnd, GWL_STYLE) & LVS_OWNERDATA) != 0; }
+	bool LV_CacheRow(int aRow);
 	
 	FResult SB_SetIcon(StrArg aFilename, optl<int> aIconNumber, optl<UINT> aPartNumber, UINT_PTR &aRetVal);
 	FResult SB_SetParts(VariantParams &aParam, UINT& aRetVal);
@@ -253,7 +253,7 @@ Map *Map::CloneTo(Map &obj)
 	int failure_count = 0; // See Object::CloneT() for comments.
 	index_t i;
 
-	obj.mFlags = mFlags;
+	obj.mFlags = mFlags & ~PossibleCycleRoot; // The clone isn't in CycleCollector's root buffer.
 	obj.mCount = mCount;
 	obj.mKeyOffsetObject = mKeyOffsetObject;
 	obj.mKeyOffsetString = mKeyOffsetString;
@@ -525,6 +525,8 @@ void Object::CallNestedDelete()
 
 Object::~Object()
 {
+	if (mFlags & PossibleCycleRoot)
+		CycleCollector::RemoveRoot(this);
 	if (mNested)
 	{
 		// Nested objects have been "destructed" but not actually deleted yet.
@@ -1517,7 +1519,7 @@ void Map::Capacity(ResultToken &aResultToken, int aID, int aFlags, ExprTokenType
 	{
 		if (mItem)
 		{
-			free(mItem);
+			ObjectPool::Free(mItem, mCapacity * sizeof(Pair));
 			mItem = nullptr;
 			mCapacity = 0;
 		}
@@ -2324,7 +2326,7 @@ ResultType Array::SetCapacity(index_t aNewCapacity)
 {
 	if (mLength > aNewCapacity)
 		RemoveAt(aNewCapacity, mLength - aNewCapacity);
-	auto new_item = (Variant *)realloc(mItem, sizeof(Variant) * aNewCapacity);
+	auto new_item = (Variant *)ObjectPool::Realloc(mItem, sizeof(Variant) * mCapacity, sizeof(Variant) * aNewCapacity);
 	if (!new_item && aNewCapacity)
 		return FAIL;
 	mItem = new_item;
@@ -2409,7 +2411,7 @@ ResultType Array::SetLength(index_t aNewLength)
 Array::~Array()
 {
 	RemoveAt(0, mLength);
-	free(mItem);
+	ObjectPool::Free(mItem, sizeof(Variant) * mCapacity);
 }
 
 Array *Array::Create(ExprTokenType *aValue[], index_t aCount)
@@ -2790,7 +2792,7 @@ ResultType Object::PropEnum::Next(Var *aName, Var *aVal)
 				++mIndex[testidx]; // Skip this property.
 				continue;
 			}
-			int r = nextobj ? _tcsicmp(testfld.name, nextobj->mFields[mIndex[nextidx]].name) : -1;
+			int r = nextobj ? ctcsicmp(testfld.name, nextobj->mFields[mIndex[nextidx]].name) : -1;
 			if (r < 0)
 			{
 				nextidx = testidx;
@@ -2866,6 +2868,23 @@ ResultType Map::GetEnumItem(UINT &aIndex, Var *aKey, Var *aVal, int aVarCount)
 }
 
 
+// Retrieves the key and value at the given position in enumeration order, without copying them.
+bool Map::ItemToToken(index_t aIndex, ExprTokenType &aKey, ExprTokenType &aValue)
+{
+	if (aIndex >= mCount)
+		return false;
+	auto &item = mItem[aIndex];
+	if (aIndex < mKeyOffsetObject)
+		aKey.SetValue(item.key.i);
+	else if (aIndex < mKeyOffsetString)
+		aKey.SetValue(item.key.p);
+	else
+		aKey.SetValue(item.key.s);
+	item.ToToken(aValue);
+	return true;
+}
+
+
 ResultType RegExMatchObject::GetEnumItem(UINT &aIndex, Var *aKey, Var *aVal, int aVarCount)
 {
 	if (aIndex >= (UINT)mPatternCount)
@@ -2932,14 +2951,14 @@ Object::FieldType *Object::FindField(name_t name, index_t &insert_pos)
 		FieldType &field = mFields[mid];
 		
 		// key_c contains the lower-case version of field.name[0].  Checking key_c first
-		// allows the _tcsicmp() call to be skipped whenever the first character differs.
+		// allows the ctcsicmp() call to be skipped whenever the first character differs.
 		// This also means that .name isn't dereferenced, which means one less potential
 		// CPU cache miss (where we wait for the data to be pulled from RAM into cache).
 		// field.key_c might cause a cache miss, but it's very likely that key.s will be
 		// read into cache at the same time (but only the pointer value, not the chars).
 		int result = first_char - field.key_c;
 		if (!result)
-			result = _tcsicmp(name, field.name);
+			result = ctcsicmp(name, field.name);
 		
 		if (result < 0)
 			right = mid;
@@ -3003,7 +3022,7 @@ Map::Pair *Map::FindItem(LPTSTR val, index_t left, index_t right, index_t &inser
 		int result = first_char - item.key_c;
 		if (!result)
 			result = !caseless ? _tcscmp(val, item.key.s)
-				: use_locale ? lstrcmpi(val, item.key.s) : _tcsicmp(val, item.key.s);
+				: use_locale ? lstrcmpi(val, item.key.s) : ctcsicmp(val, item.key.s);
 
 		if (result < 0)
 			right = mid;
@@ -3098,7 +3117,7 @@ bool Object::SetInternalCapacity(index_t new_capacity)
 bool Map::SetInternalCapacity(index_t new_capacity)
 // Caller *must* ensure new_capacity >= 1 && new_capacity >= mCount.
 {
-	Pair *new_fields = (Pair *)realloc(mItem, new_capacity * sizeof(Pair));
+	Pair *new_fields = (Pair *)ObjectPool::Realloc(mItem, mCapacity * sizeof(Pair), new_capacity * sizeof(Pair));
 	if (!new_fields)
 		return false;
 	mItem = new_fields;
@@ -3470,9 +3489,44 @@ BufferObject *BufferObject::Create(void *aData, size_t aSize)
 	return obj;
 }
 
+// Creates a Buffer which refers to part of aOwner's memory rather than owning a copy.  The owner
+// is kept alive by the view, and can't be resized until all of its views have been released.
+BufferObject *BufferObject::CreateView(BufferObject *aOwner, size_t aOffset, size_t aSize)
+{
+	auto obj = Create((char *)aOwner->mData + aOffset, aSize);
+	if (aOwner->mOwner) // Views of views refer directly to the original buffer.
+		aOwner = aOwner->mOwner;
+	aOwner->AddRef();
+	++aOwner->mViewCount;
+	obj->mOwner = aOwner;
+	return obj;
+}
+
+// Creates a Buffer for a view of a file mapping, which is unmapped when the Buffer is deleted.
+BufferObject *BufferObject::CreateMapped(void *aData, size_t aSize)
+{
+	auto obj = Create(aData, aSize);
+	obj->mMapped = true;
+	return obj;
+}
+
+BufferObject::~BufferObject()
+{
+	if (mOwner)
+	{
+		--mOwner->mViewCount;
+		mOwner->Release();
+	}
+	else if (mMapped)
+		UnmapViewOfFile(mData);
+	else
+		free(mData);
+}
+
 ObjectMember BufferObject::sMembers[] =
 {
 	Object_Method(__New, 0, 2),
+	Object_Method(Slice, 0, 2),
 	Object_Property_get(Ptr),
 	Object_Property_get_set(Size)
 };
@@ -3496,6 +3550,8 @@ void BufferObject::Invoke(ResultToken &aResultToken, int aID, int aFlags, ExprTo
 				auto new_size = ParamIndexToInt64(0);
 				if (new_size < 0 || new_size > SIZE_MAX)
 					_o_throw_value(ERR_INVALID_VALUE);
+				if ((size_t)new_size != mSize && !IsResizable())
+					_o_throw(_T("This Buffer cannot be resized."));
 				if (!Resize((size_t)new_size))
 					_o_throw_oom;
 			}
@@ -3508,6 +3564,30 @@ void BufferObject::Invoke(ResultToken &aResultToken, int aID, int aFlags, ExprTo
 			return;
 		}
 		_o_return(mSize);
+	case M_Slice: // Slice(Offset := 0, Size := this.Size - Offset)
+	{
+		size_t offset = 0, size;
+		if (!ParamIndexIsOmitted(0))
+		{
+			if (!ParamIndexIsNumeric(0))
+				_o_throw_param(0, _T("Number"));
+			auto n = ParamIndexToInt64(0);
+			if (n < 0 || (unsigned __int64)n > mSize)
+				_o_throw_param(0);
+			offset = (size_t)n;
+		}
+		size = mSize - offset;
+		if (!ParamIndexIsOmitted(1))
+		{
+			if (!ParamIndexIsNumeric(1))
+				_o_throw_param(1, _T("Number"));
+			auto n = ParamIndexToInt64(1);
+			if (n < 0 || (unsigned __int64)n > size)
+				_o_throw_param(1);
+			size = (size_t)n;
+		}
+		_o_return(CreateView(this, offset, size));
+	}
 	}
 }
 
@@ -3568,7 +3648,14 @@ void ClipboardAll::__New(ResultToken &aResultToken, int aID, int aFlags, ExprTok
 		memcpy(data, (void *)caller_data, size);
 	}
 	if (mData != data)
+	{
+		if (!IsResizable()) // Explicit call to __New on a Buffer which has views.
+		{
+			free(data);
+			_o_throw(_T("This Buffer cannot be resized."));
+		}
 		free(mData); // In case of explicit call to __New.
+	}
 	mData = data;
 	mSize = size;
 }
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "MdType.h"
+#include "CycleCollector.h"
+#include "ObjectPool.h"
 
 #define INVOKE_TYPE			(aFlags & IT_BITMASK)
 #define IS_INVOKE_SET		(aFlags & IT_SET)
@@ -157,7 +159,7 @@ public:
 		if (data->size)
 		{
 			FreeRange(0, data->length);
-			free(data);
+			ObjectPool::Free(data, data->size * sizeof(T) + sizeof(Data));
 			data = &Empty;
 		}
 	}
@@ -167,7 +169,8 @@ public:
 		index_t length = data->length;
 		ASSERT(new_size > 0 && new_size >= length);
 		Data *d = data->size ? data : nullptr;
-		if (  !(d = (Data *)realloc(d, new_size * sizeof(T) + sizeof(Data)))  )
+		size_t old_bytes = d ? d->size * sizeof(T) + sizeof(Data) : 0;
+		if (  !(d = (Data *)ObjectPool::Realloc(d, old_bytes, new_size * sizeof(T) + sizeof(Data)))  )
 			return false;
 		data = d;
 		data->size = new_size;
@@ -350,7 +353,8 @@ protected:
 		DataIsStructInfo = 0x10,
 		StructInfoLocked = 0x20,
 		NoCallDelete = 0x40,
-		LastObjectFlag = 0x40
+		PossibleCycleRoot = 0x80, // This object is in CycleCollector's root buffer.
+		LastObjectFlag = 0x80
 	};
 
 	Object *CloneTo(Object &aTo);
@@ -358,6 +362,8 @@ protected:
 	~Object();
 	bool Delete() override;
 
+	friend class CycleCollector;
+
 private:
 	Object *mBase = nullptr;
 	FlatVector<FieldType, index_t> mFields;
@@ -404,6 +410,20 @@ protected:
 
 public:
 
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		// A reference being released without the object being deleted might have been the last external
+		// reference to a cycle, so let the collector know (if it is enabled).
+		if (mRefCount > 1 && CycleCollector::IsEnabled() && !(mFlags & PossibleCycleRoot))
+			CycleCollector::AddRoot(this);
+		return ObjectBase::Release();
+	}
+
+	// Objects are typically small and short-lived, so they are allocated from the pool.  Since ObjectBase
+	// has a virtual destructor, the size passed to delete is that of the most-derived class.
+	void *operator new(size_t aBytes) { return ObjectPool::Alloc(aBytes); }
+	void operator delete(void *aPtr, size_t aBytes) { ObjectPool::Free(aPtr, aBytes); }
+
 	static Object *Create();
 	static Object *Create(ExprTokenType *aParam[], int aParamCount, ResultToken *apResultToken = nullptr);
 	static Object *CreateStructPtr(UINT_PTR aPtr, Object *aBase, ResultToken &aResultToken);
@@ -659,11 +679,12 @@ private:
 	index_t mLength = 0, mCapacity = 0;
 
 	ResultType SetCapacity(index_t aNewCapacity);
-	ResultType EnsureCapacity(index_t aRequired);
 
 	index_t ParamToZeroIndex(ExprTokenType &aParam);
 
 	Array() {}
+
+	friend class CycleCollector;
 	
 public:
 	enum : index_t
@@ -676,6 +697,7 @@ public:
 	index_t Capacity() { return mCapacity; }
 	
 	ResultType SetLength(index_t aNewLength);
+	ResultType EnsureCapacity(index_t aRequired);
 
 	template<typename TokenT>
 	ResultType InsertAt(index_t aIndex, TokenT aValue[], index_t aCount);
@@ -763,7 +785,7 @@ class Map : public Object
 	~Map()
 	{
 		Clear();
-		free(mItem);
+		ObjectPool::Free(mItem, mCapacity * sizeof(Pair));
 	}
 	 
 	Pair *FindItem(LPTSTR val, index_t left, index_t right, index_t &insert_pos);
@@ -787,9 +809,14 @@ class Map : public Object
 
 	ResultType GetEnumItem(UINT &aIndex, Var *, Var *, int);
 
+	friend class CycleCollector;
+
 public:
 	static Map *Create(ExprTokenType *aParam[] = NULL, int aParamCount = 0);
 
+	index_t Count() { return mCount; }
+	bool ItemToToken(index_t aIndex, ExprTokenType &aKey, ExprTokenType &aValue);
+
 	bool HasItem(ExprTokenType &aKey)
 	{
 		return GetItem(ExprTokenType(), aKey); // Conserves code size vs. calling FindItem() directly and is unlikely to perform worse.
@@ -934,24 +961,31 @@ private:
 protected:
 	void *mData;
 	size_t mSize;
+	BufferObject *mOwner = nullptr; // If non-null, this is a view of part of mOwner's memory.
+	UINT mViewCount = 0; // Number of views of this buffer, which prevent its memory from being reallocated.
+	bool mMapped = false; // mData is a view of a file mapping, so must be unmapped rather than freed.
 	BufferObject(void *aData = nullptr, size_t aSize = 0) : mData(aData), mSize(aSize) {}
 
 public:
 	void *Data() { return mData; }
 	size_t Size() { return mSize; }
 	ResultType Resize(size_t aNewSize);
+	bool IsResizable() { return !mOwner && !mViewCount && !mMapped; }
 
-	~BufferObject() { free(mData); }
+	~BufferObject();
 
 	enum MemberID
 	{
 		P_Ptr,
 		P_Size,
 		M___New = P_Size,
+		M_Slice
 	};
 	static ObjectMember sMembers[];
 	static Object *sPrototype;
 	static BufferObject *Create(void *aData = nullptr, size_t aSize = 0);
+	static BufferObject *CreateView(BufferObject *aOwner, size_t aOffset, size_t aSize);
+	static BufferObject *CreateMapped(void *aData, size_t aSize);
 	void Invoke(ResultToken &aResultToken, int aID, int aFlags, ExprTokenType *aParam[], int aParamCount);
 
 	static void *sVTable;
@@ -356,3 +356,57 @@ FResult Object::FreeDataPtr()
 	return OK;
 }
 #endif
+
+
+//
+// Cycle collector
+//
+
+bif_impl FResult ObjCollectCycles()
+{
+	// Collecting now could free objects which are referenced only by the expression stacks of
+	// running threads, so defer it until all threads have finished, or until the auto-execute thread
+	// reaches the next line at global scope.
+	CycleCollector::Request();
+	return OK;
+}
+
+
+bif_impl FResult ObjCycleCollector(optl<int> aThreshold, IObject *&aRetVal)
+{
+	if (aThreshold.has_value())
+	{
+		if (*aThreshold < 0)
+			return FR_E_ARG(0);
+		CycleCollector::SetThreshold(*aThreshold);
+	}
+	auto stats = Object::Create();
+	if (!stats)
+		return FR_E_OUTOFMEM;
+	stats->SetOwnProp(_T("Threshold"), (__int64)CycleCollector::sThreshold);
+	stats->SetOwnProp(_T("Pending"), (__int64)CycleCollector::RootCount());
+	stats->SetOwnProp(_T("Collections"), (__int64)CycleCollector::sCollections);
+	stats->SetOwnProp(_T("LastFreed"), (__int64)CycleCollector::sLastFreed);
+	stats->SetOwnProp(_T("TotalFreed"), CycleCollector::sTotalFreed);
+	stats->SetOwnProp(_T("LastTime"), CycleCollector::sLastTime);
+	stats->SetOwnProp(_T("MaxTime"), CycleCollector::sMaxTime);
+	stats->SetOwnProp(_T("TotalTime"), CycleCollector::sTotalTime);
+	aRetVal = stats;
+	return OK;
+}
+
+
+bif_impl FResult ObjPoolStats(IObject *&aRetVal)
+{
+	auto stats = Object::Create();
+	if (!stats)
+		return FR_E_OUTOFMEM;
+	stats->SetOwnProp(_T("PoolAllocs"), ObjectPool::sPoolAllocs);
+	stats->SetOwnProp(_T("HeapAllocs"), ObjectPool::sHeapAllocs);
+	stats->SetOwnProp(_T("Frees"), ObjectPool::sFrees);
+	stats->SetOwnProp(_T("InUse"), ObjectPool::sInUse);
+	stats->SetOwnProp(_T("Chunks"), (__int64)ObjectPool::sChunkCount);
+	stats->SetOwnProp(_T("ChunkSize"), (__int64)ObjectPool::ChunkSize);
+	aRetVal = stats;
+	return OK;
+}
@@ -29,6 +29,7 @@
 #include "globaldata.h"
 #include "script_func_impl.h"
 #include "abi.h"
+#include "IniCache.h"
 
 
 bif_impl FResult IniRead(StrArg aFilespec, optl<StrArg> aSection, optl<StrArg> aKey, optl<StrArg> aDefault, StrRet &aRetVal)
@@ -45,6 +46,16 @@ bif_impl FResult IniRead(StrArg aFilespec, optl<StrArg> aSection, optl<StrArg> a
 	{
 		if (!aSection.has_value()) // But an explicit "" acceptable (see below).
 			return FR_E_ARG(1);
+#ifdef UNICODE
+		LPCTSTR value;
+		size_t value_length;
+		if (IniCacheLookup(szFileTemp, aSection.value(), aKey.value(), value, value_length)
+			&& value_length < _countof(szBuffer)) // Otherwise, let the API truncate it.
+		{
+			g->LastError = 0;
+			return aRetVal.Copy(value, value_length) ? OK : FR_E_OUTOFMEM;
+		}
+#endif
 		// An access violation can occur if the following conditions are met:
 		//	1) aFilespec specifies a Unicode file.
 		//	2) aSection is a read-only string, either empty or containing only spaces.
@@ -162,6 +173,7 @@ bif_impl FResult IniWrite(StrArg aValue, StrArg aFilespec, StrArg aSection, optl
 			WritePrivateProfileString(NULL, NULL, NULL, szFileTemp);	// Flush
 #ifdef UNICODE
 	}
+	IniCacheInvalidate(szFileTemp);
 #endif
 	return result ? OK : FR_E_WIN32;
 }
@@ -178,6 +190,9 @@ bif_impl FResult IniDelete(StrArg aFilespec, StrArg aSection, optl<StrArg> aKey)
 	BOOL result = WritePrivateProfileString(aSection, aKey.value_or_null(), NULL, szFileTemp);  // Returns zero on failure.
 	g->LastError = GetLastError();
 	WritePrivateProfileString(NULL, NULL, NULL, szFileTemp);	// Flush
+#ifdef UNICODE
+	IniCacheInvalidate(szFileTemp);
+#endif
 	return result ? OK : FR_E_WIN32(g->LastError);
 }
 
@@ -323,112 +323,6 @@ __int64 FileTimeSecondsUntil(FILETIME *pftStart, FILETIME *pftEnd)
 
 
 
-SymbolType IsNumeric(LPCTSTR aBuf, BOOL aAllowNegative, BOOL aAllowAllWhitespace
-	, BOOL aAllowFloat, BOOL aAllowImpure)  // BOOL vs. bool might squeeze a little more performance out of this frequently-called function.
-// String can contain whitespace.
-// If aBuf doesn't contain something purely numeric, PURE_NOT_NUMERIC is returned.  The same happens if
-// aBuf contains a float but aAllowFloat is false.  (The aAllowFloat parameter isn't strictly necessary
-// because the caller could just check whether the return value is/isn't PURE_FLOAT to get the same effect.
-// However, supporting aAllowFloat seems to greatly improve maintainability because it saves many callers
-// from having to compare the return value to PURE_INTEGER [they can just interpret the return value as BOOL].
-// It also improves readability due to the "Is" part of the function name.  So it seems worth keeping.)
-// Otherwise, PURE_INTEGER or PURE_FLOAT is returned.
-// If aAllowAllWhitespace==true and the string is blank or all whitespace, PURE_INTEGER is returned.
-// Obsolete comment: Making this non-inline reduces the size of the compressed EXE by only 2K.  Since this
-// function is called so often, it seems preferable to keep it inline for performance.
-{
-	aBuf = omit_leading_whitespace(aBuf); // i.e. caller doesn't have to have ltrimmed, only rtrimmed.
-	if (!*aBuf) // The string is empty or consists entirely of whitespace.
-		return aAllowAllWhitespace ? PURE_INTEGER : PURE_NOT_NUMERIC;
-
-	if (*aBuf == '-')
-	{
-		if (aAllowNegative)
-			++aBuf;
-		else
-			return PURE_NOT_NUMERIC;
-	}
-	else if (*aBuf == '+')
-		++aBuf;
-
-	// Relies on short circuit boolean order to prevent reading beyond the end of the string:
-	BOOL is_hex = IS_HEX(aBuf); // BOOL vs. bool might squeeze a little more performance out this frequently-called function.
-	if (is_hex)
-		aBuf += 2;  // Skip over the 0x prefix.
-
-	// Set defaults:
-	BOOL has_decimal_point = false;
-	BOOL has_exponent = false;
-	BOOL has_at_least_one_digit = false; // i.e. a string consisting of only "+", "-" or "." is not considered numeric.
-	int c; // int vs. char might squeeze a little more performance out of it (it does reduce code size by 5 bytes). Probably must stay signed vs. unsigned for some of the uses below.
-
-	for (;; ++aBuf)
-	{
-		c = *aBuf;
-		if (IS_SPACE_OR_TAB(c))
-		{
-			if (*omit_leading_whitespace(aBuf)) // But that space or tab is followed by something other than whitespace.
-				if (!aAllowImpure) // e.g. "123 456" is not a valid pure number.
-					return PURE_NOT_NUMERIC;
-				// else fall through to the bottom logic.
-			// else since just whitespace at the end, the number qualifies as pure, so fall through to the bottom
-			// logic (it would already have returned in the loop if it was impure)
-			break;
-		}
-		if (!c) // End of string was encountered.
-			break; // The number qualifies as pure, so fall through to the logic at the bottom. (It would already have returned elsewhere in the loop if the number is impure).
-		if (c == '.')
-		{
-			if (!aAllowFloat || has_decimal_point || is_hex) // If aAllowFloat==false, a decimal point at the very end of the number is considered non-numeric even if aAllowImpure==true.  Some callers might rely on this.
-				// i.e. if aBuf contains 2 decimal points, it can't be a valid number.
-				// Note that decimal points are allowed in hexadecimal strings, e.g. 0xFF.EE.
-				// But since that format doesn't seem to be supported by VC++'s atof() and probably
-				// related functions, and since it's extremely rare, it seems best not to support it.
-				return PURE_NOT_NUMERIC;
-			else
-				has_decimal_point = true;
-		}
-		else
-		{
-			if (is_hex ? !_istxdigit(c) : (c < '0' || c > '9')) // And since we're here, it's not '.' either.
-			{
-				if (aAllowImpure) // Since aStr starts with a number (as verified above), it is considered a number.
-				{
-					if (has_at_least_one_digit)
-						return has_decimal_point ? PURE_FLOAT : PURE_INTEGER;
-					else // i.e. the strings "." and "-" are not considered to be numeric by themselves.
-						return PURE_NOT_NUMERIC;
-				}
-				else
-				{
-					if (ctoupper(c) != 'E' // v1.0.46.11: Support scientific notation in floating point numbers.
-						|| !has_at_least_one_digit // But it must have at least one digit to the left of the 'E'. Some callers rely on this check.
-						|| has_exponent
-						|| !aAllowFloat)
-						return PURE_NOT_NUMERIC;
-					if (aBuf[1] == '-' || aBuf[1] == '+') // The optional sign is present on the exponent.
-						++aBuf; // Omit it from further consideration so that the outer loop doesn't see it as an extra/illegal sign.
-					if (aBuf[1] < '0' || aBuf[1] > '9')
-						// Even if it is an 'e', ensure what follows it is a valid exponent.  Some callers rely
-						// on this check, such as ones that expect "0.6e" to be non-numeric.
-						return PURE_NOT_NUMERIC;
-					has_exponent = true;
-					has_decimal_point = true; // For simplicity, since a decimal point after the exponent isn't valid.
-				}
-			}
-			else // This character is a valid digit or hex-digit.
-				has_at_least_one_digit = true;
-		}
-	} // for()
-
-	if (has_at_least_one_digit)
-		return has_decimal_point ? PURE_FLOAT : PURE_INTEGER;
-	else
-		return PURE_NOT_NUMERIC; // i.e. the strings "+" "-" and "." are not numeric by themselves.
-}
-
-
-
 void strlcpy(LPSTR aDst, LPCSTR aSrc, size_t aDstSize) // Non-inline because it benches slightly faster that way.
 // Caller must ensure that aDstSize is greater than 0.
 // Caller must ensure that the entire capacity of aDst is writable, EVEN WHEN it knows that aSrc is much shorter
@@ -904,173 +798,6 @@ ret0:
 
 
 
-template<typename T> T digitsTo(LPCTSTR p, LPCTSTR &end)
-{
-	T i = 0;
-	for (;; ++p)
-	{
-		int c = *p;
-		if (c <= '9' && c >= '0')
-			c -= '0';
-		else
-			break;
-		i = i * 10 + c;
-	}
-	end = p;
-	return i;
-}
-
-
-template<typename T> T xdigitsTo(LPCTSTR p, LPCTSTR &end)
-{
-	T i = 0;
-	for (;; ++p)
-	{
-		int c = *p;
-		if (c <= '9' && c >= '0')
-			c -= '0';
-		else if (c <= 'F' && c >= 'A')
-			c -= 'A' - 10;
-		else if (c <= 'f' && c >= 'a')
-			c -= 'a' - 10;
-		else
-			break;
-		i = i * 16 + c;
-	}
-	end = p;
-	return i;
-}
-
-
-// istrtoi64(): like _tcstoi64, but allows wrapping overflow consistent with
-// arithmetic expressions.  Some behaviour may be unlike _tcstoi64/strtoll:
-//  - Decimal and hexadecimal are always supported; caller cannot specify base.
-//  - A leading '0' does not activate base 8, since we specifically don't want that.
-//  - Only space and tab are considered whitespace, consistent with IsNumeric().
-//  - errno is never set.
-__int64 istrtoi64(LPCTSTR buf, LPCTSTR *endptr)
-{
-	// unsigned vs. signed is unlikely to matter in practice, but only unsigned has
-	// well-defined behaviour regarding overflow (that is, it wraps but technically
-	// never "overflows" according to the standard).
-	UINT64 i;
-
-	// Skip spaces and tabs.
-	LPCTSTR p = omit_leading_whitespace(buf);
-	
-	// Determine/skip sign.
-	bool negative = *p == '-';
-	if (negative || *p == '+')
-		++p;
-
-	LPCTSTR end;
-	if (IS_HEX(p))
-	{
-		p += 2;
-		i = xdigitsTo<UINT64>(p, end);
-	}
-	else
-	{
-		i = digitsTo<UINT64>(p, end);
-	}
-	if (endptr)
-		*endptr = p == end ? buf : end; // Don't consider " -" or "-0x" numeric on its own.
-	// Casting out of range unsigned to signed has "implementation defined" behaviour;
-	// Microsoft's implementation does not change the bit pattern.
-	return negative ? -(__int64)i : (__int64)i;
-}
-
-
-// nstrtoi64(): like istrtoi64, but permits scientific notation (including a decimal
-// fraction, which may be significant in combination with the exponent).
-// This function is mostly identical to istrtoi64, so comments there also apply here.
-// Attempts to merge the two functions resulted in 300-1000 bytes larger code size due
-// to inlining, how heavily these are used, and the fact that omitted parameters are
-// actually still passed by the compiler.
-__int64 nstrtoi64(LPCTSTR buf)
-{
-	UINT64 i;
-
-	LPCTSTR p = omit_leading_whitespace(buf);
-
-	bool negative = *p == '-';
-	if (negative || *p == '+')
-		++p;
-
-	if (IS_HEX(p))
-	{
-		p += 2;
-		i = xdigitsTo<UINT64>(p, p);
-	}
-	else // Decimal.
-	{
-		i = digitsTo<UINT64>(p, p);
-
-		// Check for a decimal fraction/exponent:
-		LPCTSTR end_int = p;
-		if (*p == '.')
-		{
-			do ++p;
-			while (*p <= '9' && *p >= '0');
-		}
-		LPCTSTR end_fraction = p;
-		if (*p == 'e' || *p == 'E')
-		{
-			++p;
-			bool exp_negative = *p == '-';
-			if (exp_negative || *p == '+')
-				++p;
-			UINT64 exp = digitsTo<UINT64>(p, p); // UINT64 vs. char does not affect code size; using UINT64 ensures that unreasonably large exponents produce a consistent result.
-			if (p > end_fraction + 1) // Exponent present.
-			{
-				if (!exp_negative && *end_int == '.')
-				{
-					// Parse additional digits while simultaneously applying part of the exponentiation.
-					for (p = end_int + 1; p < end_fraction && exp; ++p, --exp) // Scan from '.' to 'e'
-						i = i * 10 + (*p - '0');
-				}
-				if (exp >= (exp_negative ? 20 : 64)) // Avoid unnecessary looping for abnormally large exponents.
-				{
-					// For n * 10**64, the low 64 bits of the result are always 0.  
-					// For n / 10**20, the result is always 0 since 10**20 > _UI16_MAX > n.
-					i = 0;
-				}
-				else
-				{
-					// This section multiplies or divides i by a power of 10 without resorting to
-					// floating-point operations.  Overflow of the result is allowed and will wrap,
-					// but to get the correct result we must not wrap the multiplier.
-					while (exp >= 20) // Implies !exp_negative.  10**20 won't fit in multiplier.
-					{
-						i *= 10000000000000000000ui64;
-						exp -= 19;
-					}
-					if (exp != 0) // An exponent of 0 is valid but does not alter the result.
-					{
-						// Perform exponentiation by squaring.
-						UINT64 multiplier = 1;
-						UINT64 bs = 10;
-						while (exp > 1)
-						{
-							if (exp & 1) multiplier *= bs;
-							exp >>= 1;
-							bs *= bs;
-						}
-						multiplier *= bs;
-						if (exp_negative)
-							i /= multiplier;
-						else
-							i *= multiplier;
-					}
-				}
-			}
-		}
-	}
-	return negative ? -(__int64)i : (__int64)i;
-}
-
-
-
 UINT StrReplace(LPTSTR aHaystack, LPTSTR aOld, LPTSTR aNew, StringCaseSenseType aStringCaseSense
 	, UINT aLimit, size_t aSizeLimit, LPTSTR *aDest, size_t *aHaystackLength)
 // Replaces all (or aLimit) occurrences of aOld with aNew in aHaystack.
@@ -1459,6 +1186,21 @@ LPTSTR TranslateLFtoCRLF(LPCTSTR aString)
 
 
 
+HANDLE FindFirstFileBatched(LPCTSTR aFilespec, LPWIN32_FIND_DATA aFindData, bool aShortNames)
+// Same as FindFirstFile() except that on Windows 7 and later, the system is asked to fetch directory
+// entries in larger batches, which substantially reduces the number of file system requests needed
+// to enumerate a large directory (especially on a network share).  If aShortNames is false, the
+// 8.3 name isn't retrieved (cAlternateFileName is left empty), which saves the file system from
+// looking it up for each file.
+{
+	if (!g_os.IsWin7OrLater()) // Neither FindExInfoBasic nor FIND_FIRST_EX_LARGE_FETCH are supported.
+		return FindFirstFile(aFilespec, aFindData);
+	return FindFirstFileEx(aFilespec, aShortNames ? FindExInfoStandard : FindExInfoBasic, aFindData
+		, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+}
+
+
+
 bool DoesFilePatternExist(LPCTSTR aFilePattern, DWORD *aFileAttr, DWORD aRequiredAttr)
 // Returns true if the file/folder exists or false otherwise.
 // If non-NULL, aFileAttr's DWORD is set to the attributes of the file/folder if a match is found.
@@ -3259,32 +3001,6 @@ LPCTSTR InStrAny(LPCTSTR aStr, LPTSTR aNeedle[], int aNeedleCount, size_t &aFoun
 
 
 
-int FTOA(double aValue, LPTSTR aBuf, int aBufSize)
-// Converts aValue to a string while trying to ensure that conversion back to double will
-// produce the same value.  Trailing 0s after the decimal point are stripped for brevity, when not printed in scientific notation.
-// Numbers printed in scientific notation may not contain a decimal point.
-// Caller must ensure there is sufficient buffer size to avoid truncating the output.
-{
-	int result = sntprintf(aBuf, aBufSize, _T("%.17g"), aValue);
-	
-	// the 'g' specifier might cause the result to lack a decimal point. 
-	// If the number is not written in scientific notation, and lacks a decimal point,
-	// add ".0" to make the string look like a float.
-	size_t search_result = _tcscspn(aBuf, _T(".e")); 
-	if (search_result == result			// if true, no decimal point, '.', or 'e' was found, add ".0",
-		&& result + 3 <= aBufSize		// but only if the buffer has room for two more characters and the null terminator,
-		&& cisdigit(aBuf[result - 1]))	// and the number isn't some variation of inf or NaN.
-	{
-		aBuf[result] = '.';				// overwrites the current null terminator.
-		aBuf[result+1] = '0';
-		aBuf[result+2] = '\0';
-		result += 2;					// the result is the number of characters written, excluding the terminator.
-	}
-	return result;
-}
-
-
-
 // Caller must call CoTaskMemFree() on the result when done.
 PWSTR GetDocumentsFolder()
 {
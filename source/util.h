@@ -89,6 +89,8 @@ inline TCHAR ctolower(TBYTE c)
 	return cisupper(c) ? (c | 0x20) : c;
 }
 
+#include "NameCompare.h" // ctcsicmp(), which depends on ctolower() above.
+
 // NOTE: MOVING THINGS OUT OF THIS FILE AND INTO util.cpp can hurt benchmarks by 10% or more, so be careful
 // when doing so (even when the change seems inconsequential, it can impact benchmarks due to quirks of code
 // generation and caching).
@@ -227,6 +229,10 @@ inline size_t omit_trailing_any(T aBuf, LPCTSTR aOmitList, T aBuf_marker)
 
 
 
+#include "CharSet.h" // CharSet, for lists of delimiters and omitted characters.
+
+
+
 inline size_t ltrim(LPTSTR aStr, size_t aLength = -1)
 // Caller must ensure that aStr is not NULL.
 // v1.0.25: Returns the length if it was discovered as a result of the operation, or aLength otherwise.
@@ -543,7 +549,7 @@ inline double ATOF(LPCTSTR buf)
 int FTOA(double aValue, LPTSTR aBuf, int aBufSize);
 
 #define ITOA(value, buf)	_itot(value, buf, 10)
-#define ITOA64(value, buf)	_i64tot(value, buf, 10)
+LPTSTR ITOA64(__int64 aValue, LPTSTR aBuf);
 #define UTOA(value, buf)	_ultot(value, buf, 10)
 #define UTOA64(value, buf)	_ui64tot(value, buf, 10)
 #ifdef _WIN64
@@ -701,6 +707,7 @@ __int64 FileTimeSecondsUntil(FILETIME *pftStart, FILETIME *pftEnd);
 
 SymbolType IsNumeric(LPCTSTR aBuf, BOOL aAllowNegative = false // BOOL vs. bool might squeeze a little more performance out of this frequently-called function.
 	, BOOL aAllowAllWhitespace = true, BOOL aAllowFloat = false, BOOL aAllowImpure = false);
+SymbolType ParseNumeric(LPCTSTR aBuf, __int64 &aInt64, double &aDouble);
 
 void strlcpy(LPSTR aDst, LPCSTR aSrc, size_t aDstSize);
 void wcslcpy(LPWSTR aDst, LPCWSTR aSrc, size_t aDstSize);
@@ -724,6 +731,7 @@ size_t PredictReplacementSize(ptrdiff_t aLengthDelta, int aReplacementCount, int
 	, size_t aCurrentLength, size_t aEndOffsetOfCurrMatch);
 LPTSTR TranslateLFtoCRLF(LPCTSTR aString);
 bool DoesFilePatternExist(LPCTSTR aFilePattern, DWORD *aFileAttr = NULL, DWORD aRequiredAttr = 0);
+HANDLE FindFirstFileBatched(LPCTSTR aFilespec, LPWIN32_FIND_DATA aFindData, bool aShortNames = true);
 LPTSTR ConvertFilespecToCorrectCase(LPTSTR aFilespec, LPTSTR aBuf, size_t aBufSize, size_t &aBufLength);
 void ConvertFilespecToCorrectCase(LPTSTR aBuf, size_t aBufSize, size_t &aBufLength);
 LPTSTR FileAttribToStr(LPTSTR aBuf, DWORD aAttr);
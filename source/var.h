@@ -429,18 +429,26 @@ public:
 	// aToken.var is the same as the "this" var. Converts var into a number and stores it numerically in aToken.
 	{
 		Var &var = *ResolveAlias();
-		switch (aToken.symbol = var.IsNumeric())
+		switch (var.mAttrib & VAR_ATTRIB_CACHE)
 		{
-		case PURE_INTEGER:
-			aToken.value_int64 = var.ToInt64();
-			break;
-		case PURE_FLOAT:
-			aToken.value_double = var.ToDouble();
-			break;
-		default: // Not a pure number.
+		case VAR_ATTRIB_IS_INT64:
+			aToken.SetValue(var.mContentsInt64);
+			return OK;
+		case VAR_ATTRIB_IS_DOUBLE:
+			aToken.SetValue(var.mContentsDouble);
+			return OK;
+		case VAR_ATTRIB_NOT_NUMERIC:
+			aToken.symbol = PURE_NOT_NUMERIC;
 			return FAIL;
 		}
-		return OK; // Since above didn't return, indicate success.
+		// Since the string isn't a cached number, parse it once rather than calling IsNumeric() and then
+		// ToInt64() or ToDouble().  See IsNumeric() for comments.
+		aToken.symbol = ::ParseNumeric(var.Contents(), aToken.value_int64, aToken.value_double);
+		if (aToken.symbol != PURE_NOT_NUMERIC)
+			return OK;
+		if (!VarTypeIsVirtual(var.mType))
+			var.mAttrib |= VAR_ATTRIB_NOT_NUMERIC;
+		return FAIL;
 	}
 
 	void ToTokenSkipAddRef(ExprTokenType &aToken)
@@ -1355,6 +1355,65 @@ int GetWindowTextTimeout(HWND aWnd, LPTSTR aBuf, INT_PTR aBufSize, UINT aTimeout
 
 
 
+// Process paths retrieved by window searches are cached for a short period, since retrieving them
+// requires opening the process (and for full paths, resolving the device name), which is by far the
+// most expensive attribute of a window to retrieve.  Typically many windows share a process, and
+// #HotIf WinActive/WinExist and WinWait may search for the same windows many times in quick succession.
+// The TTL is short enough that a process ID being reused for a different process within that time is
+// not a concern.  There is a separate cache for the main thread and hook thread, for thread-safety.
+#define PROCESS_PATH_CACHE_SIZE 32 // Must be a power of 2.
+#define PROCESS_PATH_CACHE_TTL 100 // Milliseconds.
+struct ProcessPathCacheEntry
+{
+	DWORD pid;
+	DWORD tick; // When the path was retrieved.  Zero if the entry is unused.
+	bool name_only;
+	TCHAR path[MAX_PATH];
+};
+static ProcessPathCacheEntry sProcessPathCache[2][PROCESS_PATH_CACHE_SIZE];
+
+static void GetProcessNameCached(DWORD aProcessID, LPTSTR aBuf, DWORD aBufSize, bool aGetNameOnly)
+// This function must be kept thread-safe because it may be called (indirectly) by hook thread too.
+{
+	DWORD thread_id = GetCurrentThreadId();
+	if (thread_id != g_MainThreadID && thread_id != g_HookThreadID)
+	{
+		GetProcessName(aProcessID, aBuf, aBufSize, aGetNameOnly);
+		return;
+	}
+	auto &entry = sProcessPathCache[thread_id != g_MainThreadID]
+		[(aProcessID / 4) & (PROCESS_PATH_CACHE_SIZE - 1)]; // Process IDs are multiples of 4.
+	DWORD tick_now = GetTickCount();
+	if (entry.tick && entry.pid == aProcessID && entry.name_only == aGetNameOnly
+		&& tick_now - entry.tick < PROCESS_PATH_CACHE_TTL)
+	{
+		tcslcpy(aBuf, entry.path, aBufSize);
+		return;
+	}
+	GetProcessName(aProcessID, entry.path, _countof(entry.path), aGetNameOnly);
+	entry.pid = aProcessID;
+	entry.name_only = aGetNameOnly;
+	entry.tick = tick_now ? tick_now : 1;
+	tcslcpy(aBuf, entry.path, aBufSize);
+}
+
+
+
+// Compiled WinTitles are cached separately for the main thread and hook thread, since the cache and
+// the compiled criteria it holds aren't thread-safe.  See WinTitleCriteria.h.
+static WinTitleCache sWinTitleCache[2];
+
+static WinTitleCriteria *CompileWinTitle(LPCTSTR aWinTitle)
+// This function must be kept thread-safe because it may be called (indirectly) by hook thread too.
+{
+	DWORD thread_id = GetCurrentThreadId();
+	if (thread_id != g_MainThreadID && thread_id != g_HookThreadID)
+		return WinTitleCriteria::Compile(aWinTitle);
+	return sWinTitleCache[thread_id != g_MainThreadID].Get(aWinTitle);
+}
+
+
+
 ResultType WindowSearch::SetCriteria(ScriptThreadSettings &aSettings, LPCTSTR aTitle, LPCTSTR aText, LPCTSTR aExcludeTitle, LPCTSTR aExcludeText)
 // Returns FAIL if the new criteria can't possibly match a window (due to ahk_id being in invalid
 // window or the specified ahk_group not existing).  Otherwise, it returns OK.
@@ -1378,127 +1437,41 @@ ResultType WindowSearch::SetCriteria(ScriptThreadSettings &aSettings, LPCTSTR aT
 	mCriterionExcludeText = aExcludeText;
 	mSettings = &aSettings;
 
-	DWORD orig_criteria = mCriteria, this_criterion = CRITERION_TITLE, next_criterion;
-	LPCTSTR start, end, value, next_value = nullptr;
-	size_t value_length, buf_used = 0;
-
-	for (mCriteria = 0, start = aTitle; this_criterion; start = next_value, this_criterion = next_criterion)
+	DWORD orig_criteria = mCriteria;
+	// The compiled criteria are cached per thread, keyed by the WinTitle string, so that evaluating
+	// a window group or repeatedly checking the same WinTitle doesn't parse it each time.
+	WinTitleCriteria *compiled = CompileWinTitle(aTitle);
+	if (!compiled)
+		return FAIL;
+	if (mCompiled)
+		mCompiled->Release(); // Done after CompileWinTitle() in case it returned the same object.
+	mCompiled = compiled;
+	mCriteria = compiled->criteria;
+
+	if (mCriteria & CRITERION_ID)
 	{
-		for (next_criterion = 0, end = start; end = tcscasestr(end, _T("ahk_")); end += 4)
-		{
-			// To reduce ambiguity, the following requires that any "ahk_" criteria beyond the first
-			// be preceded by at least one space or tab:
-			if (end > aTitle && !IS_SPACE_OR_TAB(end[-1]))
-				continue;
-			auto cp = end + 4;
-			if (!_tcsnicmp(cp, _T("id"), 2))
-				cp += 2, next_criterion = CRITERION_ID;
-			else if (!_tcsnicmp(cp, _T("pid"), 3))
-				cp += 3, next_criterion = CRITERION_PID;
-			else if (!_tcsnicmp(cp, _T("group"), 5))
-				cp += 5, next_criterion = CRITERION_GROUP;
-			else if (!_tcsnicmp(cp, _T("exe"), 3))
-				cp += 3, next_criterion = CRITERION_PATH;
-			else if (!_tcsnicmp(cp, _T("class"), 5))
-				cp += 5, next_criterion = CRITERION_CLASS;
-			else
-				continue;
-			next_value = cp;
-			break;
-		}
-
-		switch (this_criterion)
+		LPCTSTR id = compiled->id;
+		for (int i = 0; i < compiled->id_count; ++i, id += _tcslen(id) + 1)
 		{
-		case CRITERION_ID:
-			HWND hwnd;
-			hwnd = (HWND)ATOU64(start);
+			HWND hwnd = (HWND)ATOU64(id);
 			// Note that this can validly be the HWND of a child window; i.e. ahk_id %ChildWindowHwnd% is supported.
 			if (hwnd != HWND_BROADCAST && !IsWindow(hwnd) // Checked here once rather than each call to IsMatch().
-				|| (mCriteria & CRITERION_ID) && hwnd != mCriterionHwnd) // Two different IDs have been specified, so there can never be a match.
+				|| i && hwnd != mCriterionHwnd) // Two different IDs have been specified, so there can never be a match.
 			{
 				mCriterionHwnd = NULL;
 				return FAIL; // Inform caller of invalid criteria.  No need to do anything else further below.
 			}
 			mCriterionHwnd = hwnd;
-			break;
-		case CRITERION_PID:
-			mCriterionPID = ATOU(start);
-			break;
-		default:
-			// In the following line, it may have been preferable to skip only zero or one spaces rather than
-			// calling omit_leading_whitespace().  But now this should probably be kept for backward compatibility.
-			// Besides, even if it's possible for a class name to start with a space, a RegEx dot or other symbol
-			// can be used to match it via SetTitleMatchMode RegEx.
-			start = omit_leading_whitespace(start);
-			if (end == start) // Empty or consists entirely of whitespace.
-			{
-				// For backward compatibility, disqualify any title consisting entirely of whitespace,
-				// but otherwise include any trailing whitespace aside from the final delimiting space.
-				if (this_criterion == CRITERION_TITLE) // Only title, since it has no explicit keyword.
-					continue;
-				value = _T(""); // For backward-compatibility.  An empty value is an automatic pass for RegEx mode and fail for other modes.
-			}
-			else if (end) // Because end != start, this implies end[-1] is the delimiting space.
-			{
-				if (!buf_used) // mCriterionBuf hasn't been used by this call, but may have been used by a previous call.
-				{
-					// Allow for space in the buffer for all remaining options, to minimize realloc and avoid the need
-					// to update previously stored addresses.  Some options don't need buffer space, but this is just
-					// an estimate, and we will allow extra space for future calls anyway.
-					size_t max_size = _tcschr(end, '\0') - start + 1;
-					if (max_size > mCriterionBufSize)
-					{
-						// Use a generous initial size and exponential growth to minimize the number of reallocs
-						// while evaluating window groups.
-						if (mCriterionBufSize < 1024)
-							mCriterionBufSize = 1024;
-						while (mCriterionBufSize < max_size)
-							mCriterionBufSize <<= 1;
-						free(mCriterionBuf); // The previous content is not needed, so free/malloc rather than realloc.
-						if (!(mCriterionBuf = tmalloc(mCriterionBufSize)))
-						{
-							mCriterionBufSize = 0;
-							return FAIL;
-						}
-					}
-				}
-				// Omit exactly one space or tab from the title criterion. That space or tab is the one
-				// required to delimit the special "ahk_" string.  Any other spaces or tabs to the left of
-				// that one are considered literal (for flexibility).
-				value_length = end - start - 1; // -1 to omit the delimiting space.
-				auto buf = mCriterionBuf + buf_used;
-				tmemcpy(buf, start, value_length);
-				buf[value_length] = '\0';
-				buf_used += value_length + 1;
-				value = buf;
-			}
-			else
-				value = start;
-
-			switch (this_criterion)
-			{
-			case CRITERION_TITLE:
-				// Due to checks above, there is always at least one non-whitespace character.
-				mCriterionTitle = value;
-				mCriterionTitleLength = end ? value_length : _tcslen(value);
-				break;
-			case CRITERION_GROUP:
-				if (   !(mCriterionGroup = g_script.FindGroup(value))   )
-					return FAIL; // No such group: Inform caller of invalid criteria.  No need to do anything else further below.
-				break;
-			case CRITERION_PATH:
-				mCriterionPath = value;
-				// Allow something like "ahk_exe firefox.exe" to be an exact match for the process name
-				// instead of full path, but for flexibility, always use full path when in regex mode.
-				mCriterionPathIsNameOnly = mSettings->TitleMatchMode != FIND_REGEX && !_tcschr(mCriterionPath, '\\');
-				break;
-			case CRITERION_CLASS:
-				mCriterionClass = value;
-				break;
-			}
 		}
-		mCriteria |= this_criterion;
 	}
+	if (mCriteria & CRITERION_PID)
+		mCriterionPID = ATOU(compiled->pid);
+	if (mCriteria & CRITERION_GROUP)
+		if (   !(mCriterionGroup = g_script.FindGroup(compiled->group))   )
+			return FAIL; // No such group: Inform caller of invalid criteria.  No need to do anything else further below.
+	// Allow something like "ahk_exe firefox.exe" to be an exact match for the process name
+	// instead of full path, but for flexibility, always use full path when in regex mode.
+	mCriterionPathIsNameOnly = mSettings->TitleMatchMode != FIND_REGEX && !compiled->path_has_backslash;
 
 	// Since this function doesn't change mCandidateParent, there is no need to update the candidate's
 	// attributes unless the type of criterion has changed or if mExcludeTitle became non-blank as
@@ -1541,8 +1514,7 @@ void WindowSearch::UpdateCandidateAttributes()
 	{
 		DWORD dwPid;
 		if (GetWindowThreadProcessId(mCandidateParent, &dwPid))
-			if (!GetProcessName(dwPid, mCandidatePath, _countof(mCandidatePath), mCriterionPathIsNameOnly))
-				*mCandidatePath = '\0';
+			GetProcessNameCached(dwPid, mCandidatePath, _countof(mCandidatePath), mCriterionPathIsNameOnly); // Sets it to "" on failure.
 	}
 	if (mCriteria & CRITERION_CLASS)
 		GetClassName(mCandidateParent, mCandidateClass, _countof(mCandidateClass)); // Limit to WINDOW_CLASS_SIZE in this case since that's the maximum that can be searched.
@@ -1566,60 +1538,19 @@ HWND WindowSearch::IsMatch(bool aInvert)
 	if (!mCandidateParent || !mCriteria) // Nothing to check, so no match.
 		return NULL;
 
-	if ((mCriteria & CRITERION_TITLE) && *mCriterionTitle) // For performance, avoid the calls below (especially RegEx) when mCriterionTitle is blank (assuming it's even possible for it to be blank under these conditions).
-	{
-		switch(mSettings->TitleMatchMode)
-		{
-		case FIND_ANYWHERE:
-			if (!_tcsstr(mCandidateTitle, mCriterionTitle)) // Suitable even if mCriterionTitle is blank, though that's already ruled out above.
-				return NULL;
-			break;
-		case FIND_IN_LEADING_PART:
-			if (_tcsncmp(mCandidateTitle, mCriterionTitle, mCriterionTitleLength)) // Suitable even if mCriterionTitle is blank, though that's already ruled out above. If it were possible, mCriterionTitleLength would be 0 and thus strncmp would yield 0 to indicate "strings are equal".
-				return NULL;
-			break;
-		case FIND_REGEX:
-			if (!RegExMatch(mCandidateTitle, mCriterionTitle))
-				return NULL;
-			break;
-		default: // Exact match.
-			if (_tcscmp(mCandidateTitle, mCriterionTitle))
-				return NULL;
-		}
-		// If above didn't return, it's a match so far so continue onward to the other checks.
-	}
-
-	if (mCriteria & CRITERION_CLASS) // mCriterionClass is probably always non-blank when CRITERION_CLASS is present (harmless even if it isn't), so *mCriterionClass isn't checked.
-	{
-		if (mSettings->TitleMatchMode == FIND_REGEX)
-		{
-			if (!RegExMatch(mCandidateClass, mCriterionClass))
-				return NULL;
-		}
-		else // For backward compatibility, all other modes use exact-match for Class.
-			if (_tcscmp(mCandidateClass, mCriterionClass)) // Doesn't match the required class name.
-				return NULL;
-		// If nothing above returned, it's a match so far so continue onward to the other checks.
-	}
+	// Title, class and path are compared by the compiled criteria.  mCriteria lacks these criteria
+	// when SetCriteria() was given a WinGroup rather than a WinTitle, in which case mCompiled may be
+	// stale.  For performance, the title comparison (especially RegEx) is skipped when the title is blank.
+	if ((mCriteria & (CRITERION_TITLE | CRITERION_CLASS | CRITERION_PATH))
+		&& !mCompiled->IsMatch(mSettings->TitleMatchMode, mCandidateTitle, mCandidateClass, mCandidatePath
+			, [](LPCTSTR aSubject, LPCTSTR aPattern) { return RegExMatch(aSubject, aPattern) != NULL; }))
+		return NULL;
 
 	// For the following, mCriterionPID would already be filled in, though it might be an explicitly specified zero.
 	if ((mCriteria & CRITERION_PID) && mCandidatePID != mCriterionPID) // Doesn't match required PID.
 		return NULL;
 	//else it's a match so far, but continue onward in case there are other criteria.
 
-	if (mCriteria & CRITERION_PATH)
-	{
-		if (mSettings->TitleMatchMode == FIND_REGEX)
-		{
-			if (!RegExMatch(mCandidatePath, mCriterionPath))
-				return NULL;
-		}
-		else
-			if (_tcsicmp(mCandidatePath, mCriterionPath)) // Doesn't match the required path.
-				return NULL;
-		// If nothing above returned, it's a match so far so continue onward to the other checks.
-	}
-
 	// The following also handles the fact that mCriterionGroup might be NULL if the specified group
 	// does not exist or was never successfully created:
 	if ((mCriteria & CRITERION_GROUP) && (!mCriterionGroup || !mCriterionGroup->IsMember(mCandidateParent, *mSettings)))
@@ -1643,24 +1574,9 @@ HWND WindowSearch::IsMatch(bool aInvert)
 
 	if (*mCriterionExcludeTitle)
 	{
-		switch(mSettings->TitleMatchMode)
-		{
-		case FIND_ANYWHERE:
-			if (_tcsstr(mCandidateTitle, mCriterionExcludeTitle))
-				return NULL;
-			break;
-		case FIND_IN_LEADING_PART:
-			if (!_tcsncmp(mCandidateTitle, mCriterionExcludeTitle, mCriterionExcludeTitleLength))
-				return NULL;
-			break;
-		case FIND_REGEX:
-			if (RegExMatch(mCandidateTitle, mCriterionExcludeTitle))
-				return NULL;
-			break;
-		default: // Exact match.
-			if (!_tcscmp(mCandidateTitle, mCriterionExcludeTitle))
-				return NULL;
-		}
+		if (mSettings->TitleMatchMode == FIND_REGEX ? RegExMatch(mCandidateTitle, mCriterionExcludeTitle) != NULL
+			: WinTitleCriteria::IsTitleMatch(mCandidateTitle, mCriterionExcludeTitle, mCriterionExcludeTitleLength, mSettings->TitleMatchMode))
+			return NULL;
 		// If above didn't return, WinTitle and ExcludeTitle are both satisfied.  So continue
 		// on below in case there is some WinText or ExcludeText to search.
 	}
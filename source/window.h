@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include "defines.h"
 #include "globaldata.h"
 #include "util.h" // for strlcpy()
+#include "WinTitleCriteria.h"
 
 
 // Note: it is apparently possible for a hidden window to be the foreground
@@ -71,14 +72,6 @@ inline bool IsTextMatch(LPCTSTR aHaystack, LPCTSTR aNeedle)
 #define CONTROL_NN_SIZE 10  // Allows for maximum length of a UINT to ensure buffers are always sufficient (although creating so many controls would be impossible).
 #define WINDOW_CLASS_NN_SIZE (WINDOW_CLASS_SIZE + CONTROL_NN_SIZE)
 
-// Bitwise fields to support multiple criteria in v1.0.36.02
-#define CRITERION_TITLE 0x01
-#define CRITERION_ID    0x02
-#define CRITERION_PID   0x04
-#define CRITERION_CLASS 0x08
-#define CRITERION_GROUP 0x10
-#define CRITERION_PATH	0x20
-
 class WindowSearch
 {
 	// One of the reasons for having this class is to avoid fetching PID, Class, and Window Text
@@ -91,11 +84,8 @@ public:
 
 	// Controlled and initialized by SetCriteria():
 	ScriptThreadSettings *mSettings;           // Settings such as TitleMatchMode and DetectHiddenWindows.
-	LPTSTR mCriterionBuf;                     // Contains all of the other string criterion sourced from WinTitle.
-	size_t mCriterionBufSize;
-	LPCTSTR mCriterionTitle;                   // The portion of WinTitle preceding the first "ahk_" keyword.
-	LPCTSTR mCriterionClass;                   // For "ahk_class".
-	size_t mCriterionTitleLength;             // Length of mCriterionTitle.
+	WinTitleCriteria *mCompiled;              // The compiled WinTitle, including the title, ahk_class and ahk_exe criteria.
+	LPCTSTR mCriterionClass;                   // Used only by ControlExist(): the ClassNN to search for.
 	LPCTSTR mCriterionExcludeTitle;           // ExcludeTitle.
 	size_t mCriterionExcludeTitleLength;      // Length of the above.
 	LPCTSTR mCriterionText;                   // WinText.
@@ -103,7 +93,6 @@ public:
 	HWND mCriterionHwnd;                      // For "ahk_id".
 	DWORD mCriterionPID;                      // For "ahk_pid".
 	WinGroup *mCriterionGroup;                // For "ahk_group".
-	LPCTSTR mCriterionPath;                    // For "ahk_exe".
 
 	bool mCriterionPathIsNameOnly;
 	bool mFindLastMatch; // Whether to keep searching even after a match is found, so that last one is found.
@@ -145,7 +134,7 @@ public:
 		// For performance and code size, only the most essential members are initialized.
 		// The others do not require it or are initialized by SetCriteria() or SetCandidate().
 		: mCriteria(0), mCriterionExcludeTitle(_T("")) // ExcludeTitle is referenced often, so should be initialized.
-		, mCriterionBuf(NULL), mCriterionBufSize(0)
+		, mCompiled(NULL)
 		, mFoundCount(0), mFoundParent(NULL) // Must be initialized here since none of the member functions is allowed to do it.
 		, mFoundChild(NULL) // ControlExist() relies upon this.
 		, mCandidateParent(NULL)
@@ -159,7 +148,8 @@ public:
 
 	~WindowSearch()
 	{
-		free(mCriterionBuf);
+		if (mCompiled)
+			mCompiled->Release();
 	}
 };
 
@@ -0,0 +1,142 @@
+"""
+Breakpoints.py - Tests hit conditions, conditional breakpoints and logpoints (Debugger::PreExecLine
+and breakpoint_set in source/Debugger.cpp) by debugging Breakpoints.ahk with a stub DBGp client.
+
+Usage:  python tests\\dbgp\\Breakpoints.py path\\to\\AutoHotkey64.exe
+
+Each test debugs a new instance of the script, which sums the numbers 1 to 10 with a loop.  The
+exit code is the number of failed checks.
+"""
+
+import os
+import sys
+import traceback
+
+from dbgp import Client, find_line, quote
+
+SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'Breakpoints.ahk')
+BODY = find_line(SCRIPT, 'body')
+DONE = find_line(SCRIPT, 'done')
+
+failures = 0
+
+
+def check(actual, expected, message):
+    global failures
+    if actual != expected:
+        failures += 1
+        print('FAILED: %s: expected %r, got %r' % (message, expected, actual))
+
+
+def hit_equal(client):
+    bp = client.set_breakpoint(BODY, '-h 3', '-o ==')
+    check(client.run(), 'break', 'Hit count == 3')
+    check(client.line(), BODY, 'Line of break')
+    check(client.value('i'), '3', 'Break on the third hit')
+    check(client.hit_count(bp), 3, 'hit_count')
+    check(client.run(), 'stopped', 'No break after the third hit')
+
+
+def hit_multiple(client):
+    client.set_breakpoint(BODY, '-h 4', '-o %')
+    breaks = []
+    while client.run() == 'break':
+        breaks.append(client.value('i'))
+    check(breaks, ['4', '8'], 'Breaks for hit count % 4')
+
+
+def temporary(client):
+    client.set_breakpoint(BODY, '-r 1')
+    check(client.run(), 'break', 'Temporary breakpoint')
+    check(client.value('i'), '1', 'Temporary breakpoint on the first hit')
+    check(client.run(), 'stopped', 'Temporary breakpoint deleted after the first hit')
+
+
+def conditional(client):
+    bp = client.set_breakpoint(BODY, condition='i = 7')
+    check(client.run(), 'break', 'Condition i = 7')
+    check(client.value('i'), '7', 'Break when the condition is met')
+    check(client.hit_count(bp), 1, 'hit_count counts only when the condition is met')
+    check(client.run(), 'stopped', 'No other break for i = 7')
+
+
+def conditional_with_hit_count(client):
+    client.set_breakpoint(BODY, '-h 2', '-o ==', condition='i > 5')
+    check(client.run(), 'break', 'Condition i > 5 with hit count == 2')
+    check(client.value('i'), '7', 'Second hit with the condition met')
+    check(client.run(), 'stopped', 'No other break for the second hit')
+
+
+def conditional_never_met(client):
+    bp = client.set_breakpoint(BODY, condition='i < 0')
+    client.set_breakpoint(DONE)
+    check(client.run(), 'break', 'Condition i < 0')
+    check(client.line(), DONE, 'No break for a condition which is never met')
+    check(client.hit_count(bp), 0, 'hit_count for a condition which is never met')
+
+
+def invalid_condition(client):
+    try:
+        client.set_breakpoint(BODY, condition='i ! 1')
+        check('no error', 'error', 'Condition with an invalid operator')
+    except RuntimeError:
+        pass
+    client.set_breakpoint(DONE)
+    check(client.run(), 'break', 'Invalid condition')
+    check(client.line(), DONE, 'No breakpoint set by an invalid condition')
+
+
+def logpoint(client):
+    client.command('stderr', '-c 1')
+    client.set_breakpoint(BODY, '-l ' + quote('i={i} total={total} "{A_Index}"'))
+    client.set_breakpoint(DONE)
+    check(client.run(), 'break', 'Logpoint')
+    check(client.line(), DONE, 'Logpoint doesn\'t break')
+    expected = ['i=%d total=%d "%d"\n' % (i, i * (i - 1) // 2, i) for i in range(1, 11)]
+    check(client.streams, expected, 'Logpoint messages')
+
+
+def logpoint_with_condition(client):
+    client.command('stderr', '-c 2')
+    client.set_breakpoint(BODY, '-l ' + quote('{i} {unmatched'), condition='i >= 9')
+    client.set_breakpoint(DONE)
+    check(client.run(), 'break', 'Logpoint with a condition')
+    check(client.streams, ['9 {unmatched\n', '10 {unmatched\n'], 'Logpoint messages when the condition is met')
+
+
+def logpoint_stderr_disabled(client):
+    # The default mode; the messages go to OutputDebugString, the same as OutputDebug.
+    client.set_breakpoint(BODY, '-l ' + quote('i={i}'))
+    client.set_breakpoint(DONE)
+    check(client.run(), 'break', 'Logpoint without stderr')
+    check(client.streams, [], 'No stderr packets unless enabled with "stderr -c"')
+
+
+TESTS = [hit_equal, hit_multiple, temporary, conditional, conditional_with_hit_count,
+         conditional_never_met, invalid_condition, logpoint, logpoint_with_condition,
+         logpoint_stderr_disabled]
+
+
+def main():
+    global failures
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    exe = sys.argv[1]
+    for test in TESTS:
+        client = Client(exe, SCRIPT)
+        try:
+            test(client)
+        except Exception:
+            failures += 1
+            print('FAILED: %s raised an exception:' % test.__name__)
+            traceback.print_exc(file=sys.stdout)
+        finally:
+            output = client.close()
+        if output:
+            print('%s output:\n%s' % (test.__name__, output))
+    print('%d tests, %d failed checks' % (len(TESTS), failures))
+    sys.exit(failures)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,60 @@
+"""
+ConditionalBreakpoint.py - Benchmark for the cost of a conditional breakpoint which never fires.
+Runs tests\\bench\\ConditionalBreakpoint.ahk, a tight loop, in each of these ways and prints the
+time per iteration which the script measures:
+
+  - without a debugger;
+  - with a debugger client attached but no breakpoints;
+  - with a line breakpoint whose hit count is never reached (-h with -o ==);
+  - with a conditional breakpoint whose condition is never met (i < 0);
+  - with a conditional breakpoint comparing a string (i == "x").
+
+Usage:  python tests\\dbgp\\ConditionalBreakpoint.py path\\to\\AutoHotkey64.exe [iterations]
+"""
+
+import os
+import subprocess
+import sys
+
+from dbgp import Client, find_line
+
+SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'bench', 'ConditionalBreakpoint.ahk')
+BODY = find_line(SCRIPT, 'body')
+TIMEOUT = 600
+
+
+def debugged(exe, args, breakpoint=None):
+    client = Client(exe, SCRIPT, args, timeout=TIMEOUT)
+    try:
+        if breakpoint:
+            breakpoint(client)
+        status = client.run()
+        if status != 'stopped':
+            return 'stopped with status %s' % status
+    finally:
+        output = client.close()
+    return output
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+    exe = sys.argv[1]
+    args = sys.argv[2:]
+    runs = [
+        ('No debugger', lambda: subprocess.run([exe, '/ErrorStdOut', SCRIPT] + args,
+            stdout=subprocess.PIPE, timeout=TIMEOUT).stdout.decode('utf-8', 'replace')),
+        ('Debugger, no breakpoints', lambda: debugged(exe, args)),
+        ('Hit count never reached', lambda: debugged(exe, args,
+            lambda c: c.set_breakpoint(BODY, '-h 2000000000', '-o =='))),
+        ('Condition i < 0', lambda: debugged(exe, args,
+            lambda c: c.set_breakpoint(BODY, condition='i < 0'))),
+        ('Condition i == "x"', lambda: debugged(exe, args,
+            lambda c: c.set_breakpoint(BODY, condition='i == "x"'))),
+    ]
+    for label, run in runs:
+        print('  %-26s %s' % (label, run().strip()))
+
+
+if __name__ == '__main__':
+    main()
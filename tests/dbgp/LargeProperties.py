@@ -0,0 +1,86 @@
+"""
+LargeProperties.py - Benchmark for property_get with a large Array and a large string.  Debugs
+tests\\bench\\LargeProperties.ahk, which builds an Array of 100000 integers and a 50 MB string, and
+prints the time taken to get:
+
+  - the first, middle and last pages of the Array, with max_children 1000;
+  - every page of the Array, one request per page;
+  - the whole Array in one page;
+  - the whole string, with -m 0.
+
+Each time is the best of 3 and includes receiving and parsing the response, but not decoding the
+Base64 data, which is then checked against the size attribute.
+
+Usage:  python tests\\dbgp\\LargeProperties.py path\\to\\AutoHotkey64.exe [items [MB]]
+"""
+
+import base64
+import os
+import sys
+import time
+
+from dbgp import Client, find_line
+
+SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'bench', 'LargeProperties.ahk')
+DONE = find_line(SCRIPT, 'done')
+TIMEOUT = 600
+REPEAT = 3
+PAGESIZE = 1000
+
+
+def best(request):
+    """Returns the shortest time taken by request() and the result of its last call."""
+    times = []
+    for _ in range(REPEAT):
+        start = time.perf_counter()
+        result = request()
+        times.append(time.perf_counter() - start)
+    return min(times), result
+
+
+def get(client, name, *args):
+    return client.command('property_get', '-n ' + name, *args).find('property')
+
+
+def get_pages(client, pages):
+    return sum(len(get(client, 'arr', '-p %d' % page).findall('property')) for page in range(pages))
+
+
+def main():
+    if len(sys.argv) not in (2, 3, 4):
+        sys.exit(__doc__)
+    exe = sys.argv[1]
+    args = sys.argv[2:]
+    count = int(args[0]) if args else 100000
+    pages = count // PAGESIZE + 1  # The <base> counts as one child.
+    client = Client(exe, SCRIPT, args, timeout=TIMEOUT)
+    try:
+        client.set_breakpoint(DONE)
+        if client.run() != 'break':
+            sys.exit('The script did not break on line %d' % DONE)
+
+        client.command('feature_set', '-n max_children', '-v %d' % PAGESIZE)
+        for label, page in [('first page', 0), ('middle page', pages // 2), ('last page', pages - 1)]:
+            t, prop = best(lambda: get(client, 'arr', '-p %d' % page))
+            print('  arr, %-18s %9.2f ms  %6d children' % (label, t * 1e3, len(prop.findall('property'))))
+        t, items = best(lambda: get_pages(client, pages))
+        print('  arr, %-18s %9.2f ms  %6d children  %8.0f items/s' % ('all %d pages' % pages, t * 1e3, items, items / t))
+
+        client.command('feature_set', '-n max_children', '-v %d' % (count + 1))
+        t, prop = best(lambda: get(client, 'arr'))
+        items = len(prop.findall('property'))
+        print('  arr, %-18s %9.2f ms  %6d children  %8.0f items/s' % ('one page', t * 1e3, items, items / t))
+
+        t, prop = best(lambda: get(client, 'str', '-m 0'))
+        size = int(prop.get('size'))
+        data = base64.b64decode(prop.text or '')
+        print('  str, %-18s %9.2f ms  %6.1f MB  %8.1f MB/s%s' % ('-m 0', t * 1e3, size / 1e6, size / 1e6 / t
+            , '' if len(data) == size else '  (got %d bytes, expected %d)' % (len(data), size)))
+    finally:
+        output = client.close()
+    if output:
+        print(output)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,168 @@
+"""
+PropertyGet.py - Tests the paging of the children of an Array and a Map and the Base64-encoded
+values returned by property_get (property_get_or_value, Object::DebugWriteProperty,
+PropertyWriter::WriteIndexedItems and WritePropertyData in source/Debugger.cpp) by debugging
+PropertyGet.ahk with a stub DBGp client.
+
+Usage:  python tests\\dbgp\\PropertyGet.py path\\to\\AutoHotkey64.exe
+
+Each test debugs a new instance of the script, paused at its end once it has built an Array of
+100000 integers, a Map of 250 strings and a string containing XML-special and non-ASCII characters.
+The exit code is the number of failed checks.
+"""
+
+import base64
+import os
+import sys
+import traceback
+
+from dbgp import Client, find_line, quote
+
+SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'PropertyGet.ahk')
+DONE = find_line(SCRIPT, 'done')
+
+PAGESIZE = 100
+ARRAY = [('[%d]' % k, str(k * 2)) for k in range(1, 100001)]
+MAP = [('["k%05d"]' % k, 'v%d' % k) for k in range(250)]
+STR = ''.join('%d: <tag attr="x"> & \u00e9 \u20ac \U0001d11e\r\n' % i for i in range(1, 51))
+
+failures = 0
+
+
+def check(actual, expected, message):
+    global failures
+    if actual != expected:
+        failures += 1
+        print('FAILED: %s: expected %r, got %r' % (message, expected, actual))
+
+
+def pause(client, pagesize=PAGESIZE):
+    client.set_breakpoint(DONE)
+    check(client.run(), 'break', 'Break at the end of the script')
+    client.command('feature_set', '-n max_children', '-v %d' % pagesize)
+
+
+def get(client, name, *args):
+    return client.command('property_get', '-n ' + quote(name), *args).find('property')
+
+
+def decode(prop):
+    return base64.b64decode(prop.text or '').decode('utf-8')
+
+
+def children(prop):
+    """Returns the name and decoded value of each child, or None for the value of an object."""
+    return [(p.get('name'), decode(p) if p.get('encoding') == 'base64' else None)
+            for p in prop.findall('property')]
+
+
+def pages(client, name):
+    """Returns the items on each page of an object up to the first empty page, any <base> found
+    on those pages and the number of pages which had items."""
+    result, base, page = [], [], 0
+    while True:
+        items = children(get(client, name, '-p %d' % page))
+        base += [item for item in items if item[0] == '<base>']
+        items = [item for item in items if item[0] != '<base>']
+        if not items:
+            return result, base, page
+        result += items
+        page += 1
+
+
+def array_first_page(client):
+    pause(client)
+    prop = get(client, 'arr')
+    check((prop.get('classname'), prop.get('page'), prop.get('pagesize'), prop.get('children')),
+          ('Array', '0', str(PAGESIZE), '1'), 'Attributes of arr')
+    items = children(prop)
+    check(items[0], ('<base>', None), 'The base is the first child on page 0')
+    check(items[1:], ARRAY[:PAGESIZE - 1], 'Items on page 0')
+    check(prop.findall('property')[1].get('fullname'), 'arr[1]', 'fullname of the first item')
+
+
+def array_later_pages(client):
+    pause(client)
+    check(children(get(client, 'arr', '-p 1')), ARRAY[PAGESIZE - 1:2 * PAGESIZE - 1], 'Items on page 1')
+    check(children(get(client, 'arr', '-p 500')), ARRAY[500 * PAGESIZE - 1:501 * PAGESIZE - 1], 'Items on page 500')
+    check(children(get(client, 'arr', '-p 1000')), ARRAY[-1:], 'The last item is alone on the last page')
+    check(children(get(client, 'arr', '-p 1001')), [], 'No items after the last page')
+    client.command('feature_set', '-n max_children', '-v 1000')
+    check(children(get(client, 'arr', '-p 3')), ARRAY[2999:3999], 'Items on page 3 with max_children 1000')
+
+
+def array_all_pages(client):
+    pause(client)
+    items, base, count = pages(client, 'arr')
+    check(count, len(ARRAY) // PAGESIZE + 1, 'Number of pages of arr')
+    check(base, [('<base>', None)], 'One <base> in all pages')
+    check(items == ARRAY, True, 'Each item of arr once, in order')
+
+
+def map_all_pages(client):
+    pause(client)
+    items, base, count = pages(client, 'm')
+    check(count, 3, 'Number of pages of m')
+    check(base, [('<base>', None)], 'One <base> in all pages of m')
+    check(items, MAP, 'Each item of m once, in order')
+    check(get(client, 'm', '-p 1').find('property').get('fullname'), 'm["k00099"]', 'fullname of the first item on page 1')
+
+
+def truncated(limit):
+    """Returns the part of STR which fits in limit bytes of UTF-8 without splitting a character."""
+    result, length = '', 0
+    for c in STR:
+        length += len(c.encode('utf-8'))
+        if length > limit:
+            break
+        result += c
+    return result
+
+
+def string_value(client):
+    pause(client)
+    prop = get(client, 'str', '-m 0')
+    check((prop.get('type'), prop.get('children'), prop.get('encoding')), ('string', '0', 'base64'), 'Attributes of str')
+    check(decode(prop), STR, 'Decoded value of str')
+    check(prop.get('size'), str(len(STR.encode('utf-8'))), 'size is the number of UTF-8 bytes')
+    check(decode(get(client, 'str')), truncated(1024), 'Value of str limited by the default max_data')
+
+
+def string_max_data(client):
+    pause(client)
+    size = str(len(STR.encode('utf-8')))
+    for limit in range(1, 40):
+        prop = get(client, 'str', '-m %d' % limit)
+        check(decode(prop), truncated(limit), 'Value of str with -m %d' % limit)
+        check(prop.get('size'), size, 'size of str with -m %d is the total size' % limit)
+    client.command('feature_set', '-n max_data', '-v 0')
+    check(decode(get(client, 'str')), STR, 'Value of str with max_data 0 (unlimited)')
+
+
+TESTS = [array_first_page, array_later_pages, array_all_pages, map_all_pages, string_value,
+         string_max_data]
+
+
+def main():
+    global failures
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    exe = sys.argv[1]
+    for test in TESTS:
+        client = Client(exe, SCRIPT)
+        try:
+            test(client)
+        except Exception:
+            failures += 1
+            print('FAILED: %s raised an exception:' % test.__name__)
+            traceback.print_exc(file=sys.stdout)
+        finally:
+            output = client.close()
+        if output:
+            print('%s output:\n%s' % (test.__name__, output))
+    print('%d tests, %d failed checks' % (len(TESTS), failures))
+    sys.exit(failures)
+
+
+if __name__ == '__main__':
+    main()
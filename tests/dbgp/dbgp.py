@@ -0,0 +1,131 @@
+"""
+dbgp.py - A minimal DBGp client for testing the debugger engine (source/Debugger.cpp).
+
+Client listens on a local port, starts AutoHotkey with /Debug so that the script connects to it,
+and sends commands one at a time.  Stream packets (from OutputDebug and logpoints, when enabled
+with "stderr -c") which arrive while waiting for a response are collected in Client.streams.
+"""
+
+import base64
+import os
+import re
+import socket
+import subprocess
+import xml.etree.ElementTree as ET
+
+
+def find_line(script, marker):
+    """Returns the number of the line in script which ends with the comment ;@marker."""
+    with open(script, encoding='utf-8-sig') as f:
+        for number, line in enumerate(f, 1):
+            if line.rstrip().endswith(';@' + marker):
+                return number
+    raise ValueError('No line marked ;@%s in %s' % (marker, script))
+
+
+def quote(value):
+    """Quotes a command argument which may contain spaces, as Debugger::ParseArgs expects."""
+    return '"' + value.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def strip_namespaces(element):
+    for e in element.iter():
+        e.tag = re.sub(r'^\{.*\}', '', e.tag)
+    return element
+
+
+class Client:
+    def __init__(self, exe, script, args=(), timeout=30):
+        self.timeout = timeout
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        listener.bind(('127.0.0.1', 0))
+        listener.listen(1)
+        listener.settimeout(timeout)
+        port = listener.getsockname()[1]
+        self.process = subprocess.Popen(
+            [exe, '/ErrorStdOut', '/Debug=127.0.0.1:%d' % port, os.path.abspath(script)] + list(args),
+            stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        try:
+            self.sock, _ = listener.accept()
+        except socket.timeout:
+            self.process.kill()
+            raise
+        finally:
+            listener.close()
+        self.received = bytearray() # Appended to in place, since large responses arrive in many pieces.
+        self.streams = []
+        self.next_id = 1
+        self.init = self.read_packet()
+        if self.init.tag != 'init':
+            raise RuntimeError('Expected <init>, got <%s>' % self.init.tag)
+
+    def read_packet(self, timeout=None):
+        """Reads one packet: the length of the XML, a null byte, the XML and another null byte."""
+        self.sock.settimeout(timeout or self.timeout)
+        while b'\0' not in self.received:
+            self.receive()
+        length, _, self.received = self.received.partition(b'\0')
+        length = int(length)
+        while len(self.received) < length + 1:
+            self.receive()
+        xml, self.received = self.received[:length], self.received[length + 1:]
+        return strip_namespaces(ET.fromstring(bytes(xml)))
+
+    def receive(self):
+        data = self.sock.recv(65536)
+        if not data:
+            raise EOFError('The debugger engine disconnected')
+        self.received += data
+
+    def command(self, name, *args, data=None, timeout=None):
+        """Sends a command and returns its <response>, raising an error if it's an error response."""
+        transaction_id = str(self.next_id)
+        self.next_id += 1
+        text = '%s -i %s' % (name, transaction_id)
+        if args:
+            text += ' ' + ' '.join(args)
+        if data is not None:
+            text += ' -- ' + base64.b64encode(data.encode('utf-8')).decode('ascii')
+        self.sock.sendall(text.encode('utf-8') + b'\0')
+        while True:
+            packet = self.read_packet(timeout)
+            if packet.tag == 'stream':
+                self.streams.append(base64.b64decode(packet.text or '').decode('utf-8').rstrip('\0'))
+            elif packet.tag == 'response' and packet.get('transaction_id') == transaction_id:
+                break
+        error = packet.find('error')
+        if error is not None:
+            message = error.find('message')
+            raise RuntimeError('%s failed with error %s%s' % (name, error.get('code')
+                , ': ' + message.text if message is not None else ''))
+        return packet
+
+    def run(self, timeout=None):
+        """Resumes the script and returns the status it stopped with: "break" or "stopped"."""
+        return self.command('run', timeout=timeout).get('status')
+
+    def line(self):
+        """Returns the line number the script is paused at."""
+        return int(self.command('stack_get', '-d 0').find('stack').get('lineno'))
+
+    def value(self, name):
+        response = self.command('property_value', '-n ' + quote(name))
+        return base64.b64decode(response.text or '').decode('utf-8')
+
+    def set_breakpoint(self, line, *args, condition=None):
+        """Sets a breakpoint on a line of the main script file and returns its ID."""
+        if condition is not None:
+            args = ('-t conditional',) + args
+        else:
+            args = ('-t line',) + args
+        return self.command('breakpoint_set', '-n %d' % line, *args, data=condition).get('id')
+
+    def hit_count(self, breakpoint_id):
+        response = self.command('breakpoint_get', '-d ' + breakpoint_id)
+        return int(response.find('breakpoint').get('hit_count'))
+
+    def close(self):
+        """Disconnects and waits for the script to exit, returning its output."""
+        self.sock.close()
+        output, _ = self.process.communicate(timeout=self.timeout)
+        return output.decode('utf-8', 'replace')
@@ -0,0 +1,66 @@
+#include "CharSet_reference.h"
+#include "unit.h"
+#include <random>
+#include <string>
+
+//
+// Splits generated text the way Loop Parse and StrSplit() do, with the per-character searches of
+// the delimiter and omit lists used before CharSet and with CharSet, for typical lists: one
+// delimiter, several, several with omitted characters, and delimiters and omitted characters
+// above 0xFF.  The time is per character of input.  The optional argument is the number of
+// characters (default 10000000).
+//
+
+static std::wstring sBuf;
+
+template<typename L>
+static double Time(const std::wstring &aText, LPCTSTR aDelimiters, LPCTSTR aOmitList, L aLoop)
+{
+	sBuf = aText;
+	size_t count = 0;
+	unit::Timer timer;
+	aLoop(&sBuf[0], aDelimiters, aOmitList, [&](LPCTSTR aField) { ++count; unit::Use(aField); });
+	double t = timer.Elapsed();
+	unit::Use(count);
+	return t * 1e9 / aText.size();
+}
+
+static void Compare(LPCTSTR aLabel, const std::wstring &aText, LPCTSTR aDelimiters, LPCTSTR aOmitList)
+{
+	double old_loop = Time(aText, aDelimiters, aOmitList, [](LPTSTR aBuf, LPCTSTR aDelim, LPCTSTR aOmit, auto aField) {
+		ReferenceLoop(aBuf, aDelim, aOmit, aField); });
+	double new_loop = Time(aText, aDelimiters, aOmitList, [](LPTSTR aBuf, LPCTSTR aDelim, LPCTSTR aOmit, auto aField) {
+		CharSetLoop(aBuf, aDelim, aOmit, aField); });
+	printf("  %-24ls %8.2f ns %8.2f ns %6.1fx\n", aLabel, old_loop, new_loop, old_loop / new_loop);
+}
+
+static std::wstring Generate(size_t aSize, LPCTSTR aSeparators)
+{
+	static const wchar_t *sWords[] = { L"alpha", L"beta", L"gamma", L"delta", L"epsilon", L"zeta", L"12345", L"6.5" };
+	std::mt19937 rng(46);
+	size_t separator_count = wcslen(aSeparators);
+	std::wstring text;
+	text.reserve(aSize + 16);
+	while (text.size() < aSize)
+	{
+		if (rng() % 4 == 0)
+			text += L' ';
+		text += sWords[rng() % 8];
+		text += aSeparators[rng() % separator_count];
+	}
+	return text;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size = argc > 1 ? atoi(argv[1]) : 10000000;
+	printf("%zu chars, per char:      old loop   CharSet\n", size);
+	Compare(L"one delimiter", Generate(size, L","), L",", L"");
+	Compare(L"one delimiter, omit", Generate(size, L","), L",", L" \t");
+	Compare(L"three delimiters", Generate(size, L",;|"), L",;|", L"");
+	Compare(L"lines, omit CR/space", Generate(size, L"\n"), L"\n", L"\r \t");
+	Compare(L"whitespace delimiters", Generate(size, L" \t\r\n"), L" \t\r\n", L"");
+	Compare(L"non-ASCII, omit", Generate(size, L"\x2022\x3000"), L"\x2022\x3000", L"\x3000 ");
+	Compare(L"no delimiters", Generate(size / 10, L","), L"", L" ,");
+	return 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+//
+// The per-character searches which CharSet replaced, copied from util.h, and the loop of
+// Line::PerformLoopParse written with each, for CharSet_test and CharSet_bench.  Each loop parses
+// aBuf in place and passes each field to aField.  StrSplit() finds single-character delimiters and
+// trims omitted characters the same way.
+//
+
+typedef wchar_t TBYTE;
+
+#include "CharSet.h"
+
+template<typename T = LPTSTR>
+inline T StrChrAny(T aStr, LPCTSTR aCharList)
+{
+	if (aStr == NULL || aCharList == NULL) return NULL;
+	if (!*aStr || !*aCharList) return NULL;
+	LPCTSTR look_for_this_char;
+	TCHAR char_being_analyzed;
+	for (; *aStr; ++aStr)
+		for (char_being_analyzed = *aStr, look_for_this_char = aCharList; *look_for_this_char; ++look_for_this_char)
+			if (char_being_analyzed == *look_for_this_char)
+				return aStr;  // Match found.
+	return NULL; // No match.
+}
+
+template<typename T>
+inline T omit_leading_any(T aBuf, LPCTSTR aOmitList, size_t aLength)
+{
+	LPCTSTR cp;
+	for (size_t i = 0; i < aLength; ++i, ++aBuf)
+	{
+		for (cp = aOmitList; *cp; ++cp)
+			if (*aBuf == *cp) // Match found.
+				break;
+		if (!*cp) // No match found, so this character is not omitted, thus we immediately return it's position.
+			return aBuf;
+	}
+	return aBuf;
+}
+
+template<typename T>
+inline size_t omit_trailing_any(T aBuf, LPCTSTR aOmitList, T aBuf_marker)
+{
+	LPCTSTR cp;
+	for (; aBuf_marker > aBuf; --aBuf_marker)
+	{
+		for (cp = aOmitList; *cp; ++cp)
+			if (*aBuf_marker == *cp) // Match found.
+				break;
+		if (!*cp) // No match found, so this character is not omitted, thus we immediately return.
+			return (aBuf_marker - aBuf) + 1; // The length of the string when trailing chars are omitted.
+	}
+	for (cp = aOmitList; *cp; ++cp)
+		if (*aBuf_marker == *cp) // Match found.
+			return 0;
+	return 1;
+}
+
+// The loop of Line::PerformLoopParse before CharSet.
+template<typename F>
+static void ReferenceLoop(LPTSTR aBuf, LPCTSTR aDelimiters, LPCTSTR aOmitList, F aField)
+{
+	TCHAR *field, *field_end, saved_char;
+	size_t field_length;
+	if (!*aBuf)
+		return;
+	for (field = aBuf;;)
+	{
+		if (*aDelimiters)
+		{
+			if (   !(field_end = StrChrAny(field, aDelimiters))   )
+				field_end = field + wcslen(field);
+		}
+		else
+		{
+			if (*aOmitList && wcschr(aOmitList, *field))
+			{
+				++field;
+				if (!*field)
+					break;
+				continue;
+			}
+			field_end = field + 1;
+		}
+		saved_char = *field_end;
+		*field_end = '\0';
+		if (*aOmitList && *field && *aDelimiters)
+		{
+			field = omit_leading_any(field, aOmitList, field_end - field);
+			if (*field)
+			{
+				field_length = omit_trailing_any(field, aOmitList, field_end - 1);
+				field[field_length] = '\0';
+			}
+		}
+		aField(field);
+		if (!saved_char)
+			break;
+		*field_end = saved_char;
+		field = *aDelimiters ? field_end + 1 : field_end;
+	}
+}
+
+// The loop of Line::PerformLoopParse.
+template<typename F>
+static void CharSetLoop(LPTSTR aBuf, LPCTSTR aDelimiters, LPCTSTR aOmitList, F aField)
+{
+	TCHAR *field, *field_end, saved_char;
+	size_t field_length;
+	CharSet delimiter_set(aDelimiters), omit_set(aOmitList);
+	if (!*aBuf)
+		return;
+	for (field = aBuf;;)
+	{
+		if (*aDelimiters)
+		{
+			if (   !(field_end = delimiter_set.Find(field))   )
+				field_end = field + wcslen(field);
+		}
+		else
+		{
+			if (omit_set.Contains(*field))
+			{
+				++field;
+				if (!*field)
+					break;
+				continue;
+			}
+			field_end = field + 1;
+		}
+		saved_char = *field_end;
+		*field_end = '\0';
+		if (*aOmitList && *field && *aDelimiters)
+		{
+			field = omit_leading_any(field, omit_set, field_end - field);
+			if (*field)
+			{
+				field_length = omit_trailing_any(field, omit_set, field_end - 1);
+				field[field_length] = '\0';
+			}
+		}
+		aField(field);
+		if (!saved_char)
+			break;
+		*field_end = saved_char;
+		field = *aDelimiters ? field_end + 1 : field_end;
+	}
+}
@@ -0,0 +1,107 @@
+//
+// Tests for CharSet (CharSet.h), which replaced per-character searches of the delimiter and omit
+// lists in Loop Parse and StrSplit().  Each check compares CharSet with the function it replaced,
+// for lists of ASCII characters, characters above 0xFF and mixtures of both, and then compares the
+// fields found by Loop Parse with each.
+//
+
+#include "CharSet_reference.h"
+#include "unit.h"
+#include <random>
+#include <string>
+#include <vector>
+
+static LPCTSTR sLists[] = {
+	L"", L",", L"|", L" ", L"\t", L",;", L" \t\r\n", L"abc,", L"\x7F", L"\x80", L"\xFF",
+	L"\x100", L"\x2022", L"\xFFFF", L",\x2022", L"\x2022,", L"\x3000 \t", L"\xE9\xC9\x100\x2028",
+};
+
+// Characters from which test strings are built: ASCII, Latin-1 and characters above 0xFF,
+// including each character in the lists above.
+static const wchar_t sAlphabet[] = L"ab ,;|\t\r\nc\x7F\x80\xE9\xC9\xFF\x100\x2022\x2028\x3000\xFFFF";
+
+typedef std::vector<std::wstring> Fields;
+
+static std::wstring RandomString(std::mt19937 &aRng)
+{
+	std::wstring s(aRng() % 24, ' ');
+	for (auto &c : s)
+		c = sAlphabet[aRng() % (sizeof(sAlphabet) / sizeof(*sAlphabet) - 1)];
+	return s;
+}
+
+TEST(Contains)
+{
+	for (LPCTSTR list : sLists)
+	{
+		CharSet set(list);
+		for (unsigned c = 1; c <= 0xFFFF; ++c)
+			CHECK_EQ(set.Contains((TCHAR)c), wcschr(list, (TCHAR)c) != NULL);
+		CHECK(!set.Contains('\0'));
+	}
+}
+
+TEST(Find)
+{
+	std::mt19937 rng(46);
+	for (int i = 0; i < 100000; ++i)
+	{
+		std::wstring s = RandomString(rng);
+		for (LPCTSTR list : sLists)
+		{
+			CharSet set(list);
+			CHECK(set.Find(s.c_str()) == StrChrAny(s.c_str(), list));
+		}
+	}
+}
+
+TEST(Omit)
+{
+	std::mt19937 rng(46);
+	for (int i = 0; i < 100000; ++i)
+	{
+		std::wstring s = RandomString(rng);
+		if (s.empty())
+			continue;
+		LPCTSTR str = s.c_str(), end = str + s.size() - 1;
+		for (LPCTSTR list : sLists)
+		{
+			CharSet set(list);
+			size_t length = rng() % (s.size() + 1);
+			CHECK(omit_leading_any(str, set, length) == omit_leading_any(str, list, length));
+			CHECK_EQ(omit_trailing_any(str, set, end), omit_trailing_any(str, list, end));
+		}
+	}
+}
+
+static Fields Split(bool aCharSet, const std::wstring &aText, LPCTSTR aDelimiters, LPCTSTR aOmitList)
+{
+	Fields fields;
+	std::wstring buf = aText;
+	auto add = [&](LPCTSTR aField) { fields.push_back(aField); };
+	if (aCharSet)
+		CharSetLoop(&buf[0], aDelimiters, aOmitList, add);
+	else
+		ReferenceLoop(&buf[0], aDelimiters, aOmitList, add);
+	return fields;
+}
+
+TEST(LoopParse)
+{
+	std::mt19937 rng(46);
+	for (int i = 0; i < 20000; ++i)
+	{
+		std::wstring s = RandomString(rng);
+		for (LPCTSTR delimiters : sLists)
+			for (LPCTSTR omit : { L"", L" ", L" \t", L"\x2022", L"\x3000 ,", L"\xFFFF\xE9" })
+				CHECK(Split(true, s, delimiters, omit) == Split(false, s, delimiters, omit));
+	}
+	CHECK(Split(true, L" a ;b\x2022 c,,", L",;", L" \x2022") == Fields({ L"a", L"b\x2022 c", L"", L"" }));
+	CHECK(Split(true, L"a\x2022" L"b\x2022", L"\x2022", L"") == Fields({ L"a", L"b", L"" }));
+	CHECK(Split(true, L"a b\x3000", L"", L" \x3000") == Fields({ L"a", L"b" }));
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
@@ -0,0 +1,103 @@
+#include "CsvParse.h"
+#include "CsvParse_reference.h"
+#include "unit.h"
+#include <random>
+
+//
+// Parses generated CSV text with the loop Loop Parse CSV used before CsvParseField() and with the
+// current one, and reports the throughput in MB/s of ASCII text (one byte per character).
+//  - Lines: each line is copied and parsed on its own, as for Loop Read with Loop Parse CSV.
+//  - Rows: the whole text is parsed at once, as by CSVParse().
+//  - Escaped quotes: one long line of quoted fields containing pairs of quotes, for which the old
+//    loop moved the rest of the line once per pair.
+// The optional argument is the size of the generated text in MB (default 32).
+//
+
+static std::wstring sLine;
+
+static std::wstring Generate(size_t aSize, std::vector<size_t> &aLineStart)
+{
+	static const wchar_t *sWords[] = { L"alpha", L"beta", L"gamma", L"delta", L"epsilon", L"zeta" };
+	std::mt19937 rng(45);
+	std::wstring text;
+	text.reserve(aSize + 256);
+	while (text.size() < aSize)
+	{
+		aLineStart.push_back(text.size());
+		text += std::to_wstring(rng() % 1000000);
+		text += L",";
+		text += sWords[rng() % 6];
+		text += L",\"";
+		text += sWords[rng() % 6];
+		text += L", ";
+		text += sWords[rng() % 6];
+		text += L"\",";
+		if (rng() % 4 == 0)
+			text += L"\"say \"\"hi\"\"\"";
+		text += L",";
+		text += std::to_wstring((rng() % 100000) / 100.0);
+		text += L",,";
+		text += sWords[rng() % 6];
+		text += L"\r\n";
+	}
+	aLineStart.push_back(text.size());
+	return text;
+}
+
+template<typename P>
+static double Lines(const std::wstring &aText, const std::vector<size_t> &aLineStart, P aParse)
+{
+	size_t count = 0;
+	unit::Timer timer;
+	for (size_t i = 0; i + 1 < aLineStart.size(); ++i)
+	{
+		sLine.assign(aText, aLineStart[i], aLineStart[i + 1] - aLineStart[i] - 2); // Exclude `r`n.
+		aParse(&sLine[0], L"", [&](LPCTSTR aValue) { ++count; unit::Use(aValue); });
+	}
+	double t = timer.Elapsed();
+	unit::Use(count);
+	return t;
+}
+
+static void Report(LPCTSTR aLabel, size_t aChars, double aOld, double aNew)
+{
+	double mb = aChars / 1e6;
+	if (aOld)
+		printf("  %-16ls %9.1f MB/s %9.1f MB/s\n", aLabel, mb / aOld, mb / aNew);
+	else
+		printf("  %-16ls %14s %9.1f MB/s\n", aLabel, "-", mb / aNew);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size = (argc > 1 ? atoi(argv[1]) : 32) * 1000000;
+	std::vector<size_t> line_start;
+	std::wstring text = Generate(size, line_start);
+	printf("%zu lines, %.1f MB:       old loop  CsvParseField\n", line_start.size() - 1, text.size() / 1e6);
+
+	double old_lines = Lines(text, line_start, [](LPTSTR aBuf, LPCTSTR aOmit, auto aField) { ReferenceLoop(aBuf, aOmit, aField); });
+	double new_lines = Lines(text, line_start, [](LPTSTR aBuf, LPCTSTR aOmit, auto aField) { CurrentLoop(aBuf, aOmit, aField); });
+	Report(L"Lines", text.size(), old_lines, new_lines);
+
+	std::wstring copy = text;
+	size_t rows = 0, fields = 0;
+	unit::Timer timer;
+	RowsLoop(&copy[0], L"", [&] { ++rows; }, [&](LPCTSTR aValue) { ++fields; unit::Use(aValue); });
+	double new_rows = timer.Elapsed();
+	unit::Use(rows + fields);
+	Report(L"Rows", text.size(), 0, new_rows);
+
+	std::wstring quoted;
+	while (quoted.size() < 200000)
+		quoted += L"\"a \"\"quoted\"\" word\",";
+	std::wstring buf = quoted;
+	unit::Timer old_timer;
+	ReferenceLoop(&buf[0], L"", [&](LPCTSTR aValue) { unit::Use(aValue); });
+	double old_quoted = old_timer.Elapsed();
+	buf = quoted;
+	unit::Timer new_timer;
+	CurrentLoop(&buf[0], L"", [&](LPCTSTR aValue) { unit::Use(aValue); });
+	double new_quoted = new_timer.Elapsed();
+	Report(L"Escaped quotes", quoted.size(), old_quoted, new_quoted);
+	return 0;
+}
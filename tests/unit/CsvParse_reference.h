@@ -0,0 +1,152 @@
+#pragma once
+
+//
+// The loop Loop Parse CSV used before CsvParseField(), and the loops which now use it, for
+// CsvParse_test and CsvParse_bench.  Each loop parses aBuf in place and passes each field to
+// aField.  The omit list is applied the same way by each loop.
+//
+
+#include <string>
+#include <vector>
+
+static LPTSTR Omit(LPTSTR aField, LPTSTR aEnd, LPCTSTR aOmitList)
+// Same as omit_leading_any() and omit_trailing_any(), as used by Loop Parse CSV.
+{
+	if (!*aOmitList || !*aField)
+		return aField;
+	for (; aField < aEnd && wcschr(aOmitList, *aField); ++aField);
+	for (; aEnd > aField && wcschr(aOmitList, aEnd[-1]); --aEnd);
+	*aEnd = '\0';
+	return aField;
+}
+
+// The loop in Line::PerformLoopParseCSV before CsvParseField(): each pair of quotes within a
+// quoted field was collapsed by moving the rest of the string.
+template<typename F>
+static void ReferenceLoop(LPTSTR aBuf, LPCTSTR aOmitList, F aField)
+{
+	if (!*aBuf)
+		return;
+	TCHAR *field, *field_end, saved_char;
+	bool field_is_enclosed_in_quotes;
+
+	for (field = aBuf;;)
+	{
+		if (*field == '"')
+		{
+			field_is_enclosed_in_quotes = true;
+			++field;
+		}
+		else
+			field_is_enclosed_in_quotes = false;
+
+		for (field_end = field;;)
+		{
+			if (   !(field_end = wcschr(field_end, field_is_enclosed_in_quotes ? '"' : ','))   )
+			{
+				field_end = field + wcslen(field);
+				break;
+			}
+			if (field_is_enclosed_in_quotes)
+			{
+				if (field_end[1] == '"')  // A pair of quotes was encountered.
+				{
+					wmemmove(field_end, field_end + 1, wcslen(field_end + 1) + 1); // +1 to include terminator.
+					++field_end; // Skip over the literal double quote that we just produced.
+					continue; // Keep looking for the "real" ending quote.
+				}
+			}
+			break;
+		}
+
+		saved_char = *field_end; // This can be the terminator, a comma, or a double-quote.
+		*field_end = '\0';
+
+		aField(Omit(field, field_end, aOmitList));
+
+		if (!saved_char) // The last item in the list has just been processed, so the loop is done.
+			break;
+		if (saved_char == ',') // Set "field" to be the position of the next field.
+			field = field_end + 1;
+		else // saved_char must be a double-quote char.
+		{
+			field = field_end + 1;
+			if (!*field) // No more fields occur after this one.
+				break;
+			if (   !(field = wcschr(field, ','))   ) // No more fields.
+				break;
+			++field;
+		}
+	}
+}
+
+// The loop in Line::PerformLoopParseCSV.
+template<typename F>
+static void CurrentLoop(LPTSTR aBuf, LPCTSTR aOmitList, F aField)
+{
+	if (!*aBuf)
+		return;
+	TCHAR *field, *field_end, *value_end, saved_char;
+	for (field = aBuf;;)
+	{
+		field_end = CsvParseField(field, field, value_end, false);
+		saved_char = *field_end;
+		*value_end = '\0';
+		aField(Omit(field, value_end, aOmitList));
+		if (!saved_char)
+			break;
+		field = field_end + 1;
+	}
+}
+
+// The loop in CSVParse() with no Columns, which calls aRow at the start of each row.
+template<typename R, typename F>
+static void RowsLoop(LPTSTR aBuf, LPCTSTR aOmitList, R aRow, F aField)
+{
+	for (LPTSTR field = aBuf; *field; )
+	{
+		aRow();
+		if (*field == '\n' || (*field == '\r' && field[1] == '\n'))
+		{
+			field += 1 + (*field == '\r');
+			continue;
+		}
+		for (;;)
+		{
+			LPTSTR value, value_end;
+			LPTSTR field_end = CsvParseField(field, value, value_end, true);
+			TCHAR delimiter = *field_end;
+			*value_end = '\0'; // Only for Omit(); CSVParse() appends the value by its length instead.
+			aField(Omit(value, value_end, aOmitList));
+			field = delimiter ? field_end + 1 : field_end;
+			if (delimiter != ',')
+				break;
+		}
+	}
+}
+
+typedef std::vector<std::wstring> Fields;
+
+static Fields ReferenceParse(LPCTSTR aText, LPCTSTR aOmitList)
+{
+	Fields fields;
+	std::wstring copy = aText;
+	ReferenceLoop(&copy[0], aOmitList, [&](LPCTSTR aValue) { fields.push_back(aValue); });
+	return fields;
+}
+
+static Fields LoopParseCSV(LPCTSTR aText, LPCTSTR aOmitList)
+{
+	Fields fields;
+	std::wstring copy = aText;
+	CurrentLoop(&copy[0], aOmitList, [&](LPCTSTR aValue) { fields.push_back(aValue); });
+	return fields;
+}
+
+static std::vector<Fields> ParseRows(LPCTSTR aText, LPCTSTR aOmitList)
+{
+	std::vector<Fields> rows;
+	std::wstring copy = aText;
+	RowsLoop(&copy[0], aOmitList, [&] { rows.emplace_back(); }, [&](LPCTSTR aValue) { rows.back().push_back(aValue); });
+	return rows;
+}
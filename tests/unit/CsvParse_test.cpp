@@ -0,0 +1,106 @@
+//
+// Differential tests for CsvParseField().  Each string is split by ReferenceParse(), the loop Loop
+// Parse CSV used before, and by the current loop, and the fields must be identical.  Rows are
+// checked by parsing single lines the same way and by a few cases with the expected fields.
+//
+
+#include "CsvParse.h"
+#include "CsvParse_reference.h"
+#include "unit.h"
+#include <random>
+
+static void Compare(LPCTSTR aText, LPCTSTR aOmitList = L"")
+{
+	Fields expected = ReferenceParse(aText, aOmitList);
+	Fields actual = LoopParseCSV(aText, aOmitList);
+	CHECK(actual == expected);
+	if (actual != expected)
+		printf("  for \"%ls\" with omit list \"%ls\"\n", aText, aOmitList);
+	// A single line parsed as rows gives one row with the same fields.
+	if (*aText && !wcschr(aText, '\n'))
+	{
+		std::vector<Fields> rows = ParseRows(aText, aOmitList);
+		CHECK(rows.size() == 1 && rows[0] == expected);
+	}
+}
+
+TEST(QuotedFields)
+{
+	Compare(L"a,b,c");
+	Compare(L"\"a\",\"b,c\",d");
+	Compare(L"\"a\"x,b");            // Text after the ending quote is ignored.
+	Compare(L"\"a\"x");
+	Compare(L"\"unterminated,b");
+	Compare(L"a\"b\",c");            // A quote within an unquoted field is literal.
+	Compare(L"\"\"");
+	Compare(L"\"\",\"\"");
+	Compare(L"\"");
+}
+
+TEST(EscapedQuotes)
+{
+	Compare(L"\"\"\"string with escaped quotes\"\"\"");
+	Compare(L"\"a\"\"b\",\"\"\"\"\"\"");
+	Compare(L"\"a\"\"\",b");
+	Compare(L"\"a\"\"");             // A pair at the end, with no ending quote.
+	Compare(L"\"\"\"\"\"\"\"\"\"\"");
+	Fields fields = LoopParseCSV(L"\"say \"\"hi\"\"\",\"\"\"\"", L"");
+	CHECK(fields == Fields({ L"say \"hi\"", L"\"" }));
+}
+
+TEST(EmptyFields)
+{
+	Compare(L"a,");
+	Compare(L"a,,");
+	Compare(L",");
+	Compare(L",,a");
+	Compare(L"\"a\",");
+	Compare(L"\"a\",,");
+	Compare(L"\"a\"x,");
+	CHECK(LoopParseCSV(L"\"a\",,", L"") == Fields({ L"a", L"", L"" }));
+	CHECK(LoopParseCSV(L"", L"").empty());
+}
+
+TEST(OmitChars)
+{
+	Compare(L" a , b ,c ", L" ");
+	Compare(L"\" a \" , \"b\"", L" ");   // The leading space means the second field isn't quoted.
+	Compare(L"xx,x\"\"x,\"x\"", L"x");
+	Compare(L"  ,  ", L" ");
+}
+
+TEST(Random)
+{
+	// Short strings from a small alphabet cover every arrangement of quotes and commas.
+	static const wchar_t sAlphabet[] = L"\",\",ab ";
+	static LPCTSTR sOmitLists[] = { L"", L" ", L"a\"" };
+	std::mt19937 rng(45);
+	wchar_t text[24];
+	for (int i = 0; i < 300000; ++i)
+	{
+		int length = rng() % 20;
+		for (int j = 0; j < length; ++j)
+			text[j] = sAlphabet[rng() % (sizeof(sAlphabet) / sizeof(*sAlphabet) - 1)];
+		text[length] = '\0';
+		Compare(text, sOmitLists[i % 3]);
+	}
+}
+
+TEST(Rows)
+{
+	typedef std::vector<Fields> Rows;
+	CHECK(ParseRows(L"a,b\nc,d\n", L"") == Rows({ { L"a", L"b" }, { L"c", L"d" } }));
+	CHECK(ParseRows(L"a,b\r\nc,d", L"") == Rows({ { L"a", L"b" }, { L"c", L"d" } }));
+	CHECK(ParseRows(L"a,\r\n,b\r\n", L"") == Rows({ { L"a", L"" }, { L"", L"b" } }));
+	CHECK(ParseRows(L"\"multi\r\nline\",x\n\"q\"\"\"\r\n", L"") == Rows({ { L"multi\r\nline", L"x" }, { L"q\"" } }));
+	CHECK(ParseRows(L"\"a\"junk\r\nb", L"") == Rows({ { L"a" }, { L"b" } }));
+	CHECK(ParseRows(L"a\n\nb\r\n\r\n", L"") == Rows({ { L"a" }, {}, { L"b" }, {} }));
+	CHECK(ParseRows(L"a\rb,c", L"") == Rows({ { L"a\rb", L"c" } })); // Only `n or `r`n ends a row.
+	CHECK(ParseRows(L" a ,b \r\n", L" ") == Rows({ { L"a", L"b" } }));
+	CHECK(ParseRows(L"", L"").empty());
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+//
+// Parameters for Format() as a built-in function receives them, and Reference(), the single-pass
+// implementation Format() used before format strings were compiled, for FormatProgram_test.cpp
+// and FormatProgram_bench.cpp.
+//
+
+#include <string>
+#include <vector>
+
+static IObject sObject;
+
+struct Value
+{
+	ExprTokenType token;
+	std::wstring text;
+};
+
+static Value Int(__int64 n) { Value v; v.token.symbol = SYM_INTEGER; v.token.value_int64 = n; return v; }
+static Value Float(double n) { Value v; v.token.symbol = SYM_FLOAT; v.token.value_double = n; return v; }
+static Value Str(LPCTSTR s) { Value v; v.token.symbol = SYM_STRING; v.text = s; return v; }
+static Value Obj() { Value v; v.token.symbol = SYM_OBJECT; v.token.object = &sObject; return v; }
+
+struct Result
+{
+	std::wstring text;
+	int bad_param = 0; // Parameter of the wrong type, if any.
+	bool expected_string = false; // Whether bad_param was expected to be a String, rather than a Number.
+
+	bool operator==(const Result &r) const
+	{
+		return bad_param ? bad_param == r.bad_param && expected_string == r.expected_string : !r.bad_param && text == r.text;
+	}
+};
+
+// Holds the format string and parameters as the tokens a built-in function receives.
+struct Call
+{
+	std::vector<Value> values;
+	std::vector<ExprTokenType *> params;
+
+	Call(LPCTSTR aFormat, std::vector<Value> aParams)
+	{
+		values.push_back(Str(aFormat));
+		values.insert(values.end(), aParams.begin(), aParams.end());
+		for (auto &v : values)
+		{
+			if (v.token.symbol == SYM_STRING)
+				v.token.marker = &v.text[0];
+			params.push_back(&v.token);
+		}
+	}
+};
+
+static int RefPrint(LPTSTR aTarget, LPCTSTR aSpec, ExprTokenType &aValue)
+{
+	switch (aValue.symbol)
+	{
+	case SYM_INTEGER: return aTarget ? _stprintf(aTarget, aSpec, aValue.value_int64) : _sctprintf(aSpec, aValue.value_int64);
+	case SYM_FLOAT: return aTarget ? _stprintf(aTarget, aSpec, aValue.value_double) : _sctprintf(aSpec, aValue.value_double);
+	default: return aTarget ? _stprintf(aTarget, aSpec, aValue.marker) : _sctprintf(aSpec, aValue.marker);
+	}
+}
+
+// BIF_Format as it was before FormatProgram, with these changes: errors are returned rather than
+// thrown, values are passed to printf with their own type (see FormatValue() in FormatProgram.cpp),
+// and the type lookups check for the end of the string, which the original matched in _tcschr()
+// for a format ending in something like "{1:", reading past the end.
+static Result Reference(Call &aCall)
+{
+	ExprTokenType **aParam = aCall.params.data();
+	int aParamCount = (int)aCall.params.size();
+	Result result;
+	LPCTSTR fmt = aParam[0]->marker, lit, cp, cp_end, cp_spec;
+	LPTSTR target = NULL;
+	std::vector<TCHAR> buf;
+	int size = 0, spec_len;
+	int param, last_param;
+	TCHAR number_buf[MAX_NUMBER_SIZE];
+	TCHAR spec[12+MAX_INTEGER_LENGTH*2];
+	TCHAR custom_format;
+	ExprTokenType value;
+	*spec = '%';
+
+	for (;;)
+	{
+		last_param = 0;
+
+		for (lit = cp = fmt;; )
+		{
+			for (cp_end = cp; *cp_end && *cp_end != '{'; ++cp_end);
+			if (cp_end > lit)
+			{
+				if (target)
+					tmemcpy(target, lit, cp_end - lit), target += cp_end - lit;
+				else
+					size += int(cp_end - lit);
+				lit = cp_end;
+			}
+			cp = cp_end;
+			if (!*cp)
+				break;
+			++cp;
+			if ((*cp == '{' || *cp == '}') && cp[1] == '}')
+			{
+				if (target)
+					*target++ = *cp;
+				else
+					++size;
+				cp += 2;
+				lit = cp;
+				continue;
+			}
+
+			for (cp_end = cp; *cp_end >= '0' && *cp_end <= '9'; ++cp_end);
+			if (cp_end > cp)
+				param = ATOI(cp), cp = cp_end;
+			else
+				param = last_param + 1;
+			if (param >= aParamCount || param < 1)
+				continue;
+
+			custom_format = 0;
+
+			if (*cp == ':')
+			{
+				cp_spec = ++cp;
+				for (cp = cp_spec; *cp && _tcschr(_T("-+0 #"), *cp); ++cp);
+				for ( ; *cp >= '0' && *cp <= '9'; ++cp);
+				if (*cp == '.') do ++cp; while (*cp >= '0' && *cp <= '9');
+				spec_len = int(cp - cp_spec);
+
+				if (spec_len + 4 >= (int)_countof(spec))
+					continue;
+				tmemcpy(spec + 1, cp_spec, spec_len);
+				++spec_len;
+
+				if (*cp && _tcschr(_T("diouxX"), *cp))
+				{
+					spec[spec_len++] = 'I';
+					spec[spec_len++] = '6';
+					spec[spec_len++] = '4';
+					value.symbol = SYM_INTEGER;
+					spec[spec_len++] = *cp++;
+				}
+				else if (*cp && _tcschr(_T("eEfgGaA"), *cp))
+				{
+					value.symbol = SYM_FLOAT;
+					spec[spec_len++] = *cp++;
+				}
+				else if (*cp && _tcschr(_T("cCp"), *cp))
+				{
+					value.symbol = SYM_INTEGER;
+					spec[spec_len++] = *cp++;
+				}
+				else
+				{
+					value.symbol = SYM_STRING;
+					spec[spec_len++] = 's';
+					if (*cp && _tcschr(_T("ULlTt"), *cp))
+						custom_format = toupper(*cp++);
+					if (*cp == 's')
+						++cp;
+				}
+			}
+			else
+			{
+				value.symbol = SYM_STRING;
+				spec[1] = 's';
+				spec_len = 2;
+			}
+			if (value.symbol == SYM_STRING)
+			{
+				if (TokenToObject(*aParam[param]))
+				{
+					result.bad_param = param, result.expected_string = true;
+					return result;
+				}
+				value.marker = TokenToString(*aParam[param], number_buf);
+			}
+			else
+			{
+				if (!TokenIsNumeric(*aParam[param]))
+				{
+					result.bad_param = param;
+					return result;
+				}
+				if (value.symbol == SYM_INTEGER)
+					value.value_int64 = TokenToInt64(*aParam[param]);
+				else
+					value.value_double = TokenToDouble(*aParam[param]);
+			}
+			spec[spec_len] = '\0';
+
+			if (*cp != '}')
+				continue;
+			++cp;
+			lit = cp;
+
+			last_param = param;
+
+			if (target)
+			{
+				int len = RefPrint(target, spec, value);
+				switch (custom_format)
+				{
+				case 0: break;
+				case 'U': CharUpper(target); break;
+				case 'L': CharLower(target); break;
+				case 'T': StrToTitleCase(target); break;
+				}
+				target += len;
+			}
+			else
+				size += RefPrint(NULL, spec, value);
+		}
+		if (target)
+		{
+			*target = '\0';
+			result.text.assign(buf.data(), target - buf.data());
+			return result;
+		}
+		buf.resize(size + 1);
+		target = buf.data();
+	}
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+//
+// Stand-in for the parts of script.h, defines.h and util.h which FormatProgram.cpp uses.  Tokens
+// hold an integer, a float, a string or an object; strings are converted to numbers with the C
+// library, which is enough for the values the tests use, since the reference implementation in
+// FormatProgram_test.cpp converts them the same way.
+//
+
+#define script_h
+
+#include <string>
+
+#define MAX_INTEGER_LENGTH 20
+#define MAX_NUMBER_SIZE 256
+#define _countof(a) (sizeof(a) / sizeof(*(a)))
+
+enum SymbolType { SYM_STRING, SYM_INTEGER, SYM_FLOAT, SYM_OBJECT };
+
+struct IObject { int unused; };
+
+struct ExprTokenType
+{
+	union
+	{
+		__int64 value_int64;
+		double value_double;
+		IObject *object;
+		LPTSTR marker;
+	};
+	SymbolType symbol;
+};
+
+inline int ATOI(LPCTSTR buf) { return (int)wcstoll(buf, NULL, 10); }
+
+inline IObject *TokenToObject(ExprTokenType &aToken)
+{
+	return aToken.symbol == SYM_OBJECT ? aToken.object : NULL;
+}
+
+inline SymbolType TokenIsNumeric(ExprTokenType &aToken)
+{
+	if (aToken.symbol != SYM_STRING)
+		return aToken.symbol == SYM_OBJECT ? SYM_STRING : aToken.symbol;
+	LPTSTR end;
+	if (!*aToken.marker)
+		return SYM_STRING;
+	wcstoll(aToken.marker, &end, 0);
+	if (!*end)
+		return SYM_INTEGER;
+	wcstod(aToken.marker, &end);
+	return *end ? SYM_STRING : SYM_FLOAT;
+}
+
+inline __int64 TokenToInt64(ExprTokenType &aToken)
+{
+	switch (aToken.symbol)
+	{
+	case SYM_INTEGER: return aToken.value_int64;
+	case SYM_FLOAT: return (__int64)aToken.value_double;
+	default: return TokenIsNumeric(aToken) == SYM_INTEGER ? wcstoll(aToken.marker, NULL, 0) : (__int64)wcstod(aToken.marker, NULL);
+	}
+}
+
+inline double TokenToDouble(ExprTokenType &aToken)
+{
+	switch (aToken.symbol)
+	{
+	case SYM_INTEGER: return (double)aToken.value_int64;
+	case SYM_FLOAT: return aToken.value_double;
+	default: return TokenIsNumeric(aToken) == SYM_INTEGER ? (double)wcstoll(aToken.marker, NULL, 0) : wcstod(aToken.marker, NULL);
+	}
+}
+
+inline LPTSTR TokenToString(ExprTokenType &aToken, LPTSTR aBuf)
+{
+	switch (aToken.symbol)
+	{
+	case SYM_INTEGER: swprintf(aBuf, MAX_NUMBER_SIZE, L"%lld", aToken.value_int64); return aBuf;
+	case SYM_FLOAT: swprintf(aBuf, MAX_NUMBER_SIZE, L"%.17g", aToken.value_double); return aBuf;
+	default: return aToken.marker;
+	}
+}
+
+inline LPTSTR CharUpper(LPTSTR aStr) { for (LPTSTR cp = aStr; *cp; ++cp) *cp = towupper(*cp); return aStr; }
+inline LPTSTR CharLower(LPTSTR aStr) { for (LPTSTR cp = aStr; *cp; ++cp) *cp = towlower(*cp); return aStr; }
+
+inline LPTSTR StrToTitleCase(LPTSTR aStr)
+{
+	for (bool convert_next_alpha_char_to_upper = true; *aStr; ++aStr)
+	{
+		if (iswalpha(*aStr))
+		{
+			*aStr = convert_next_alpha_char_to_upper ? towupper(*aStr) : towlower(*aStr);
+			convert_next_alpha_char_to_upper = false;
+		}
+		else if (iswspace(*aStr))
+			convert_next_alpha_char_to_upper = true;
+	}
+	return aStr;
+}
+
+// The Microsoft CRT's wide printf functions take %s as a wide string, %c as a wide character and
+// %C as a narrow one, and accept the I64 size prefix; glibc's use %ls, %lc, %c and ll.  Format()
+// specs have a single conversion, at the end.  Where glibc fails (such as for a character it
+// can't convert), the result is empty; the CRT would output something, but both implementations
+// see the same result.
+inline std::wstring CrtSpec(LPCTSTR aSpec)
+{
+	std::wstring spec = aSpec;
+	size_t pos = spec.find(L"I64");
+	if (pos != std::wstring::npos)
+		spec.replace(pos, 3, L"ll");
+	switch (spec.back())
+	{
+	case 's':
+	case 'c': spec.insert(spec.size() - 1, L"l"); break;
+	case 'C': spec.back() = 'c'; break;
+	}
+	return spec;
+}
+
+// Both format into a buffer of their own first, since glibc may write part of the output before
+// failing, which would overrun a target sized by _sctprintf().
+#define FORMAT_STUB_BUF_SIZE 65536
+
+inline int FormatStub(LPTSTR aBuf, LPCTSTR aSpec, va_list aArgs)
+{
+	static TCHAR sBuf[FORMAT_STUB_BUF_SIZE];
+	int result = vswprintf(sBuf, FORMAT_STUB_BUF_SIZE, CrtSpec(aSpec).c_str(), aArgs);
+	if (result < 0)
+		result = 0;
+	if (aBuf)
+		tmemcpy(aBuf, sBuf, result), aBuf[result] = '\0';
+	return result;
+}
+
+inline int _stprintf(LPTSTR aBuf, LPCTSTR aSpec, ...)
+{
+	va_list args;
+	va_start(args, aSpec);
+	int result = FormatStub(aBuf, aSpec, args);
+	va_end(args);
+	return result;
+}
+
+inline int _sctprintf(LPCTSTR aSpec, ...)
+{
+	va_list args;
+	va_start(args, aSpec);
+	int result = FormatStub(NULL, aSpec, args);
+	va_end(args);
+	return result;
+}
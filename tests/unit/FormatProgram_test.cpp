@@ -0,0 +1,195 @@
+//
+// Differential tests for FormatProgram.  Each case formats the same parameters with Reference(),
+// the single-pass implementation Format() used before format strings were compiled, and with the
+// compiled program run the way BIF_Format runs it, and checks that the results (or the parameter
+// reported as having the wrong type) are identical.  A few cases also check the expected text, so
+// that both implementations being wrong in the same way would still be noticed.
+//
+
+#include "FormatProgram.h"
+#include "FormatProgram_reference.h"
+#include "unit.h"
+#include <random>
+
+// The compiled program, used the way BIF_Format uses it.
+static Result Compiled(Call &aCall, bool *aCached = nullptr)
+{
+	Result result;
+	LPCTSTR fmt = aCall.params[0]->marker;
+	bool cached;
+	FormatProgram *program = FormatProgram::Get(fmt, wcslen(fmt), (int)aCall.params.size(), cached);
+	CHECK(program != nullptr);
+	size_t length;
+	if (FormatItem *item = program->Run(aCall.params.data(), NULL, length))
+	{
+		result.bad_param = item->param;
+		result.expected_string = item->symbol == SYM_STRING;
+	}
+	else
+	{
+		result.text.resize(length);
+		size_t written;
+		CHECK(!program->Run(aCall.params.data(), &result.text[0], written));
+		CHECK_EQ(written, length);
+	}
+	if (!cached)
+		free(program);
+	if (aCached)
+		*aCached = cached;
+	return result;
+}
+
+static int sMismatches = 0;
+
+static Result Check(LPCTSTR aFormat, std::vector<Value> aParams)
+{
+	Call call(aFormat, aParams);
+	Result expected = Reference(call), actual = Compiled(call);
+	if (!(actual == expected))
+	{
+		if (++sMismatches <= 20)
+			printf("  \"%ls\" with %zu params: \"%ls\" (bad %d), expected \"%ls\" (bad %d)\n", aFormat, aParams.size()
+				, actual.text.c_str(), actual.bad_param, expected.text.c_str(), expected.bad_param);
+		CHECK(false);
+	}
+	return actual;
+}
+
+static std::wstring Text(LPCTSTR aFormat, std::vector<Value> aParams)
+{
+	Result r = Check(aFormat, aParams);
+	return r.bad_param ? L"<bad " + std::to_wstring(r.bad_param) + L">" : r.text;
+}
+
+static std::vector<Value> SampleValues()
+{
+	return {
+		Int(0), Int(42), Int(-42), Int(65), Int(255), Int(INT64_MAX), Int(INT64_MIN), Int(0x10000)
+		, Float(3.14159), Float(-0.0), Float(1e300), Float(1e-5), Float(-2.5)
+		, Str(L""), Str(L"abc"), Str(L"hello woRLD"), Str(L"123"), Str(L"-7.5"), Str(L"0x1F"), Str(L"mIxEd  case\tX")
+		, Obj()
+	};
+}
+
+TEST(Specifiers)
+{
+	static LPCTSTR sTypes[] = { L"", L"d", L"i", L"o", L"u", L"x", L"X", L"e", L"E", L"f", L"g", L"G", L"a", L"A"
+		, L"c", L"C", L"p", L"s", L"U", L"L", L"l", L"T", L"t", L"Us", L"q" };
+	static LPCTSTR sFlags[] = { L"", L"-", L"+", L"0", L" ", L"#", L"-+0 #" };
+	static LPCTSTR sWidths[] = { L"", L"1", L"12" };
+	static LPCTSTR sPrecisions[] = { L"", L".", L".0", L".3" };
+	auto values = SampleValues();
+	for (LPCTSTR type : sTypes)
+		for (LPCTSTR flags : sFlags)
+			for (LPCTSTR width : sWidths)
+				for (LPCTSTR precision : sPrecisions)
+				{
+					std::wstring fmt = L"<{1:" + std::wstring(flags) + width + precision + type + L"}>";
+					for (auto &value : values)
+						Check(fmt.c_str(), { value });
+				}
+	for (auto &value : values)
+	{
+		Check(L"{}", { value });
+		Check(L"{1}", { value });
+		Check(L"{:}", { value });
+	}
+}
+
+TEST(Expected)
+{
+	CHECK(Text(L"{:05d}", { Int(42) }) == L"00042");
+	CHECK(Text(L"{:x}|{:X}|{:#o}", { Int(255), Int(255), Int(8) }) == L"ff|FF|010");
+	CHECK(Text(L"{:.2f}|{:+e}", { Float(3.14159), Str(L"1") }) == L"3.14|+1.000000e+00");
+	CHECK(Text(L"{:d}", { Int(INT64_MIN) }) == L"-9223372036854775808"); // Not truncated to 32 bits.
+	CHECK(Text(L"{:U}|{:L}|{:T}|{:l}|{:t}", { Str(L"abc"), Str(L"ABC"), Str(L"hello woRLD"), Str(L"X"), Str(L"a b") }) == L"ABC|abc|Hello World|x|A B");
+	CHECK(Text(L"{:-5}|{:5}|{:.2}", { Str(L"ab"), Str(L"ab"), Str(L"abc") }) == L"ab   |   ab|ab");
+	CHECK(Text(L"{:c}{:c}", { Int(72), Str(L"105") }) == L"Hi");
+	CHECK(Text(L"{2}{1}{}", { Str(L"a"), Str(L"b") }) == L"bab"); // {} follows the last index used.
+	CHECK(Text(L"{} {} {}", { Int(1), Int(2) }) == L"1 2 {}");
+	CHECK(Text(L"{{}{}}{{}}", { }) == L"{}{}");
+	CHECK(Text(L"{3}{0}{-1}{", { Int(1), Int(2) }) == L"{3}{0}{-1}{");
+	CHECK(Text(L"{1:", { Int(1) }) == L"{1:");
+	CHECK(Text(L"{1:d", { Int(1) }) == L"{1:d");
+	CHECK(Text(L"{1:q}", { Int(1) }) == L"{1:q}");
+	CHECK(Text(L"{1:}", { Float(0.5) }) == L"0.5");
+	CHECK(Text(L"{1:000000000000000000000000000000000000000000000000000001d}", { Int(1) })
+		== L"{1:000000000000000000000000000000000000000000000000000001d}"); // Specifier too long.
+	CHECK(Text(L"", { }) == L"");
+}
+
+TEST(TypeErrors)
+{
+	CHECK(Text(L"{:d}", { Str(L"abc") }) == L"<bad 1>");
+	CHECK(Text(L"{:f}", { Obj() }) == L"<bad 1>");
+	CHECK(Text(L"{1}{2:x}{3}", { Int(1), Int(2), Obj() }) == L"<bad 3>");
+	CHECK(Text(L"{2}{1:d}", { Str(L"x"), Obj() }) == L"<bad 2>");
+	CHECK(Text(L"{1:d", { Str(L"abc") }) == L"<bad 1>"); // Output literally, but still type-checked.
+	CHECK(Text(L"{2:q}", { Int(1), Obj() }) == L"<bad 2>");
+	CHECK(Text(L"{3}", { Obj(), Obj() }) == L"{3}"); // Invalid index, so not checked.
+	Call call(L"{:d}{}", { Str(L"a"), Obj() });
+	Result r = Compiled(call);
+	CHECK(r.bad_param == 1 && !r.expected_string);
+	Call call2(L"{:d}{}", { Int(1), Obj() });
+	r = Compiled(call2);
+	CHECK(r.bad_param == 2 && r.expected_string);
+}
+
+TEST(Random)
+{
+	// Format strings built from fragments which exercise each branch of the parser, including
+	// placeholders broken off at any point.
+	static LPCTSTR sPieces[] = {
+		L"{", L"}", L"{{}", L"{}}", L"{}", L"{1}", L"{2}", L"{3}", L"{0}", L"{9}", L"{:", L":", L"{1:", L"{2:"
+		, L"-", L"+", L"0", L" ", L"#", L"1", L"12", L".", L".3", L"d", L"x", L"o", L"c", L"C", L"p", L"e", L"f", L"g", L"a"
+		, L"s", L"U", L"L", L"T", L"t", L"l", L"q", L"ab", L"Lit ", L"\x00e9", L"00000000000000000000000000"
+	};
+	auto values = SampleValues();
+	std::mt19937 rng(12345);
+	for (int i = 0; i < 200000; ++i)
+	{
+		std::wstring fmt;
+		for (int n = rng() % 12; n >= 0; --n)
+			fmt += sPieces[rng() % _countof(sPieces)];
+		std::vector<Value> params;
+		for (int n = rng() % 5; n > 0; --n)
+			params.push_back(values[rng() % values.size()]);
+		Check(fmt.c_str(), params);
+	}
+	CHECK_EQ(sMismatches, 0);
+}
+
+TEST(Cache)
+{
+	// The same string is compiled once per parameter count, since that decides which indices
+	// are valid.
+	bool cached;
+	Call one(L"[{2}]", { Int(1) }), two(L"[{2}]", { Int(1), Int(2) });
+	CHECK(Compiled(one).text == L"[{2}]");
+	CHECK(Compiled(two).text == L"[2]");
+	Compiled(one, &cached);
+	CHECK(cached);
+	CHECK(Compiled(one).text == L"[{2}]");
+	CHECK(Compiled(two).text == L"[2]");
+
+	// Strings which don't fit in the cache are compiled each time and freed by the caller.
+	std::wstring long_fmt(FORMAT_PROGRAM_CACHE_MAX_LENGTH, 'x');
+	long_fmt += L"{}";
+	Call long_call(long_fmt.c_str(), { Str(L"!") });
+	Result r = Compiled(long_call, &cached);
+	CHECK(!cached);
+	CHECK(r.text == std::wstring(FORMAT_PROGRAM_CACHE_MAX_LENGTH, 'x') + L"!");
+
+	// Many more strings than slots: each result is still right after its slot is reused.
+	for (int round = 0; round < 3; ++round)
+		for (int i = 0; i < FORMAT_PROGRAM_CACHE_SIZE * 4; ++i)
+		{
+			std::wstring fmt = L"{1:0" + std::to_wstring(i % 20 + 1) + L"d}/" + std::to_wstring(i);
+			Check(fmt.c_str(), { Int(i) });
+		}
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
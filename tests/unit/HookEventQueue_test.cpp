@@ -0,0 +1,179 @@
+//
+// Tests for HookEventQueue, including a stress test with the producer (standing in for the hook
+// thread) and consumer (standing in for the main thread) running concurrently.
+//
+
+#include "HookEventQueue.h"
+#include "unit.h"
+#include <thread>
+
+static HookEvent MakeEvent(UINT aSeq)
+{
+	// Each field is derived from the sequence number so that a torn read can be detected.
+	HookEvent event;
+	event.time = (__int64)aSeq * 7919;
+	event.message = 0x8000 + (aSeq & 1);
+	event.id = aSeq;
+	event.sc = (USHORT)(aSeq * 3);
+	event.input_level = (UCHAR)(aSeq % 101);
+	return event;
+}
+
+static bool IsIntact(const HookEvent &aEvent)
+{
+	HookEvent expected = MakeEvent(aEvent.id);
+	return aEvent.time == expected.time && aEvent.message == expected.message
+		&& aEvent.sc == expected.sc && aEvent.input_level == expected.input_level;
+}
+
+
+TEST(PushPop)
+{
+	static HookEventQueue q;
+	HookEvent e {};
+	CHECK(!q.Pop(e));
+	for (UINT i = 0; i < 10; ++i)
+		CHECK(q.Push(MakeEvent(i)));
+	CHECK_EQ(q.Depth(), 10U);
+	CHECK_EQ(q.HighWater(), 10U);
+	for (UINT i = 0; i < 10; ++i)
+	{
+		CHECK(q.Pop(e));
+		CHECK_EQ(e.id, i);
+		CHECK(IsIntact(e));
+	}
+	CHECK(!q.Pop(e));
+	CHECK_EQ(q.Depth(), 0U);
+}
+
+TEST(Overflow)
+{
+	static HookEventQueue q;
+	for (UINT i = 0; i < HookEventQueue::Capacity; ++i)
+		CHECK(q.Push(MakeEvent(i)));
+	CHECK(!q.Push(MakeEvent(999)));
+	CHECK(!q.Push(MakeEvent(1000)));
+	CHECK_EQ(q.Overflows(), 2U);
+	CHECK_EQ(q.HighWater(), (UINT)HookEventQueue::Capacity);
+	HookEvent e {};
+	CHECK(q.Pop(e));
+	CHECK_EQ(e.id, 0U);
+	CHECK(q.Push(MakeEvent(1001))); // Room again.
+}
+
+TEST(TakeDiscardsOlderRecords)
+{
+	static HookEventQueue q;
+	for (UINT i = 0; i < 5; ++i)
+		q.Push(MakeEvent(i));
+	HookEvent e {};
+	CHECK(q.Take(MakeEvent(3).message, 3, e));
+	CHECK_EQ(e.id, 3U);
+	CHECK_EQ(q.mSkipped, 3U);
+	CHECK(!q.Take(MakeEvent(2).message, 2, e)); // Already discarded.
+	CHECK_EQ(q.Depth(), 1U); // A failed Take leaves the ring unchanged.
+	CHECK(q.Pop(e));
+	CHECK_EQ(e.id, 4U);
+}
+
+TEST(ResetIsAppliedByProducer)
+{
+	static HookEventQueue q;
+	for (UINT i = 0; i < HookEventQueue::Capacity + 3; ++i)
+		q.Push(MakeEvent(i));
+	CHECK_EQ(q.Overflows(), 3U);
+	q.ResetStats();
+	CHECK_EQ(q.Overflows(), 0U); // Reported as reset even before the producer acts on it.
+	CHECK_EQ(q.HighWater(), 0U);
+	CHECK(!q.Push(MakeEvent(0))); // Still full.
+	CHECK_EQ(q.Overflows(), 1U); // Counted from the reset.
+	HookEvent e {};
+	while (q.Pop(e));
+	q.ResetStats();
+	q.Push(MakeEvent(1));
+	CHECK_EQ(q.HighWater(), 1U);
+}
+
+TEST(ConcurrentProducerConsumer)
+{
+	// The producer pushes a long sequence of events as fast as it can, while
+	// the consumer mostly uses Pop() but sometimes Take()s a record a few places ahead (as when the
+	// messages for some records were lost), and periodically resets the statistics.  Every record
+	// must be received intact and in order, and each must be accounted for exactly once as either
+	// received, skipped or dropped due to overflow.
+	static HookEventQueue q;
+	const UINT total = 1000000;
+	UINT pushed = 0;
+	std::atomic<bool> done {false};
+
+	std::thread producer([&] {
+		for (UINT i = 0; i < total; ++i)
+		{
+			// Most events are retried until there's room so that the threads overlap for the whole
+			// test, but some are not, so that overflows occur whenever the ring is full.
+			bool ok = q.Push(MakeEvent(i));
+			while (!ok && i % 16)
+			{
+				std::this_thread::yield();
+				ok = q.Push(MakeEvent(i));
+			}
+			if (ok)
+				++pushed;
+		}
+		done.store(true, std::memory_order_release);
+	});
+
+	UINT received = 0, skipped = 0, last = UINT_MAX, out_of_order = 0, torn = 0, over_capacity = 0;
+	auto receive = [&](const HookEvent &e) {
+		if (last != UINT_MAX && e.id <= last)
+			++out_of_order;
+		last = e.id;
+		++received;
+		if (!IsIntact(e))
+			++torn;
+	};
+	for (UINT n = 0; ; ++n)
+	{
+		bool finished = done.load(std::memory_order_acquire);
+		HookEvent e {};
+		if (!q.Pop(e))
+		{
+			if (finished)
+				break;
+			std::this_thread::yield();
+			continue;
+		}
+		receive(e);
+		if (n % 64 == 63)
+		{
+			// Take the record three places ahead, skipping the two between.  If it hasn't been pushed
+			// yet or was dropped due to overflow, Take() fails and leaves the ring unchanged.
+			UINT target = e.id + 3, skipped_before = q.mSkipped;
+			if (q.Take(MakeEvent(target).message, target, e))
+			{
+				skipped += q.mSkipped - skipped_before;
+				receive(e);
+			}
+		}
+		if (n % 4096 == 0)
+		{
+			if (q.HighWater() > HookEventQueue::Capacity)
+				++over_capacity;
+			q.ResetStats(); // Also resets mSkipped, which was accumulated above.
+		}
+	}
+	producer.join();
+
+	CHECK_EQ(out_of_order, 0U);
+	CHECK_EQ(torn, 0U);
+	CHECK_EQ(over_capacity, 0U);
+	CHECK_EQ(received + skipped, pushed);
+	CHECK_EQ(q.Depth(), 0U);
+	printf("  %u pushed, %u dropped, %u received, %u skipped\n", pushed, total - pushed, received, skipped);
+}
+
+
+int main()
+{
+	return RUN_TESTS();
+}
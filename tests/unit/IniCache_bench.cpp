@@ -0,0 +1,77 @@
+//
+// Benchmark of IniCache on a file of 10000 keys (100 sections of 100 keys), using the in-memory
+// files of IniCache_stubs.h.  Compares 10000 lookups answered from the cache with lookups when the
+// file is parsed for each one (as the API does), and with a write before each lookup, which
+// invalidates the cache as IniWrite does.  The last two parse the whole file each time, so only
+// the first 1000 operations are timed.
+//
+
+#include "IniCache.h"
+#include "unit.h"
+#include <string>
+#include <vector>
+
+static const LPCTSTR sPath = L"C:\\bench.ini";
+static const int N = 10000;
+
+struct Lookup { std::wstring section, key; };
+
+template<typename F>
+static void Time(const char *aLabel, int aCount, F aFunc)
+{
+	unit::Timer timer;
+	int found = aFunc(aCount);
+	double t = timer.Elapsed();
+	printf("  %-20s %6d operations %8.3f s  %8.2f us/operation  (%d found)\n", aLabel, aCount, t, t * 1e6 / aCount, found);
+}
+
+int main()
+{
+	std::string data;
+	for (int s = 1; s <= 100; ++s)
+	{
+		data += "[Section" + std::to_string(s) + "]\r\n";
+		for (int k = 1; k <= 100; ++k)
+			data += "Key" + std::to_string(k) + "=Value " + std::to_string(s) + "." + std::to_string(k) + "\r\n";
+	}
+	FakeFile &file = FakeFiles()[sPath];
+	file.data = data;
+	std::vector<Lookup> lookups;
+	for (int i = 1; i <= N; ++i)
+		lookups.push_back({ L"Section" + std::to_wstring(i * 7 % 100 + 1), L"Key" + std::to_wstring(i * 13 % 100 + 1) });
+
+	auto lookup = [](Lookup &l) {
+		LPCTSTR value;
+		size_t length;
+		return IniCacheLookup(sPath, l.section.c_str(), l.key.c_str(), value, length);
+	};
+	printf("A file of %d keys:\n", N);
+	Time("cached lookup", N, [&](int aCount) {
+		int found = 0;
+		for (int i = 0; i < aCount; ++i)
+			found += lookup(lookups[i]);
+		return found;
+	});
+	Time("parse per lookup", N / 10, [&](int aCount) {
+		int found = 0;
+		for (int i = 0; i < aCount; ++i)
+		{
+			IniCacheInvalidate();
+			found += lookup(lookups[i]);
+		}
+		return found;
+	});
+	Time("write + lookup", N / 10, [&](int aCount) {
+		int found = 0;
+		for (int i = 0; i < aCount; ++i)
+		{
+			// Overwrite a value in place, keeping the size, then invalidate as IniWrite does.
+			file.data[data.size() - 3] = '0' + i % 10;
+			file.write_time++;
+			IniCacheInvalidate(sPath);
+			found += lookup(lookups[i]);
+		}
+		return found;
+	});
+	return 0;
+}
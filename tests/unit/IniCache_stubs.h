@@ -0,0 +1,155 @@
+#pragma once
+
+//
+// Stand-in for util.h and the Windows API functions which IniCache.cpp uses.  Files live in an
+// in-memory table (FakeFiles()) which tests fill and modify directly; each file has contents and a
+// last-write time, and a path can also be marked as a directory or as mapped to the registry.
+// CompareStringOrdinal() folds case with towupper(), which is enough for ASCII names.
+//
+
+#define util_h
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+
+typedef unsigned char *LPBYTE;
+typedef void *HKEY;
+struct FILETIME { DWORD dwLowDateTime, dwHighDateTime; };
+struct BY_HANDLE_FILE_INFORMATION { DWORD dwFileAttributes; FILETIME ftLastWriteTime; DWORD nFileSizeHigh, nFileSizeLow; };
+struct WIN32_FILE_ATTRIBUTE_DATA { DWORD dwFileAttributes; FILETIME ftLastWriteTime; DWORD nFileSizeHigh, nFileSizeLow; };
+enum GET_FILEEX_INFO_LEVELS { GetFileExInfoStandard };
+
+#define __cdecl
+#define T_MAX_PATH 32767
+#define IS_SPACE_OR_TAB(c) (c == ' ' || c == '\t')
+#define _countof(a) (sizeof(a) / sizeof(*(a)))
+#define tmalloc(c) ((LPTSTR) malloc((c) * sizeof(TCHAR)))
+#define INVALID_HANDLE_VALUE ((HANDLE)(INT_PTR)-1)
+#define HKEY_LOCAL_MACHINE ((HKEY)(INT_PTR)0x80000002)
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define GENERIC_READ 0x80000000
+#define FILE_SHARE_READ 1
+#define FILE_SHARE_WRITE 2
+#define FILE_SHARE_DELETE 4
+#define OPEN_EXISTING 3
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define KEY_QUERY_VALUE 1
+#define ERROR_SUCCESS 0
+#define CP_ACP 0
+#define CSTR_LESS_THAN 1
+#define CSTR_EQUAL 2
+#define CSTR_GREATER_THAN 3
+
+// The Microsoft CRT's wide printf functions take %s as a wide string, whereas glibc's take %ls.
+inline int sntprintf(LPTSTR aBuf, int aBufSize, LPCTSTR aFormat, ...)
+{
+	std::wstring format = aFormat;
+	for (size_t pos = 0; (pos = format.find(L"%s", pos)) != std::wstring::npos; pos += 3)
+		format.replace(pos, 2, L"%ls");
+	va_list args;
+	va_start(args, aFormat);
+	int result = vswprintf(aBuf, aBufSize, format.c_str(), args);
+	va_end(args);
+	return result;
+}
+
+struct FakeFile
+{
+	std::string data;
+	ULONGLONG write_time = 0;
+	bool directory = false;
+	int opened = 0; // Number of times the file was opened for reading.
+};
+
+inline std::map<std::wstring, FakeFile> &FakeFiles() { static std::map<std::wstring, FakeFile> files; return files; }
+inline std::set<std::wstring> &FakeIniFileMapping() { static std::set<std::wstring> keys; return keys; }
+
+struct FakeHandle { FakeFile *file; size_t pos; };
+
+inline FILETIME ToFileTime(ULONGLONG aTime) { return { (DWORD)aTime, (DWORD)(aTime >> 32) }; }
+
+inline BOOL GetFileAttributesEx(LPCTSTR aPath, GET_FILEEX_INFO_LEVELS, WIN32_FILE_ATTRIBUTE_DATA *aData)
+{
+	auto it = FakeFiles().find(aPath);
+	if (it == FakeFiles().end())
+		return FALSE;
+	aData->dwFileAttributes = it->second.directory ? FILE_ATTRIBUTE_DIRECTORY : 0;
+	aData->ftLastWriteTime = ToFileTime(it->second.write_time);
+	aData->nFileSizeHigh = (DWORD)((ULONGLONG)it->second.data.size() >> 32);
+	aData->nFileSizeLow = (DWORD)it->second.data.size();
+	return TRUE;
+}
+
+inline HANDLE CreateFile(LPCTSTR aPath, DWORD, DWORD, void *, DWORD, DWORD, HANDLE)
+{
+	auto it = FakeFiles().find(aPath);
+	if (it == FakeFiles().end() || it->second.directory)
+		return INVALID_HANDLE_VALUE;
+	++it->second.opened;
+	return new FakeHandle { &it->second, 0 };
+}
+
+inline BOOL GetFileInformationByHandle(HANDLE aFile, BY_HANDLE_FILE_INFORMATION *aInfo)
+{
+	FakeFile &f = *((FakeHandle *)aFile)->file;
+	aInfo->dwFileAttributes = 0;
+	aInfo->ftLastWriteTime = ToFileTime(f.write_time);
+	aInfo->nFileSizeHigh = (DWORD)((ULONGLONG)f.data.size() >> 32);
+	aInfo->nFileSizeLow = (DWORD)f.data.size();
+	return TRUE;
+}
+
+inline BOOL ReadFile(HANDLE aFile, void *aBuf, DWORD aSize, DWORD *aRead, void *)
+{
+	auto h = (FakeHandle *)aFile;
+	size_t n = std::min((size_t)aSize, h->file->data.size() - h->pos);
+	memcpy(aBuf, h->file->data.data() + h->pos, n);
+	h->pos += n;
+	*aRead = (DWORD)n;
+	return TRUE;
+}
+
+inline BOOL CloseHandle(HANDLE aFile)
+{
+	delete (FakeHandle *)aFile;
+	return TRUE;
+}
+
+inline LONG RegOpenKeyEx(HKEY, LPCTSTR aSubKey, DWORD, DWORD, HKEY *aKey)
+{
+	if (!FakeIniFileMapping().count(aSubKey))
+		return 2; // ERROR_FILE_NOT_FOUND
+	*aKey = HKEY_LOCAL_MACHINE;
+	return ERROR_SUCCESS;
+}
+
+inline LONG RegCloseKey(HKEY) { return ERROR_SUCCESS; }
+
+inline LONG CompareFileTime(const FILETIME *a, const FILETIME *b)
+{
+	ULONGLONG ta = ((ULONGLONG)a->dwHighDateTime << 32) | a->dwLowDateTime;
+	ULONGLONG tb = ((ULONGLONG)b->dwHighDateTime << 32) | b->dwLowDateTime;
+	return ta < tb ? -1 : ta > tb;
+}
+
+// Decodes each byte as the code point of the same value (Latin-1), in place of the ANSI code page.
+inline int MultiByteToWideChar(UINT, DWORD, LPCSTR aData, int aSize, LPWSTR aBuf, int aBufSize)
+{
+	if (aBuf)
+		for (int i = 0; i < aSize && i < aBufSize; ++i)
+			aBuf[i] = (UCHAR)aData[i];
+	return aSize;
+}
+
+inline int CompareStringOrdinal(LPCWSTR a, int aLength1, LPCWSTR b, int aLength2, BOOL)
+{
+	for (int i = 0; i < aLength1 && i < aLength2; ++i)
+	{
+		wint_t ca = towupper(a[i]), cb = towupper(b[i]);
+		if (ca != cb)
+			return ca < cb ? CSTR_LESS_THAN : CSTR_GREATER_THAN;
+	}
+	return aLength1 < aLength2 ? CSTR_LESS_THAN : aLength1 > aLength2 ? CSTR_GREATER_THAN : CSTR_EQUAL;
+}
@@ -0,0 +1,211 @@
+//
+// Tests for IniCache, using the in-memory files of IniCache_stubs.h.  Each lookup is either
+// answered from the cache with the value GetPrivateProfileString() would return, or declined so
+// that IniRead() falls back to the API; the tests check both, and that the cache notices changes.
+//
+
+#include "IniCache.h"
+#include "unit.h"
+#include <string>
+
+static const LPCTSTR sPath = L"C:\\test.ini";
+
+static void SetFile(LPCTSTR aPath, const std::string &aData, ULONGLONG aTime = 1)
+{
+	FakeFile &f = FakeFiles()[aPath];
+	f.data = aData;
+	f.write_time = aTime;
+	f.opened = 0;
+}
+
+// Returns the cached value, or "<api>" if the lookup would fall back to the API.
+static std::wstring Lookup(LPCTSTR aSection, LPCTSTR aKey, LPCTSTR aPath = sPath)
+{
+	LPCTSTR value;
+	size_t length;
+	if (!IniCacheLookup(aPath, aSection, aKey, value, length))
+		return L"<api>";
+	return std::wstring(value, length);
+}
+
+TEST(Values)
+{
+	IniCacheInvalidate();
+	SetFile(sPath,
+		"; comment\r\n"
+		"[General]\r\n"
+		"Name=Value\r\n"
+		"  Spaced  =  padded value  \r\n"
+		"Empty=\r\n"
+		"Equals=a=b\r\n"
+		"Quoted=\"quoted\"\r\n"
+		"Single='single'\r\n"
+		"Unbalanced=\"x\r\n"
+		"Inner=a \"b\" c\r\n"
+		"\r\n"
+		"\t; indented comment\n"
+		"[Other Section]\n"
+		"Name=other\n"
+		"Tab\t=\tx\ty\t\n");
+	CHECK(Lookup(L"General", L"Name") == L"Value");
+	CHECK(Lookup(L"general", L"NAME") == L"Value");
+	CHECK(Lookup(L"General", L"Spaced") == L"padded value");
+	CHECK(Lookup(L"General", L"Empty") == L"");
+	CHECK(Lookup(L"General", L"Equals") == L"a=b");
+	CHECK(Lookup(L"General", L"Quoted") == L"quoted");
+	CHECK(Lookup(L"General", L"Single") == L"single");
+	CHECK(Lookup(L"General", L"Unbalanced") == L"\"x");
+	CHECK(Lookup(L"General", L"Inner") == L"a \"b\" c");
+	CHECK(Lookup(L"Other Section", L"Name") == L"other");
+	CHECK(Lookup(L"Other Section", L"Tab") == L"x\ty");
+	CHECK_EQ(FakeFiles()[sPath].opened, 1); // Parsed once.
+}
+
+TEST(DeclinedLookups)
+{
+	IniCacheInvalidate();
+	SetFile(sPath, "[S]\nk=v\n[D]\nx=1\n[d]\ny=2\n[K]\ndup=1\nDUP=2\n");
+	CHECK(Lookup(L"S", L"missing") == L"<api>"); // The API may return the default.
+	CHECK(Lookup(L"Missing", L"k") == L"<api>");
+	CHECK(Lookup(L"D", L"x") == L"<api>"); // Duplicate section.
+	CHECK(Lookup(L"K", L"dup") == L"<api>"); // Duplicate key.
+	CHECK(Lookup(L" S", L"k") == L"<api>"); // Leading or trailing whitespace.
+	CHECK(Lookup(L"S", L"k ") == L"<api>");
+	CHECK(Lookup(L"S", L";k") == L"<api>");
+	CHECK(Lookup(L"", L"k") == L"<api>");
+	CHECK(Lookup(L"S", L"k", L"C:\\missing.ini") == L"<api>");
+	FakeFiles()[L"C:\\dir"].directory = true;
+	CHECK(Lookup(L"S", L"k", L"C:\\dir") == L"<api>");
+	CHECK(Lookup(L"S", L"k") == L"v");
+}
+
+TEST(UnparsedFiles)
+{
+	// Files containing anything the API might interpret differently aren't cached at all.
+	static const char *sFiles[] = {
+		"k=v\n[S]\nk=v\n",            // Key outside of any section.
+		"[S]\nk=v\nno equals\n",      // Line which isn't a key=value pair.
+		"[S\nk=v\n",                  // Unterminated section name.
+		"[S]x\nk=v\n",                // Text after the section name.
+		"[ S]\nk=v\n",                // Section name with leading whitespace.
+		"[S]\nk=v\n[a[b]\n",          // Bracket within a section name.
+		"\xEF\xBB\xBF[S]\nk=v\n",     // UTF-8 BOM.
+		"\xFE\xFF\0[\0S\0]\0\n",      // UTF-16BE BOM.
+	};
+	int i = 0;
+	for (auto data : sFiles)
+	{
+		IniCacheInvalidate();
+		size_t length = strlen(data);
+		if (i == _countof(sFiles) - 1)
+			length = 10;
+		SetFile(sPath, std::string(data, length));
+		if (Lookup(L"S", L"k") != L"<api>")
+			printf("File %d was cached\n", i), CHECK(false);
+		++i;
+	}
+	IniCacheInvalidate();
+	SetFile(sPath, std::string("[S]\nk=v\0x\n", 10)); // Binary zero.
+	CHECK(Lookup(L"S", L"k") == L"<api>");
+	// A file which can't be cached isn't read again until it changes.
+	int opened = FakeFiles()[sPath].opened;
+	CHECK(Lookup(L"S", L"k") == L"<api>");
+	CHECK_EQ(FakeFiles()[sPath].opened, opened);
+}
+
+TEST(RegistryMapping)
+{
+	IniCacheInvalidate();
+	SetFile(L"C:\\dir\\mapped.ini", "[S]\nk=v\n");
+	FakeIniFileMapping().insert(L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\IniFileMapping\\mapped.ini");
+	CHECK(Lookup(L"S", L"k", L"C:\\dir\\mapped.ini") == L"<api>");
+	CHECK_EQ(FakeFiles()[L"C:\\dir\\mapped.ini"].opened, 0);
+	FakeIniFileMapping().clear();
+}
+
+TEST(Changes)
+{
+	IniCacheInvalidate();
+	SetFile(sPath, "[S]\nk=one\n", 100);
+	CHECK(Lookup(L"S", L"k") == L"one");
+	// Different size.
+	SetFile(sPath, "[S]\nk=three\n", 100);
+	CHECK(Lookup(L"S", L"k") == L"three");
+	// Same size, different time.
+	SetFile(sPath, "[S]\nk=THREE\n", 200);
+	CHECK(Lookup(L"S", L"k") == L"THREE");
+	// Same size and time, as after a write within the file system's timestamp resolution; IniWrite
+	// and IniDelete call IniCacheInvalidate().
+	SetFile(sPath, "[S]\nk=tHrEe\n", 200);
+	CHECK(Lookup(L"S", L"k") == L"THREE");
+	IniCacheInvalidate(sPath);
+	CHECK(Lookup(L"S", L"k") == L"tHrEe");
+}
+
+TEST(InvalidateOneFile)
+{
+	// A write invalidates only the file written, which is matched by full path, ignoring case.
+	IniCacheInvalidate();
+	static const LPCTSTR sOther = L"C:\\other.ini";
+	SetFile(sPath, "[S]\nk=one\n", 100);
+	SetFile(sOther, "[S]\nk=other\n", 100);
+	CHECK(Lookup(L"S", L"k") == L"one");
+	CHECK(Lookup(L"S", L"k", sOther) == L"other");
+	SetFile(sPath, "[S]\nk=two\n", 100);
+	IniCacheInvalidate(L"c:\\TEST.ini");
+	CHECK(Lookup(L"S", L"k") == L"two");
+	CHECK(Lookup(L"S", L"k", sOther) == L"other");
+	CHECK_EQ(FakeFiles()[sPath].opened, 1);
+	CHECK_EQ(FakeFiles()[sOther].opened, 1); // Still cached from the first lookup.
+	IniCacheInvalidate(L"C:\\not cached.ini");
+	CHECK(Lookup(L"S", L"k") == L"two");
+	CHECK_EQ(FakeFiles()[sPath].opened, 1);
+}
+
+TEST(ManyFiles)
+{
+	// More files than there are cache slots, read in rotation.
+	IniCacheInvalidate();
+	for (int i = 0; i < 6; ++i)
+	{
+		std::wstring path = L"C:\\f" + std::to_wstring(i) + L".ini";
+		SetFile(path.c_str(), "[S]\nk=" + std::to_string(i) + "\n");
+	}
+	int wrong = 0;
+	for (int round = 0; round < 3; ++round)
+		for (int i = 0; i < 6; ++i)
+		{
+			std::wstring path = L"C:\\f" + std::to_wstring(i) + L".ini";
+			if (Lookup(L"S", L"k", path.c_str()) != std::to_wstring(i))
+				++wrong;
+		}
+	CHECK_EQ(wrong, 0);
+}
+
+TEST(LargeFile)
+{
+	IniCacheInvalidate();
+	std::string data;
+	for (int s = 0; s < 100; ++s)
+	{
+		data += "[Section" + std::to_string(s) + "]\r\n";
+		for (int k = 0; k < 100; ++k)
+			data += "Key" + std::to_string(k) + "=" + std::to_string(s * 100 + k) + "\r\n";
+	}
+	SetFile(sPath, data);
+	int wrong = 0;
+	for (int s = 99; s >= 0; --s)
+		for (int k = 0; k < 100; ++k)
+		{
+			std::wstring section = L"SECTION" + std::to_wstring(s), key = L"key" + std::to_wstring(k);
+			if (Lookup(section.c_str(), key.c_str()) != std::to_wstring(s * 100 + k))
+				++wrong;
+		}
+	CHECK_EQ(wrong, 0);
+	CHECK_EQ(FakeFiles()[sPath].opened, 1);
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
@@ -0,0 +1,85 @@
+//
+// Benchmark of KeyEventLog::Add(), which the hook thread calls for every event it processes while
+// the log is enabled.  Compares the cost per record with a plain store into an array of the same
+// size, and measures it again while another thread exports records the way KeyLogExport does
+// (copying recent ranges and checking which of them were overwritten during the copy).
+//
+
+#include <thread>
+#include <atomic>
+
+typedef USHORT sc_type;
+typedef UCHAR vk_type;
+inline void Sleep(DWORD) { std::this_thread::yield(); }
+
+#include "KeyEventLog.h"
+#include "unit.h"
+#include <vector>
+
+static const UINT sCapacity = 1 << 20; // Enough for several hours of typing.
+static const UINT sRecords = 50000000;
+
+static KeyEventRecord MakeRecord(UINT i)
+{
+	KeyEventRecord record = {};
+	record.time = (__int64)i * 1000;
+	record.sc = (sc_type)(i & 0x7F);
+	record.vk = (vk_type)(0x41 + i % 26);
+	record.flags = i & 1 ? KeyEventRecord::UP : 0;
+	record.event_type = ' ';
+	return record;
+}
+
+int main()
+{
+	// Baseline: a plain store into a ring of the same size, with no synchronization.
+	std::vector<KeyEventRecord> plain(sCapacity);
+	unit::Timer plain_timer;
+	for (UINT i = 0; i < sRecords; ++i)
+		plain[i & (sCapacity - 1)] = MakeRecord(i);
+	unit::Use(plain[0]);
+	double t_plain = plain_timer.Elapsed();
+
+	static KeyEventLog log;
+	log.SetCapacity(sCapacity);
+	unit::Timer add_timer;
+	for (UINT i = 0; i < sRecords; ++i)
+		log.Add(MakeRecord(i));
+	double t_add = add_timer.Elapsed();
+
+	// Add again while exporting continuously on another thread.
+	std::atomic<bool> done {false};
+	unsigned __int64 exported = 0, discarded = 0;
+	std::thread exporter([&] {
+		const UINT chunk = 4096; // As in KeyLogExport.
+		std::vector<KeyEventRecord> out(chunk);
+		while (!done.load(std::memory_order_relaxed))
+		{
+			auto end = log.Next(), start = log.Oldest();
+			if (end - start > chunk)
+				start = end - chunk;
+			auto first_intact = log.Copy(start, end, out.data());
+			exported += end - first_intact;
+			discarded += first_intact - start;
+		}
+	});
+	unit::Timer concurrent_timer;
+	for (UINT i = 0; i < sRecords; ++i)
+		log.Add(MakeRecord(i));
+	double t_concurrent = concurrent_timer.Elapsed();
+	done = true;
+	exporter.join();
+
+	if (log.Next() != 2ULL * sRecords)
+	{
+		printf("Expected %u records, got %llu\n", 2 * sRecords, (unsigned long long)log.Next());
+		return 1;
+	}
+	printf("%u records into a ring of %u (%u bytes each):\n", sRecords, sCapacity, (UINT)sizeof(KeyEventRecord));
+	printf("  Plain store:          %6.2f ns/record, %6.1f M records/s\n", t_plain * 1e9 / sRecords, sRecords / t_plain / 1e6);
+	printf("  KeyEventLog::Add:     %6.2f ns/record, %6.1f M records/s\n", t_add * 1e9 / sRecords, sRecords / t_add / 1e6);
+	printf("  Add while exporting:  %6.2f ns/record, %6.1f M records/s (%llu exported, %llu overwritten during copy)\n"
+		, t_concurrent * 1e9 / sRecords, sRecords / t_concurrent / 1e6, (unsigned long long)exported, (unsigned long long)discarded);
+	log.SetCapacity(0);
+	return 0;
+}
@@ -0,0 +1,214 @@
+//
+// Tests for ListViewRowCache, driven by a fake virtual ListView which sends the same sequence of
+// notifications as the real control: LVN_ODCACHEHINT for the rows about to be painted, then
+// LVN_GETDISPINFO for each visible field.  These are handled by the cache's own Prefetch() and
+// CopyField(), as GuiControlType's LV_CacheHint and LV_GetDispInfo do (lib/Gui.ListView.cpp).
+// Only the data source is simulated: CacheRow() stands in for LV_CacheRow, which calls the
+// script's function.
+//
+
+#define MAX_NUMBER_SIZE 256 // As in defines.h.
+#include "ListViewRowCache.h"
+#include "unit.h"
+#include <string>
+#include <vector>
+
+struct FakeListView
+{
+	int row_count = 0, col_count = 3;
+	int top = 0, page = 20; // Visible rows.
+	int fetches = 0; // Calls to the data source.
+	int fail_after = -1; // If non-negative, the number of fetches after which the data source fails.
+	std::vector<int> fetched; // Rows passed to the data source, in order.
+	ListViewRowCache cache;
+
+	// The data source: field c of row r is "r:c", except that field 1 of every tenth row is a number
+	// which must be formatted into the buffer, and row 7 has only one field.
+	int FieldCount(int aRow) { return aRow == 7 ? 1 : col_count; }
+	LPCTSTR FieldText(int aRow, int aColumn, LPTSTR aBuf)
+	{
+		if (aColumn >= FieldCount(aRow))
+			return _T("");
+		swprintf(aBuf, MAX_NUMBER_SIZE, aColumn == 1 && aRow % 10 == 0 ? _T("%d") : _T("%d:%d"), aRow, aColumn);
+		return aBuf;
+	}
+
+	bool CacheRow(int aRow)
+	{
+		if (cache.Contains(aRow))
+			return true;
+		if (fetches == fail_after)
+			return false; // Such as when the script can't be interrupted.
+		++fetches;
+		fetched.push_back(aRow);
+		return cache.Store(aRow, col_count, [&](int aColumn, LPTSTR aBuf) { return FieldText(aRow, aColumn, aBuf); });
+	}
+
+	void CacheHint(int aFrom, int aTo)
+	{
+		cache.Prefetch(aFrom, aTo, row_count, [&](int aRow) { return CacheRow(aRow); });
+	}
+
+	std::wstring GetDispInfo(int aRow, int aColumn, int aBufSize = 260)
+	{
+		std::vector<TCHAR> buf(aBufSize + 1, '?');
+		cache.CopyField(aRow, aColumn, row_count, buf.data(), aBufSize, [&](int aRow) { return CacheRow(aRow); });
+		return buf[0] == '?' ? L"<unchanged>" : buf.data();
+	}
+
+	// Paints the visible rows, returning the text of the last field painted.
+	std::wstring Paint()
+	{
+		int last = top + page - 1;
+		CacheHint(top, last);
+		std::wstring text;
+		for (int row = top; row <= last && row < row_count; ++row)
+			for (int c = 0; c < col_count; ++c)
+				text = GetDispInfo(row, c);
+		return text;
+	}
+};
+
+
+TEST(PaintFetchesEachRowOnce)
+{
+	FakeListView lv;
+	lv.row_count = 1000;
+	lv.Paint();
+	CHECK_EQ(lv.fetches, lv.page);
+	for (int i = 0; i < lv.page; ++i)
+		CHECK_EQ(lv.fetched[i], i);
+	// Repainting the same rows doesn't call the data source again.
+	lv.Paint();
+	lv.Paint();
+	CHECK_EQ(lv.fetches, lv.page);
+}
+
+TEST(ScrollFetchesOnlyNewRows)
+{
+	FakeListView lv;
+	lv.row_count = 1000;
+	lv.Paint();
+	lv.top = 1;
+	lv.Paint();
+	CHECK_EQ(lv.fetches, lv.page + 1);
+	CHECK_EQ(lv.fetched.back(), lv.page);
+	// Scrolling back within the cache's capacity needs nothing new.
+	lv.top = 0;
+	lv.Paint();
+	CHECK_EQ(lv.fetches, lv.page + 1);
+}
+
+TEST(FieldText)
+{
+	FakeListView lv;
+	lv.row_count = 100;
+	CHECK(lv.GetDispInfo(3, 0) == L"3:0");
+	CHECK(lv.GetDispInfo(3, 2) == L"3:2");
+	CHECK(lv.GetDispInfo(20, 1) == L"20"); // Formatted into the caller's buffer.
+	CHECK(lv.GetDispInfo(20, 2) == L"20:2");
+	CHECK(lv.GetDispInfo(7, 0) == L"7:0");
+	CHECK(lv.GetDispInfo(7, 1) == L""); // Row has fewer fields than the control has columns.
+	CHECK(lv.GetDispInfo(3, 5) == L""); // Column beyond those cached.
+	CHECK(lv.GetDispInfo(100, 0) == L"<unchanged>"); // Row beyond the row count.
+	CHECK_EQ(lv.fetches, 3);
+}
+
+TEST(EmptyFields)
+{
+	ListViewRowCache cache;
+	CHECK(cache.Store(5, 3, [](int, LPTSTR) { return _T(""); }));
+	CHECK(cache.Contains(5));
+	CHECK(std::wstring(cache.Field(5, 0)) == L"");
+	CHECK(std::wstring(cache.Field(5, 2)) == L"");
+	CHECK(cache.Store(6, 0, [](int, LPTSTR) { return _T("x"); }));
+	CHECK(cache.Contains(6));
+	CHECK(std::wstring(cache.Field(6, 0)) == L"");
+	CHECK(cache.Field(4, 0) == nullptr);
+}
+
+TEST(CollidingRowsEvictEachOther)
+{
+	FakeListView lv;
+	lv.row_count = 1000;
+	lv.GetDispInfo(1, 0);
+	lv.GetDispInfo(1 + ListViewRowCache::Size, 0);
+	CHECK(!lv.cache.Contains(1));
+	CHECK(lv.cache.Contains(1 + ListViewRowCache::Size));
+	CHECK(lv.GetDispInfo(1, 1) == L"1:1");
+	CHECK_EQ(lv.fetches, 3);
+}
+
+TEST(HintRange)
+{
+	int from, to;
+	CHECK(ListViewRowCache::HintRange(0, 19, 1000, from, to));
+	CHECK_EQ(from, 0); CHECK_EQ(to, 19);
+	CHECK(ListViewRowCache::HintRange(990, 1010, 1000, from, to)); // Clipped to the last row.
+	CHECK_EQ(from, 990); CHECK_EQ(to, 999);
+	CHECK(ListViewRowCache::HintRange(0, 999, 1000, from, to)); // Clipped to the cache's capacity.
+	CHECK_EQ(from, 0); CHECK_EQ(to, ListViewRowCache::Size - 1);
+	CHECK(!ListViewRowCache::HintRange(0, 19, 0, from, to)); // No rows.
+	CHECK(!ListViewRowCache::HintRange(5, 10, 5, from, to)); // Range is past the end.
+}
+
+TEST(PageLargerThanCache)
+{
+	// A page taller than the cache is prefetched only up to the cache's capacity; the remaining rows
+	// are retrieved on demand.  Every field must still be correct, at the cost of extra fetches.
+	FakeListView lv;
+	lv.row_count = 1000;
+	lv.page = ListViewRowCache::Size + 10;
+	lv.Paint();
+	CHECK_EQ(lv.fetches, lv.page);
+	for (int row = 0; row < lv.page; ++row)
+		CHECK(lv.GetDispInfo(row, 2) == (row == 7 ? L"" : std::to_wstring(row) + L":2"));
+	CHECK_EQ(lv.fetches, lv.page + 20); // Rows 0-9 were evicted by 128-137, and then vice versa.
+}
+
+TEST(TruncatedToBuffer)
+{
+	FakeListView lv;
+	lv.row_count = 100;
+	CHECK(lv.GetDispInfo(12, 2, 3) == L"12"); // Truncated to fit, including the terminator.
+	CHECK(lv.GetDispInfo(12, 2, 1) == L"");
+	CHECK(lv.GetDispInfo(12, 2, 0) == L"<unchanged>");
+	CHECK(lv.GetDispInfo(-1, 0) == L"<unchanged>");
+	CHECK_EQ(lv.fetches, 1);
+}
+
+TEST(FailedFetch)
+{
+	// A row which can't be retrieved leaves the field empty, and stops prefetching so that the
+	// remaining rows are retried on demand.
+	FakeListView lv;
+	lv.row_count = 1000;
+	lv.fail_after = 5;
+	lv.CacheHint(0, 19);
+	CHECK_EQ(lv.fetches, 5);
+	CHECK(lv.cache.Contains(4));
+	CHECK(!lv.cache.Contains(5));
+	CHECK(lv.GetDispInfo(6, 0) == L"");
+	CHECK(lv.GetDispInfo(4, 0) == L"4:0");
+	lv.fail_after = -1;
+	CHECK(lv.GetDispInfo(6, 0) == L"6:0");
+	CHECK_EQ(lv.fetches, 6);
+}
+
+TEST(RefreshRefetches)
+{
+	FakeListView lv;
+	lv.row_count = 50;
+	lv.Paint();
+	lv.cache.Clear(); // As LV.SetDataSource() does.
+	CHECK(!lv.cache.Contains(0));
+	lv.row_count = 10;
+	lv.Paint();
+	CHECK_EQ(lv.fetches, lv.page + 10);
+}
+
+
+int main()
+{
+	return RUN_TESTS();
+}
@@ -0,0 +1,90 @@
+//
+// Benchmark of ctcsicmp() (NameCompare.h) in a binary search like ScriptItemList::Find(), over a
+// sorted list of names resembling a script's global variables and functions.  It is compared with
+// a non-inline C-locale comparison, which stands in for the CRT's _tcsicmp() minus its per-call
+// locale check, and with glibc's wcscasecmp(), which does check the locale.
+//
+
+typedef wchar_t TBYTE;
+// Copied from util.h:
+inline int cisupper(TBYTE c) { return c <= 'Z' && c >= 'A'; }
+inline TCHAR ctolower(TBYTE c) { return cisupper(c) ? (c | 0x20) : c; }
+
+#include "NameCompare.h"
+#include "unit.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+__attribute__((noinline)) static int OutOfLineIcmp(LPCTSTR aStr1, LPCTSTR aStr2)
+{
+	int f, l;
+	do
+	{
+		f = (TBYTE)*aStr1++;
+		l = (TBYTE)*aStr2++;
+		if (f >= 'A' && f <= 'Z') f += 'a' - 'A';
+		if (l >= 'A' && l <= 'Z') l += 'a' - 'A';
+	} while (f && f == l);
+	return f - l;
+}
+
+template<typename Compare>
+static int Find(std::vector<LPCTSTR> &aList, LPCTSTR aName, Compare aCompare)
+{
+	int left = 0, right = (int)aList.size() - 1;
+	while (left <= right)
+	{
+		int mid = (left + right) / 2;
+		int result = aCompare(aName, aList[mid]);
+		if (result > 0)
+			left = mid + 1;
+		else if (result < 0)
+			right = mid - 1;
+		else
+			return mid;
+	}
+	return -1;
+}
+
+int main()
+{
+	static const LPCTSTR sPrefixes[] = { L"", L"g_", L"A_", L"my", L"Gui", L"Hotkey", L"Ctrl", L"Win" };
+	static const LPCTSTR sWords[] = { L"Count", L"Index", L"Name", L"Value", L"Handle", L"Title", L"Item", L"List"
+		, L"State", L"Timer", L"Config", L"Path" };
+	std::vector<std::wstring> names;
+	for (auto p : sPrefixes)
+		for (auto w1 : sWords)
+			for (auto w2 : sWords)
+				names.push_back(std::wstring(p) + w1 + w2);
+	std::sort(names.begin(), names.end(), [](const std::wstring &a, const std::wstring &b) {
+		return OutOfLineIcmp(a.c_str(), b.c_str()) < 0; });
+	std::vector<LPCTSTR> list;
+	for (auto &n : names)
+		list.push_back(n.c_str());
+	// Look up each name in a different case, as scripts often do.
+	std::vector<std::wstring> keys;
+	for (auto &n : names)
+	{
+		std::wstring k = n;
+		for (auto &c : k)
+			c = towlower(c);
+		keys.push_back(k);
+	}
+
+	const int repeat = 2000;
+	printf("%d lookups in a list of %d names:\n", (int)(repeat * keys.size()), (int)list.size());
+	auto time = [&](const char *aName, auto aCompare) { // Generic so that ctcsicmp() can be inlined.
+		unit::Timer timer;
+		int found = 0;
+		for (int r = 0; r < repeat; ++r)
+			for (auto &k : keys)
+				found += Find(list, k.c_str(), aCompare) >= 0;
+		double t = timer.Elapsed();
+		printf("  %-14s %7.1f ns/lookup (%d found)\n", aName, t * 1e9 / (repeat * keys.size()), found);
+	};
+	time("ctcsicmp", [](LPCTSTR a, LPCTSTR b) { return ctcsicmp(a, b); });
+	time("out-of-line", [](LPCTSTR a, LPCTSTR b) { return OutOfLineIcmp(a, b); });
+	time("wcscasecmp", [](LPCTSTR a, LPCTSTR b) { return wcscasecmp(a, b); });
+	return 0;
+}
@@ -0,0 +1,141 @@
+//
+// Tests for ctcsicmp() (NameCompare.h), which replaced _tcsicmp() in the searches for variables,
+// functions, properties and so on.  Those lists are kept sorted, so ctcsicmp() must order every
+// pair of strings exactly as _tcsicmp() does in the "C" locale, not just agree on equality.
+//
+
+typedef wchar_t TBYTE;
+// Copied from util.h:
+inline int cisupper(TBYTE c) { return c <= 'Z' && c >= 'A'; }
+inline TCHAR ctolower(TBYTE c) { return cisupper(c) ? (c | 0x20) : c; }
+
+#include "NameCompare.h"
+#include "unit.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// _tcsicmp() as implemented by the CRT for the "C" locale: each code unit is converted to lowercase
+// if it is A-Z, and the result is the difference of the first pair which differs.
+static int ReferenceIcmp(LPCTSTR aStr1, LPCTSTR aStr2)
+{
+	int f, l;
+	do
+	{
+		f = (TBYTE)*aStr1++;
+		l = (TBYTE)*aStr2++;
+		if (f >= 'A' && f <= 'Z') f += 'a' - 'A';
+		if (l >= 'A' && l <= 'Z') l += 'a' - 'A';
+	} while (f && f == l);
+	return f - l;
+}
+
+static int Sign(int n) { return (n > 0) - (n < 0); }
+
+static unsigned sSeed = 12345;
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+// Characters chosen to be near the boundaries of the folded range, and non-ASCII letters whose
+// case _tcsicmp() doesn't fold in the "C" locale.
+static const TCHAR sChars[] = L"AZaz09_@[\\]^`{|}~ \x7F\xC0\xC9\xE0\xE9\x130\x131\xFF\xFF21\xFF41\xD800\xFFFF";
+
+static std::wstring RandomName(int aMaxLength)
+{
+	std::wstring s;
+	for (int n = (int)(Random() % (aMaxLength + 1)); n; --n)
+		s += sChars[Random() % (sizeof(sChars) / sizeof(*sChars) - 1)];
+	return s;
+}
+
+// Returns aName with the case of each ASCII letter randomly changed.
+static std::wstring RandomCase(std::wstring aName)
+{
+	for (auto &c : aName)
+		if (Random() & 1)
+			c = (c >= 'a' && c <= 'z') ? c - 32 : (c >= 'A' && c <= 'Z') ? c + 32 : c;
+	return aName;
+}
+
+TEST(Examples)
+{
+	CHECK_EQ(ctcsicmp(L"", L""), 0);
+	CHECK_EQ(ctcsicmp(L"A_Index", L"a_index"), 0);
+	CHECK_EQ(ctcsicmp(L"MsgBox", L"MSGBOX"), 0);
+	CHECK(ctcsicmp(L"a", L"ab") < 0);
+	CHECK(ctcsicmp(L"ab", L"a") > 0);
+	CHECK(ctcsicmp(L"_", L"a") < 0); // '_' sorts before letters, as they are folded to lowercase.
+	CHECK(ctcsicmp(L"_", L"A") < 0);
+	CHECK(ctcsicmp(L"[", L"a") < 0);
+	CHECK(ctcsicmp(L"{", L"Z") > 0);
+	CHECK(ctcsicmp(L"\xC9", L"\xE9") != 0); // Non-ASCII letters aren't folded.
+	CHECK(ctcsicmp(L"\xFFFF", L"a") > 0); // Code units compare as unsigned.
+}
+
+TEST(SignMatchesCRT)
+{
+	int mismatches = 0;
+	for (int i = 0; i < 2000000; ++i)
+	{
+		std::wstring a = RandomName(6), b;
+		switch (i % 3)
+		{
+		case 0: b = RandomName(6); break;
+		case 1: b = RandomCase(a); break; // Equal, or differing only in case.
+		default: b = RandomCase(a.substr(0, Random() % (a.length() + 1))) + RandomName(2); break; // Common prefix.
+		}
+		if (Sign(ctcsicmp(a.c_str(), b.c_str())) != Sign(ReferenceIcmp(a.c_str(), b.c_str())) && ++mismatches <= 10)
+			printf("ctcsicmp(\"%ls\", \"%ls\") differs\n", a.c_str(), b.c_str());
+	}
+	CHECK_EQ(mismatches, 0);
+}
+
+TEST(IdenticalOrdering)
+{
+	// Sort a list with the CRT's comparison, as the lists built by earlier versions were, then check
+	// that a binary search with ctcsicmp() (as in ScriptItemList::Find) finds every name in any case.
+	std::vector<std::wstring> names = { L"A_Index", L"A_LoopField", L"Abs", L"ACos", L"_private", L"__New"
+		, L"x", L"X1", L"x_", L"x[", L"Zz", L"{", L"\xC9t\xE9", L"\xE9t\xE9" };
+	for (int i = 0; i < 20000; ++i)
+		names.push_back(RandomName(8));
+	std::sort(names.begin(), names.end(), [](const std::wstring &a, const std::wstring &b) {
+		return ReferenceIcmp(a.c_str(), b.c_str()) < 0; });
+	names.erase(std::unique(names.begin(), names.end(), [](const std::wstring &a, const std::wstring &b) {
+		return !ReferenceIcmp(a.c_str(), b.c_str()); }), names.end());
+
+	int not_found = 0, unsorted = 0;
+	for (size_t i = 1; i < names.size(); ++i)
+		if (ctcsicmp(names[i - 1].c_str(), names[i].c_str()) >= 0)
+			++unsorted;
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		std::wstring key = RandomCase(names[i]);
+		int left = 0, right = (int)names.size() - 1, found = -1;
+		while (left <= right)
+		{
+			int mid = (left + right) / 2;
+			int result = ctcsicmp(key.c_str(), names[mid].c_str());
+			if (result > 0)
+				left = mid + 1;
+			else if (result < 0)
+				right = mid - 1;
+			else
+			{
+				found = mid;
+				break;
+			}
+		}
+		if (found != (int)i && ++not_found <= 10)
+			printf("\"%ls\" not found\n", key.c_str());
+	}
+	CHECK_EQ(unsorted, 0);
+	CHECK_EQ(not_found, 0);
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
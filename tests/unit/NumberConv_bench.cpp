@@ -0,0 +1,88 @@
+//
+// Benchmark of the number/string conversions in NumberConv.cpp against the C runtime calls they
+// replaced: FTOA() vs. "%.17g", ITOA64() vs. "%lld", and ParseNumeric() vs. IsNumeric() followed
+// by ATOI64() or _tstof().  The inputs are the kinds of values scripts typically convert.  The C
+// runtime here is glibc rather than the Microsoft CRT, so the ratios are only indicative.
+//
+
+#include "unit.h"
+#include <string>
+#include <vector>
+
+static const int N = 2000000;
+
+template<typename F>
+static void Time(const char *aName, const char *aVariant, F aFunc)
+{
+	unit::Timer timer;
+	aFunc();
+	double t = timer.Elapsed();
+	printf("  %-12s %-26s %7.1f ns/call\n", aName, aVariant, t * 1e9 / N);
+}
+
+int main()
+{
+	std::vector<double> doubles;
+	std::vector<__int64> ints;
+	std::vector<std::wstring> strings;
+	unsigned seed = 12345;
+	for (int i = 0; i < N; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		int r = (int)(seed >> 8);
+		doubles.push_back(r % 4 ? (r % 1000000) / 100.0 : r * 0.001);
+		ints.push_back(i % 8 ? r % 100000 : (__int64)r * r);
+		TCHAR buf[64];
+		switch (i % 4)
+		{
+		case 0: case 1: ITOA64(ints.back(), buf); break;
+		case 2: FTOA(doubles.back(), buf, _countof(buf)); break;
+		default: swprintf(buf, _countof(buf), L"0x%X", r); break;
+		}
+		strings.push_back(buf);
+	}
+
+	printf("%d conversions each:\n", N);
+	TCHAR buf[64];
+	Time("FTOA", "\"%.17g\"", [&] {
+		for (double d : doubles)
+			unit::Use(swprintf(buf, _countof(buf), L"%.17g", d));
+	});
+	Time("FTOA", "FTOA()", [&] {
+		for (double d : doubles)
+			unit::Use(FTOA(d, buf, _countof(buf)));
+	});
+	Time("ITOA64", "\"%lld\"", [&] {
+		for (__int64 n : ints)
+			unit::Use(swprintf(buf, _countof(buf), L"%lld", n));
+	});
+	Time("ITOA64", "ITOA64()", [&] {
+		for (__int64 n : ints)
+			unit::Use(ITOA64(n, buf));
+	});
+	Time("ParseNumeric", "IsNumeric() + ATOI64/_tstof", [&] {
+		for (auto &s : strings)
+		{
+			__int64 i = 0;
+			double d = 0;
+			if (SymbolType t = IsNumeric(s.c_str(), true, false, true))
+			{
+				if (t == PURE_INTEGER)
+					i = ATOI64(s.c_str());
+				else
+					d = _tstof(s.c_str());
+			}
+			unit::Use(i), unit::Use(d);
+		}
+	});
+	Time("ParseNumeric", "ParseNumeric()", [&] {
+		for (auto &s : strings)
+		{
+			__int64 i = 0;
+			double d = 0;
+			unit::Use(ParseNumeric(s.c_str(), i, d));
+			unit::Use(i), unit::Use(d);
+		}
+	});
+	return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+//
+// Stand-in for the parts of defines.h and util.h which NumberConv.cpp uses.  util.h depends on
+// much of the rest of the program, so its include guard is defined here to keep it out, and the
+// definitions below are copied from it.
+//
+
+#define util_h
+
+#include <limits.h>
+#include <stdarg.h>
+
+typedef wchar_t TBYTE;
+
+enum SymbolType { PURE_NOT_NUMERIC, PURE_INTEGER, PURE_FLOAT };
+
+#define IS_SPACE_OR_TAB(c) (c == ' ' || c == '\t')
+#define IS_HEX(buf) (*buf == '0' && (*(buf + 1) == 'x' || *(buf + 1) == 'X') && iswxdigit(*(buf + 2)))
+#define _countof(a) (sizeof(a) / sizeof(*(a)))
+#define _tcscspn wcscspn
+#define _tstof(s) wcstod((s), NULL)
+
+inline int cisdigit(TBYTE c) { return c <= '9' && c >= '0'; }
+inline int cislower(TBYTE c) { return c >= 'a' && c <= 'z'; }
+inline TCHAR ctoupper(TBYTE c) { return cislower(c) ? (c & ~0x20) : c; }
+inline LPCTSTR omit_leading_whitespace(LPCTSTR aBuf) { for (; IS_SPACE_OR_TAB(*aBuf); ++aBuf); return aBuf; }
+inline LPTSTR omit_leading_whitespace(LPTSTR aBuf) { return (LPTSTR)omit_leading_whitespace((LPCTSTR)aBuf); }
+
+inline int sntprintf(LPTSTR aBuf, int aBufSize, LPCTSTR aFormat, ...)
+{
+	va_list args;
+	va_start(args, aFormat);
+	int result = vswprintf(aBuf, aBufSize, aFormat, args);
+	va_end(args);
+	return result < 0 ? 0 : result;
+}
+
+__int64 istrtoi64(LPCTSTR buf, LPCTSTR *endptr);
+__int64 nstrtoi64(LPCTSTR buf);
+inline __int64 ATOI64(LPCTSTR buf) { return nstrtoi64(buf); }
+int FTOA(double aValue, LPTSTR aBuf, int aBufSize);
+LPTSTR ITOA64(__int64 aValue, LPTSTR aBuf);
+SymbolType IsNumeric(LPCTSTR aBuf, BOOL aAllowNegative = false
+	, BOOL aAllowAllWhitespace = true, BOOL aAllowFloat = false, BOOL aAllowImpure = false);
+SymbolType ParseNumeric(LPCTSTR aBuf, __int64 &aInt64, double &aDouble);
@@ -0,0 +1,214 @@
+//
+// Tests for the number/string conversions in NumberConv.cpp.  Each is compared directly against
+// the C runtime function it replaced, over edge cases and pseudo-random inputs: FTOA() against
+// swprintf "%.17g", ITOA64() against swprintf "%lld" (as _i64tot formats), and the values given by
+// ParseNumeric() against wcstoll/wcstoull (as _wtoi64 converts) and wcstod.
+//
+
+#include "unit.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static UINT64 sSeed = 0x9E3779B97F4A7C15ull;
+
+static UINT64 Random()
+{
+	sSeed ^= sSeed << 13;
+	sSeed ^= sSeed >> 7;
+	sSeed ^= sSeed << 17;
+	return sSeed;
+}
+
+static double FromBits(UINT64 aBits)
+{
+	double d;
+	memcpy(&d, &aBits, sizeof(d));
+	return d;
+}
+
+static UINT64 ToBits(double aValue)
+{
+	UINT64 bits;
+	memcpy(&bits, &aValue, sizeof(bits));
+	return bits;
+}
+
+static std::vector<double> TestDoubles()
+{
+	std::vector<double> v = {
+		0.0, -0.0, 1.0, -1.0, 0.1, 0.2, 0.3, 0.5, 1.0 / 3, 2.0 / 3, 1.5, 10.0, 100.0, 123.456, 3.141592653589793
+		, 0.001, nextafter(0.001, 0), nextafter(0.001, 1), 0.00099999999999999, 0.0009999999999999999
+		, 1e16, 1e17, nextafter(1e17, 0), nextafter(1e17, 2e17), 99999999999999999.0, 9007199254740992.0
+		, 9007199254740993.0, 72057594037927936.0, 144115188075855872.0, 12345678901234567.0
+		, 0.30000000000000004, 0.1 + 0.2, 1e-5, 1e-300, 1e300, 1e308, DBL_MAX, -DBL_MAX, DBL_MIN
+		, DBL_MIN / 2, 4.9406564584124654e-324, DBL_EPSILON, 1 + DBL_EPSILON, 1 - DBL_EPSILON / 2
+		, INFINITY, -INFINITY, NAN, 9.999999999999999e16, 0.09999999999999999, 0.01, 0.009999999999999998
+	};
+	for (int i = 0; i < 300000; ++i)
+	{
+		// Arbitrary bit patterns, covering every exponent.
+		v.push_back(FromBits(Random()));
+		// Values in and around the range printed in fixed notation.
+		UINT64 bits = Random();
+		int exp = 1023 - 12 + (int)(bits >> 58) % 72;
+		v.push_back(FromBits((bits & 0x800FFFFFFFFFFFFFull) | ((UINT64)exp << 52)));
+		// Values with few decimal digits, as scripts usually deal with.
+		static const double sScale[] = { 1, 10, 100, 1000, 1e4, 1e5, 1e6 };
+		v.push_back((double)(__int64)(Random() % 2000000000 - 1000000000) / sScale[Random() % 7]);
+	}
+	return v;
+}
+
+TEST(FTOA_MatchesPrintf)
+{
+	TCHAR buf[64], expected[64];
+	int mismatches = 0;
+	for (double d : TestDoubles())
+	{
+		int length = FTOA(d, buf, _countof(buf));
+		int expected_length = swprintf(expected, _countof(expected), L"%.17g", d);
+		// The one intended difference: FTOA() appends ".0" to anything which would look like an integer.
+		if ((int)wcscspn(expected, L".e") == expected_length && cisdigit(expected[expected_length - 1]))
+			expected_length += swprintf(expected + expected_length, 3, L".0");
+		if ((wcscmp(buf, expected) || length != expected_length) && ++mismatches <= 10)
+			printf("FTOA(%.17g): \"%ls\" vs. \"%ls\"\n", d, buf, expected);
+	}
+	CHECK_EQ(mismatches, 0);
+}
+
+TEST(FTOA_RoundTrip)
+{
+	TCHAR buf[64];
+	int mismatches = 0;
+	for (double d : TestDoubles())
+	{
+		if (!isfinite(d))
+			continue;
+		FTOA(d, buf, _countof(buf));
+		if (ToBits(wcstod(buf, NULL)) != ToBits(d) && ++mismatches <= 10)
+			printf("FTOA(%.17g) = \"%ls\" doesn't round-trip\n", d, buf);
+	}
+	CHECK_EQ(mismatches, 0);
+}
+
+TEST(FTOA_SmallBuffer)
+{
+	// Buffers smaller than 32 characters take the sprintf path, which must give the same result.
+	TCHAR buf[31], big[64];
+	for (double d : { 0.0, 0.1, -123.456, 1e17, 1e-300, -DBL_MAX })
+	{
+		FTOA(d, buf, _countof(buf));
+		FTOA(d, big, _countof(big));
+		CHECK(!wcscmp(buf, big));
+	}
+}
+
+TEST(ITOA64_MatchesPrintf)
+{
+	std::vector<__int64> v = { 0, 1, -1, 9, 10, 99, 100, -100, INT_MAX, INT_MIN, UINT_MAX, (__int64)UINT_MAX + 1
+		, INT64_MAX, INT64_MIN, INT64_MIN + 1 };
+	for (__int64 p = 1; p <= INT64_MAX / 10; p *= 10)
+		for (__int64 n : { p - 1, p, p + 1, -p + 1, -p, -p - 1 })
+			v.push_back(n);
+	for (int i = 0; i < 1000000; ++i)
+		v.push_back((__int64)(Random() >> (Random() % 64)) * (i & 1 ? -1 : 1));
+	TCHAR buf[32], expected[32];
+	int mismatches = 0;
+	for (__int64 n : v)
+	{
+		swprintf(expected, _countof(expected), L"%lld", n);
+		if (wcscmp(ITOA64(n, buf), expected) && ++mismatches <= 10)
+			printf("ITOA64(%lld) = \"%ls\"\n", n, buf);
+	}
+	CHECK_EQ(mismatches, 0);
+}
+
+static int sOverflows; // Integers which overflowed, and so were compared with ATOI64() rather than the CRT.
+
+static bool SameResult(LPCTSTR aBuf)
+// Checks ParseNumeric() against the C runtime.  Which strings are numeric is decided by IsNumeric(),
+// which ParseNumeric() must agree with; the CRT must then consume the whole string (except trailing
+// spaces and tabs) and give the same value.  The sign and any 0x prefix are removed first, since
+// _wtoi64 supports only decimal and ParseNumeric() never treats a leading 0 as octal.  The CRT
+// saturates integers which overflow whereas AutoHotkey wraps them, so those are compared with
+// ATOI64() instead.
+{
+	__int64 i = 0;
+	double d = 0;
+	SymbolType type = ParseNumeric(aBuf, i, d);
+	if (type != IsNumeric(aBuf, true, false, true))
+		return false;
+	LPCTSTR p = omit_leading_whitespace(aBuf);
+	wchar_t *end;
+	if (type == PURE_FLOAT)
+	{
+		double expected = wcstod(p, &end);
+		return !*omit_leading_whitespace(end) && ToBits(d) == ToBits(expected);
+	}
+	if (type != PURE_INTEGER)
+		return true;
+	bool negative = *p == '-';
+	if (*p == '-' || *p == '+')
+		++p;
+	bool hex = p[0] == '0' && (p[1] == 'x' || p[1] == 'X');
+	errno = 0;
+	UINT64 expected = hex ? wcstoull(p + 2, &end, 16) : (UINT64)wcstoll(p, &end, 10);
+	if (*omit_leading_whitespace(end))
+		return false;
+	if (errno == ERANGE)
+	{
+		++sOverflows;
+		return i == ATOI64(aBuf);
+	}
+	return i == (__int64)(negative ? 0 - expected : expected);
+}
+
+TEST(ParseNumeric_Examples)
+{
+	__int64 i;
+	double d;
+	CHECK_EQ(ParseNumeric(L"123", i, d), PURE_INTEGER); CHECK_EQ(i, 123);
+	CHECK_EQ(ParseNumeric(L" \t-42 \t", i, d), PURE_INTEGER); CHECK_EQ(i, -42);
+	CHECK_EQ(ParseNumeric(L"+0x1F", i, d), PURE_INTEGER); CHECK_EQ(i, 31);
+	CHECK_EQ(ParseNumeric(L"-0xff", i, d), PURE_INTEGER); CHECK_EQ(i, -255);
+	CHECK_EQ(ParseNumeric(L"010", i, d), PURE_INTEGER); CHECK_EQ(i, 10); // Not octal.
+	CHECK_EQ(ParseNumeric(L"9223372036854775808", i, d), PURE_INTEGER); CHECK_EQ(i, INT64_MIN); // Wraps.
+	CHECK_EQ(ParseNumeric(L"0xFFFFFFFFFFFFFFFF", i, d), PURE_INTEGER); CHECK_EQ(i, -1);
+	CHECK_EQ(ParseNumeric(L"1.5", i, d), PURE_FLOAT); CHECK_EQ(d, 1.5);
+	CHECK_EQ(ParseNumeric(L"-.5", i, d), PURE_FLOAT); CHECK_EQ(d, -0.5);
+	CHECK_EQ(ParseNumeric(L"1.", i, d), PURE_FLOAT); CHECK_EQ(d, 1.0);
+	CHECK_EQ(ParseNumeric(L"1e3", i, d), PURE_FLOAT); CHECK_EQ(d, 1000.0);
+	CHECK_EQ(ParseNumeric(L"2E-1 ", i, d), PURE_FLOAT); CHECK_EQ(d, 0.2);
+	for (LPCTSTR s : { L"", L" ", L"-", L"+", L".", L"0x", L"-0x", L"0xG", L"1e", L"1e+", L".e1", L"1 2", L"12a"
+		, L"1.2.3", L"1e2e3", L"0x1.5", L"--1", L"abc", L" 12", L"inf", L"nan" })
+		CHECK_EQ(ParseNumeric(s, i, d), PURE_NOT_NUMERIC);
+}
+
+TEST(ParseNumeric_MatchesCRT)
+{
+	static const LPCTSTR sPieces[] = {
+		L" ", L"\t", L"-", L"+", L"0x", L"0X", L"0", L"1", L"7", L"12345", L"9223372036854775807"
+		, L"18446744073709551616", L"99999999999999999999999", L".", L"e", L"E", L"e-", L"e+", L"5", L"a"
+		, L"F", L"x", L"g", L" ", L"\n", L"1e400", L"0.000000001", L"ff", L"1.5", L"e308", L"١"
+	};
+	int mismatches = 0;
+	for (int i = 0; i < 3000000; ++i)
+	{
+		std::wstring s;
+		for (int n = 1 + (int)(Random() % 6); n; --n)
+			s += sPieces[Random() % _countof(sPieces)];
+		if (!SameResult(s.c_str()) && ++mismatches <= 10)
+			printf("ParseNumeric(\"%ls\") differs\n", s.c_str());
+	}
+	CHECK_EQ(mismatches, 0);
+	CHECK(sOverflows < 300000); // Most integers are compared with the CRT.
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
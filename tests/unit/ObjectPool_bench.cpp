@@ -0,0 +1,49 @@
+#include "ObjectPool.h"
+#include "unit.h"
+
+//
+// Churn benchmark: allocates and frees objects of the sizes used by small script objects
+// (an Object header plus an initial item buffer), comparing the pool with malloc/free.
+//
+
+static const int sIterations = 10000000;
+static const size_t sSizes[] = { 48, 64, 96, 128 }; // Typical header and small item buffer sizes.
+static const int sLive = 256; // Objects which stay alive at any given time.
+
+template<typename Alloc, typename Free>
+static double Churn(Alloc aAlloc, Free aFree)
+{
+	static void *live[sLive];
+	static size_t live_size[sLive];
+	unit::Timer timer;
+	for (int i = 0; i < sIterations; ++i)
+	{
+		int slot = i % sLive;
+		if (live[slot])
+			aFree(live[slot], live_size[slot]);
+		live_size[slot] = sSizes[i & 3];
+		live[slot] = aAlloc(live_size[slot]);
+		*(int *)live[slot] = i;
+	}
+	for (int slot = 0; slot < sLive; ++slot)
+	{
+		aFree(live[slot], live_size[slot]);
+		live[slot] = nullptr;
+	}
+	return timer.Elapsed();
+}
+
+static void *PoolAlloc(size_t aSize) { return ObjectPool::Alloc(aSize); }
+static void PoolFree(void *aPtr, size_t aSize) { ObjectPool::Free(aPtr, aSize); }
+static void *CrtAlloc(size_t aSize) { return malloc(aSize); }
+static void CrtFree(void *aPtr, size_t) { free(aPtr); }
+
+int main()
+{
+	double heap = Churn(CrtAlloc, CrtFree);
+	double pool = Churn(PoolAlloc, PoolFree);
+	printf("%d allocations/frees of %d live small blocks:\n", sIterations, sLive);
+	printf("  malloc/free:  %.3f s (%.1f ns/op)\n", heap, heap * 1e9 / sIterations);
+	printf("  ObjectPool:   %.3f s (%.1f ns/op), %u chunk(s)\n", pool, pool * 1e9 / sIterations, ObjectPool::sChunkCount);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "ObjectPool.h"
+#include "unit.h"
+
+
+TEST(ReusesFreedBlocksOfTheSameClass)
+{
+	void *a = ObjectPool::Alloc(40);
+	ObjectPool::Free(a, 40);
+	void *b = ObjectPool::Alloc(33); // Same 48-byte class.
+	CHECK(a == b);
+	ObjectPool::Free(b, 33);
+}
+
+TEST(LargeBlocksBypassThePool)
+{
+	auto heap_allocs = ObjectPool::sHeapAllocs, in_use = ObjectPool::sInUse;
+	void *p = ObjectPool::Alloc(ObjectPool::MaxSize + 1);
+	CHECK(p != nullptr);
+	CHECK_EQ(ObjectPool::sHeapAllocs, heap_allocs + 1);
+	CHECK_EQ(ObjectPool::sInUse, in_use);
+	ObjectPool::Free(p, ObjectPool::MaxSize + 1);
+	CHECK_EQ(ObjectPool::sInUse, in_use);
+}
+
+TEST(BlocksDoNotOverlap)
+{
+	const int count = 10000;
+	static char *block[count];
+	for (int i = 0; i < count; ++i)
+	{
+		size_t size = 1 + i % ObjectPool::MaxSize;
+		block[i] = (char *)ObjectPool::Alloc(size);
+		memset(block[i], i & 0xFF, size);
+	}
+	bool intact = true;
+	for (int i = 0; i < count; ++i)
+	{
+		size_t size = 1 + i % ObjectPool::MaxSize;
+		for (size_t j = 0; j < size; ++j)
+			intact = intact && block[i][j] == (char)(i & 0xFF);
+		ObjectPool::Free(block[i], size);
+	}
+	CHECK(intact);
+}
+
+TEST(ReallocPreservesContents)
+{
+	// Grow within a class, across classes and out of the pool, then shrink back into it.
+	size_t sizes[] = { 8, 16, 17, 100, ObjectPool::MaxSize, ObjectPool::MaxSize + 1, 4096, 24 };
+	size_t size = 1;
+	auto p = (unsigned char *)ObjectPool::Alloc(size);
+	p[0] = 0xA5;
+	for (size_t new_size : sizes)
+	{
+		p = (unsigned char *)ObjectPool::Realloc(p, size, new_size);
+		CHECK(p != nullptr);
+		for (size_t i = 1; i < new_size; ++i)
+			if (i >= size)
+				p[i] = (unsigned char)i;
+		CHECK_EQ(p[0], 0xA5);
+		bool intact = true;
+		for (size_t i = 1; i < size && i < new_size; ++i)
+			intact = intact && p[i] == (unsigned char)i;
+		CHECK(intact);
+		size = new_size;
+	}
+	ObjectPool::Free(p, size);
+}
+
+TEST(InUseCountIsBalanced)
+{
+	auto in_use = ObjectPool::sInUse;
+	void *p[64];
+	for (int i = 0; i < 64; ++i)
+		p[i] = ObjectPool::Alloc(1 + i * 4);
+	CHECK_EQ(ObjectPool::sInUse, in_use + 64);
+	for (int i = 0; i < 64; ++i)
+		ObjectPool::Free(p[i], 1 + i * 4);
+	CHECK_EQ(ObjectPool::sInUse, in_use);
+}
+
+int main()
+{
+	return RUN_TESTS();
+}
@@ -0,0 +1,95 @@
+#include "SendProgram.h"
+#include "unit.h"
+#include <string>
+
+//
+// Sends a few typical strings repeatedly, timing each stage of what SendKeys() does before it
+// calls SendInput: compiling the string each time (as it used to be parsed inline) vs. finding the
+// cached program by its hash, and building the array of events from the program.  The events are
+// a down and up for each character or key, with the modifiers pressed around them, for both
+// SendInput and SendPlay; resolving each character to a VK for the target layout is not included,
+// since that requires Windows.
+//
+
+static const int sIterations = 200000;
+
+template<typename F>
+static double Time(F aStage)
+{
+	unit::Timer timer;
+	for (int i = 0; i < sIterations; ++i)
+		aStage();
+	return timer.Elapsed() * 1e9 / sIterations;
+}
+
+static void BuildEvents(SendProgram *aProgram, bool aPlayback)
+{
+	INPUT mem[500]; // As for MAX_INITIAL_EVENTS_SI, which is also enough for this many PlaybackEvents.
+	InputEventArray events;
+	events.Init(mem, aPlayback ? 500 * sizeof(INPUT) / sizeof(PlaybackEvent) : 500, 0, aPlayback);
+	modLR_type mods = 0;
+	for (UINT i = 0; i < aProgram->mOpCount; ++i)
+	{
+		SendOp &op = aProgram->mOp[i];
+		switch (op.type)
+		{
+		case SOP_MODIFIER:
+			events.PutKeybd(op.mod, 0x10, 0x2A, 0, 0, false);
+			mods |= op.mod;
+			break;
+		case SOP_CHAR:
+		case SOP_KEY:
+			for (int r = op.type == SOP_KEY ? op.repeat_count : 1; r > 0; --r)
+			{
+				vk_type vk = op.type == SOP_CHAR ? (vk_type)ctoupper(op.ch) : 0x24;
+				events.PutKeybd(0, vk, 0x1E, 0, 0, false);
+				events.PutKeybd(0, vk, 0x1E, KEYEVENTF_KEYUP, 0, false);
+			}
+			if (mods)
+			{
+				events.PutKeybd(mods, 0x10, 0x2A, KEYEVENTF_KEYUP, 0, false);
+				mods = 0;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	unit::Use(events.mCount);
+	events.Free();
+}
+
+static void Compare(LPCTSTR aLabel, LPCTSTR aKeys)
+{
+	size_t length = wcslen(aKeys);
+	SendProgram *cached = SendProgram::Compile(aKeys, SCM_NOT_RAW);
+	cached->mHash = SendProgram::Hash(aKeys, length, SCM_NOT_RAW, NULL);
+	double compile = Time([&] {
+		SendProgram *program = SendProgram::Compile(aKeys, SCM_NOT_RAW);
+		unit::Use(program->mOpCount);
+		program->Release();
+	});
+	double lookup = Time([&] {
+		UINT hash = SendProgram::Hash(aKeys, length, SCM_NOT_RAW, NULL);
+		bool found = cached->Matches(aKeys, length, SCM_NOT_RAW, NULL, hash);
+		unit::Use(found);
+	});
+	double input = Time([&] { BuildEvents(cached, false); });
+	double play = Time([&] { BuildEvents(cached, true); });
+	printf("  %-14ls %9.1f ns %9.1f ns %9.1f ns %9.1f ns\n", aLabel, compile, lookup, input, play);
+	cached->Release();
+}
+
+int main()
+{
+	std::wstring paragraph;
+	for (int i = 0; i < 8; ++i)
+		paragraph += L"The quick brown fox jumps over the lazy dog. ";
+	printf("%d sends each:    compile      lookup   SendInput    SendPlay\n", sIterations);
+	Compare(L"hotkey", L"^c");
+	Compare(L"keys", L"{Home}+{End}{Del}");
+	Compare(L"word", L"Hello");
+	Compare(L"signature", L"Best regards,{Enter}{Enter}Jane Doe{Tab 2}");
+	Compare(L"paragraph", paragraph.c_str());
+	return 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+//
+// Stand-in for the parts of keyboard_mouse.h, defines.h, util.h and winuser.h which SendProgram
+// uses.  Those headers depend on much of the rest of the program, so their include guards are
+// defined here to keep them out, and the definitions below are copied from them.
+//
+
+#define keyboard_h
+#define util_h
+
+typedef short SHORT;
+typedef wchar_t TBYTE;
+typedef USHORT sc_type;
+typedef UCHAR vk_type;
+typedef UCHAR modLR_type;
+
+#define MOD_LCONTROL 0x01
+#define MOD_RCONTROL 0x02
+#define MOD_LALT 0x04
+#define MOD_RALT 0x08
+#define MOD_LSHIFT 0x10
+#define MOD_RSHIFT 0x20
+#define MOD_LWIN 0x40
+#define MOD_RWIN 0x80
+
+#define VK_BACK 0x08
+#define VK_TAB 0x09
+#define VK_RETURN 0x0D
+
+#define VK_CONTROL 0x11
+#define VK_MENU 0x12
+#define VK_F10 0x79
+#define SC_LCONTROL 0x01D
+#define SC_RALT 0x138
+
+enum SendRawModes {SCM_NOT_RAW = FALSE, SCM_RAW, SCM_RAW_TEXT};
+enum KeyEventTypes {KEYDOWN, KEYUP, KEYDOWNANDUP};
+
+typedef UCHAR HookType;
+#define HOOK_KEYBD 0x01
+#define HOOK_MOUSE 0x02
+
+#define COORD_UNSPECIFIED INT_MIN
+#define COORD_UNSPECIFIED_SHORT SHRT_MIN
+#define MSG_OFFSET_MOUSE_MOVE 0x80000000
+
+struct PlaybackEvent
+{
+	UINT message;
+	union
+	{
+		struct
+		{
+			sc_type sc;
+			vk_type vk;
+		};
+		struct
+		{
+			SHORT x;
+			SHORT y;
+		};
+		DWORD time_to_wait;
+	};
+};
+
+// From winuser.h.
+struct INPUT
+{
+	DWORD type;
+	union
+	{
+		struct { LONG dx, dy; DWORD mouseData, dwFlags, time; ULONG_PTR dwExtraInfo; } mi;
+		struct { WORD wVk, wScan; DWORD dwFlags, time; ULONG_PTR dwExtraInfo; } ki;
+	};
+};
+typedef INPUT *LPINPUT;
+#define INPUT_MOUSE 0
+#define INPUT_KEYBOARD 1
+#define KEYEVENTF_KEYUP 0x0002
+#define KEYEVENTF_UNICODE 0x0004
+#define MOUSEEVENTF_MOVE 0x0001
+#define MOUSEEVENTF_LEFTDOWN 0x0002
+#define MOUSEEVENTF_LEFTUP 0x0004
+#define MOUSEEVENTF_RIGHTDOWN 0x0008
+#define MOUSEEVENTF_RIGHTUP 0x0010
+#define MOUSEEVENTF_MIDDLEDOWN 0x0020
+#define MOUSEEVENTF_MIDDLEUP 0x0040
+#define MOUSEEVENTF_XDOWN 0x0080
+#define MOUSEEVENTF_XUP 0x0100
+#define MOUSEEVENTF_WHEEL 0x0800
+#define MOUSEEVENTF_HWHEEL 0x1000
+#define MOUSEEVENTF_ABSOLUTE 0x8000
+#define WM_KEYDOWN 0x0100
+#define WM_KEYUP 0x0101
+#define WM_SYSKEYDOWN 0x0104
+#define WM_SYSKEYUP 0x0105
+#define WM_MOUSEMOVE 0x0200
+#define WM_LBUTTONDOWN 0x0201
+#define WM_LBUTTONUP 0x0202
+#define WM_RBUTTONDOWN 0x0204
+#define WM_RBUTTONUP 0x0205
+#define WM_MBUTTONDOWN 0x0207
+#define WM_MBUTTONUP 0x0208
+#define WM_MOUSEWHEEL 0x020A
+#define WM_XBUTTONDOWN 0x020B
+#define WM_XBUTTONUP 0x020C
+#define WM_MOUSEHWHEEL 0x020E
+#define LOBYTE(w) ((BYTE)((w) & 0xff))
+
+#define IS_SPACE_OR_TAB(c) (c == ' ' || c == '\t')
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define _countof(a) (sizeof(a) / sizeof(*(a)))
+
+inline TCHAR ctoupper(TBYTE c) { return towupper(c); }
+inline int ATOI(LPCTSTR buf) { return (int)wcstoll(buf, NULL, (buf[0] == '0' && (buf[1] | 0x20) == 'x') ? 16 : 10); }
+inline LPCTSTR omit_leading_whitespace(LPCTSTR aBuf) { for (; IS_SPACE_OR_TAB(*aBuf); ++aBuf); return aBuf; }
+inline LPTSTR omit_leading_whitespace(LPTSTR aBuf) { return (LPTSTR)omit_leading_whitespace((LPCTSTR)aBuf); }
+inline LPTSTR StrChrAny(LPTSTR aStr, LPCTSTR aCharList) { return wcspbrk(aStr, aCharList); }
@@ -0,0 +1,287 @@
+//
+// Tests for the SendProgram parser.  Each string is compiled and its operations are rendered as a
+// compact description, which is compared against what SendKeys() would have done with the string
+// when it parsed it inline.  Also tests InputEventArray, which builds the arrays of events for
+// SendInput and SendPlay.
+//
+
+#include "SendProgram.h"
+#include "unit.h"
+#include <string>
+
+// Renders the operations of a program, one per character or {} item, separated by spaces:
+//   ^+!#     modifier
+//   -        skipped
+//   0        reset (an item which sends nothing but cancels modifiers)
+//   C(...)   {Click ...}
+//   K(name,event[,down type],repeat)
+//   'c'      character, suffixed with r or t for raw or text mode, and =vk if it has a fixed VK
+static std::wstring Describe(LPCTSTR aKeys, SendRawModes aSendRaw = SCM_NOT_RAW)
+{
+	SendProgram *program = SendProgram::Compile(aKeys, aSendRaw);
+	std::wstring s;
+	for (UINT i = 0; i < program->mOpCount; ++i)
+	{
+		SendOp &op = program->mOp[i];
+		if (i)
+			s += L' ';
+		wchar_t buf[64];
+		switch (op.type)
+		{
+		case SOP_SKIP: s += L'-'; break;
+		case SOP_RESET: s += L'0'; break;
+		case SOP_MODIFIER:
+			s += op.mod == MOD_LCONTROL ? L'^' : op.mod == MOD_LSHIFT ? L'+' : op.mod == MOD_LALT ? L'!' : L'#';
+			break;
+		case SOP_CLICK:
+			s += L"C(";
+			s += program->Text(op);
+			s += L')';
+			break;
+		case SOP_KEY:
+			s += L"K(";
+			s.append(program->Text(op), op.name_length);
+			s += op.event_type == KEYDOWN ? L",down" : op.event_type == KEYUP ? L",up" : L"";
+			if (op.event_type == KEYDOWN)
+				s += op.key_down_type == KEYDOWN_TEMP ? L"temp" : op.key_down_type == KEYDOWN_REMAP ? L"R" : L"";
+			swprintf(buf, 64, L",%d)", op.repeat_count);
+			s += buf;
+			break;
+		case SOP_CHAR:
+			s += L'\'';
+			s += op.ch;
+			s += L'\'';
+			if (op.send_raw)
+				s += op.send_raw == SCM_RAW ? L'r' : L't';
+			if (op.vk)
+			{
+				swprintf(buf, 64, L"=%d", op.vk);
+				s += buf;
+			}
+			break;
+		}
+	}
+	CHECK_EQ(program->mSourceLength, wcslen(aKeys));
+	CHECK(!wmemcmp(program->mText, aKeys, program->mSourceLength + 1));
+	program->Release();
+	return s;
+}
+
+#define CHECK_SEND(keys, expected) CHECK(Describe(keys) == expected)
+
+
+TEST(CharactersAndModifiers)
+{
+	CHECK_SEND(L"", L"");
+	CHECK_SEND(L"ab", L"'a' 'b'");
+	CHECK_SEND(L"^+!#x", L"^ + ! # 'x'");
+	CHECK_SEND(L"}", L"-");
+}
+
+TEST(KeyItems)
+{
+	CHECK_SEND(L"{Enter}", L"K(Enter,1)");
+	CHECK_SEND(L"{ Tab}", L"K(Tab,1)"); // Leading whitespace is skipped.
+	CHECK_SEND(L"^{Home}x", L"^ K(Home,1) 'x'");
+	CHECK_SEND(L"{Bogus}", L"K(Bogus,1)"); // Resolved (or not) at the time of sending.
+	CHECK_SEND(L"{}", L"0");
+	CHECK_SEND(L"{  }", L"0");
+}
+
+TEST(RepeatCounts)
+{
+	CHECK_SEND(L"{a 3}", L"K(a,3)");
+	CHECK_SEND(L"{a\t12}", L"K(a,12)");
+	CHECK_SEND(L"{a 0}", L"0");
+	CHECK_SEND(L"{a -1}", L"0");
+	CHECK_SEND(L"{a }", L"0"); // An empty word is a repeat count of zero.
+	CHECK_SEND(L"{a 0x10}", L"K(a,16)");
+}
+
+TEST(DownAndUp)
+{
+	CHECK_SEND(L"{Shift down}", L"K(Shift,down,1)");
+	CHECK_SEND(L"{Shift Down}{Shift Up}", L"K(Shift,down,1) K(Shift,up,1)");
+	CHECK_SEND(L"{Ctrl DownTemp}", L"K(Ctrl,downtemp,1)");
+	CHECK_SEND(L"{Ctrl downtemp}", L"K(Ctrl,downtemp,1)");
+	CHECK_SEND(L"{LWin DownR}", L"K(LWin,downR,1)");
+	CHECK_SEND(L"{LWin downr}", L"K(LWin,downR,1)"); // Case-insensitive, like the other words.
+	CHECK_SEND(L"{LWin DownX}", L"K(LWin,down,1)");
+	CHECK_SEND(L"{a upx}", L"0"); // Not "Up", so it's a repeat count.
+}
+
+TEST(BraceItems)
+{
+	CHECK_SEND(L"{{}", L"K({,1)");
+	CHECK_SEND(L"{}}", L"K(},1)");
+	CHECK_SEND(L"{} down}", L"K(},down,1)");
+	CHECK_SEND(L"{}   up}x", L"K(},up,1) 'x'");
+	CHECK_SEND(L"{} 5}", L"0 ' ' '5' -"); // Only Down and Up are supported after "{}".
+	CHECK_SEND(L"{} down", L"- ' ' 'd' 'o' 'w' 'n'"); // Unmatched.
+}
+
+TEST(UnmatchedBrace)
+{
+	CHECK_SEND(L"a{b", L"'a' - 'b'");
+	CHECK_SEND(L"{", L"-");
+}
+
+TEST(Click)
+{
+	CHECK_SEND(L"{Click}", L"C(Click)");
+	CHECK_SEND(L"{Click 10 20 Right}", L"C(Click 10 20 Right)");
+	CHECK_SEND(L"^{click}", L"^ C(click)");
+}
+
+TEST(RawAndText)
+{
+	CHECK_SEND(L"{Raw}^{a}", L"0 '^'r '{'r 'a'r '}'r");
+	CHECK_SEND(L"x{Text}!\t", L"'x' 0 '!'t '\t't=9");
+	CHECK_SEND(L"{Text}a\r\nb\n\b", L"0 'a't '\r't=13 'b't '\n't=13 '\b't=8");
+	CHECK_SEND(L"{Raw}\r\n", L"0 '\r'r '\n'r"); // Only {Text} translates.
+	CHECK(Describe(L"^a{b}", SCM_RAW) == L"'^'r 'a'r '{'r 'b'r '}'r");
+	CHECK(Describe(L"{Raw}", SCM_RAW_TEXT) == L"'{'t 'R't 'a't 'w't '}'t");
+}
+
+TEST(TooLongItemIsSkipped)
+{
+	std::wstring keys = L"{" + std::wstring(1024, L'x') + L"}a";
+	CHECK(Describe(keys.c_str()) == L"0 'a'");
+}
+
+TEST(HashAndMatches)
+{
+	LPCTSTR keys = L"^{Home}abc";
+	size_t length = wcslen(keys);
+	SendProgram *program = SendProgram::Compile(keys, SCM_NOT_RAW);
+	UINT hash = SendProgram::Hash(keys, length, SCM_NOT_RAW, NULL);
+	program->mHash = hash;
+	CHECK(program->Matches(keys, length, SCM_NOT_RAW, NULL, hash));
+	CHECK(!program->Matches(keys, length, SCM_RAW, NULL, SendProgram::Hash(keys, length, SCM_RAW, NULL)));
+	CHECK(!program->Matches(L"^{Home}abd", length, SCM_NOT_RAW, NULL, SendProgram::Hash(L"^{Home}abd", length, SCM_NOT_RAW, NULL)));
+	program->Release();
+}
+
+
+TEST(InputEventArrayKeybd)
+{
+	INPUT mem[4];
+	InputEventArray a;
+	a.Init(mem, 4, MOD_LSHIFT, false);
+	a.PutKeybd(0, 'A', 0x11E, 0, 1234, true);
+	a.PutKeybd(MOD_LSHIFT, VK_MENU, 0x2A, KEYEVENTF_KEYUP, 1234, true);
+	a.PutKeybd(0, 0, 0x263A, KEYEVENTF_UNICODE, 1234, true);
+	CHECK_EQ(a.mCount, 3u);
+	CHECK_EQ(mem[0].type, (DWORD)INPUT_KEYBOARD);
+	CHECK_EQ(mem[0].ki.wVk, 'A');
+	CHECK_EQ(mem[0].ki.wScan, 0x1E); // The extended-key bit is omitted...
+	CHECK_EQ(mem[2].ki.wScan, 0x263A); // ... except for KEYEVENTF_UNICODE, where it's a character.
+	CHECK_EQ(mem[1].ki.dwFlags, (DWORD)KEYEVENTF_KEYUP);
+	CHECK_EQ(mem[0].ki.dwExtraInfo, (ULONG_PTR)1234);
+	CHECK_EQ(mem[0].ki.time, 0u);
+	CHECK_EQ(a.mModifiersLR, 0); // Shift was released.
+	CHECK_EQ(a.mHooksToRemove, HOOK_KEYBD);
+	a.Free();
+}
+
+TEST(InputEventArrayPlayback)
+{
+	PlaybackEvent mem[8];
+	InputEventArray a;
+	a.Init(mem, 8, 0, true);
+	a.PutKeybd(0, 'A', 0x1E, 0, 0, false);
+	a.PutKeybd(MOD_LALT, VK_MENU, 0x38, 0, 0, false); // Alt itself is a syskey,
+	a.PutKeybd(0, 'A', 0x1E, 0, 0, false); // as is any key while it's down
+	a.PutKeybd(MOD_LALT, VK_MENU, 0x38, KEYEVENTF_KEYUP, 0, false); // and Alt's release (the predicted state is updated first).
+	a.PutKeybd(0, VK_F10, 0x44, 0, 0, false); // F10 by itself.
+	a.PutKeybd(MOD_LCONTROL, VK_CONTROL, SC_LCONTROL, 0, 0, false);
+	a.PutKeybd(0, VK_F10, 0x44, 0, 0, false); // But not Ctrl+F10.
+	a.PutKeybd(0, 0, 0, 0, 50, false); // A delay.
+	CHECK_EQ(a.mCount, 8u);
+	static const UINT expected[] = { WM_KEYDOWN, WM_SYSKEYDOWN, WM_SYSKEYDOWN, WM_SYSKEYUP, WM_SYSKEYDOWN, WM_KEYDOWN, WM_KEYDOWN, 0 };
+	for (UINT i = 0; i < a.mCount; ++i)
+		CHECK_EQ(mem[i].message, expected[i]);
+	CHECK_EQ(mem[1].vk, VK_MENU);
+	CHECK_EQ(mem[1].sc, 0x38);
+	CHECK_EQ(mem[7].time_to_wait, 50u);
+	CHECK_EQ(a.mModifiersLR, MOD_LCONTROL);
+	CHECK_EQ(a.mHooksToRemove, 0); // Only SendInput is affected by hooks.
+	a.Free();
+}
+
+TEST(InputEventArrayAltGr)
+{
+	// With an AltGr layout, SendPlay precedes RAlt with LControl, as the system does for SendInput.
+	PlaybackEvent pb[4];
+	InputEventArray a;
+	a.Init(pb, 4, 0, true);
+	a.PutKeybd(MOD_RALT, VK_MENU, SC_RALT, 0, 0, true);
+	a.PutKeybd(MOD_RALT, VK_MENU, SC_RALT, 0, 0, false);
+	CHECK_EQ(a.mCount, 3u);
+	CHECK_EQ(pb[0].vk, VK_CONTROL);
+	CHECK_EQ(pb[0].sc, SC_LCONTROL);
+	CHECK_EQ(pb[1].vk, VK_MENU);
+	CHECK_EQ(pb[2].vk, VK_MENU);
+	a.Free();
+
+	INPUT si[4];
+	a.Init(si, 4, 0, false);
+	a.PutKeybd(MOD_RALT, VK_MENU, SC_RALT, 0, 0, true);
+	CHECK_EQ(a.mCount, 1u);
+	a.Free();
+}
+
+TEST(InputEventArrayMouse)
+{
+	INPUT si[2];
+	InputEventArray a;
+	a.Init(si, 2, 0, false);
+	a.PutMouse(MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE, 0, 100, COORD_UNSPECIFIED, 99);
+	CHECK_EQ(si[0].type, (DWORD)INPUT_MOUSE);
+	CHECK_EQ(si[0].mi.dx, 100);
+	CHECK_EQ(si[0].mi.dy, 0);
+	CHECK_EQ(si[0].mi.dwExtraInfo, (ULONG_PTR)99);
+	CHECK_EQ(a.mHooksToRemove, HOOK_MOUSE);
+	a.Free();
+
+	PlaybackEvent pb[4];
+	a.Init(pb, 4, 0, true);
+	a.PutMouse(MOUSEEVENTF_MOVE, 0, 10, 20, 0);
+	a.PutMouse(MOUSEEVENTF_MOVE | MOUSEEVENTF_LEFTDOWN, 0, 10, 20, 0);
+	a.PutMouse(MOUSEEVENTF_XUP | MSG_OFFSET_MOUSE_MOVE, 0, (DWORD)-5, COORD_UNSPECIFIED, 0);
+	a.PutMouse(MOUSEEVENTF_HWHEEL, 120, COORD_UNSPECIFIED, COORD_UNSPECIFIED, 0);
+	CHECK_EQ(pb[0].message, (UINT)WM_MOUSEMOVE);
+	CHECK_EQ(pb[1].message, (UINT)WM_LBUTTONDOWN);
+	CHECK_EQ(pb[2].message, (UINT)WM_XBUTTONUP | MSG_OFFSET_MOUSE_MOVE);
+	CHECK_EQ(pb[3].message, (UINT)WM_MOUSEHWHEEL);
+	CHECK_EQ(pb[1].x, 10);
+	CHECK_EQ(pb[1].y, 20);
+	CHECK_EQ(pb[2].x, -5);
+	CHECK_EQ(pb[2].y, COORD_UNSPECIFIED_SHORT);
+	a.Free();
+}
+
+TEST(InputEventArrayExpand)
+{
+	for (int playback = 0; playback < 2; ++playback)
+	{
+		INPUT mem[3];
+		InputEventArray a;
+		a.Init(mem, 3, 0, playback);
+		for (int i = 0; i < 100; ++i)
+			a.PutKeybd(0, 'A' + i % 26, 0x1E, (i & 1) ? KEYEVENTF_KEYUP : 0, 0, false);
+		CHECK_EQ(a.mCount, 100u);
+		CHECK(a.mMax >= 100u);
+		CHECK(a.mInput != mem);
+		CHECK(!a.mAbort);
+		for (int i = 0; i < 100; ++i)
+			CHECK_EQ(playback ? a.Playback()[i].vk : a.mInput[i].ki.wVk, 'A' + i % 26);
+		a.Free();
+	}
+}
+
+
+int main()
+{
+	return RUN_TESTS();
+}
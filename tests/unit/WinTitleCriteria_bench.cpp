@@ -0,0 +1,84 @@
+//
+// Benchmark of WinTitle compilation during a window search.  Evaluating a window group, such as
+// WinExist("ahk_group G") or GroupActivate, calls WindowSearch::SetCriteria() for each WindowSpec
+// in the group for each window enumerated, so the cost of compiling WinTitle is multiplied by the
+// number of windows.  This simulates such a search over 5000 synthetic windows, with candidate
+// attributes compared by WinTitleCriteria::IsMatch() in the default TitleMatchMode, and compares
+// compiling each WinTitle every time (as SetCriteria() used to parse it) with looking it up in a
+// WinTitleCache.
+//
+
+#include "WinTitleCriteria.h"
+#include "unit.h"
+#include <string>
+#include <vector>
+
+struct SyntheticWindow
+{
+	std::wstring title, class_name, exe;
+};
+
+static const LPCTSTR sGroup[] = {
+	_T("ahk_exe notepad.exe"),
+	_T("Document ahk_class Chrome_WidgetWin_1 ahk_exe chrome.exe"),
+	_T("ahk_class CabinetWClass"),
+	_T("Inbox - Outlook ahk_exe OUTLOOK.EXE"),
+	_T("Visual Studio Code ahk_exe Code.exe"),
+	_T("Windows PowerShell ahk_class ConsoleWindowClass"),
+	_T("ahk_exe explorer.exe ahk_class Progman"),
+	_T("Calculator"),
+};
+static const int sGroupSize = sizeof(sGroup) / sizeof(*sGroup);
+
+template<typename Get>
+static double Search(std::vector<SyntheticWindow> &aWindows, int aRepeat, int &aMatches, Get aGet)
+{
+	unit::Timer timer;
+	aMatches = 0;
+	for (int r = 0; r < aRepeat; ++r)
+		for (auto &w : aWindows)
+			for (int s = 0; s < sGroupSize; ++s)
+			{
+				WinTitleCriteria *c = aGet(sGroup[s]);
+				bool match = c->IsMatch(FIND_IN_LEADING_PART, w.title.c_str(), w.class_name.c_str(), w.exe.c_str()
+					, [](LPCTSTR, LPCTSTR) { return false; });
+				c->Release();
+				if (match)
+				{
+					++aMatches;
+					break;
+				}
+			}
+	return timer.Elapsed();
+}
+
+int main()
+{
+	static const wchar_t *classes[] = { L"Notepad", L"Chrome_WidgetWin_1", L"CabinetWClass", L"rctrl_renwnd32"
+		, L"ConsoleWindowClass", L"Progman", L"ApplicationFrameWindow", L"#32770" };
+	static const wchar_t *exes[] = { L"notepad.exe", L"chrome.exe", L"explorer.exe", L"OUTLOOK.EXE"
+		, L"conhost.exe", L"explorer.exe", L"ApplicationFrameHost.exe", L"setup.exe" };
+	std::vector<SyntheticWindow> windows(5000);
+	for (size_t i = 0; i < windows.size(); ++i)
+	{
+		windows[i].title = L"Window " + std::to_wstring(i) + L" - Some Application";
+		windows[i].class_name = classes[i % 8];
+		windows[i].exe = exes[i % 8];
+	}
+
+	const int repeat = 20;
+	const double evaluations = (double)repeat * windows.size();
+	int matches_compiled, matches_cached;
+	double t_compile = Search(windows, repeat, matches_compiled, [](LPCTSTR t) { return WinTitleCriteria::Compile(t); });
+	WinTitleCache cache;
+	double t_cached = Search(windows, repeat, matches_cached, [&](LPCTSTR t) { return cache.Get(t); });
+	if (matches_compiled != matches_cached)
+	{
+		printf("Mismatch: %d vs %d matches\n", matches_compiled, matches_cached);
+		return 1;
+	}
+	printf("%d windows x %d WinTitles, %d searches (%d matches per search):\n", (int)windows.size(), sGroupSize, repeat, matches_cached / repeat);
+	printf("  Compile each time: %7.1f ms per search, %6.1f ns per window\n", t_compile * 1000 / repeat, t_compile * 1e9 / evaluations);
+	printf("  WinTitleCache:     %7.1f ms per search, %6.1f ns per window\n", t_cached * 1000 / repeat, t_cached * 1e9 / evaluations);
+	return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+//
+// Stand-in for the part of defines.h which WinTitleCriteria.h uses.  defines.h depends on much of
+// the rest of the program, so its include guard is defined here to keep it out, and the definition
+// below is copied from it.
+//
+
+#define defines_h
+
+enum TitleMatchModes {MATCHMODE_INVALID = 0, FIND_IN_LEADING_PART = 1, FIND_ANYWHERE = 2, FIND_EXACT = 3, FIND_REGEX, FIND_FAST, FIND_SLOW};
@@ -0,0 +1,204 @@
+//
+// Tests for WinTitleCriteria and WinTitleCache.  The expected results follow the rules which
+// WindowSearch::SetCriteria() applied when it parsed WinTitle itself.
+//
+
+#include "WinTitleCriteria.h"
+#include "unit.h"
+#include <string>
+
+static std::wstring S(LPCTSTR aValue) { return aValue; }
+
+struct Compiled
+{
+	WinTitleCriteria *c;
+	Compiled(LPCTSTR aWinTitle) : c(WinTitleCriteria::Compile(aWinTitle)) {}
+	~Compiled() { c->Release(); }
+	WinTitleCriteria *operator->() { return c; }
+};
+
+
+TEST(TitleOnly)
+{
+	Compiled c(_T("Untitled - Notepad"));
+	CHECK_EQ(c->criteria, (DWORD)CRITERION_TITLE);
+	CHECK(S(c->title) == L"Untitled - Notepad");
+	CHECK_EQ(c->title_length, (size_t)18);
+}
+
+TEST(EmptyTitle)
+{
+	// An empty WinTitle has a blank title criterion, which IsMatch() treats as matching anything.
+	Compiled c(_T(""));
+	CHECK_EQ(c->criteria, (DWORD)CRITERION_TITLE);
+	CHECK(S(c->title) == L"");
+	Compiled ws(_T("  "));
+	CHECK_EQ(ws->criteria, (DWORD)CRITERION_TITLE);
+	CHECK(S(ws->title) == L"");
+}
+
+TEST(TitleAndKeywords)
+{
+	Compiled c(_T("My Window ahk_class Notepad ahk_exe notepad.exe"));
+	CHECK_EQ(c->criteria, (DWORD)(CRITERION_TITLE | CRITERION_CLASS | CRITERION_PATH));
+	CHECK(S(c->title) == L"My Window");
+	CHECK_EQ(c->title_length, (size_t)9);
+	CHECK(S(c->class_name) == L"Notepad");
+	CHECK(S(c->path) == L"notepad.exe");
+	CHECK(!c->path_has_backslash);
+}
+
+TEST(OnlyOneDelimiterIsOmitted)
+{
+	// Spaces to the left of the delimiting space are part of the value; leading ones are not.
+	Compiled c(_T("  Title   ahk_class  Cls \tahk_pid 12"));
+	CHECK(S(c->title) == L"Title  ");
+	CHECK(S(c->class_name) == L"Cls ");
+	CHECK(S(c->pid) == L" 12");
+}
+
+TEST(WhitespaceTitleIsNotACriterion)
+{
+	Compiled c(_T("   ahk_class X"));
+	CHECK_EQ(c->criteria, (DWORD)CRITERION_CLASS);
+	CHECK(S(c->class_name) == L"X");
+}
+
+TEST(EmptyKeywordValue)
+{
+	Compiled c(_T("ahk_class ahk_exe"));
+	CHECK_EQ(c->criteria, (DWORD)(CRITERION_CLASS | CRITERION_PATH));
+	CHECK(S(c->class_name) == L"");
+	CHECK(S(c->path) == L"");
+}
+
+TEST(KeywordMustFollowWhitespace)
+{
+	Compiled c(_T("xahk_class Y"));
+	CHECK_EQ(c->criteria, (DWORD)CRITERION_TITLE);
+	CHECK(S(c->title) == L"xahk_class Y");
+	Compiled u(_T("Title ahk_unknown ahk_CLASS Z"));
+	CHECK_EQ(u->criteria, (DWORD)(CRITERION_TITLE | CRITERION_CLASS));
+	CHECK(S(u->title) == L"Title ahk_unknown");
+	CHECK(S(u->class_name) == L"Z");
+}
+
+TEST(KeywordsAreCaseInsensitive)
+{
+	Compiled c(_T("AHK_EXE C:\\Windows\\notepad.exe Ahk_Group g"));
+	CHECK_EQ(c->criteria, (DWORD)(CRITERION_PATH | CRITERION_GROUP));
+	CHECK(S(c->path) == L"C:\\Windows\\notepad.exe");
+	CHECK(c->path_has_backslash);
+	CHECK(S(c->group) == L"g");
+}
+
+TEST(Numbers)
+{
+	Compiled c(_T("ahk_id 0x1234 ahk_pid 42 ahk_id 4660 ahk_pid 43"));
+	CHECK_EQ(c->criteria, (DWORD)(CRITERION_ID | CRITERION_PID));
+	CHECK_EQ(c->id_count, 2);
+	CHECK(S(c->id) == L" 0x1234 "); // The caller converts the text as it would have the original string.
+	CHECK(S(c->id + wcslen(c->id) + 1) == L" 4660 ");
+	CHECK(S(c->pid) == L" 43"); // The last one is used.
+	Compiled joined(_T("ahk_id0x10"));
+	CHECK_EQ(joined->criteria, (DWORD)CRITERION_ID);
+	CHECK(S(joined->id) == L"0x10");
+}
+
+TEST(LaterValuesOverride)
+{
+	Compiled c(_T("ahk_class A ahk_class B"));
+	CHECK(S(c->class_name) == L"B");
+}
+
+TEST(CacheReturnsSameCriteria)
+{
+	WinTitleCache cache;
+	auto a = cache.Get(_T("ahk_class Notepad"));
+	auto b = cache.Get(_T("ahk_class Notepad"));
+	auto other = cache.Get(_T("ahk_class notepad")); // Titles and classes are case-sensitive.
+	CHECK(a == b);
+	CHECK(a != other);
+	CHECK(S(other->class_name) == L"notepad");
+	a->Release();
+	b->Release();
+	other->Release();
+}
+
+TEST(EvictedCriteriaRemainValid)
+{
+	// A search keeps its criteria even if evaluating a group compiles enough other WinTitles to
+	// evict them from the cache.
+	WinTitleCache cache;
+	auto held = cache.Get(_T("Outer ahk_group G"));
+	for (int i = 0; i < 10 * WinTitleCache::Size; ++i)
+	{
+		wchar_t title[32];
+		swprintf(title, 32, L"Window %d", i);
+		auto c = cache.Get(title);
+		CHECK(S(c->title) == title);
+		c->Release();
+	}
+	CHECK(S(held->title) == L"Outer");
+	CHECK(S(held->group) == L"G");
+	held->Release();
+	cache.Clear();
+	auto again = cache.Get(_T("Outer ahk_group G"));
+	CHECK(S(again->group) == L"G");
+	again->Release();
+}
+
+TEST(MatchTitleModes)
+{
+	auto no_regex = [](LPCTSTR, LPCTSTR) { CHECK(!"RegEx not expected"); return false; };
+	Compiled c(_T("Notepad"));
+	CHECK(c->IsMatch(FIND_IN_LEADING_PART, _T("Notepad - file.txt"), _T(""), _T(""), no_regex));
+	CHECK(!c->IsMatch(FIND_IN_LEADING_PART, _T("file.txt - Notepad"), _T(""), _T(""), no_regex));
+	CHECK(c->IsMatch(FIND_ANYWHERE, _T("file.txt - Notepad"), _T(""), _T(""), no_regex));
+	CHECK(!c->IsMatch(FIND_ANYWHERE, _T("file.txt - notepad"), _T(""), _T(""), no_regex));
+	CHECK(c->IsMatch(FIND_EXACT, _T("Notepad"), _T(""), _T(""), no_regex));
+	CHECK(!c->IsMatch(FIND_EXACT, _T("Notepad "), _T(""), _T(""), no_regex));
+	// A blank title matches anything, without calling the RegEx matcher.
+	Compiled blank(_T(""));
+	CHECK(blank->IsMatch(FIND_EXACT, _T("Anything"), _T(""), _T(""), no_regex));
+	CHECK(blank->IsMatch(FIND_REGEX, _T("Anything"), _T(""), _T(""), no_regex));
+	CHECK(WinTitleCriteria::IsTitleMatch(_T("abc"), _T("abcd"), 4, FIND_IN_LEADING_PART) == false);
+	CHECK(WinTitleCriteria::IsTitleMatch(_T("abcd"), _T("bc"), 2, FIND_ANYWHERE));
+}
+
+TEST(MatchClassAndPath)
+{
+	auto no_regex = [](LPCTSTR, LPCTSTR) { CHECK(!"RegEx not expected"); return false; };
+	Compiled c(_T("Doc ahk_class Notepad ahk_exe notepad.exe"));
+	// Class is always an exact, case-sensitive match outside of RegEx mode; the path is exact but
+	// case-insensitive.  Neither is affected by the leading-part or anywhere modes.
+	CHECK(c->IsMatch(FIND_IN_LEADING_PART, _T("Document"), _T("Notepad"), _T("NOTEPAD.EXE"), no_regex));
+	CHECK(!c->IsMatch(FIND_IN_LEADING_PART, _T("Document"), _T("notepad"), _T("notepad.exe"), no_regex));
+	CHECK(!c->IsMatch(FIND_ANYWHERE, _T("Document"), _T("NotepadX"), _T("notepad.exe"), no_regex));
+	CHECK(!c->IsMatch(FIND_ANYWHERE, _T("Document"), _T("Notepad"), _T("notepad.exe2"), no_regex));
+	CHECK(!c->IsMatch(FIND_ANYWHERE, _T("Word"), _T("Notepad"), _T("notepad.exe"), no_regex));
+	// Attributes for absent criteria aren't compared.
+	Compiled exe_only(_T("ahk_exe notepad.exe"));
+	CHECK(exe_only->IsMatch(FIND_EXACT, _T("Whatever"), _T("Whatever"), _T("notepad.exe"), no_regex));
+}
+
+TEST(MatchRegEx)
+{
+	std::wstring calls;
+	auto regex = [&](LPCTSTR aSubject, LPCTSTR aPattern) {
+		calls += std::wstring(aPattern) + L"~" + aSubject + L";";
+		return *aSubject == *aPattern;
+	};
+	Compiled c(_T("T.* ahk_class C.* ahk_exe p.*"));
+	CHECK(c->IsMatch(FIND_REGEX, _T("Title"), _T("Class"), _T("path"), regex));
+	CHECK(calls == L"T.*~Title;C.*~Class;p.*~path;");
+	calls.clear();
+	CHECK(!c->IsMatch(FIND_REGEX, _T("Title"), _T("class"), _T("path"), regex));
+	CHECK(calls == L"T.*~Title;C.*~class;"); // Stops at the first mismatch.
+}
+
+
+int main()
+{
+	return RUN_TESTS();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//
+// Stand-in for the Windows and CRT headers normally included by source/stdafx.h, for building
+// the platform-independent parts of the source on other platforms.  The Makefile force-includes
+// this before each file (source/stdafx.h itself includes nothing but <algorithm> on compilers
+// other than MSVC).  It provides only the types and names which those parts use.  TCHAR is
+// wchar_t, as in the Unicode builds of AutoHotkey.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <alloca.h>
+#include <new>
+
+#define __int64 long long // A macro rather than a typedef so that "unsigned __int64" works.
+typedef unsigned char UCHAR, BYTE;
+typedef unsigned short USHORT, WORD;
+typedef unsigned int UINT, DWORD;
+typedef int INT, BOOL;
+typedef unsigned int ULONG;
+typedef int LONG;
+typedef uint64_t ULONGLONG, UINT64;
+typedef int64_t LONGLONG, INT64;
+typedef uintptr_t UINT_PTR, ULONG_PTR, DWORD_PTR;
+typedef intptr_t INT_PTR, LONG_PTR;
+typedef void *HANDLE, *HKL, *HWND;
+
+typedef wchar_t TCHAR, WCHAR;
+typedef char CHAR;
+typedef TCHAR *LPTSTR, *LPWSTR;
+typedef const TCHAR *LPCTSTR, *LPCWSTR;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+
+#define _T(x) L ## x
+#define TRUE 1
+#define FALSE 0
+#define UNICODE
+#define _UNICODE
+
+#define _tcslen wcslen
+#define _tcschr wcschr
+#define _tcsrchr wcsrchr
+#define _tcscmp wcscmp
+#define _tcsncmp wcsncmp
+#define _tcsicmp wcscasecmp
+#define _tcsnicmp wcsncasecmp
+#define _tcscpy wcscpy
+#define _tcsncpy wcsncpy
+#define _tcsstr wcsstr
+#define _tcstol wcstol
+#define _tcstoul wcstoul
+#define _tcstod wcstod
+#define _tcstoi64 wcstoll
+#define _tcstoui64 wcstoull
+#define _tcsdup wcsdup
+#define _totupper towupper
+#define _totlower towlower
+#define _istspace iswspace
+#define _istdigit iswdigit
+#define _istxdigit iswxdigit
+#define _istalpha iswalpha
+#define _istalnum iswalnum
+#define _alloca alloca
+#define _strdup strdup
+#define _stricmp strcasecmp
+
+#define tmemcpy wmemcpy
+#define tmemmove wmemmove
+#define tmemset wmemset
+#define tmemcmp wmemcmp
+
+#define __forceinline inline __attribute__((always_inline))
+#define UNREFERENCED_PARAMETER(x) ((void)(x))
+#define _I64_MAX INT64_MAX
@@ -0,0 +1,75 @@
+#pragma once
+
+//
+// unit.h - Minimal assertion and timing helpers for the platform-independent unit tests.
+//
+// Each test program defines its tests with TEST(name) and calls RUN_TESTS() from main().
+// Failed checks are reported with their location; the exit code is the number of failures.
+//
+
+#include <stdio.h>
+#include <chrono>
+
+namespace unit
+{
+	struct Test
+	{
+		const char *name;
+		void (*func)();
+		Test *next;
+	};
+
+	inline Test *&Head() { static Test *head = nullptr; return head; }
+	inline int &Failures() { static int failures = 0; return failures; }
+
+	struct Registrar
+	{
+		Test test;
+		Registrar(const char *aName, void (*aFunc)())
+		{
+			test = { aName, aFunc, nullptr };
+			Test **tail = &Head();
+			while (*tail)
+				tail = &(*tail)->next;
+			*tail = &test;
+		}
+	};
+
+	inline int RunAll()
+	{
+		int failed_tests = 0;
+		for (Test *t = Head(); t; t = t->next)
+		{
+			int before = Failures();
+			t->func();
+			if (Failures() != before)
+				++failed_tests, printf("FAILED: %s\n", t->name);
+		}
+		printf("%d test(s) failed, %d check(s) failed\n", failed_tests, Failures());
+		return Failures() ? 1 : 0;
+	}
+
+	// Returns the elapsed time in seconds since the timer was constructed.
+	class Timer
+	{
+		std::chrono::steady_clock::time_point mStart = std::chrono::steady_clock::now();
+	public:
+		double Elapsed() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count(); }
+	};
+
+	// Prevents the compiler from optimizing away a value computed only for timing.
+	template<typename T> inline void Use(const T &aValue) { asm volatile("" : : "g"(&aValue) : "memory"); }
+}
+
+#define TEST(name) \
+	static void test_##name(); \
+	static unit::Registrar registrar_##name(#name, test_##name); \
+	static void test_##name()
+
+#define CHECK(cond) \
+	((cond) ? (void)0 : (void)(++unit::Failures(), printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #cond)))
+
+#define CHECK_EQ(a, b) \
+	(((a) == (b)) ? (void)0 : (void)(++unit::Failures(), printf("%s(%d): CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__, #a, #b)))
+
+#define RUN_TESTS() unit::RunAll()